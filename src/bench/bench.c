@@ -0,0 +1,4 @@
+#include "types.h"
+#include "bench.h"
+
+U32 Bench_Scratch[BENCH_SCRATCH_SIZE / sizeof(U32)];
@@ -0,0 +1,37 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "types.h"
+
+/* On-target benchmarks. They print their results with printf (SWO) and are run from the boot    */
+/* task when BENCH_ENABLED is set to 1.                                                           */
+#ifndef BENCH_ENABLED
+#define BENCH_ENABLED                      (0)
+#endif
+
+/* The benchmarks run one after the other and share one static area for their buffers, each one
+   lays it out with a struct of its own. With separate buffers the bench build would not fit in
+   the 20 kB of SRAM.                                                                             */
+#define BENCH_SCRATCH_SIZE                 (2048)
+
+extern U32 Bench_Scratch[BENCH_SCRATCH_SIZE / sizeof(U32)];
+
+/* The scratch area as a 'type', which must fit in it: the array size is negative otherwise */
+#define BENCH_SCRATCH(type) \
+  ((type *)Bench_Scratch + 0 * sizeof(char[(sizeof(type) <= BENCH_SCRATCH_SIZE) ? 1 : -1]))
+
+void Bench_GPIO(void);
+void Bench_RamFunc(void);
+void Bench_IRQ(void);
+void Bench_ADC(void);
+void Bench_DSP(void);
+void Bench_FFT(void);
+void Bench_Math(void);
+void Bench_AHRS(void);
+void Bench_Control(void);
+void Bench_Wave(void);
+void Bench_Logic(void);
+void Bench_CAN(void);
+void Bench_DMA(void);
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,100 @@
+#include <stdio.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "adc.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define BENCH_ADC_FRAMES                   (128)
+#define BENCH_ADC_DECIMATION               (4)
+#define BENCH_ADC_TIME                     (100)
+
+/* Internal channels, nothing has to be connected: 16 - temperature sensor, 17 - Vref */
+static const U8 Bench_AdcChannels[] = {17, 16};
+
+typedef struct
+{
+  U16 Ring[ADC_RING_SIZE(2, BENCH_ADC_FRAMES)];
+  U16 Out[ADC_OUT_SIZE(2, BENCH_ADC_FRAMES, BENCH_ADC_DECIMATION)];
+} Bench_AdcBuffers;
+
+static volatile U32 Bench_AdcFrames = 0;
+
+static const U32 Bench_AdcRates[] = {50000, 100000, 200000, 400000, 600000, 800000, 1000000};
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_AdcBlock(const ADC_Block * pBlock, void * pContext)
+{
+  Bench_AdcFrames += pBlock->Frames * (U32)pContext;
+  ADC_Release(pBlock);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Runs the engine for BENCH_ADC_TIME ticks and reports the frame rate that actually arrived.
+   Above the conversion limit the ADC ignores the triggers it gets while busy, so the measured
+   rate stops following the programmed one.                                                       */
+
+static void bench_AdcRun(U32 rate, U32 channels, U32 decimation)
+{
+  Bench_AdcBuffers * pBuffers = BENCH_SCRATCH(Bench_AdcBuffers);
+  ADC_Config config;
+  ADC_Stats stats;
+  U32 frames;
+
+  config.pChannels  = Bench_AdcChannels;
+  config.Channels   = channels;
+  config.SampleTime = ADC_SAMPLE_1CYCLE5;
+  config.Decimation = decimation;
+  config.Frames     = BENCH_ADC_FRAMES;
+  config.Rate       = rate;
+  config.pRing      = pBuffers->Ring;
+  config.pOut       = pBuffers->Out;
+  config.pCallback  = bench_AdcBlock;
+  config.pContext   = (void *)decimation;
+
+  if (FALSE == ADC_Init(&config)) return;
+
+  Bench_AdcFrames = 0;
+  ADC_Start();
+  vTaskDelay(BENCH_ADC_TIME);
+  ADC_Stop();
+
+  frames = Bench_AdcFrames * (configTICK_RATE_HZ / BENCH_ADC_TIME);
+  ADC_GetStats(&stats);
+
+  printf("  %d ch /%-2d %8d %8d %6d", channels, decimation, ADC_GetRate(), frames, stats.Dropped);
+#if (1 == ADC_PROFILE)
+  if (0 < stats.Samples)
+  {
+    printf(" %4d.%02d", stats.Cycles / stats.Samples, (stats.Cycles * 100 / stats.Samples) % 100);
+  }
+#endif
+  printf("\r\n");
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_ADC(void)
+{
+  U32 i;
+
+  printf("ADC acquisition at %d Hz, frames/s\r\n", SystemCoreClock);
+  printf("  %-8s %8s %8s %6s", "", "timer", "received", "drops");
+#if (1 == ADC_PROFILE)
+  printf(" %7s", "cyc/smp");
+#endif
+  printf("\r\n");
+
+  for (i = 0; i < (sizeof(Bench_AdcRates) / sizeof(Bench_AdcRates[0])); i++)
+  {
+    bench_AdcRun(Bench_AdcRates[i], 1, BENCH_ADC_DECIMATION);
+  }
+
+  bench_AdcRun(100000, 2, 1);
+  bench_AdcRun(100000, 2, BENCH_ADC_DECIMATION);
+}
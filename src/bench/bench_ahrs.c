@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "dsp.h"
+#include "matrix.h"
+#include "quat.h"
+#include "ahrs.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define BENCH_AHRS_RATE                    (200)
+#define BENCH_AHRS_SAMPLES                 (400)
+#define BENCH_AHRS_BETA                    (0.04f)
+#define BENCH_AHRS_KP                      (1.0f)
+#define BENCH_AHRS_KI                      (0.05f)
+#define BENCH_AHRS_CALLS                   (64)
+
+/* Float reference of the same filters, the fixed-point output is compared against it */
+typedef struct
+{
+  float W;
+  float X;
+  float Y;
+  float Z;
+} Bench_QuatF;
+
+/* Constant body rate (rad/s) with a gyroscope bias on X, the attitude at t is exp(w t / 2) */
+static const float Bench_AHRSRate[3] = {0.5f, -0.3f, 0.8f};
+static const float Bench_AHRSBias    = 0.02f;
+
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_NormalizeF(Bench_QuatF * pQ)
+{
+  float n = 1.0f / sqrtf(pQ->W * pQ->W + pQ->X * pQ->X + pQ->Y * pQ->Y + pQ->Z * pQ->Z);
+
+  pQ->W *= n;
+  pQ->X *= n;
+  pQ->Y *= n;
+  pQ->Z *= n;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_IntegrateF(Bench_QuatF * pQ, const float * pRate, const float * pStep, float dt)
+{
+  float w = pQ->W, x = pQ->X, y = pQ->Y, z = pQ->Z;
+
+  pQ->W += (0.5f * (-x * pRate[0] - y * pRate[1] - z * pRate[2]) - pStep[0]) * dt;
+  pQ->X += (0.5f * ( w * pRate[0] + y * pRate[2] - z * pRate[1]) - pStep[1]) * dt;
+  pQ->Y += (0.5f * ( w * pRate[1] - x * pRate[2] + z * pRate[0]) - pStep[2]) * dt;
+  pQ->Z += (0.5f * ( w * pRate[2] + x * pRate[1] - y * pRate[0]) - pStep[3]) * dt;
+  bench_NormalizeF(pQ);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_MadgwickF(Bench_QuatF * pQ, const float * pGyro, const float * pAccel)
+{
+  float w = pQ->W, x = pQ->X, y = pQ->Y, z = pQ->Z;
+  float n, f1, f2, f3, s[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+  n  = 1.0f / sqrtf(pAccel[0] * pAccel[0] + pAccel[1] * pAccel[1] + pAccel[2] * pAccel[2]);
+  f1 = 2.0f * (x * z - w * y) - pAccel[0] * n;
+  f2 = 2.0f * (w * x + y * z) - pAccel[1] * n;
+  f3 = 1.0f - 2.0f * (x * x + y * y) - pAccel[2] * n;
+
+  s[0] = -2.0f * y * f1 + 2.0f * x * f2;
+  s[1] =  2.0f * z * f1 + 2.0f * w * f2 - 4.0f * x * f3;
+  s[2] = -2.0f * w * f1 + 2.0f * z * f2 - 4.0f * y * f3;
+  s[3] =  2.0f * x * f1 + 2.0f * y * f2;
+
+  n = sqrtf(s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3]);
+  if (0.0f < n)
+  {
+    n = BENCH_AHRS_BETA / n;
+    s[0] *= n;
+    s[1] *= n;
+    s[2] *= n;
+    s[3] *= n;
+  }
+
+  bench_IntegrateF(pQ, pGyro, s, 1.0f / BENCH_AHRS_RATE);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_MahonyF(Bench_QuatF * pQ, float * pBias, const float * pGyro,
+                          const float * pAccel)
+{
+  static const float none[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  float w = pQ->W, x = pQ->X, y = pQ->Y, z = pQ->Z;
+  float n, a[3], v[3], e[3], rate[3];
+  U32 i;
+
+  n = 1.0f / sqrtf(pAccel[0] * pAccel[0] + pAccel[1] * pAccel[1] + pAccel[2] * pAccel[2]);
+  for (i = 0; i < 3; i++) a[i] = pAccel[i] * n;
+
+  v[0] = 2.0f * (x * z - w * y);
+  v[1] = 2.0f * (w * x + y * z);
+  v[2] = w * w - x * x - y * y + z * z;
+
+  e[0] = a[1] * v[2] - a[2] * v[1];
+  e[1] = a[2] * v[0] - a[0] * v[2];
+  e[2] = a[0] * v[1] - a[1] * v[0];
+
+  for (i = 0; i < 3; i++)
+  {
+    pBias[i] += BENCH_AHRS_KI * e[i] / BENCH_AHRS_RATE;
+    rate[i]   = pGyro[i] + BENCH_AHRS_KP * e[i] + pBias[i];
+  }
+
+  bench_IntegrateF(pQ, rate, none, 1.0f / BENCH_AHRS_RATE);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Sample i, computed when it is needed rather than kept in a table: gyroscope in Q16.16,
+   accelerometer as a 14-bit sensor would report 1 g. The latter is the third row of the rotation
+   matrix of the true attitude, that is the earth vertical seen from the body.                    */
+
+static void bench_AHRSInput(U32 i, Vec3 * pGyro, Vec3 * pAccel)
+{
+  double norm, angle, s, w, x, y, z;
+
+  norm = sqrt(Bench_AHRSRate[0] * Bench_AHRSRate[0] + Bench_AHRSRate[1] * Bench_AHRSRate[1] +
+              Bench_AHRSRate[2] * Bench_AHRSRate[2]);
+
+  angle = norm * (i + 1) / BENCH_AHRS_RATE / 2.0;
+  s = sin(angle) / norm;
+  w = cos(angle);
+  x = Bench_AHRSRate[0] * s;
+  y = Bench_AHRSRate[1] * s;
+  z = Bench_AHRSRate[2] * s;
+
+  pGyro->X = Q16(Bench_AHRSRate[0] + Bench_AHRSBias);
+  pGyro->Y = Q16(Bench_AHRSRate[1]);
+  pGyro->Z = Q16(Bench_AHRSRate[2]);
+
+  pAccel->X = (S32)(16384.0 * 2.0 * (x * z - w * y));
+  pAccel->Y = (S32)(16384.0 * 2.0 * (w * x + y * z));
+  pAccel->Z = (S32)(16384.0 * (w * w - x * x - y * y + z * z));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Largest component difference in millionths */
+
+static U32 bench_AHRSError(const Quat * pQ, const Bench_QuatF * pRef)
+{
+  double d[4];
+  U32 i, error, maxError = 0;
+
+  d[0] = (double)pQ->W / QUAT_ONE - pRef->W;
+  d[1] = (double)pQ->X / QUAT_ONE - pRef->X;
+  d[2] = (double)pQ->Y / QUAT_ONE - pRef->Y;
+  d[3] = (double)pQ->Z / QUAT_ONE - pRef->Z;
+
+  for (i = 0; i < 4; i++)
+  {
+    error = (U32)(1000000.0 * fabs(d[i]));
+    if (maxError < error) maxError = error;
+  }
+
+  return maxError;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_AHRSPrint(const char * pName, U32 cycles, U32 error)
+{
+  printf("  %-9s %6d %7d %6d\r\n", pName, cycles, SystemCoreClock / cycles, error);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Both filters run over the same samples against their float twins. The update is timed on its
+   own, with the float reference run outside of the measurement.                                  */
+
+void Bench_AHRS(void)
+{
+  Madgwick madgwick;
+  Mahony mahony;
+  Bench_QuatF madgwickF = {1.0f, 0.0f, 0.0f, 0.0f};
+  Bench_QuatF mahonyF   = {1.0f, 0.0f, 0.0f, 0.0f};
+  float biasF[3] = {0.0f, 0.0f, 0.0f};
+  float gyro[3], accel[3];
+  Vec3 gyroQ, accelQ;
+  Quat a, b;
+  Mat3 m, n;
+  U32 i, cycles, madgwickCycles = 0, mahonyCycles = 0, madgwickError = 0, mahonyError = 0;
+  U32 floatCycles = 0, error;
+
+  DWT_Init();
+
+  Madgwick_Init(&madgwick, BENCH_AHRS_RATE, Q30(BENCH_AHRS_BETA));
+  Mahony_Init(&mahony, BENCH_AHRS_RATE, Q16(BENCH_AHRS_KP), Q16(BENCH_AHRS_KI));
+
+  for (i = 0; i < BENCH_AHRS_SAMPLES; i++)
+  {
+    bench_AHRSInput(i, &gyroQ, &accelQ);
+
+    taskENTER_CRITICAL();
+    cycles = DWT_Cycles();
+    Madgwick_Update(&madgwick, &gyroQ, &accelQ);
+    cycles = DWT_Cycles() - cycles;
+    taskEXIT_CRITICAL();
+    if (madgwickCycles < cycles) madgwickCycles = cycles;
+
+    taskENTER_CRITICAL();
+    cycles = DWT_Cycles();
+    Mahony_Update(&mahony, &gyroQ, &accelQ);
+    cycles = DWT_Cycles() - cycles;
+    taskEXIT_CRITICAL();
+    if (mahonyCycles < cycles) mahonyCycles = cycles;
+
+    gyro[0]  = gyroQ.X / 65536.0f;
+    gyro[1]  = gyroQ.Y / 65536.0f;
+    gyro[2]  = gyroQ.Z / 65536.0f;
+    accel[0] = (float)accelQ.X;
+    accel[1] = (float)accelQ.Y;
+    accel[2] = (float)accelQ.Z;
+
+    taskENTER_CRITICAL();
+    cycles = DWT_Cycles();
+    bench_MadgwickF(&madgwickF, gyro, accel);
+    cycles = DWT_Cycles() - cycles;
+    taskEXIT_CRITICAL();
+    if (floatCycles < cycles) floatCycles = cycles;
+
+    bench_MahonyF(&mahonyF, biasF, gyro, accel);
+
+    error = bench_AHRSError(&madgwick.Q, &madgwickF);
+    if (madgwickError < error) madgwickError = error;
+    error = bench_AHRSError(&mahony.Q, &mahonyF);
+    if (mahonyError < error) mahonyError = error;
+  }
+
+  printf("AHRS at %d Hz, %d samples: worst-case cycles per update, max rate (Hz), max error vs "
+         "float in 1e-6\r\n", BENCH_AHRS_RATE, BENCH_AHRS_SAMPLES);
+  printf("  %-9s %6s %7s %6s\r\n", "", "cycles", "rate", "error");
+  bench_AHRSPrint("madgwick", madgwickCycles, madgwickError);
+  bench_AHRSPrint("mahony", mahonyCycles, mahonyError);
+  bench_AHRSPrint("madgwickf", floatCycles, 0);
+
+  /* Building blocks, average cycles per call */
+  a = madgwick.Q;
+  b = mahony.Q;
+  Quat_ToMatrix(&m, &a);
+  Quat_ToMatrix(&n, &b);
+
+  taskENTER_CRITICAL();
+  cycles = DWT_Cycles();
+  for (i = 0; i < BENCH_AHRS_CALLS; i++) Quat_Mul(&a, &a, &b);
+  cycles = DWT_Cycles() - cycles;
+  taskEXIT_CRITICAL();
+  printf("  quat mul %d", cycles / BENCH_AHRS_CALLS);
+
+  taskENTER_CRITICAL();
+  cycles = DWT_Cycles();
+  for (i = 0; i < BENCH_AHRS_CALLS; i++) (void)Quat_Normalize(&a);
+  cycles = DWT_Cycles() - cycles;
+  taskEXIT_CRITICAL();
+  printf(", normalize %d", cycles / BENCH_AHRS_CALLS);
+
+  taskENTER_CRITICAL();
+  cycles = DWT_Cycles();
+  for (i = 0; i < BENCH_AHRS_CALLS; i++) Mat3_Mul(&m, &m, &n, QUAT_FRAC);
+  cycles = DWT_Cycles() - cycles;
+  taskEXIT_CRITICAL();
+  printf(", mat3 mul %d\r\n", cycles / BENCH_AHRS_CALLS);
+}
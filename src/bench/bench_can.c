@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "can.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* The controller runs in silent loopback: it receives its own frames and nothing reaches the
+   pins, no transceiver or bus is needed. The filters mix every kind of entry over both FIFOs;
+   each frame sent is checked against CAN_Match() run on the same list, then the bus is saturated
+   with 8-byte frames and a high priority frame is sent behind a full queue of low ones.          */
+
+#define BENCH_CAN_BITRATE                  (1000000)
+#define BENCH_CAN_RING                     (32)
+#define BENCH_CAN_FRAMES                   (4000)
+#define BENCH_CAN_TIMEOUT                  (2000)
+#define BENCH_CAN_LOW                      (0x600)
+#define BENCH_CAN_HIGH                     (0x010)
+
+static const CAN_Filter Bench_CANFilters[] =
+{
+  {0x100, 0xFFFFFFFF, 0}, {0x101, 0xFFFFFFFF, 0}, {0x102, 0xFFFFFFFF, 0}, {0x103, 0xFFFFFFFF, 0},
+  {0x104, 0xFFFFFFFF, 0},
+  {0x200, 0x7F0, 0},
+  {CAN_ID_EXT | 0x18DAF110, 0xFFFFFFFF, 0},
+  {CAN_ID_EXT | 0x18FF0000, 0x1FFF0000 | CAN_ID_RTR, 1},
+  {0x7E8, 0xFFFFFFFF, 1},
+  {BENCH_CAN_LOW, 0x7F0 | CAN_ID_RTR, 1},
+  {BENCH_CAN_HIGH, 0xFFFFFFFF, 1}
+};
+
+static const U32 Bench_CANIds[] =
+{
+  0x100, 0x103, 0x104, 0x105, 0x0FF, 0x100 | CAN_ID_RTR, 0x200, 0x20F, 0x210, 0x205 | CAN_ID_RTR,
+  0x7E8, 0x7E9, 0x7E8 | CAN_ID_RTR, 0x60A, 0x610, 0x010, 0x011, CAN_ID_EXT | 0x18DAF110,
+  CAN_ID_EXT | 0x18DAF111, CAN_ID_EXT | 0x100, CAN_ID_EXT | 0x18FF1234, CAN_ID_EXT | 0x18FEFFFF,
+  CAN_ID_EXT | CAN_ID_RTR | 0x18FF0001, CAN_ID_EXT | 0x18DAF110 | CAN_ID_RTR
+};
+
+#define BENCH_CAN_IDS                      (sizeof(Bench_CANIds) / sizeof(Bench_CANIds[0]))
+#define BENCH_CAN_FILTERS                  (sizeof(Bench_CANFilters) / sizeof(Bench_CANFilters[0]))
+
+typedef struct
+{
+  CAN_Frame Ring[BENCH_CAN_RING];
+} Bench_CANBuffers;
+
+static CAN_Banks Bench_CANBanks;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Sends the frame, waiting for room in the queue */
+
+static U32 bench_CANSend(U32 id, U32 sequence, U32 length)
+{
+  CAN_Frame frame;
+  TickType_t start = xTaskGetTickCount();
+
+  frame.Id     = id;
+  frame.Length = (U8)length;
+  memset(frame.Data, 0, sizeof(frame.Data));
+  memcpy(frame.Data, &sequence, sizeof(sequence));
+
+  while (FALSE == CAN_Send(&frame))
+  {
+    if (BENCH_CAN_TIMEOUT < xTaskGetTickCount() - start) return FALSE;
+    taskYIELD();
+  }
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Every identifier is sent once with its index in the data. The frames the model accepts must
+   come back, with its FIFO and filter; the others must not.                                      */
+
+static void bench_CANFilters(void)
+{
+  CAN_Frame * pFrames;
+  U32 wanted = 0, received = 0, errors = 0, fifo, filter, index, n, i;
+
+  for (i = 0; i < BENCH_CAN_IDS; i++)
+  {
+    if (FALSE != CAN_Match(&Bench_CANBanks, Bench_CANIds[i], &fifo, &filter)) wanted++;
+    if (FALSE == bench_CANSend(Bench_CANIds[i], i, 4)) errors++;
+  }
+  vTaskDelay(10);
+
+  while (0 != (n = CAN_GetRead(&pFrames)))
+  {
+    for (i = 0; i < n; i++)
+    {
+      memcpy(&index, pFrames[i].Data, sizeof(index));
+      received++;
+      if ((BENCH_CAN_IDS <= index) || (pFrames[i].Id != Bench_CANIds[index]) ||
+          (FALSE == CAN_Match(&Bench_CANBanks, pFrames[i].Id, &fifo, &filter)) ||
+          (pFrames[i].Filter != filter))
+      {
+        errors++;
+      }
+    }
+    CAN_Consume(n);
+  }
+
+  printf("  filters  %d entries in %d banks, %d frames sent, %d wanted, %d received, errors %d\r\n",
+         (U32)BENCH_CAN_FILTERS, Bench_CANBanks.Banks, (U32)BENCH_CAN_IDS, wanted, received,
+         errors + wanted - received);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* One task sends and reads: the ring is read whenever the queue is full. Frames of the same
+   identifier keep their order, a gap in the sequence is a lost frame.                           */
+
+static void bench_CANThroughput(void)
+{
+  CAN_Frame * pFrames;
+  CAN_Stats stats;
+  TickType_t start, ticks;
+  U32 sent = 0, received = 0, errors = 0, sequence, n, i;
+
+  start = xTaskGetTickCount();
+  while ((received < BENCH_CAN_FRAMES) && (BENCH_CAN_TIMEOUT > xTaskGetTickCount() - start))
+  {
+    while ((sent < BENCH_CAN_FRAMES) && (0 != CAN_GetTxFree()))
+    {
+      bench_CANSend(0x100, sent++, 8);
+    }
+
+    n = CAN_GetRead(&pFrames);
+    for (i = 0; i < n; i++)
+    {
+      memcpy(&sequence, pFrames[i].Data, sizeof(sequence));
+      if (sequence != received++) errors++;
+    }
+    CAN_Consume(n);
+  }
+  ticks = xTaskGetTickCount() - start;
+  if (0 == ticks) ticks = 1;
+
+  CAN_GetStats(&stats);
+  printf("  stream   %d frames of 8 bytes in %d ms, %d frames/s, errors %d, deferred %d, "
+         "overruns %d\r\n", received, ticks * portTICK_PERIOD_MS,
+         received * 1000 / (ticks * portTICK_PERIOD_MS), errors + BENCH_CAN_FRAMES - received,
+         stats.Deferred, stats.Overruns);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* With the mailboxes and the queue full of low priority frames, the high one should come out
+   right behind the frame on the bus: the lowest of the pending mailboxes is aborted for it       */
+
+static void bench_CANPriority(void)
+{
+  CAN_Frame * pFrames;
+  CAN_Stats stats;
+  U32 position = 0, count = 0, n, i;
+
+  for (i = 0; i < CAN_TX_QUEUE; i++) bench_CANSend(BENCH_CAN_LOW + (i % 0x10), i, 8);
+  bench_CANSend(BENCH_CAN_HIGH, 0, 8);
+  vTaskDelay(10);
+
+  while (0 != (n = CAN_GetRead(&pFrames)))
+  {
+    for (i = 0; i < n; i++)
+    {
+      if (BENCH_CAN_HIGH == pFrames[i].Id) position = count + 1;
+      count++;
+    }
+    CAN_Consume(n);
+  }
+
+  CAN_GetStats(&stats);
+  printf("  priority high frame received %d of %d, requeued %d\r\n", position, count,
+         stats.Requeued);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_CAN(void)
+{
+  Bench_CANBuffers * pBuffers = BENCH_SCRATCH(Bench_CANBuffers);
+  CAN_Config config;
+
+  config.Bitrate  = BENCH_CAN_BITRATE;
+  config.Mode     = CAN_MODE_SELFTEST;
+  config.Pins     = CAN_PINS_PB8_PB9;
+  config.pFilters = Bench_CANFilters;
+  config.Filters  = BENCH_CAN_FILTERS;
+  config.pRing    = pBuffers->Ring;
+  config.Frames   = BENCH_CAN_RING;
+  config.pNotify  = NULL;
+  config.pContext = NULL;
+
+  printf("CAN self test at %d bit/s\r\n", BENCH_CAN_BITRATE);
+
+  if ((FALSE == CAN_Compile(Bench_CANFilters, BENCH_CAN_FILTERS, &Bench_CANBanks)) ||
+      (FALSE == CAN_Init(&config)))
+  {
+    printf("  no controller\r\n");
+    return;
+  }
+
+  bench_CANFilters();
+  bench_CANThroughput();
+  bench_CANPriority();
+
+  CAN_Stop();
+}
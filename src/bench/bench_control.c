@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "dsp.h"
+#include "control.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define BENCH_CONTROL_RATE                 (1000)
+#define BENCH_CONTROL_STEPS                (1000)
+#define BENCH_CONTROL_SETPOINT             (10000)
+#define BENCH_CONTROL_CALLS                (256)
+
+/* Motor model at 1 kHz: the current follows the drive with 5 ms, the speed follows the current
+   with 50 ms. x = (current, speed), the output is the speed, the input the drive.                */
+static const StateSpace_Config Bench_ControlPlant =
+{
+  {{Q16(0.8), 0, 0, 0}, {Q16(0.02), Q16(0.98), 0, 0}},
+  {{Q16(0.2), 0}, {0, 0}},
+  {0, Q16(1.0), 0, 0},
+  {0, 0},
+  2, 1, 16,
+  Q31_MIN, Q31_MAX
+};
+
+/* Largest size: 4 states, 2 inputs, for the worst-case timing */
+static const StateSpace_Config Bench_ControlFull =
+{
+  {{Q16(0.5), Q16(0.1), Q16(-0.1), Q16(0.05)}, {Q16(0.1), Q16(0.6), Q16(0.1), 0},
+   {0, Q16(0.1), Q16(0.7), Q16(0.1)}, {Q16(0.05), 0, Q16(0.1), Q16(0.8)}},
+  {{Q16(0.1), Q16(-0.1)}, {Q16(0.2), 0}, {0, Q16(0.3)}, {Q16(0.1), Q16(0.1)}},
+  {Q16(1.0), Q16(0.5), Q16(-0.5), Q16(0.25)},
+  {Q16(0.1), 0},
+  4, 2, 16,
+  -32767, 32767
+};
+
+static const PID_Config Bench_ControlFree =
+{
+  PID_KP(2.0), PID_KI(40.0, BENCH_CONTROL_RATE), PID_KD(0.01, BENCH_CONTROL_RATE), 0,
+  PID_ALPHA(100, BENCH_CONTROL_RATE), -32767, 32767, 0
+};
+
+/* Same gains, the drive can not reach the step in one go: range and rate limits hold it */
+static const PID_Config Bench_ControlLimited =
+{
+  PID_KP(2.0), PID_KI(40.0, BENCH_CONTROL_RATE), PID_KD(0.01, BENCH_CONTROL_RATE), 0,
+  PID_ALPHA(100, BENCH_CONTROL_RATE), -12000, 12000, 200
+};
+
+static volatile S32   Bench_ControlSink;
+static volatile float Bench_ControlSinkF;
+
+/* Float twin of the PID, same structure and limits */
+typedef struct
+{
+  float Integral;
+  float Derivative;
+  float Measure;
+  float Output;
+} Bench_PIDF;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static float bench_PIDF(Bench_PIDF * pPid, const PID_Config * pConfig, float setpoint,
+                        float measure)
+{
+  float error = setpoint - measure, step, integral, output, low, high, result;
+
+  pPid->Derivative += (pPid->Measure - measure - pPid->Derivative) * pConfig->Alpha / 32768.0f;
+  pPid->Measure = measure;
+
+  step = pConfig->Ki / 16777216.0f * error;
+  integral = pPid->Integral + step;
+  if (integral > pConfig->OutMax) integral = (float)pConfig->OutMax;
+  if (integral < pConfig->OutMin) integral = (float)pConfig->OutMin;
+
+  output = (pConfig->Kp * error + pConfig->Kff * setpoint + pConfig->Kd * pPid->Derivative) /
+           65536.0f + integral;
+
+  low  = (float)pConfig->OutMin;
+  high = (float)pConfig->OutMax;
+  if (0 != pConfig->RateMax)
+  {
+    if (low  < pPid->Output - pConfig->RateMax) low  = pPid->Output - pConfig->RateMax;
+    if (high > pPid->Output + pConfig->RateMax) high = pPid->Output + pConfig->RateMax;
+  }
+  result = (output > high) ? high : ((output < low) ? low : output);
+
+  if (!(((output > result) && (0 < step)) || ((output < result) && (0 > step))))
+  {
+    pPid->Integral = integral;
+  }
+
+  pPid->Output = result;
+  return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Step from 0 to BENCH_CONTROL_SETPOINT: 10-90% rise time and 2% settling time in updates
+   (ms), overshoot in 1/10 %, largest difference of the drive to the float twin                   */
+
+static void bench_ControlStep(const char * pName, const PID_Config * pConfig)
+{
+  PID pid;
+  Bench_PIDF pidF = {0.0f, 0.0f, 0.0f, 0.0f};
+  StateSpace plant;
+  S32 drive = 0, speed, peak = 0, difference, maxDifference = 0;
+  U32 k, rise10 = 0, rise90 = 0, settle = 0;
+
+  PID_Init(&pid, pConfig);
+  StateSpace_Init(&plant, &Bench_ControlPlant);
+
+  for (k = 0; k < BENCH_CONTROL_STEPS; k++)
+  {
+    speed = StateSpace_Update(&plant, &drive);
+    drive = PID_Update(&pid, BENCH_CONTROL_SETPOINT, speed);
+
+    difference = abs(drive - (S32)lrintf(bench_PIDF(&pidF, pConfig, BENCH_CONTROL_SETPOINT,
+                                                   (float)speed)));
+    if (maxDifference < difference) maxDifference = difference;
+
+    if (peak < speed) peak = speed;
+    if ((0 == rise10) && (speed >= BENCH_CONTROL_SETPOINT / 10)) rise10 = k;
+    if ((0 == rise90) && (speed >= BENCH_CONTROL_SETPOINT * 9 / 10)) rise90 = k;
+    if (abs(speed - BENCH_CONTROL_SETPOINT) > BENCH_CONTROL_SETPOINT / 50) settle = k + 1;
+  }
+
+  printf("  %-8s %5d %5d %9d %5d %5d\r\n", pName, rise90 - rise10, settle,
+         (peak - BENCH_CONTROL_SETPOINT) * 1000 / BENCH_CONTROL_SETPOINT,
+         speed - BENCH_CONTROL_SETPOINT, maxDifference);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Pseudo-random setpoints and measurements over the whole +-2^16 range, so that every limit and
+   both branches of the anti-windup are taken. Worst case and average in cycles.                  */
+
+static void bench_ControlTiming(void)
+{
+  PID pid;
+  Bench_PIDF pidF = {0.0f, 0.0f, 0.0f, 0.0f};
+  StateSpace ss;
+  S32 input[STATESPACE_INPUTS_MAX];
+  U32 i, seed = 1, cycles, worst[3] = {0, 0, 0}, total[3] = {0, 0, 0};
+
+  PID_Init(&pid, &Bench_ControlLimited);
+  StateSpace_Init(&ss, &Bench_ControlFull);
+
+  for (i = 0; i < BENCH_CONTROL_CALLS; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    input[0] = (S32)(seed >> 15) - 0x10000;
+    seed = seed * 1664525 + 1013904223;
+    input[1] = (S32)(seed >> 15) - 0x10000;
+
+    taskENTER_CRITICAL();
+    cycles = DWT_Cycles();
+    Bench_ControlSink = PID_Update(&pid, input[0], input[1]);
+    cycles = DWT_Cycles() - cycles;
+    taskEXIT_CRITICAL();
+    total[0] += cycles;
+    if (worst[0] < cycles) worst[0] = cycles;
+
+    taskENTER_CRITICAL();
+    cycles = DWT_Cycles();
+    Bench_ControlSink = StateSpace_Update(&ss, input);
+    cycles = DWT_Cycles() - cycles;
+    taskEXIT_CRITICAL();
+    total[1] += cycles;
+    if (worst[1] < cycles) worst[1] = cycles;
+
+    taskENTER_CRITICAL();
+    cycles = DWT_Cycles();
+    Bench_ControlSinkF = bench_PIDF(&pidF, &Bench_ControlLimited, (float)input[0], (float)input[1]);
+    cycles = DWT_Cycles() - cycles;
+    taskEXIT_CRITICAL();
+    total[2] += cycles;
+    if (worst[2] < cycles) worst[2] = cycles;
+  }
+
+  printf("Controller update, cycles: worst, average\r\n");
+  printf("  PID            %5d %5d\r\n", worst[0], total[0] / BENCH_CONTROL_CALLS);
+  printf("  State space 4x2 %4d %5d\r\n", worst[1], total[1] / BENCH_CONTROL_CALLS);
+  printf("  PID float      %5d %5d\r\n", worst[2], total[2] / BENCH_CONTROL_CALLS);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_Control(void)
+{
+  DWT_Init();
+
+  printf("PID step response on a motor model at %d Hz, ms and 1/10 %%, drive vs float\r\n",
+         BENCH_CONTROL_RATE);
+  printf("  %-8s %5s %5s %9s %5s %5s\r\n", "", "rise", "settl", "overshoot", "error", "float");
+  bench_ControlStep("free", &Bench_ControlFree);
+  bench_ControlStep("limited", &Bench_ControlLimited);
+
+  bench_ControlTiming();
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "dma.h"
+#include "interrupts.h"
+#include "bench.h"
+
+/* DMA_Memcpy() against the C library memcpy on the same buffers, best of several runs: aligned
+   copies go by words, a destination off by one forces bytes, the last case reads from flash.
+   The chain then moves the buffer in pieces from the transfer callbacks alone, while the CPU
+   counts how often it gets around its own loop in the meantime.                                 */
+
+#define BENCH_DMA_BYTES                    (768)
+#define BENCH_DMA_RUNS                     (8)
+#define BENCH_DMA_LINKS                    (4)
+#define BENCH_DMA_TIMEOUT                  (1000000)
+#define BENCH_DMA_GUARD                    (0xA5)
+
+typedef void (*Bench_Copy)(void * pTo, const void * pFrom, U32 count);
+
+typedef struct
+{
+  const char * pName;
+  U32          Count;
+  U32          Offset;                     /* Of the destination                                  */
+  U32          Flash;                      /* Source in flash                                     */
+} Bench_DMACase;
+
+static const Bench_DMACase Bench_DMACases[] =
+{
+  {"aligned",    64,                  0, FALSE},
+  {"aligned",    256,                 0, FALSE},
+  {"aligned",    BENCH_DMA_BYTES,     0, FALSE},
+  {"halfwords",  BENCH_DMA_BYTES - 2, 2, FALSE},
+  {"bytes",      BENCH_DMA_BYTES - 1, 1, FALSE},
+  {"from flash", BENCH_DMA_BYTES,     0, TRUE}
+};
+
+typedef struct
+{
+  U32          Source[BENCH_DMA_BYTES / 4];
+  U32          Dest[BENCH_DMA_BYTES / 4 + 1];
+  DMA_Transfer Links[BENCH_DMA_LINKS];
+} Bench_DMABuffers;
+
+static volatile U32 Bench_DMADone;
+static volatile U32 Bench_DMAErrors;
+static volatile U32 Bench_DMAEnd;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_CPUCopy(void * pTo, const void * pFrom, U32 count)
+{
+  memcpy(pTo, pFrom, count);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Fastest run, or 0 if a copy came out wrong or wrote past its end */
+
+static U32 bench_DMATime(Bench_Copy pCopy, U8 * pTo, const U8 * pFrom, U32 count)
+{
+  Bench_DMABuffers * pBuffers = BENCH_SCRATCH(Bench_DMABuffers);
+  U32 best = 0xFFFFFFFF, start, cycles, i;
+
+  for (i = 0; i < BENCH_DMA_RUNS; i++)
+  {
+    memset(pBuffers->Dest, BENCH_DMA_GUARD, sizeof(pBuffers->Dest));
+    start = DWT_Cycles();
+    pCopy(pTo, pFrom, count);
+    cycles = DWT_Cycles() - start;
+
+    if ((0 != memcmp(pTo, pFrom, count)) || (BENCH_DMA_GUARD != pTo[count])) return 0;
+    if (cycles < best) best = cycles;
+  }
+
+  return best;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_DMALink(DMA_Transfer * pTransfer, U32 events)
+{
+  if (0 != (events & DMA_EVENT_ERROR)) Bench_DMAErrors++;
+  Bench_DMADone++;
+  if (NULL == pTransfer->pNext) Bench_DMAEnd = DWT_Cycles();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The pieces land in reverse order. The first three are started as one chain, the last one is
+   queued behind them while they run.                                                             */
+
+static void bench_DMAChain(void)
+{
+  Bench_DMABuffers * pBuffers = BENCH_SCRATCH(Bench_DMABuffers);
+  U32 words = BENCH_DMA_BYTES / 4 / BENCH_DMA_LINKS, channel, start, loops = 0, i, errors = 0;
+
+  channel = DMA_Claim(DMA_REQ_MEMORY, IRQ_PRIORITY_DMA, NULL, pBuffers->Links);
+  if (0 == channel)
+  {
+    printf("  chain    no free channel\r\n");
+    return;
+  }
+
+  memset(pBuffers->Dest, 0, sizeof(pBuffers->Dest));
+  for (i = 0; i < BENCH_DMA_LINKS; i++)
+  {
+    pBuffers->Links[i].Flags       = DMA_MEMORY_TO_MEMORY | DMA_WORDS | DMA_PRIORITY_LOW;
+    pBuffers->Links[i].pPeripheral = &pBuffers->Source[i * words];
+    pBuffers->Links[i].pMemory     = &pBuffers->Dest[(BENCH_DMA_LINKS - 1 - i) * words];
+    pBuffers->Links[i].Count       = (U16)words;
+    pBuffers->Links[i].pDone       = bench_DMALink;
+    pBuffers->Links[i].pContext    = NULL;
+    pBuffers->Links[i].pNext       = (BENCH_DMA_LINKS - 2 > i) ? &pBuffers->Links[i + 1] : NULL;
+  }
+  Bench_DMADone   = 0;
+  Bench_DMAErrors = 0;
+
+  start = DWT_Cycles();
+  DMA_Start(channel, &pBuffers->Links[0]);
+  DMA_Queue(channel, &pBuffers->Links[BENCH_DMA_LINKS - 1]);
+  while ((BENCH_DMA_LINKS > Bench_DMADone) && (BENCH_DMA_TIMEOUT > loops)) loops++;
+
+  for (i = 0; i < BENCH_DMA_LINKS; i++)
+  {
+    if (0 != memcmp(&pBuffers->Source[i * words],
+                    &pBuffers->Dest[(BENCH_DMA_LINKS - 1 - i) * words], words * 4))
+    {
+      errors++;
+    }
+  }
+
+  printf("  chain    %d x %d bytes, %d callbacks in %d cycles, CPU loop %d times, errors %d\r\n",
+         BENCH_DMA_LINKS, words * 4, Bench_DMADone, Bench_DMAEnd - start, loops,
+         errors + Bench_DMAErrors);
+
+  DMA_Abort(channel);
+  DMA_Release(channel);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_DMA(void)
+{
+  Bench_DMABuffers * pBuffers = BENCH_SCRATCH(Bench_DMABuffers);
+  const Bench_DMACase * pCase;
+  const U8 * pFrom;
+  U8 * pTo;
+  U32 mhz = SystemCoreClock / 1000000, cpu, dma, i;
+
+  DWT_Init();
+  for (i = 0; i < BENCH_DMA_BYTES / 4; i++) pBuffers->Source[i] = i * 0x9E3779B9U;
+
+  printf("DMA memcpy against memcpy, cycles and MB/s\r\n");
+  for (i = 0; i < sizeof(Bench_DMACases) / sizeof(Bench_DMACases[0]); i++)
+  {
+    pCase = &Bench_DMACases[i];
+    pFrom = (FALSE != pCase->Flash) ? (const U8 *)FLASH_BASE : (const U8 *)pBuffers->Source;
+    pTo   = (U8 *)pBuffers->Dest + pCase->Offset;
+
+    cpu = bench_DMATime(bench_CPUCopy, pTo, pFrom, pCase->Count);
+    dma = bench_DMATime(DMA_Memcpy, pTo, pFrom, pCase->Count);
+    if ((0 == cpu) || (0 == dma))
+    {
+      printf("  %4d %-11s copy error\r\n", pCase->Count, pCase->pName);
+      continue;
+    }
+
+    printf("  %4d %-11s memcpy %6d %3d.%d   DMA %6d %3d.%d\r\n", pCase->Count, pCase->pName,
+           cpu, pCase->Count * mhz / cpu, (pCase->Count * mhz * 10 / cpu) % 10,
+           dma, pCase->Count * mhz / dma, (pCase->Count * mhz * 10 / dma) % 10);
+  }
+
+  bench_DMAChain();
+}
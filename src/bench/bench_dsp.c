@@ -0,0 +1,145 @@
+#include <stdio.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "dsp.h"
+#include "fir.h"
+#include "biquad.h"
+#include "moving.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define BENCH_DSP_BLOCK                    (64)
+#define BENCH_DSP_TAPS                     (32)
+#define BENCH_DSP_STAGES                   (2)
+#define BENCH_DSP_DECIMATION               (4)
+#define BENCH_DSP_AVERAGE                  (4)
+#define BENCH_DSP_MEDIAN                   (9)
+
+/* 2nd order Butterworth low-pass at fs/10, two identical sections, a1/a2 negated, Shift = 1 */
+static const Q15 Bench_BiquadQ15[BENCH_DSP_STAGES * BIQUAD_COEFFS] =
+{
+  Q15(0.0675 / 2), Q15(0.1349 / 2), Q15(0.0675 / 2), Q15(1.1430 / 2), Q15(-0.4128 / 2),
+  Q15(0.0675 / 2), Q15(0.1349 / 2), Q15(0.0675 / 2), Q15(1.1430 / 2), Q15(-0.4128 / 2),
+};
+
+static const Q31 Bench_BiquadQ31[BENCH_DSP_STAGES * BIQUAD_COEFFS] =
+{
+  Q31(0.0675 / 2), Q31(0.1349 / 2), Q31(0.0675 / 2), Q31(1.1430 / 2), Q31(-0.4128 / 2),
+  Q31(0.0675 / 2), Q31(0.1349 / 2), Q31(0.0675 / 2), Q31(1.1430 / 2), Q31(-0.4128 / 2),
+};
+
+typedef struct
+{
+  Q15 CoeffsQ15[BENCH_DSP_TAPS];
+  Q31 CoeffsQ31[BENCH_DSP_TAPS];
+  Q15 InQ15[BENCH_DSP_BLOCK];
+  Q15 OutQ15[BENCH_DSP_BLOCK];
+  Q31 InQ31[BENCH_DSP_BLOCK];
+  Q31 OutQ31[BENCH_DSP_BLOCK];
+  Q15 StateQ15[FIR_STATE_SIZE(BENCH_DSP_TAPS, BENCH_DSP_BLOCK)];
+  Q31 StateQ31[FIR_STATE_SIZE(BENCH_DSP_TAPS, BENCH_DSP_BLOCK)];
+  Q15 Window[BENCH_DSP_MEDIAN];
+  Q15 Sorted[BENCH_DSP_MEDIAN];
+} Bench_DspBuffers;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_DspReport(const char * pName, U32 cycles, U32 taps)
+{
+  U32 centi = cycles * 100 / BENCH_DSP_BLOCK;
+
+  printf("  %-22s %4d.%02d", pName, centi / 100, centi % 100);
+  if (0 < taps)
+  {
+    centi /= taps;
+    printf(" %3d.%02d", centi / 100, centi % 100);
+  }
+  printf("\r\n");
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Each kernel runs on a warm block twice, the second run is reported */
+#define BENCH_DSP(name, taps, init, run)                                                          \
+  do                                                                                              \
+  {                                                                                               \
+    U32 cycles;                                                                                   \
+    init;                                                                                         \
+    run;                                                                                          \
+    cycles = DWT_Cycles();                                                                        \
+    run;                                                                                          \
+    bench_DspReport(name, DWT_Cycles() - cycles, taps);                                           \
+  }                                                                                               \
+  while (0)
+
+void Bench_DSP(void)
+{
+  Bench_DspBuffers * pBuffers = BENCH_SCRATCH(Bench_DspBuffers);
+  FIR_Q15 firQ15;
+  FIR_Q31 firQ31;
+  FIRDecim_Q15 decim;
+  Biquad_Q15 biquadQ15;
+  Biquad_Q31 biquadQ31;
+  MovAvg_Q15 avg;
+  MovMedian_Q15 median;
+  U32 i, seed = 12345;
+
+  DWT_Init();
+
+  /* White noise at -6 dBFS, a boxcar as the FIR taps */
+  for (i = 0; i < BENCH_DSP_BLOCK; i++)
+  {
+    seed = seed * 1664525 + 1013904223;
+    pBuffers->InQ31[i] = (Q31)seed >> 1;
+    pBuffers->InQ15[i] = (Q15)(pBuffers->InQ31[i] >> 16);
+  }
+  for (i = 0; i < BENCH_DSP_TAPS; i++)
+  {
+    pBuffers->CoeffsQ15[i] = Q15(1.0 / BENCH_DSP_TAPS);
+    pBuffers->CoeffsQ31[i] = Q31(1.0 / BENCH_DSP_TAPS);
+  }
+
+  printf("DSP kernels, block of %d, cycles/sample and cycles/sample/tap\r\n", BENCH_DSP_BLOCK);
+  vTaskSuspendAll();
+
+  BENCH_DSP("FIR Q15, 32 taps", BENCH_DSP_TAPS,
+    FIR_Q15_Init(&firQ15, pBuffers->CoeffsQ15, BENCH_DSP_TAPS, pBuffers->StateQ15, BENCH_DSP_BLOCK),
+    FIR_Q15_Run(&firQ15, pBuffers->InQ15, pBuffers->OutQ15, BENCH_DSP_BLOCK));
+
+  BENCH_DSP("FIR Q31, 32 taps", BENCH_DSP_TAPS,
+    FIR_Q31_Init(&firQ31, pBuffers->CoeffsQ31, BENCH_DSP_TAPS, pBuffers->StateQ31, BENCH_DSP_BLOCK),
+    FIR_Q31_Run(&firQ31, pBuffers->InQ31, pBuffers->OutQ31, BENCH_DSP_BLOCK));
+
+  BENCH_DSP("FIR decimator Q15, /4", BENCH_DSP_TAPS,
+    FIRDecim_Q15_Init(&decim, pBuffers->CoeffsQ15, BENCH_DSP_TAPS, BENCH_DSP_DECIMATION,
+                      pBuffers->StateQ15, BENCH_DSP_BLOCK),
+    FIRDecim_Q15_Run(&decim, pBuffers->InQ15, pBuffers->OutQ15, BENCH_DSP_BLOCK));
+
+  BENCH_DSP("Biquad Q15, 2 stages", 0,
+    Biquad_Q15_Init(&biquadQ15, Bench_BiquadQ15, BENCH_DSP_STAGES, 1,
+                    (Q15 *)pBuffers->StateQ15),
+    Biquad_Q15_Run(&biquadQ15, pBuffers->InQ15, pBuffers->OutQ15, BENCH_DSP_BLOCK));
+
+  BENCH_DSP("Biquad Q31, 2 stages", 0,
+    Biquad_Q31_Init(&biquadQ31, Bench_BiquadQ31, BENCH_DSP_STAGES, 1,
+                    (Q31 *)pBuffers->StateQ31),
+    Biquad_Q31_Run(&biquadQ31, pBuffers->InQ31, pBuffers->OutQ31, BENCH_DSP_BLOCK));
+
+  BENCH_DSP("Moving average, 16", 0,
+    MovAvg_Q15_Init(&avg, pBuffers->StateQ15, BENCH_DSP_AVERAGE),
+    MovAvg_Q15_Run(&avg, pBuffers->InQ15, pBuffers->OutQ15, BENCH_DSP_BLOCK));
+
+  BENCH_DSP("Moving median, 9", 0,
+    MovMedian_Q15_Init(&median, pBuffers->Window, pBuffers->Sorted, BENCH_DSP_MEDIAN),
+    MovMedian_Q15_Run(&median, pBuffers->InQ15, pBuffers->OutQ15, BENCH_DSP_BLOCK));
+
+  BENCH_DSP("Average decimator, /16", 0,
+    (void)0,
+    Decim_Q15_Average(pBuffers->InQ15, pBuffers->OutQ15, BENCH_DSP_BLOCK, BENCH_DSP_AVERAGE));
+
+  (void)xTaskResumeAll();
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "dsp.h"
+#include "fft.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define BENCH_FFT_PI                       (3.14159265358979323846)
+#define BENCH_FFT_PEAKS                    (4)
+
+/* Two tones on exact bins, so the double precision reference spectrum is known in closed form:
+   a complex exponential of amplitude A is A in one bin, a real cosine is A/2 in two bins.       */
+#define BENCH_FFT_A1                       (0.5)
+#define BENCH_FFT_A2                       (0.25)
+#define BENCH_FFT_BIN1(size)               ((size) / 16)
+#define BENCH_FFT_BIN2(size)               ((size) / 4 + 3)
+
+/* One complex sample per word of the bench scratch area, aligned for the word accesses of the
+   reordering pass. The sizes above what the area holds are not measured.                        */
+#define BENCH_FFT_SIZE_MAX                 (BENCH_SCRATCH_SIZE / sizeof(U32))
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static Q15 bench_FftQ15(double x)
+{
+  return Q15_Sat((S32)floor(x * 32768.0 + 0.5));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The kernels are timed one call each, inside a critical section: the tick does not show and the
+   cycle count depends on the size only.                                                          */
+
+#define BENCH_FFT_TIME(cycles, call)                                                              \
+  do                                                                                              \
+  {                                                                                               \
+    taskENTER_CRITICAL();                                                                         \
+    cycles = DWT_Cycles();                                                                        \
+    call;                                                                                         \
+    cycles = DWT_Cycles() - cycles;                                                               \
+    taskEXIT_CRITICAL();                                                                          \
+  }                                                                                               \
+  while (0)
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* x[n] = A1 exp(j w1 n) + A2 exp(-j w2 n): A1 in bin BIN1, A2 in bin size - BIN2, zero elsewhere */
+
+static U32 bench_FftComplex(U32 size, U32 * pCycles)
+{
+  Q15 * pData = BENCH_SCRATCH(Q15);
+  U32 k, err, maxErr = 0;
+  double a1, a2, re, im;
+
+  for (k = 0; k < size; k++)
+  {
+    a1 = 2.0 * BENCH_FFT_PI * BENCH_FFT_BIN1(size) * k / size;
+    a2 = 2.0 * BENCH_FFT_PI * BENCH_FFT_BIN2(size) * k / size;
+    pData[2 * k]     = bench_FftQ15(BENCH_FFT_A1 * cos(a1) + BENCH_FFT_A2 * cos(a2));
+    pData[2 * k + 1] = bench_FftQ15(BENCH_FFT_A1 * sin(a1) - BENCH_FFT_A2 * sin(a2));
+  }
+
+  BENCH_FFT_TIME(*pCycles, (void)FFT_Q15_Complex(pData, size, FALSE));
+
+  for (k = 0; k < size; k++)
+  {
+    re = (BENCH_FFT_BIN1(size) == k) ? BENCH_FFT_A1 :
+         ((size - BENCH_FFT_BIN2(size)) == k) ? BENCH_FFT_A2 : 0.0;
+    im = 0.0;
+    err = (U32)fabs(pData[2 * k] - re * 32768.0) + (U32)fabs(pData[2 * k + 1] - im * 32768.0);
+    if (maxErr < err) maxErr = err;
+  }
+
+  return maxErr;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* x[n] = A1 cos(w1 n) + A2 sin(w2 n): A1/2 in bin BIN1, -j A2/2 in bin BIN2 */
+
+static void bench_FftTones(Q15 * pData, U32 size)
+{
+  double a1, a2;
+  U32 k;
+
+  for (k = 0; k < size; k++)
+  {
+    a1 = 2.0 * BENCH_FFT_PI * BENCH_FFT_BIN1(size) * k / size;
+    a2 = 2.0 * BENCH_FFT_PI * BENCH_FFT_BIN2(size) * k / size;
+    pData[k] = bench_FftQ15(BENCH_FFT_A1 * cos(a1) + BENCH_FFT_A2 * sin(a2));
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 bench_FftReal(U32 size, U32 * pCycles)
+{
+  Q15 * pData = BENCH_SCRATCH(Q15);
+  U32 k, err, maxErr = 0;
+  double re, im;
+
+  bench_FftTones(pData, size);
+  BENCH_FFT_TIME(*pCycles, (void)FFT_Q15_Real(pData, size));
+
+  /* DC and Nyquist are zero and packed into the first pair */
+  for (k = 0; k < (size >> 1); k++)
+  {
+    re = (BENCH_FFT_BIN1(size) == k) ? (BENCH_FFT_A1 / 2) : 0.0;
+    im = (BENCH_FFT_BIN2(size) == k) ? (-BENCH_FFT_A2 / 2) : 0.0;
+    err = (U32)fabs(pData[2 * k] - re * 32768.0) + (U32)fabs(pData[2 * k + 1] - im * 32768.0);
+    if (maxErr < err) maxErr = err;
+  }
+
+  return maxErr;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_FFT(void)
+{
+  Q15 * pData = BENCH_SCRATCH(Q15);
+  FFT_Peak peaks[BENCH_FFT_PEAKS];
+  U32 size, complex, real, hann, magnitude, search, errComplex, errReal, found;
+
+  DWT_Init();
+
+  printf("FFT Q15, cycles, max error |re| + |im| against the exact spectrum in LSB\r\n");
+  printf("  %4s %8s %3s %8s %3s %6s %6s %6s\r\n",
+         "size", "complex", "err", "real", "err", "hann", "mag", "peaks");
+
+  for (size = 64; size <= BENCH_FFT_SIZE_MAX; size <<= 1)
+  {
+    errComplex = bench_FftComplex(size, &complex);
+    errReal    = bench_FftReal(size, &real);
+
+    /* The analysis chain on the same real tones, the strongest peak is at BIN1 * 256 */
+    bench_FftTones(pData, size);
+    BENCH_FFT_TIME(hann, FFT_Q15_Hann(pData, size));
+    (void)FFT_Q15_Real(pData, size);
+    BENCH_FFT_TIME(magnitude, FFT_Q15_RealMagnitude(pData, pData, size));
+    BENCH_FFT_TIME(search,
+      found = FFT_Q15_Peaks(pData, (size >> 1) + 1, Q15(0.01), peaks, BENCH_FFT_PEAKS));
+
+    printf("  %4d %8d %3d %8d %3d %6d %6d %6d, %d peaks, first at %d/256\r\n",
+           size, complex, errComplex, real, errReal, hann, magnitude, search,
+           found, (0 < found) ? peaks[0].Position : 0);
+  }
+}
@@ -0,0 +1,84 @@
+#include <stdio.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "gpio.h"
+#include "dwt.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* 8-bit bus on PA0..PA7. The pins are not switched to outputs, only the port registers are
+   exercised, so nothing is driven while the benchmark runs.                                      */
+#define BENCH_BUS(BIT) \
+  BIT(0, 0) BIT(1, 1) BIT(2, 2) BIT(3, 3) BIT(4, 4) BIT(5, 5) BIT(6, 6) BIT(7, 7)
+
+/* The same bus spread over non-adjacent pins */
+#define BENCH_BUS_SCATTERED(BIT) \
+  BIT(0, 0) BIT(1, 2) BIT(2, 4) BIT(3, 6) BIT(4, 8) BIT(5, 10) BIT(6, 12) BIT(7, 15)
+
+#define BENCH_GPIO_WRITES                  (256)
+
+GPIO_GROUP_DEFINE(Bench_Bus, GPIOA, BENCH_BUS)
+GPIO_GROUP_DEFINE(Bench_BusScattered, GPIOA, BENCH_BUS_SCATTERED)
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_PerPin(U32 value)
+{
+  U32 pin;
+
+  for (pin = 0; pin < 8; pin++)
+  {
+    if (0 != (value & (1 << pin)))
+    {
+      GPIO_Hi(GPIOA, pin);
+    }
+    else
+    {
+      GPIO_Lo(GPIOA, pin);
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_Report(const char * pName, U32 cycles)
+{
+  U32 perWrite = cycles / BENCH_GPIO_WRITES;
+
+  printf("  %-18s %4d cycles/write, %5d kwrites/s\r\n",
+         pName, perWrite, SystemCoreClock / 1000 / perWrite);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_GPIO(void)
+{
+  U32 value, cycles;
+
+  DWT_Init();
+  BITBAND_RCC_APB2ENR(RCC_APB2ENR_IOPAEN_Pos) = 1;
+
+  printf("GPIO bus write\r\n");
+  vTaskSuspendAll();
+
+  cycles = DWT_Cycles();
+  for (value = 0; value < BENCH_GPIO_WRITES; value++) bench_PerPin(value);
+  bench_Report("GPIO_Hi/GPIO_Lo", DWT_Cycles() - cycles);
+
+  cycles = DWT_Cycles();
+  for (value = 0; value < BENCH_GPIO_WRITES; value++) Bench_Bus_Write(value);
+  bench_Report("Group", DWT_Cycles() - cycles);
+
+  cycles = DWT_Cycles();
+  for (value = 0; value < BENCH_GPIO_WRITES; value++) Bench_BusScattered_Write(value);
+  bench_Report("Group (scattered)", DWT_Cycles() - cycles);
+
+  cycles = DWT_Cycles();
+  for (value = 0; value < BENCH_GPIO_WRITES; value++) (void)Bench_BusScattered_Read();
+  bench_Report("Group read", DWT_Cycles() - cycles);
+
+  (void)xTaskResumeAll();
+}
@@ -0,0 +1,89 @@
+#include <stdio.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "irq.h"
+#include "bench.h"
+
+/* The tamper pin is not used on the board, the interrupt is only ever pended by software */
+#define BENCH_IRQ                          TAMPER_IRQn
+#define BENCH_IRQ_RUNS                     (16)
+
+typedef struct
+{
+  U32 Cycles;
+} Bench_Irq;
+
+static Bench_Irq Bench_IrqDirect;
+static Bench_Irq Bench_IrqAttached;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Overrides the weak handler of the startup file, so it is in the flash table as well */
+
+void TAMPER_IRQHandler(void)
+{
+  Bench_IrqDirect.Cycles = DWT_Cycles();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_IrqHandler(Bench_Irq * pIrq)
+{
+  pIrq->Cycles = DWT_Cycles();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The interrupt is pended with PRIMASK set and taken on the instruction that clears it, so the
+   measured time is exactly the entry: stacking, vector fetch, trampoline and the handler prologue
+   up to the DWT read. The cost of the DWT read and CPSIE alone is subtracted.                    */
+
+static U32 bench_Latency(Bench_Irq * pIrq)
+{
+  U32 run, start, best = 0xFFFFFFFF, base = 0xFFFFFFFF;
+
+  for (run = 0; run < BENCH_IRQ_RUNS; run++)
+  {
+    __disable_irq();
+    start = DWT_Cycles();
+    __enable_irq();
+    start = DWT_Cycles() - start;
+    if (base > start) base = start;
+
+    __disable_irq();
+    NVIC_SetPendingIRQ(BENCH_IRQ);
+    start = DWT_Cycles();
+    __enable_irq();
+    __DSB();
+    __ISB();
+    start = *(volatile U32 *)&pIrq->Cycles - start;
+    if (best > start) best = start;
+  }
+
+  return (best - base);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_IRQ(void)
+{
+  DWT_Init();
+  NVIC_SetPriority(BENCH_IRQ, 0);
+  NVIC_EnableIRQ(BENCH_IRQ);
+
+  printf("Interrupt entry latency at %d Hz, cycles\r\n", SystemCoreClock);
+
+  IRQ_UseFlash(TRUE);
+  printf("  Flash table          %4d\r\n", bench_Latency(&Bench_IrqDirect));
+  IRQ_UseFlash(FALSE);
+
+  IRQ_SetVector(BENCH_IRQ, TAMPER_IRQHandler);
+  printf("  SRAM table           %4d\r\n", bench_Latency(&Bench_IrqDirect));
+
+  IRQ_ATTACH(BENCH_IRQ, bench_IrqHandler, &Bench_IrqAttached);
+  printf("  SRAM table + context %4d\r\n", bench_Latency(&Bench_IrqAttached));
+
+  IRQ_Detach(BENCH_IRQ);
+}
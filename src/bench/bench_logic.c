@@ -0,0 +1,135 @@
+#include <stdio.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "gpio.h"
+#include "wave.h"
+#include "logic.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* The waveform engine counts on PB12..PB15, one step every BENCH_LOGIC_STEP samples, and the
+   analyzer records it at rising rates. A lossless capture shows runs of exactly that length;
+   samples dropped by a saturated DMA shorten them. Nothing has to be connected.                  */
+
+#define BENCH_LOGIC_SAMPLES                (384)
+#define BENCH_LOGIC_POST                   (BENCH_LOGIC_SAMPLES / 2 - LOGIC_MARGIN)
+#define BENCH_LOGIC_RUNS                   (BENCH_LOGIC_POST)
+#define BENCH_LOGIC_STEP                   (4)
+#define BENCH_LOGIC_WORDS                  (64)
+#define BENCH_LOGIC_PINS                   (0xF000)
+
+static const U32 Bench_LogicRates[] = {1000000, 2000000, 3000000, 4500000, 6000000, 9000000};
+
+typedef struct
+{
+  U16 Ring[BENCH_LOGIC_SAMPLES];
+  U32 Dump[LOGIC_DUMP_SIZE(BENCH_LOGIC_RUNS) / sizeof(U32)];
+  U32 Wave[WAVE_BUFFER_SIZE(BENCH_LOGIC_WORDS)];
+} Bench_LogicBuffers;
+
+static U32 Bench_LogicCount;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 bench_LogicProduce(U32 * pWords, U32 count, void * pContext)
+{
+  U32 i, value;
+
+  for (i = 0; i < count; i++)
+  {
+    value = (Bench_LogicCount++ & 0x0F) << 12;
+    pWords[i] = value | ((~value & BENCH_LOGIC_PINS) << 16);
+  }
+  return count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The first and the last runs are cut by the window and are not checked */
+
+static void bench_LogicCheck(U32 rate)
+{
+  Bench_LogicBuffers * pBuffers = BENCH_SCRATCH(Bench_LogicBuffers);
+  Logic_Header * pHeader = (Logic_Header *)pBuffers->Dump;
+  const U16 * pRun = (const U16 *)(pHeader + 1);
+  U32 size, i, samples = 0, steps = 0, errors = 0;
+
+  size = Logic_Compress((U8 *)pBuffers->Dump, sizeof(pBuffers->Dump));
+  if ((0 == size) || (3 > pHeader->Runs))
+  {
+    printf("  %7d Hz  no capture\r\n", rate);
+    return;
+  }
+
+  for (i = 1; i < pHeader->Runs - 1U; i++)
+  {
+    if (pRun[2 * i] != (((pRun[2 * i - 2] >> 12) + 1) & 0x0F) << 12) errors++;
+    if ((BENCH_LOGIC_STEP - 1 > pRun[2 * i + 1]) || (BENCH_LOGIC_STEP + 1 < pRun[2 * i + 1]))
+    {
+      errors++;
+    }
+    samples += pRun[2 * i + 1];
+    steps++;
+  }
+
+  printf("  %7d Hz  runs %4d, samples/step %d.%02d, errors %d\r\n", pHeader->Rate, pHeader->Runs,
+         samples / steps, (samples * 100 / steps) % 100, errors);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_Logic(void)
+{
+  Bench_LogicBuffers * pBuffers = BENCH_SCRATCH(Bench_LogicBuffers);
+  Wave_Config wave;
+  Logic_Config logic;
+  U32 i, timeout;
+
+  for (i = 12; i < 16; i++)
+  {
+    GPIO_Lo(GPIOB, i);
+    GPIO_Init(GPIOB, i, GPIO_TYPE_OUT_PP_50MHZ);
+  }
+
+  wave.pPort     = GPIOB;
+  wave.pBuffer   = pBuffers->Wave;
+  wave.Words     = BENCH_LOGIC_WORDS;
+  wave.pProducer = bench_LogicProduce;
+  wave.pDone     = NULL;
+  wave.pContext  = NULL;
+
+  logic.pPort        = (GPIO *)GPIOB;
+  logic.pRing        = pBuffers->Ring;
+  logic.Samples      = BENCH_LOGIC_SAMPLES;
+  logic.Pre          = 0;
+  logic.Post         = BENCH_LOGIC_POST;
+  logic.Mask         = BENCH_LOGIC_PINS;
+  logic.TriggerMask  = 0;
+  logic.TriggerValue = 0;
+  logic.TriggerEdge  = FALSE;
+  logic.pDone        = NULL;
+  logic.pContext     = NULL;
+
+  printf("Logic analyzer, %d samples per step on PB12..PB15\r\n", BENCH_LOGIC_STEP);
+
+  for (i = 0; i < sizeof(Bench_LogicRates) / sizeof(Bench_LogicRates[0]); i++)
+  {
+    wave.Rate  = Bench_LogicRates[i] / BENCH_LOGIC_STEP;
+    logic.Rate = Bench_LogicRates[i];
+    if ((FALSE == Wave_Init(&wave)) || (FALSE == Logic_Init(&logic))) return;
+
+    Wave_Start();
+    Logic_Arm();
+    for (timeout = 0; (LOGIC_DONE != Logic_GetStatus()) && (100 > timeout); timeout++)
+    {
+      vTaskDelay(1);
+    }
+    Logic_Abort();
+    Wave_Stop();
+
+    bench_LogicCheck(Bench_LogicRates[i]);
+  }
+}
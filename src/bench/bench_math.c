@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <math.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "dsp.h"
+#include "fixmath.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define BENCH_MATH_CALLS                   (128)
+#define BENCH_MATH_PI                      (3.14159265358979323846)
+
+/* One function pair. The arguments of call i are generated in fixed point, the float arguments
+   are the same values scaled to real numbers. The reference is libm in double precision, scaled
+   back to the fixed-point output, so the error is in LSB of the fixed-point result.              */
+typedef struct
+{
+  const char * pName;
+  void       (*pArgs)(U32 i, S32 * pA, S32 * pB);
+  S32        (*pFixed)(S32 a, S32 b);
+  float      (*pFloat)(float a, float b);
+  double     (*pReference)(double a, double b);
+  double       Scale;                      /* Fixed-point argument to real                        */
+} Bench_MathPair;
+
+typedef struct
+{
+  S32   A[BENCH_MATH_CALLS];               /* Fixed-point arguments                               */
+  S32   B[BENCH_MATH_CALLS];
+  float X[BENCH_MATH_CALLS];               /* The same in float                                   */
+  float Y[BENCH_MATH_CALLS];
+} Bench_MathBuffers;
+
+static volatile S32   Bench_MathSink;
+static volatile float Bench_MathSinkF;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_SinArgs(U32 i, S32 * pA, S32 * pB)
+{
+  *pA = (S32)(U16)(i * 509 + 123);
+  *pB = 0;
+}
+
+static S32 bench_Sin(S32 a, S32 b)
+{
+  return Math_Sin((Math_Angle)a);
+}
+
+static float bench_Sinf(float a, float b)
+{
+  return sinf(a);
+}
+
+static double bench_SinRef(double a, double b)
+{
+  return fmin(sin(a) * 32768.0, 32767.0);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_Atan2Args(U32 i, S32 * pA, S32 * pB)
+{
+  double angle = 2.0 * BENCH_MATH_PI * (i * 509 + 123) / 65536.0;
+
+  *pA = (S32)(10000.0 * sin(angle));
+  *pB = (S32)(10000.0 * cos(angle));
+}
+
+static S32 bench_Atan2(S32 a, S32 b)
+{
+  return (S16)Math_Atan2(a, b);
+}
+
+static float bench_Atan2f(float a, float b)
+{
+  return atan2f(a, b);
+}
+
+static double bench_Atan2Ref(double a, double b)
+{
+  return atan2(a, b) * 32768.0 / BENCH_MATH_PI;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_SqrtArgs(U32 i, S32 * pA, S32 * pB)
+{
+  *pA = (S32)(i * 16777213 + 7);
+  *pB = 0;
+}
+
+static S32 bench_Sqrt(S32 a, S32 b)
+{
+  return (S32)Math_Sqrt((U32)a);
+}
+
+static float bench_Sqrtf(float a, float b)
+{
+  return sqrtf(a);
+}
+
+static double bench_SqrtRef(double a, double b)
+{
+  return sqrt(a);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Q16.16 from 0.25 to 127 */
+static void bench_RecipArgs(U32 i, S32 * pA, S32 * pB)
+{
+  *pA = (S32)(16384 + i * 65000);
+  *pB = 0;
+}
+
+static S32 bench_Recip(S32 a, S32 b)
+{
+  return Math_RecipQ16(a);
+}
+
+static float bench_Recipf(float a, float b)
+{
+  return 1.0f / a;
+}
+
+static double bench_RecipRef(double a, double b)
+{
+  return 65536.0 / a;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_Log2Args(U32 i, S32 * pA, S32 * pB)
+{
+  *pA = (S32)(i * 16776999 + 1);
+  *pB = 0;
+}
+
+static S32 bench_Log2(S32 a, S32 b)
+{
+  return Math_Log2((U32)a);
+}
+
+static float bench_Log2f(float a, float b)
+{
+  return log2f(a);
+}
+
+static double bench_Log2Ref(double a, double b)
+{
+  return log2(a) * 65536.0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Q16.16 from -8 to 8 */
+static void bench_Exp2Args(U32 i, S32 * pA, S32 * pB)
+{
+  *pA = (S32)(i * 8192) - (8 << 16) + 77;
+  *pB = 0;
+}
+
+static S32 bench_Exp2(S32 a, S32 b)
+{
+  return (S32)Math_Exp2(a);
+}
+
+static float bench_Exp2f(float a, float b)
+{
+  return exp2f(a);
+}
+
+static double bench_Exp2Ref(double a, double b)
+{
+  return exp2(a) * 65536.0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static S32 bench_Nop(S32 a, S32 b)
+{
+  return a;
+}
+
+static float bench_Nopf(float a, float b)
+{
+  return a;
+}
+
+static const Bench_MathPair Bench_MathPairs[] =
+{
+  {"sin",   bench_SinArgs,   bench_Sin,   bench_Sinf,   bench_SinRef,   BENCH_MATH_PI / 32768},
+  {"atan2", bench_Atan2Args, bench_Atan2, bench_Atan2f, bench_Atan2Ref, 1.0},
+  {"sqrt",  bench_SqrtArgs,  bench_Sqrt,  bench_Sqrtf,  bench_SqrtRef,  1.0},
+  {"1/x",   bench_RecipArgs, bench_Recip, bench_Recipf, bench_RecipRef, 1.0 / 65536},
+  {"log2",  bench_Log2Args,  bench_Log2,  bench_Log2f,  bench_Log2Ref,  1.0},
+  {"exp2",  bench_Exp2Args,  bench_Exp2,  bench_Exp2f,  bench_Exp2Ref,  1.0 / 65536},
+};
+
+#define BENCH_MATH_PAIRS                   (sizeof(Bench_MathPairs) / sizeof(Bench_MathPairs[0]))
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Both versions are called through a pointer, so the compiler can not fold them into the loop.
+   The cost of an empty call is subtracted, the result is cycles per call.                        */
+
+static U32 bench_MathFixed(S32 (*pFunc)(S32 a, S32 b))
+{
+  const Bench_MathBuffers * pBuffers = BENCH_SCRATCH(Bench_MathBuffers);
+  U32 cycles, i;
+
+  taskENTER_CRITICAL();
+  cycles = DWT_Cycles();
+  for (i = 0; i < BENCH_MATH_CALLS; i++)
+  {
+    Bench_MathSink = pFunc(pBuffers->A[i], pBuffers->B[i]);
+  }
+  cycles = DWT_Cycles() - cycles;
+  taskEXIT_CRITICAL();
+
+  return (cycles / BENCH_MATH_CALLS);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 bench_MathFloat(float (*pFunc)(float a, float b))
+{
+  const Bench_MathBuffers * pBuffers = BENCH_SCRATCH(Bench_MathBuffers);
+  U32 cycles, i;
+
+  taskENTER_CRITICAL();
+  cycles = DWT_Cycles();
+  for (i = 0; i < BENCH_MATH_CALLS; i++)
+  {
+    Bench_MathSinkF = pFunc(pBuffers->X[i], pBuffers->Y[i]);
+  }
+  cycles = DWT_Cycles() - cycles;
+  taskEXIT_CRITICAL();
+
+  return (cycles / BENCH_MATH_CALLS);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_Math(void)
+{
+  Bench_MathBuffers * pBuffers = BENCH_SCRATCH(Bench_MathBuffers);
+  const Bench_MathPair * pMath;
+  U32 i, fixed, soft, nop, nopf, error, maxError;
+
+  DWT_Init();
+
+  printf("Fixed-point math vs libm float, cycles per call, max error in 1/100 LSB\r\n");
+  printf("  %-6s %5s %5s %5s\r\n", "", "fixed", "float", "error");
+
+  for (pMath = Bench_MathPairs; pMath < &Bench_MathPairs[BENCH_MATH_PAIRS]; pMath++)
+  {
+    maxError = 0;
+    for (i = 0; i < BENCH_MATH_CALLS; i++)
+    {
+      pMath->pArgs(i, &pBuffers->A[i], &pBuffers->B[i]);
+      pBuffers->X[i] = (float)(pBuffers->A[i] * pMath->Scale);
+      pBuffers->Y[i] = (float)(pBuffers->B[i] * pMath->Scale);
+
+      error = (U32)(100.0 * fabs(pMath->pFixed(pBuffers->A[i], pBuffers->B[i]) -
+                                 pMath->pReference(pBuffers->A[i] * pMath->Scale,
+                                                   pBuffers->B[i] * pMath->Scale)));
+      if (maxError < error) maxError = error;
+    }
+
+    nop   = bench_MathFixed(bench_Nop);
+    nopf  = bench_MathFloat(bench_Nopf);
+    fixed = bench_MathFixed(pMath->pFixed) - nop;
+    soft  = bench_MathFloat(pMath->pFloat) - nopf;
+
+    printf("  %-6s %5d %5d %5d\r\n", pMath->pName, fixed, soft, maxError);
+  }
+}
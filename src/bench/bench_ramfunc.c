@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stddef.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "ramfunc.h"
+#include "interrupts.h"
+#include "stackguard.h"
+#include "trace.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define BENCH_RAMFUNC_NODES                (32)
+#define BENCH_RAMFUNC_BYTES                (64)
+#define BENCH_RAMFUNC_RUNS                 (16)
+
+/* A turn of the tick loop takes a few cycles, an exception at least 24 */
+#define BENCH_RAMFUNC_GAP                  (40)
+
+typedef struct Bench_Node_s
+{
+  U32                   Value;
+  struct Bench_Node_s * pNext;
+} Bench_Node;
+
+typedef U32 (*Bench_Kernel)(const void * pArg);
+
+typedef struct
+{
+  const char * pName;
+  Bench_Kernel pFlash;
+  Bench_Kernel pSram;
+  U32          Arg;                        /* Offset in Bench_RamFuncBuffers                      */
+} Bench_Twin;
+
+/* Every kernel is compiled twice from the same body: once in flash and once in SRAM, so both
+   copies see the same compiler output and only the fetch path differs.                          */
+#define BENCH_TWIN(name, ...) \
+  static U32 name##_Flash(const void * pArg) __VA_ARGS__ \
+  static RAMFUNC U32 name##_Sram(const void * pArg) __VA_ARGS__
+
+/* Pointer chasing with a data dependent branch, the shape of the list walks in the kernel */
+BENCH_TWIN(bench_List,
+{
+  const Bench_Node * pNode = (const Bench_Node *)pArg;
+  U32 count = 0;
+
+  for (; NULL != pNode; pNode = pNode->pNext)
+  {
+    if (0 != (pNode->Value & 1)) count++;
+  }
+  return count;
+})
+
+/* Tight loop with a short conditional, the shape of a bitwise CRC or a bit-banged protocol */
+BENCH_TWIN(bench_Crc8,
+{
+  const U8 * pData = (const U8 *)pArg;
+  U32 crc = 0, i, bit;
+
+  for (i = 0; i < BENCH_RAMFUNC_BYTES; i++)
+  {
+    crc ^= pData[i];
+    for (bit = 0; bit < 8; bit++)
+    {
+      crc = (0 != (crc & 0x80)) ? ((crc << 1) ^ 0x07) : (crc << 1);
+    }
+  }
+  return (crc & 0xFF);
+})
+
+/* Jump table, the shape of a protocol state machine in an ISR */
+BENCH_TWIN(bench_States,
+{
+  U32 state = *(const U32 *)pArg;
+  U32 i, acc = 0;
+
+  for (i = 0; i < BENCH_RAMFUNC_BYTES; i++)
+  {
+    switch (state & 7)
+    {
+      case 0:  acc += 1;         state = acc + 3; break;
+      case 1:  acc ^= state;     state += 5;      break;
+      case 2:  acc <<= 1;        state += 7;      break;
+      case 3:  acc -= state;     state ^= acc;    break;
+      case 4:  acc |= i;         state += 1;      break;
+      case 5:  acc &= ~i;        state += 3;      break;
+      case 6:  acc += acc >> 3;  state += 2;      break;
+      default: acc = ~acc;       state += 6;      break;
+    }
+  }
+  return acc;
+})
+
+/* Loads and stores only: with the code in SRAM, the fetches compete with the data accesses */
+BENCH_TWIN(bench_Copy,
+{
+  U32 * pBuffer = (U32 *)pArg;
+  U32 i;
+
+  for (i = 0; i < (BENCH_RAMFUNC_BYTES / 2); i++)
+  {
+    pBuffer[i + (BENCH_RAMFUNC_BYTES / 2)] = pBuffer[i];
+  }
+  return pBuffer[BENCH_RAMFUNC_BYTES - 1];
+})
+
+typedef struct
+{
+  Bench_Node Nodes[BENCH_RAMFUNC_NODES];
+  U32        Buffer[BENCH_RAMFUNC_BYTES];
+  U32        State;
+} Bench_RamFuncBuffers;
+
+static const Bench_Twin Bench_Twins[] =
+{
+  {"List",   bench_List_Flash,   bench_List_Sram,   offsetof(Bench_RamFuncBuffers, Nodes)},
+  {"CRC-8",  bench_Crc8_Flash,   bench_Crc8_Sram,   offsetof(Bench_RamFuncBuffers, Buffer)},
+  {"States", bench_States_Flash, bench_States_Sram, offsetof(Bench_RamFuncBuffers, State)},
+  {"Copy",   bench_Copy_Flash,   bench_Copy_Sram,   offsetof(Bench_RamFuncBuffers, Buffer)},
+};
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Each run is timed separately and the best one is kept, so the SysTick interrupt does not show.
+   The call goes through a volatile pointer, so the kernel can not be inlined into the caller.   */
+
+static U32 bench_Run(Bench_Kernel pKernel, const void * pArg)
+{
+  Bench_Kernel volatile pCall = pKernel;
+  U32 run, cycles, best = 0xFFFFFFFF;
+
+  for (run = 0; run < BENCH_RAMFUNC_RUNS; run++)
+  {
+    cycles = DWT_Cycles();
+    (void)pCall(pArg);
+    cycles = DWT_Cycles() - cycles;
+    if (best > cycles) best = cycles;
+  }
+
+  return best;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_Where(const char * pName, const void * pFunc)
+{
+  printf("  %-20s 0x%08X %s\r\n", pName, (U32)pFunc, RAMFUNC_IS_SRAM(pFunc) ? "SRAM" : "flash");
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The real SysTick_Handler, as the task sees it: the loop only reads the cycle counter, so a long
+   gap between two reads is an interrupt. The shortest gap over BENCH_RAMFUNC_RUNS ticks, less a
+   bare turn of the loop, is the handler with xTaskIncrementTick() and the exception entry and
+   exit. A tick that makes a task ready for a switch takes longer and is not the shortest.       */
+
+static U32 bench_Tick(void)
+{
+  U32 start, last, now, gap, turn = 0xFFFFFFFF, best = 0xFFFFFFFF, ticks = 0;
+  U32 timeout = SystemCoreClock / configTICK_RATE_HZ * BENCH_RAMFUNC_RUNS * 2;
+
+  start = last = DWT_Cycles();
+  while ((BENCH_RAMFUNC_RUNS > ticks) && (timeout > last - start))
+  {
+    now  = DWT_Cycles();
+    gap  = now - last;
+    last = now;
+
+    if (BENCH_RAMFUNC_GAP < gap)
+    {
+      ticks++;
+      if (best > gap) best = gap;
+    }
+    else if (turn > gap)
+    {
+      turn = gap;
+    }
+  }
+
+  return (0 == ticks) ? 0 : (best - turn);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_RamFunc(void)
+{
+  Bench_RamFuncBuffers * pBuffers = BENCH_SCRATCH(Bench_RamFuncBuffers);
+  const void * pArg;
+  U32 i, flash, sram, cycles, best, tick;
+  S32 saved;
+#if (1 == STACKGUARD_PROFILE)
+  U32 min, max;
+#endif
+
+  DWT_Init();
+
+  for (i = 0; i < BENCH_RAMFUNC_NODES; i++)
+  {
+    pBuffers->Nodes[i].Value = i * 7;
+    pBuffers->Nodes[i].pNext = (i < (BENCH_RAMFUNC_NODES - 1)) ? &pBuffers->Nodes[i + 1] : NULL;
+  }
+  for (i = 0; i < BENCH_RAMFUNC_BYTES; i++)
+  {
+    pBuffers->Buffer[i] = i;
+  }
+  pBuffers->State = 0;
+
+  printf("Flash vs SRAM execution at %d Hz, cycles\r\n", SystemCoreClock);
+  printf("  %-10s %6s %6s %6s\r\n", "", "flash", "SRAM", "saved");
+
+  for (i = 0; i < (sizeof(Bench_Twins) / sizeof(Bench_Twins[0])); i++)
+  {
+    pArg  = (const U8 *)pBuffers + Bench_Twins[i].Arg;
+    flash = bench_Run(Bench_Twins[i].pFlash, pArg);
+    sram  = bench_Run(Bench_Twins[i].pSram, pArg);
+    saved = (S32)flash - (S32)sram;
+    printf("  %-10s %6d %6d %6d (%3d%%)\r\n",
+           Bench_Twins[i].pName, flash, sram, saved, saved * 100 / (S32)flash);
+  }
+
+  /* The kernel paths can not be duplicated, the linker files decide where they are. They are
+     timed in place: run the bench on a RAMFUNC_FLASH build too (ramfunc.h), the difference of
+     each line is what its functions gain from SRAM.                                             */
+  printf("Kernel paths (%s)\r\n", RAMFUNC_IS_SRAM(SysTick_Handler) ? "SRAM" : "flash");
+  bench_Where("PendSV_Handler", (const void *)PendSV_Handler);
+  bench_Where("vTaskSwitchContext", (const void *)vTaskSwitchContext);
+  bench_Where("SysTick_Handler", (const void *)SysTick_Handler);
+  bench_Where("xTaskIncrementTick", (const void *)xTaskIncrementTick);
+  bench_Where("StackGuard_Switch", (const void *)StackGuard_Switch);
+  bench_Where("Trace_Event", (const void *)Trace_Event);
+
+  /* The caller has the highest priority, so PendSV switches back to it: a full context switch */
+  for (best = 0xFFFFFFFF, i = 0; i < BENCH_RAMFUNC_RUNS; i++)
+  {
+    cycles = DWT_Cycles();
+    taskYIELD();
+    cycles = DWT_Cycles() - cycles;
+    if (best > cycles) best = cycles;
+  }
+  printf("  Switch               %6d cycles\r\n", best);
+
+#if (1 == STACKGUARD_PROFILE)
+  /* Its share of every switch since boot, the guard store and the profiling itself */
+  StackGuard_GetCycles(&min, &max);
+  printf("  StackGuard_Switch    %6d to %d cycles\r\n", min, max);
+#endif
+
+  /* SysTick_Handler and xTaskIncrementTick() */
+  tick = bench_Tick();
+  printf("  Tick                 %6d cycles\r\n", tick);
+}
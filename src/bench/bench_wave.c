@@ -0,0 +1,144 @@
+#include <stdio.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "gpio.h"
+#include "dwt.h"
+#include "wave.h"
+#include "ws2812.h"
+#include "bench.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Four strips of 32 LEDs on PB12..PB15, nothing has to be connected */
+#define BENCH_WAVE_STRIPS                  (4)
+#define BENCH_WAVE_LEDS                    (32)
+#define BENCH_WAVE_BYTES                   (3 * BENCH_WAVE_LEDS)
+#define BENCH_WAVE_WORDS                   (8 * WS2812_WORDS_PER_BYTE)
+
+static const U8 Bench_WavePins[BENCH_WAVE_STRIPS] = {12, 13, 14, 15};
+
+typedef struct
+{
+  U32 Buffer[WAVE_BUFFER_SIZE(BENCH_WAVE_WORDS)];
+  U8  Data[BENCH_WAVE_STRIPS * BENCH_WAVE_BYTES];
+} Bench_WaveBuffers;
+
+static WS2812 Bench_WaveStrip;
+static U32 Bench_WaveProducer;
+static volatile U32 Bench_WaveEnd;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The usual bit-banged loop: every bit is timed on the cycle counter with the interrupts masked,
+   one strip after the other                                                                      */
+
+static U32 bench_WaveBitBang(const U8 * pFrame)
+{
+  U32 t0h = SystemCoreClock / 2500000, t1h = SystemCoreClock / 1250000;
+  U32 period = SystemCoreClock / 800000, high, start, cycles, strip, i, b, pin;
+  const U8 * pData;
+
+  __disable_irq();
+  cycles = DWT_Cycles();
+
+  for (strip = 0; strip < BENCH_WAVE_STRIPS; strip++)
+  {
+    pin = Bench_WavePins[strip];
+    pData = &pFrame[strip * BENCH_WAVE_BYTES];
+    for (i = 0; i < BENCH_WAVE_BYTES; i++)
+    {
+      for (b = 0x80; 0 != b; b >>= 1)
+      {
+        high = (0 != (pData[i] & b)) ? t1h : t0h;
+        start = DWT_Cycles();
+        GPIO_Hi(GPIOB, pin);
+        while ((DWT_Cycles() - start) < high) {};
+        GPIO_Lo(GPIOB, pin);
+        while ((DWT_Cycles() - start) < period) {};
+      }
+    }
+  }
+
+  cycles = DWT_Cycles() - cycles;
+  __enable_irq();
+
+  return cycles;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The encoder with its cost measured, this is all the CPU does for the engine besides the
+   interrupt entry                                                                                */
+
+static U32 bench_WaveProduce(U32 * pWords, U32 count, void * pContext)
+{
+  U32 cycles = DWT_Cycles();
+
+  count = WS2812_Produce(pWords, count, pContext);
+  Bench_WaveProducer += DWT_Cycles() - cycles;
+
+  return count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void bench_WaveDone(void * pContext)
+{
+  Bench_WaveEnd = DWT_Cycles();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Bench_Wave(void)
+{
+  Bench_WaveBuffers * pBuffers = BENCH_SCRATCH(Bench_WaveBuffers);
+  Wave_Config config;
+  Wave_Stats stats;
+  U32 i, start, frame, bitBang;
+
+  DWT_Init();
+
+  for (i = 0; i < BENCH_WAVE_STRIPS; i++)
+  {
+    GPIO_Lo(GPIOB, Bench_WavePins[i]);
+    GPIO_Init(GPIOB, Bench_WavePins[i], GPIO_TYPE_OUT_PP_50MHZ);
+  }
+  for (i = 0; i < sizeof(pBuffers->Data); i++) pBuffers->Data[i] = (U8)(i * 37);
+
+  config.pPort     = GPIOB;
+  config.Rate      = WS2812_RATE;
+  config.pBuffer   = pBuffers->Buffer;
+  config.Words     = BENCH_WAVE_WORDS;
+  config.pProducer = bench_WaveProduce;
+  config.pDone     = bench_WaveDone;
+  config.pContext  = &Bench_WaveStrip;
+
+  if (FALSE == Wave_Init(&config)) return;
+
+  WS2812_Init(&Bench_WaveStrip, Bench_WavePins, BENCH_WAVE_STRIPS, BENCH_WAVE_LEDS);
+  WS2812_Frame(&Bench_WaveStrip, pBuffers->Data);
+
+  Bench_WaveProducer = 0;
+  start = DWT_Cycles();
+  Wave_Start();
+  while (TRUE == Wave_IsBusy())
+  {
+    vTaskDelay(1);
+  }
+  frame = Bench_WaveEnd - start;
+  Wave_GetStats(&stats);
+  Wave_Stop();
+
+  bitBang = bench_WaveBitBang(pBuffers->Data);
+
+  printf("WS2812 frame, %d strips x %d LEDs, %d words/s, cycles\r\n", BENCH_WAVE_STRIPS,
+         BENCH_WAVE_LEDS, Wave_GetRate());
+  printf("  Bit-bang   %8d (interrupts masked)\r\n", bitBang);
+  printf("  Wave       %8d, CPU %d (%d.%02d%%), late halves %d\r\n", frame, Bench_WaveProducer,
+         Bench_WaveProducer * 100 / frame, (Bench_WaveProducer * 10000 / frame) % 100, stats.Late);
+#if (1 == WAVE_PROFILE)
+  printf("  Interrupt  %8d\r\n", stats.Cycles);
+#endif
+}
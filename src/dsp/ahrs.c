@@ -0,0 +1,179 @@
+#include "types.h"
+#include "dsp.h"
+#include "matrix.h"
+#include "quat.h"
+#include "ahrs.h"
+
+/* The rate of change of the quaternion is kept in Q24: |dq/dt| <= |w| / 2 leaves room for 256 rad/s
+   and the step dq/dt * dt (with dt in Q30) lands back in Q30 with a single shift.                */
+#define AHRS_DOT_FRAC                      (24)
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Rounded to nearest: a truncating shift of a small error is -1 LSB half of the time, which the
+   filters would integrate as a steady turn about the unobservable vertical                     */
+
+__STATIC_INLINE S64 ahrs_Round(S64 acc, U32 frac)
+{
+  return (acc + ((S64)1 << (frac - 1))) >> frac;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static S32 ahrs_Period(U32 rate)
+{
+  return (S32)((QUAT_ONE + (rate >> 1)) / rate);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* q += (q (0, w) / 2 - correction) dt, then q is normalized. Rates are Q16.16, the correction is
+   in Q24 and may be NULL.                                                                        */
+
+static void ahrs_Integrate(Quat * pQ, const Vec3 * pRate, const Quat * pCorrection, S32 dt)
+{
+  S64 w = pQ->W, x = pQ->X, y = pQ->Y, z = pQ->Z;
+  S64 gx = pRate->X, gy = pRate->Y, gz = pRate->Z;
+  S32 dw, dx, dy, dz;
+
+  /* Q30 * Q16 = Q46, one more bit for the half */
+  dw = (S32)((-x * gx - y * gy - z * gz) >> (QUAT_FRAC + 16 + 1 - AHRS_DOT_FRAC));
+  dx = (S32)(( w * gx + y * gz - z * gy) >> (QUAT_FRAC + 16 + 1 - AHRS_DOT_FRAC));
+  dy = (S32)(( w * gy - x * gz + z * gx) >> (QUAT_FRAC + 16 + 1 - AHRS_DOT_FRAC));
+  dz = (S32)(( w * gz + x * gy - y * gx) >> (QUAT_FRAC + 16 + 1 - AHRS_DOT_FRAC));
+
+  if (NULL != pCorrection)
+  {
+    dw -= pCorrection->W;
+    dx -= pCorrection->X;
+    dy -= pCorrection->Y;
+    dz -= pCorrection->Z;
+  }
+
+  pQ->W += (S32)ahrs_Round((S64)dw * dt, AHRS_DOT_FRAC);
+  pQ->X += (S32)ahrs_Round((S64)dx * dt, AHRS_DOT_FRAC);
+  pQ->Y += (S32)ahrs_Round((S64)dy * dt, AHRS_DOT_FRAC);
+  pQ->Z += (S32)ahrs_Round((S64)dz * dt, AHRS_DOT_FRAC);
+
+  (void)Quat_Normalize(pQ);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Copies and normalizes the accelerometer vector, FALSE if there is none to use */
+
+static U32 ahrs_Gravity(Vec3 * pOut, const Vec3 * pAccel)
+{
+  if (NULL == pAccel) return FALSE;
+
+  *pOut = *pAccel;
+  return Vec3_Normalize(pOut);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Madgwick_Init(Madgwick * pFilter, U32 rate, S32 beta)
+{
+  Quat_Identity(&pFilter->Q);
+  pFilter->Beta = beta;
+  pFilter->Dt   = ahrs_Period(rate);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The objective is f = R(q)^T (0, 0, 1) - a, its gradient is J^T f:
+     f1 = 2 (xz - wy) - ax,  f2 = 2 (wx + yz) - ay,  f3 = 1 - 2 (x^2 + y^2) - az
+     s  = (-2y f1 + 2x f2,  2z f1 + 2w f2 - 4x f3,  -2w f1 + 2z f2 - 4y f3,  2x f1 + 2y f2)
+   f and s are in Q26 (|s| < 32), only the direction of s is used.                                */
+
+void Madgwick_Update(Madgwick * pFilter, const Vec3 * pGyro, const Vec3 * pAccel)
+{
+  S64 w = pFilter->Q.W, x = pFilter->Q.X, y = pFilter->Q.Y, z = pFilter->Q.Z;
+  S64 f1, f2, f3;
+  Quat step;
+  Vec3 a;
+
+  if (FALSE == ahrs_Gravity(&a, pAccel))
+  {
+    ahrs_Integrate(&pFilter->Q, pGyro, NULL, pFilter->Dt);
+    return;
+  }
+
+  f1 = ahrs_Round(x * z - w * y, 33) - ahrs_Round(a.X, 4);
+  f2 = ahrs_Round(w * x + y * z, 33) - ahrs_Round(a.Y, 4);
+  f3 = (1 << 26) - ahrs_Round(x * x + y * y, 33) - ahrs_Round(a.Z, 4);
+
+  step.W = (S32)ahrs_Round(-y * f1 + x * f2, 29);
+  step.X = (S32)ahrs_Round( z * f1 + w * f2 - 2 * x * f3, 29);
+  step.Y = (S32)ahrs_Round(-w * f1 + z * f2 - 2 * y * f3, 29);
+  step.Z = (S32)ahrs_Round( x * f1 + y * f2, 29);
+
+  /* At the optimum the gradient vanishes, there is nothing to correct */
+  if (FALSE == Quat_Normalize(&step))
+  {
+    ahrs_Integrate(&pFilter->Q, pGyro, NULL, pFilter->Dt);
+    return;
+  }
+
+  /* Q30 * Q30 to Q24 */
+  step.W = (S32)ahrs_Round((S64)pFilter->Beta * step.W, 2 * QUAT_FRAC - AHRS_DOT_FRAC);
+  step.X = (S32)ahrs_Round((S64)pFilter->Beta * step.X, 2 * QUAT_FRAC - AHRS_DOT_FRAC);
+  step.Y = (S32)ahrs_Round((S64)pFilter->Beta * step.Y, 2 * QUAT_FRAC - AHRS_DOT_FRAC);
+  step.Z = (S32)ahrs_Round((S64)pFilter->Beta * step.Z, 2 * QUAT_FRAC - AHRS_DOT_FRAC);
+
+  ahrs_Integrate(&pFilter->Q, pGyro, &step, pFilter->Dt);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mahony_Init(Mahony * pFilter, U32 rate, S32 kp, S32 ki)
+{
+  Quat_Identity(&pFilter->Q);
+  pFilter->Kp     = kp;
+  pFilter->Ki     = ki;
+  pFilter->Dt     = ahrs_Period(rate);
+  pFilter->Bias.X = 0;
+  pFilter->Bias.Y = 0;
+  pFilter->Bias.Z = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The error is the cross product of the measured and the estimated gravity (both unit, Q30). The
+   corrected rate is w + Kp e + Ki integral(e dt).                                                */
+
+void Mahony_Update(Mahony * pFilter, const Vec3 * pGyro, const Vec3 * pAccel)
+{
+  S64 w = pFilter->Q.W, x = pFilter->Q.X, y = pFilter->Q.Y, z = pFilter->Q.Z;
+  S64 vx, vy, vz;
+  Vec3 a, e, rate;
+
+  rate = *pGyro;
+
+  if (TRUE == ahrs_Gravity(&a, pAccel))
+  {
+    /* Gravity in the body frame, the third row of R(q) */
+    vx = (x * z - w * y) >> 29;
+    vy = (w * x + y * z) >> 29;
+    vz = (w * w - x * x - y * y + z * z) >> 30;
+
+    e.X = (S32)ahrs_Round(a.Y * vz - a.Z * vy, 30);
+    e.Y = (S32)ahrs_Round(a.Z * vx - a.X * vz, 30);
+    e.Z = (S32)ahrs_Round(a.X * vy - a.Y * vx, 30);
+
+    /* Ki e dt: Q16 * Q30 * Q30 to Q30 */
+    if (0 != pFilter->Ki)
+    {
+      pFilter->Bias.X += (S32)ahrs_Round(ahrs_Round((S64)pFilter->Ki * e.X, 16) * pFilter->Dt, 30);
+      pFilter->Bias.Y += (S32)ahrs_Round(ahrs_Round((S64)pFilter->Ki * e.Y, 16) * pFilter->Dt, 30);
+      pFilter->Bias.Z += (S32)ahrs_Round(ahrs_Round((S64)pFilter->Ki * e.Z, 16) * pFilter->Dt, 30);
+    }
+
+    /* Kp e: Q16 * Q30 to Q16, the bias from Q30 to Q16 */
+    rate.X += (S32)ahrs_Round((S64)pFilter->Kp * e.X, 30) + (S32)ahrs_Round(pFilter->Bias.X, 14);
+    rate.Y += (S32)ahrs_Round((S64)pFilter->Kp * e.Y, 30) + (S32)ahrs_Round(pFilter->Bias.Y, 14);
+    rate.Z += (S32)ahrs_Round((S64)pFilter->Kp * e.Z, 30) + (S32)ahrs_Round(pFilter->Bias.Z, 14);
+  }
+
+  ahrs_Integrate(&pFilter->Q, &rate, NULL, pFilter->Dt);
+}
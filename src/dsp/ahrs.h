@@ -0,0 +1,40 @@
+#ifndef __AHRS_H__
+#define __AHRS_H__
+
+#include "types.h"
+#include "dsp.h"
+#include "matrix.h"
+#include "quat.h"
+
+/* Attitude from a gyroscope and an accelerometer (6-axis IMU) in fixed point. The gyroscope rates
+   are rad/s in Q16.16 (Q16(x)), the accelerometer vector may have any scale since only its
+   direction is used: pass the raw reading. A NULL or zero accelerometer vector integrates the
+   gyroscope alone (free fall, saturated sensor). The attitude is the body to earth rotation.     */
+
+/* Madgwick: gradient descent step towards the measured gravity, Beta in Q30 (Q30(0.04) is a
+   common choice: larger follows the accelerometer faster, smaller filters vibration better).     */
+typedef struct
+{
+  Quat Q;
+  S32  Beta;                               /* Q30                                                 */
+  S32  Dt;                                 /* Sample period, Q30 seconds                          */
+} Madgwick;
+
+void Madgwick_Init(Madgwick * pFilter, U32 rate, S32 beta);
+void Madgwick_Update(Madgwick * pFilter, const Vec3 * pGyro, const Vec3 * pAccel);
+
+/* Mahony: PI controller on the angle between the measured and the estimated gravity. Kp and Ki
+   in Q16.16, the integral is the estimated gyroscope bias in Q30 rad/s.                          */
+typedef struct
+{
+  Quat Q;
+  S32  Kp;                                 /* Q16.16                                              */
+  S32  Ki;                                 /* Q16.16, 0 disables the bias estimation              */
+  S32  Dt;                                 /* Sample period, Q30 seconds                          */
+  Vec3 Bias;                               /* Q30 rad/s                                           */
+} Mahony;
+
+void Mahony_Init(Mahony * pFilter, U32 rate, S32 kp, S32 ki);
+void Mahony_Update(Mahony * pFilter, const Vec3 * pGyro, const Vec3 * pAccel);
+
+#endif /* __AHRS_H__ */
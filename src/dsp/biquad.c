@@ -0,0 +1,103 @@
+#include <string.h>
+
+#include "types.h"
+#include "dsp.h"
+#include "biquad.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Biquad_Q15_Init(Biquad_Q15 * pBiquad, const Q15 * pCoeffs, U8 stages, U8 shift, Q15 * pState)
+{
+  pBiquad->pCoeffs = pCoeffs;
+  pBiquad->pState  = pState;
+  pBiquad->Stages  = stages;
+  pBiquad->Shift   = shift;
+
+  memset(pState, 0, stages * BIQUAD_STATE * sizeof(Q15));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Stage by stage over the whole block: the coefficients and the state of a stage stay in
+   registers for the inner loop, only x and y move through memory. The first stage reads pIn,
+   the others work in place in pOut.                                                             */
+
+void Biquad_Q15_Run(Biquad_Q15 * pBiquad, const Q15 * pIn, Q15 * pOut, U32 count)
+{
+  const Q15 * pCoeffs = pBiquad->pCoeffs;
+  Q15 * pState = pBiquad->pState;
+  U32 shift = 15 - pBiquad->Shift, stage, n;
+  S32 b0, b1, b2, a1, a2, x0, x1, x2, y1, y2;
+  S64 acc;
+
+  for (stage = 0; stage < pBiquad->Stages; stage++)
+  {
+    b0 = pCoeffs[0]; b1 = pCoeffs[1]; b2 = pCoeffs[2]; a1 = pCoeffs[3]; a2 = pCoeffs[4];
+    x1 = pState[0];  x2 = pState[1];  y1 = pState[2];  y2 = pState[3];
+
+    for (n = 0; n < count; n++)
+    {
+      x0  = pIn[n];
+      acc = (S64)b0 * x0 + (S64)b1 * x1 + (S64)b2 * x2 + (S64)a1 * y1 + (S64)a2 * y2;
+      x2  = x1;
+      x1  = x0;
+      y2  = y1;
+      y1  = Q15_Sat((S32)((acc + (1 << (shift - 1))) >> shift));
+      pOut[n] = (Q15)y1;
+    }
+
+    pState[0] = (Q15)x1; pState[1] = (Q15)x2; pState[2] = (Q15)y1; pState[3] = (Q15)y2;
+    pCoeffs += BIQUAD_COEFFS;
+    pState  += BIQUAD_STATE;
+    pIn = pOut;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Biquad_Q31_Init(Biquad_Q31 * pBiquad, const Q31 * pCoeffs, U8 stages, U8 shift, Q31 * pState)
+{
+  pBiquad->pCoeffs = pCoeffs;
+  pBiquad->pState  = pState;
+  pBiquad->Stages  = stages;
+  pBiquad->Shift   = shift;
+
+  memset(pState, 0, stages * BIQUAD_STATE * sizeof(Q31));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Biquad_Q31_Run(Biquad_Q31 * pBiquad, const Q31 * pIn, Q31 * pOut, U32 count)
+{
+  const Q31 * pCoeffs = pBiquad->pCoeffs;
+  Q31 * pState = pBiquad->pState;
+  U32 shift = 31 - pBiquad->Shift, stage, n;
+  Q31 b0, b1, b2, a1, a2, x0, x1, x2, y1, y2;
+  S64 acc;
+
+  for (stage = 0; stage < pBiquad->Stages; stage++)
+  {
+    b0 = pCoeffs[0]; b1 = pCoeffs[1]; b2 = pCoeffs[2]; a1 = pCoeffs[3]; a2 = pCoeffs[4];
+    x1 = pState[0];  x2 = pState[1];  y1 = pState[2];  y2 = pState[3];
+
+    for (n = 0; n < count; n++)
+    {
+      x0  = pIn[n];
+      acc = (S64)b0 * x0;
+      acc += (S64)b1 * x1;
+      acc += (S64)b2 * x2;
+      acc += (S64)a1 * y1;
+      acc += (S64)a2 * y2;
+      x2  = x1;
+      x1  = x0;
+      y2  = y1;
+      y1  = Q31_Sat((acc + ((S64)1 << (shift - 1))) >> shift);
+      pOut[n] = y1;
+    }
+
+    pState[0] = x1; pState[1] = x2; pState[2] = y1; pState[3] = y2;
+    pCoeffs += BIQUAD_COEFFS;
+    pState  += BIQUAD_STATE;
+    pIn = pOut;
+  }
+}
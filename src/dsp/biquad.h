@@ -0,0 +1,39 @@
+#ifndef __BIQUAD_H__
+#define __BIQUAD_H__
+
+#include "types.h"
+#include "dsp.h"
+
+/* Cascades of Direct Form I biquads. Each stage has 5 coefficients {b0, b1, b2, a1, a2}:
+     y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] + a1 y[n-1] + a2 y[n-2]
+   Note the sign of a1 and a2: they are negated compared to the usual design tools (as in
+   CMSIS-DSP). Coefficients of magnitude above 1 are scaled down by 2^Shift, the sum is scaled
+   back before the output of every stage.                                                        */
+
+#define BIQUAD_COEFFS                      (5)
+#define BIQUAD_STATE                       (4)
+
+typedef struct
+{
+  const Q15 * pCoeffs;                     /* BIQUAD_COEFFS per stage                             */
+  Q15 *       pState;                      /* BIQUAD_STATE per stage: x1, x2, y1, y2              */
+  U8          Stages;
+  U8          Shift;
+} Biquad_Q15;
+
+/* The 64-bit accumulator has one guard bit: |x| and the coefficient sum must keep it below 2 */
+typedef struct
+{
+  const Q31 * pCoeffs;
+  Q31 *       pState;
+  U8          Stages;
+  U8          Shift;
+} Biquad_Q31;
+
+void Biquad_Q15_Init(Biquad_Q15 * pBiquad, const Q15 * pCoeffs, U8 stages, U8 shift, Q15 * pState);
+void Biquad_Q15_Run(Biquad_Q15 * pBiquad, const Q15 * pIn, Q15 * pOut, U32 count);
+
+void Biquad_Q31_Init(Biquad_Q31 * pBiquad, const Q31 * pCoeffs, U8 stages, U8 shift, Q31 * pState);
+void Biquad_Q31_Run(Biquad_Q31 * pBiquad, const Q31 * pIn, Q31 * pOut, U32 count);
+
+#endif /* __BIQUAD_H__ */
@@ -0,0 +1,119 @@
+#include <string.h>
+
+#include "types.h"
+#include "dsp.h"
+#include "ramfunc.h"
+#include "control.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void PID_Init(PID * pPid, const PID_Config * pConfig)
+{
+  pPid->pConfig = pConfig;
+  PID_Reset(pPid, 0, 0);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void PID_Reset(PID * pPid, S32 measure, S32 output)
+{
+  pPid->Integral   = (S64)output << PID_INTEGRAL_FRAC;
+  pPid->Derivative = 0;
+  pPid->Measure    = measure;
+  pPid->Output     = output;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Bounds of the 64-bit intermediates with |setpoint|, |measure| < 2^16 and gains below 2^31:
+   the proportional and feed-forward terms below 2^48, the integral step below 2^48 and the
+   integral itself within the output limits (2^55), the derivative below 2^60.                    */
+
+RAMFUNC S32 PID_Update(PID * pPid, S32 setpoint, S32 measure)
+{
+  const PID_Config * pConfig = pPid->pConfig;
+  S64 error, step, integral, limit, output;
+  S32 result, difference, low, high;
+
+  error = (S64)setpoint - measure;
+
+  /* d = d + alpha (-(measure - previous) - d) */
+  difference = (pPid->Measure - measure) << PID_DERIVATIVE_FRAC;
+  pPid->Derivative += (S32)(((S64)(difference - pPid->Derivative) * pConfig->Alpha) >> 15);
+  pPid->Measure = measure;
+
+  step = (S64)pConfig->Ki * error;
+  integral = pPid->Integral + step;
+  limit = (S64)pConfig->OutMax << PID_INTEGRAL_FRAC;
+  if (integral > limit) integral = limit;
+  limit = (S64)pConfig->OutMin << PID_INTEGRAL_FRAC;
+  if (integral < limit) integral = limit;
+
+  /* Sum in Q16, rounded */
+  output = (S64)pConfig->Kp * error + (S64)pConfig->Kff * setpoint +
+           (integral >> (PID_INTEGRAL_FRAC - 16)) +
+           (((S64)pConfig->Kd * pPid->Derivative) >> PID_DERIVATIVE_FRAC);
+  output = (output + 0x8000) >> 16;
+
+  low  = pConfig->OutMin;
+  high = pConfig->OutMax;
+  if (0 != pConfig->RateMax)
+  {
+    if (low  < pPid->Output - pConfig->RateMax) low  = pPid->Output - pConfig->RateMax;
+    if (high > pPid->Output + pConfig->RateMax) high = pPid->Output + pConfig->RateMax;
+  }
+
+  if (output > high)      result = high;
+  else if (output < low)  result = low;
+  else                    result = (S32)output;
+
+  /* The step is dropped when it pushes further into the limit holding the output */
+  if (!(((output > result) && (0 < step)) || ((output < result) && (0 > step))))
+  {
+    pPid->Integral = integral;
+  }
+
+  pPid->Output = result;
+  return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void StateSpace_Init(StateSpace * pSS, const StateSpace_Config * pConfig)
+{
+  pSS->pConfig = pConfig;
+  memset(pSS->X, 0, sizeof(pSS->X));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+RAMFUNC S32 StateSpace_Update(StateSpace * pSS, const S32 * pInput)
+{
+  const StateSpace_Config * pConfig = pSS->pConfig;
+  U32 frac = pConfig->Frac, i, j;
+  S32 x[STATESPACE_STATES_MAX];
+  S64 acc, round = (0 < frac) ? ((S64)1 << (frac - 1)) : 0;
+  S32 result;
+
+  /* By hand: memcpy() stays in flash and would be reached through a veneer */
+  for (i = 0; i < pConfig->States; i++) x[i] = pSS->X[i];
+
+  acc = round;
+  for (i = 0; i < pConfig->States; i++) acc += (S64)pConfig->C[i] * x[i];
+  for (j = 0; j < pConfig->Inputs; j++) acc += (S64)pConfig->D[j] * pInput[j];
+  acc >>= frac;
+
+  if (acc > pConfig->OutMax)      result = pConfig->OutMax;
+  else if (acc < pConfig->OutMin) result = pConfig->OutMin;
+  else                            result = (S32)acc;
+
+  for (i = 0; i < pConfig->States; i++)
+  {
+    acc = round;
+    for (j = 0; j < pConfig->States; j++) acc += (S64)pConfig->A[i][j] * x[j];
+    for (j = 0; j < pConfig->Inputs; j++) acc += (S64)pConfig->B[i][j] * pInput[j];
+    pSS->X[i] = Q31_Sat(acc >> frac);
+  }
+
+  return result;
+}
@@ -0,0 +1,97 @@
+#ifndef __CONTROL_H__
+#define __CONTROL_H__
+
+#include "types.h"
+#include "dsp.h"
+#include "ramfunc.h"
+
+/* Fixed-point controllers for loops closed in a timer interrupt. The updates have no loop that
+   depends on the data, no division and no library call, they run from SRAM (RAMFUNC) so that the
+   flash wait states do not add jitter: the worst case is the cost of the longest path, measured
+   by Bench_Control(). They keep no global state and call no kernel function, so any context may
+   run them, one instance is only ever updated from one context.
+
+   The setpoint and the measurement are S32 within +-2^16 (ADC or PWM codes, Q15, scaled
+   engineering units), the output has the same unit as the limits. Gains in Q16.16 unless noted,
+   the configuration may be a const table in flash and is shared by all instances using it.      */
+
+/* Gains of a continuous design (ki in 1/s, kd in s) for an update rate in Hz */
+#define PID_KP(kp)                         Q16(kp)
+#define PID_KI(ki, rate) \
+  ((S32)(((ki) < 0) ? ((ki) * 16777216.0 / (rate) - 0.5) : ((ki) * 16777216.0 / (rate) + 0.5)))
+#define PID_KD(kd, rate)                   Q16((kd) * (rate))
+
+/* First-order low-pass on the derivative, cutoff in Hz (w / (1 + w) with w = 2 pi fc / rate) */
+#define PID_ALPHA(cutoff, rate) \
+  Q15((6.283185307179586 * (cutoff)) / ((rate) + 6.283185307179586 * (cutoff)))
+
+/* Fraction bits of the filtered measurement difference and of the integral */
+#define PID_DERIVATIVE_FRAC                (12)
+#define PID_INTEGRAL_FRAC                  (24)
+
+typedef struct
+{
+  S32 Kp;                                  /* Q16.16                                              */
+  S32 Ki;                                  /* Q8.24, per update (ki / rate): PID_KI()             */
+  S32 Kd;                                  /* Q16.16, per update (kd * rate): PID_KD()            */
+  S32 Kff;                                 /* Q16.16, setpoint feed-forward                       */
+  Q15 Alpha;                               /* Derivative filter, Q15_MAX for none                 */
+  S32 OutMin;
+  S32 OutMax;
+  S32 RateMax;                             /* Largest output change per update, 0 for no limit    */
+} PID_Config;
+
+typedef struct
+{
+  const PID_Config * pConfig;
+  S64 Integral;                            /* Output unit, PID_INTEGRAL_FRAC                      */
+  S32 Derivative;                          /* Measurement change per update, PID_DERIVATIVE_FRAC  */
+  S32 Measure;                             /* Previous measurement                                */
+  S32 Output;                              /* Previous output                                     */
+} PID;
+
+/* u = Kp e + sum(Ki e) - Kd d(measure) + Kff setpoint, limited to [OutMin, OutMax] and to RateMax
+   per update. The derivative acts on the measurement (no kick on a setpoint step). Anti-windup by
+   conditional integration: the integral does not move further into a limit that holds the output,
+   whether the range or the rate limit.                                                           */
+void PID_Init(PID * pPid, const PID_Config * pConfig);
+
+/* Bumpless start or transfer from another controller: the next update continues from 'output'
+   with no derivative kick from 'measure'                                                         */
+void PID_Reset(PID * pPid, S32 measure, S32 output);
+
+RAMFUNC S32 PID_Update(PID * pPid, S32 setpoint, S32 measure);
+
+/* Discrete state-space controller (or observer, or plant model):
+     y[k] = C x[k] + D u[k],  x[k+1] = A x[k] + B u[k]
+   with the coefficients in Q(Frac). The inputs are usually the setpoint and the measurement; for
+   anti-windup pass the output actually applied (limited) as one of the inputs, as in an observer
+   form. The states saturate to S32.                                                              */
+#define STATESPACE_STATES_MAX              (4)
+#define STATESPACE_INPUTS_MAX              (2)
+
+typedef struct
+{
+  S32 A[STATESPACE_STATES_MAX][STATESPACE_STATES_MAX];
+  S32 B[STATESPACE_STATES_MAX][STATESPACE_INPUTS_MAX];
+  S32 C[STATESPACE_STATES_MAX];
+  S32 D[STATESPACE_INPUTS_MAX];
+  U8  States;
+  U8  Inputs;
+  U8  Frac;
+  S32 OutMin;
+  S32 OutMax;
+} StateSpace_Config;
+
+typedef struct
+{
+  const StateSpace_Config * pConfig;
+  S32 X[STATESPACE_STATES_MAX];
+} StateSpace;
+
+void StateSpace_Init(StateSpace * pSS, const StateSpace_Config * pConfig);
+
+/* The loops run over the configured size, the worst case is at the largest size */
+RAMFUNC S32 StateSpace_Update(StateSpace * pSS, const S32 * pInput);
+
+#endif /* __CONTROL_H__ */
@@ -0,0 +1,72 @@
+#ifndef __DSP_H__
+#define __DSP_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* Fixed-point formats: Q15 is [-1, 1) in S16, Q31 is [-1, 1) in S32. The M3 has SSAT/USAT and
+   the 32x32 -> 64 multiply-accumulate (SMLAL), but no saturating add and no dual 16-bit MAC, so
+   the kernels accumulate in 64 bits and saturate once per output.                                */
+typedef S16 Q15;
+typedef S32 Q31;
+
+#define Q15_MAX                            ((Q15)0x7FFF)
+#define Q15_MIN                            ((Q15)-0x8000)
+#define Q31_MAX                            ((Q31)0x7FFFFFFF)
+#define Q31_MIN                            ((Q31)(-0x7FFFFFFF - 1))
+
+/* Constants from real numbers, folded by the compiler: rounded to nearest, 1.0 saturates */
+#define Q15(x) \
+  ((Q15)(((x) >= 1.0) ? 32767.0 : (((x) < 0) ? ((x) * 32768.0 - 0.5) : ((x) * 32768.0 + 0.5))))
+#define Q31(x) \
+  ((Q31)(((x) >= 1.0) ? 2147483647.0 : \
+         (((x) < 0) ? ((x) * 2147483648.0 - 0.5) : ((x) * 2147483648.0 + 0.5))))
+
+/* Q16.16 and Q30 constants in S32, for rates, gains and quaternions */
+#define Q16(x) \
+  ((S32)(((x) < 0) ? ((x) * 65536.0 - 0.5) : ((x) * 65536.0 + 0.5)))
+#define Q30(x) \
+  ((S32)(((x) < 0) ? ((x) * 1073741824.0 - 0.5) : ((x) * 1073741824.0 + 0.5)))
+
+__STATIC_INLINE Q15 Q15_Sat(S32 x)
+{
+  return (Q15)__SSAT(x, 16);
+}
+
+__STATIC_INLINE Q31 Q31_Sat(S64 x)
+{
+  if (x > (S64)Q31_MAX) return Q31_MAX;
+  if (x < (S64)Q31_MIN) return Q31_MIN;
+  return (Q31)x;
+}
+
+__STATIC_INLINE Q15 Q15_Add(Q15 a, Q15 b)
+{
+  return Q15_Sat((S32)a + b);
+}
+
+/* Overflow happened if both operands have the sign opposite to the sum */
+__STATIC_INLINE Q31 Q31_Add(Q31 a, Q31 b)
+{
+  Q31 sum = (Q31)((U32)a + (U32)b);
+
+  if (0 > ((a ^ sum) & (b ^ sum))) sum = (0 > a) ? Q31_MIN : Q31_MAX;
+  return sum;
+}
+
+/* Rounded products, -1 * -1 saturates */
+__STATIC_INLINE Q15 Q15_Mul(Q15 a, Q15 b)
+{
+  return Q15_Sat(((S32)a * b + 0x4000) >> 15);
+}
+
+__STATIC_INLINE Q31 Q31_Mul(Q31 a, Q31 b)
+{
+  return Q31_Sat(((S64)a * b + 0x40000000) >> 31);
+}
+
+/* Q15 to an unsigned 'bits' wide code (DAC, PWM compare): [-1, 1) -> [0, 2^bits) */
+#define Q15_ToUnsigned(x, bits) \
+  ((U32)__USAT(((S32)(x) + 0x8000) >> (16 - (bits)), (bits)))
+
+#endif /* __DSP_H__ */
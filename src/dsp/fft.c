@@ -0,0 +1,345 @@
+#include "types.h"
+#include "dsp.h"
+#include "fixmath.h"
+#include "fft.h"
+#include "fft_table.h"
+
+/* Largest real sample that pairs with any other into a complex one of magnitude below 1 */
+#define FFT_REAL_PEAK                      (23170)
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* log2 of a valid size, 0 otherwise */
+
+static U32 fft_Log2(U32 size, U32 min)
+{
+  if ((min > size) || (FFT_SIZE_MAX < size) || (0 != (size & (size - 1)))) return 0;
+  return (31 - __CLZ(size));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* x * conj(w) with w = cos + j sin. The products are below 2^31 for |x| <= sqrt(2).              */
+
+__STATIC_INLINE void fft_Rotate(Q15 * pOut, S32 re, S32 im, const Q15 * pW)
+{
+  S32 c = pW[0], s = pW[1];
+
+  pOut[0] = Q15_Sat((re * c + im * s + 0x4000) >> 15);
+  pOut[1] = Q15_Sat((im * c - re * s + 0x4000) >> 15);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The sums are kept in 32 bits and scaled by 4 once, so only the rotated outputs lose precision.
+   The two middle outputs are stored swapped: the radix-4 digit reversal becomes the plain bit
+   reversal, and mixed radix-2/radix-4 sizes share one reordering pass.                           */
+
+__STATIC_INLINE void fft_Butterfly4
+(
+  Q15 *       p0,
+  U32         quarter,
+  const Q15 * pW1,
+  const Q15 * pW2,
+  const Q15 * pW3,
+  U32         rotate
+)
+{
+  Q15 * p1 = p0 + 2 * quarter;
+  Q15 * p2 = p1 + 2 * quarter;
+  Q15 * p3 = p2 + 2 * quarter;
+  S32 t0r = (S32)p0[0] + p2[0], t0i = (S32)p0[1] + p2[1];
+  S32 t1r = (S32)p0[0] - p2[0], t1i = (S32)p0[1] - p2[1];
+  S32 t2r = (S32)p1[0] + p3[0], t2i = (S32)p1[1] + p3[1];
+  S32 t3r = (S32)p1[0] - p3[0], t3i = (S32)p1[1] - p3[1];
+
+  p0[0] = (Q15)((t0r + t2r) >> 2);
+  p0[1] = (Q15)((t0i + t2i) >> 2);
+
+  if (FALSE == rotate)
+  {
+    p1[0] = (Q15)((t0r - t2r) >> 2);
+    p1[1] = (Q15)((t0i - t2i) >> 2);
+    p2[0] = (Q15)((t1r + t3i) >> 2);
+    p2[1] = (Q15)((t1i - t3r) >> 2);
+    p3[0] = (Q15)((t1r - t3i) >> 2);
+    p3[1] = (Q15)((t1i + t3r) >> 2);
+  }
+  else
+  {
+    fft_Rotate(p1, (t0r - t2r) >> 2, (t0i - t2i) >> 2, pW2);
+    fft_Rotate(p2, (t1r + t3i) >> 2, (t1i - t3r) >> 2, pW1);
+    fft_Rotate(p3, (t1r - t3i) >> 2, (t1i + t3r) >> 2, pW3);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* One stage over sub-transforms of 'span' points. The twiddles are loaded once per column, the
+   first column has unit twiddles and no multiplications (the whole last stage is such a column). */
+
+static void fft_Radix4(Q15 * pData, U32 size, U32 span)
+{
+  U32 quarter = span >> 2;
+  U32 step = 2 * (FFT_TABLE_SIZE / span);
+  Q15 * pEnd = &pData[2 * size];
+  Q15 * p0;
+  U32 n;
+
+  for (p0 = pData; p0 < pEnd; p0 += 2 * span)
+  {
+    fft_Butterfly4(p0, quarter, NULL, NULL, NULL, FALSE);
+  }
+
+  for (n = 1; n < quarter; n++)
+  {
+    const Q15 * pW1 = &FFT_Twiddles[n * step];
+    const Q15 * pW2 = &FFT_Twiddles[2 * n * step];
+    const Q15 * pW3 = &FFT_Twiddles[3 * n * step];
+
+    for (p0 = &pData[2 * n]; p0 < pEnd; p0 += 2 * span)
+    {
+      fft_Butterfly4(p0, quarter, pW1, pW2, pW3, TRUE);
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The first stage of the odd powers of 2: even bins to the first half, odd bins to the second */
+
+static void fft_Radix2(Q15 * pData, U32 size)
+{
+  const Q15 * pW = FFT_Twiddles;
+  U32 step = 2 * (FFT_TABLE_SIZE / size);
+  Q15 * pA = pData;
+  Q15 * pB = pData + size;
+  S32 dr, di;
+  U32 n;
+
+  for (n = (size >> 1); 0 < n; n--)
+  {
+    dr = ((S32)pA[0] - pB[0]) >> 1;
+    di = ((S32)pA[1] - pB[1]) >> 1;
+    pA[0] = (Q15)(((S32)pA[0] + pB[0]) >> 1);
+    pA[1] = (Q15)(((S32)pA[1] + pB[1]) >> 1);
+    fft_Rotate(pB, dr, di, pW);
+    pA += 2;
+    pB += 2;
+    pW += step;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A complex sample is one word, RBIT gives the reversed index in a single instruction */
+
+static void fft_BitReverse(Q15 * pData, U32 log2Size)
+{
+  U32 * pWords = (U32 *)pData;
+  U32 shift = 32 - log2Size;
+  U32 i, j, tmp;
+
+  for (i = 1; i < ((1U << log2Size) - 1); i++)
+  {
+    j = __RBIT(i) >> shift;
+    if (i < j)
+    {
+      tmp       = pWords[i];
+      pWords[i] = pWords[j];
+      pWords[j] = tmp;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* IFFT(x) = swap(FFT(swap(x))), where swap exchanges re and im: one rotation per sample */
+
+static void fft_Swap(Q15 * pData, U32 size)
+{
+  U32 * pWords = (U32 *)pData;
+
+  for (; 0 < size; size--, pWords++)
+  {
+    *pWords = __ROR(*pWords, 16);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 FFT_Q15_Complex(Q15 * pData, U32 size, U32 inverse)
+{
+  U32 log2Size = fft_Log2(size, FFT_SIZE_MIN);
+  U32 span = size;
+
+  if (0 == log2Size) return FALSE;
+
+  if (FALSE != inverse) fft_Swap(pData, size);
+
+  if (0 != (log2Size & 1))
+  {
+    fft_Radix2(pData, size);
+    span >>= 1;
+  }
+  for (; 4 <= span; span >>= 2)
+  {
+    fft_Radix4(pData, size, span);
+  }
+  fft_BitReverse(pData, log2Size);
+
+  if (FALSE != inverse) fft_Swap(pData, size);
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The even samples are the real and the odd samples the imaginary parts of a half size complex
+   sequence z. With A = Z[k], B = Z[M - k], M = size / 2 and W = exp(-j 2 pi k / size):
+     X[k]     = (A + conj(B) - j W (A - conj(B))) / 4
+     X[M - k] = conj of the same with the roles of A and B exchanged
+   so each pass of the split loop produces two bins from the same loads and the same twiddle.
+   A pair of samples is one complex input, which must stay below 1 in magnitude: when a sample
+   is above 1/sqrt(2) all of them are halved first, and the split scales by 2 instead of 4.       */
+
+U32 FFT_Q15_Real(Q15 * pData, U32 size)
+{
+  const Q15 * pW;
+  U32 step = 2 * (FFT_TABLE_SIZE / size);
+  U32 shift = 2, n;
+  Q15 * pA = &pData[2];
+  Q15 * pB = &pData[size - 2];
+  S32 er, ei, dr, di, c, s, p, q;
+
+  if (0 == fft_Log2(size, 2 * FFT_SIZE_MIN)) return FALSE;
+
+  for (n = 0; n < size; n++)
+  {
+    if ((FFT_REAL_PEAK < pData[n]) || (-FFT_REAL_PEAK > pData[n])) break;
+  }
+  if (n < size)
+  {
+    for (n = 0; n < size; n++) pData[n] = (Q15)(pData[n] >> 1);
+    shift = 1;
+  }
+
+  (void)FFT_Q15_Complex(pData, size >> 1, FALSE);
+
+  /* DC and Nyquist are real, both come from Z[0] */
+  er = pData[0];
+  ei = pData[1];
+  pData[0] = (Q15)((er + ei) >> (shift - 1));
+  pData[1] = (Q15)((er - ei) >> (shift - 1));
+
+  for (pW = &FFT_Twiddles[step]; pA < pB; pA += 2, pB -= 2, pW += step)
+  {
+    er = (S32)pA[0] + pB[0];
+    ei = (S32)pA[1] - pB[1];
+    dr = ((S32)pA[0] - pB[0]) >> 1;
+    di = ((S32)pA[1] + pB[1]) >> 1;
+    c  = pW[0];
+    s  = pW[1];
+    p  = (c * dr + s * di) >> 14;
+    q  = (c * di - s * dr) >> 14;
+
+    pA[0] = Q15_Sat((er + q) >> shift);
+    pA[1] = Q15_Sat((ei - p) >> shift);
+    pB[0] = Q15_Sat((er - q) >> shift);
+    pB[1] = Q15_Sat((-ei - p) >> shift);
+  }
+
+  /* k = M / 2: W = -j, the bin is conj(Z[M / 2]) / 2 */
+  pA[0] = Q15_Sat((S32)pA[0] >> (shift - 1));
+  pA[1] = Q15_Sat(-(S32)pA[1] >> (shift - 1));
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* w[n] = (1 - cos(2 pi n / size)) / 2, the cosine is read from the twiddle table, mirrored for
+   the second half                                                                                */
+
+void FFT_Q15_Hann(Q15 * pData, U32 size)
+{
+  U32 step = 2 * (FFT_TABLE_SIZE / size);
+  U32 n;
+  S32 w;
+
+  if (0 == fft_Log2(size, 2)) return;
+
+  for (n = 0; n < size; n++)
+  {
+    w = (32768 - FFT_Twiddles[(((size >> 1) >= n) ? n : (size - n)) * step]) >> 1;
+    pData[n] = (Q15)((pData[n] * w) >> 15);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* re^2 + im^2 is Q30 below 2^31, its square root is Q15 */
+
+__STATIC_INLINE Q15 fft_Magnitude(S32 re, S32 im)
+{
+  U32 mag = Math_Sqrt((U32)(re * re) + (U32)(im * im));
+
+  return (Q15)((mag > (U32)Q15_MAX) ? Q15_MAX : mag);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Bin k is written after its pair at 2k was read, so the output may overwrite the input */
+
+void FFT_Q15_Magnitude(const Q15 * pData, Q15 * pMag, U32 bins)
+{
+  for (; 0 < bins; bins--, pData += 2)
+  {
+    *pMag++ = fft_Magnitude(pData[0], pData[1]);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void FFT_Q15_RealMagnitude(const Q15 * pData, Q15 * pMag, U32 size)
+{
+  S32 dc = pData[0], nyquist = pData[1];
+
+  FFT_Q15_Magnitude(&pData[2], &pMag[1], (size >> 1) - 1);
+  pMag[0] = (Q15)((0 > dc) ? -dc : dc);
+  pMag[size >> 1] = (Q15)((0 > nyquist) ? -nyquist : nyquist);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The peaks are kept sorted by an insertion into a short list, the weakest one falls off */
+
+U32 FFT_Q15_Peaks(const Q15 * pMag, U32 bins, Q15 threshold, FFT_Peak * pPeaks, U32 count)
+{
+  U32 found = 0, k, i;
+  S32 left, peak, right, curve;
+
+  if (0 == count) return 0;
+
+  for (k = 1; (k + 1) < bins; k++)
+  {
+    left  = pMag[k - 1];
+    peak  = pMag[k];
+    right = pMag[k + 1];
+    if ((threshold > peak) || (left >= peak) || (right > peak)) continue;
+    if ((found == count) && (pPeaks[count - 1].Magnitude >= peak)) continue;
+
+    if (found < count) found++;
+    for (i = found - 1; (0 < i) && (pPeaks[i - 1].Magnitude < peak); i--)
+    {
+      pPeaks[i] = pPeaks[i - 1];
+    }
+
+    /* Vertex of the parabola: (left - right) / (2 (left - 2 peak + right)), within half a bin */
+    curve = left - 2 * peak + right;
+    pPeaks[i].Position  = (k << 8) + ((left - right) * 128) / curve;
+    pPeaks[i].Magnitude = (Q15)peak;
+  }
+
+  return found;
+}
@@ -0,0 +1,43 @@
+#ifndef __FFT_H__
+#define __FFT_H__
+
+#include "types.h"
+#include "dsp.h"
+
+/* In-place Q15 FFT, decimation in frequency: radix-4 stages, plus one radix-2 stage when the size
+   is an odd power of 2, then a bit-reversal pass. Every stage scales by its radix, so the output
+   is the DFT divided by the size in both directions and the butterflies can not overflow while
+   the magnitude of the input stays below 1. The data are interleaved re, im and 32-bit aligned.  */
+#define FFT_SIZE_MIN                       (16)
+#define FFT_SIZE_MAX                       (1024)
+
+/* Complex transform of 'size' points, FALSE if the size is not a power of 2 in range */
+U32 FFT_Q15_Complex(Q15 * pData, U32 size, U32 inverse);
+
+/* Forward transform of 'size' real samples, run as a complex one of size / 2. The output keeps the
+   buffer: bins 1 .. size / 2 - 1 as re, im pairs, with the (real) DC and Nyquist bins packed into
+   the first pair. Sizes from 2 * FFT_SIZE_MIN to FFT_SIZE_MAX. Samples up to 1/sqrt(2) keep the
+   accuracy of FFT_Q15_Complex(); louder input is halved first, which doubles the rounding error. */
+U32 FFT_Q15_Real(Q15 * pData, U32 size);
+
+/* Hann window over 'size' real samples, before FFT_Q15_Real(). The coherent gain is 1/2.        */
+void FFT_Q15_Hann(Q15 * pData, U32 size);
+
+/* |X| of 'bins' complex bins, saturated to Q15. pMag may be the data buffer.                     */
+void FFT_Q15_Magnitude(const Q15 * pData, Q15 * pMag, U32 bins);
+
+/* |X| of the output of FFT_Q15_Real(): size / 2 + 1 bins from DC to Nyquist, in place allowed   */
+void FFT_Q15_RealMagnitude(const Q15 * pData, Q15 * pMag, U32 size);
+
+typedef struct
+{
+  U32 Position;                            /* Bin index in 1/256 of a bin, interpolated           */
+  Q15 Magnitude;
+} FFT_Peak;
+
+/* Local maxima of a magnitude spectrum at or above 'threshold', at most 'count' of them sorted by
+   magnitude. The position is refined by a parabola through the 3 bins around the maximum, the
+   frequency is Position * fs / (256 * size). Returns the number of peaks found.                  */
+U32 FFT_Q15_Peaks(const Q15 * pMag, U32 bins, Q15 threshold, FFT_Peak * pPeaks, U32 count);
+
+#endif /* __FFT_H__ */
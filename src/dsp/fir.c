@@ -0,0 +1,182 @@
+#include <string.h>
+
+#include "types.h"
+#include "dsp.h"
+#include "fir.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* pX runs forward from the oldest sample, pB backward from the last coefficient. Unrolled by 4,
+   every product is a single SMLAL into the 64-bit accumulator.                                   */
+
+static S64 fir_DotQ15(const Q15 * pX, const Q15 * pB, U32 taps)
+{
+  S64 acc = 0;
+  U32 k;
+
+  for (k = taps >> 2; 0 < k; k--)
+  {
+    acc += (S64)pX[0] * pB[ 0];
+    acc += (S64)pX[1] * pB[-1];
+    acc += (S64)pX[2] * pB[-2];
+    acc += (S64)pX[3] * pB[-3];
+    pX += 4;
+    pB -= 4;
+  }
+
+  for (k = taps & 3; 0 < k; k--)
+  {
+    acc += (S64)*pX++ * *pB--;
+  }
+
+  return acc;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static S64 fir_DotQ31(const Q31 * pX, const Q31 * pB, U32 taps)
+{
+  S64 acc = 0;
+  U32 k;
+
+  for (k = taps >> 2; 0 < k; k--)
+  {
+    acc += (S64)pX[0] * pB[ 0];
+    acc += (S64)pX[1] * pB[-1];
+    acc += (S64)pX[2] * pB[-2];
+    acc += (S64)pX[3] * pB[-3];
+    pX += 4;
+    pB -= 4;
+  }
+
+  for (k = taps & 3; 0 < k; k--)
+  {
+    acc += (S64)*pX++ * *pB--;
+  }
+
+  return acc;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void FIR_Q15_Init(FIR_Q15 * pFir, const Q15 * pCoeffs, U16 taps, Q15 * pState, U16 blockSize)
+{
+  pFir->pCoeffs   = pCoeffs;
+  pFir->pState    = pState;
+  pFir->Taps      = taps;
+  pFir->BlockSize = blockSize;
+
+  memset(pState, 0, FIR_STATE_SIZE(taps, blockSize) * sizeof(Q15));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Any 'count' is accepted, it is processed in chunks of BlockSize. pIn and pOut may be the same
+   buffer.                                                                                        */
+
+void FIR_Q15_Run(FIR_Q15 * pFir, const Q15 * pIn, Q15 * pOut, U32 count)
+{
+  const Q15 * pLast = &pFir->pCoeffs[pFir->Taps - 1];
+  Q15 * pState = pFir->pState;
+  U32 taps = pFir->Taps, block, n;
+
+  while (0 < count)
+  {
+    block = (count > pFir->BlockSize) ? pFir->BlockSize : count;
+    memcpy(&pState[taps - 1], pIn, block * sizeof(Q15));
+
+    for (n = 0; n < block; n++)
+    {
+      pOut[n] = Q15_Sat((S32)((fir_DotQ15(&pState[n], pLast, taps) + 0x4000) >> 15));
+    }
+
+    /* The last Taps - 1 inputs are the history of the next block */
+    memmove(pState, &pState[block], (taps - 1) * sizeof(Q15));
+
+    pIn   += block;
+    pOut  += block;
+    count -= block;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void FIR_Q31_Init(FIR_Q31 * pFir, const Q31 * pCoeffs, U16 taps, Q31 * pState, U16 blockSize)
+{
+  pFir->pCoeffs   = pCoeffs;
+  pFir->pState    = pState;
+  pFir->Taps      = taps;
+  pFir->BlockSize = blockSize;
+
+  memset(pState, 0, FIR_STATE_SIZE(taps, blockSize) * sizeof(Q31));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void FIR_Q31_Run(FIR_Q31 * pFir, const Q31 * pIn, Q31 * pOut, U32 count)
+{
+  const Q31 * pLast = &pFir->pCoeffs[pFir->Taps - 1];
+  Q31 * pState = pFir->pState;
+  U32 taps = pFir->Taps, block, n;
+
+  while (0 < count)
+  {
+    block = (count > pFir->BlockSize) ? pFir->BlockSize : count;
+    memcpy(&pState[taps - 1], pIn, block * sizeof(Q31));
+
+    for (n = 0; n < block; n++)
+    {
+      pOut[n] = Q31_Sat((fir_DotQ31(&pState[n], pLast, taps) + 0x40000000) >> 31);
+    }
+
+    memmove(pState, &pState[block], (taps - 1) * sizeof(Q31));
+
+    pIn   += block;
+    pOut  += block;
+    count -= block;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void FIRDecim_Q15_Init
+(
+  FIRDecim_Q15 * pDecim,
+  const Q15 *    pCoeffs,
+  U16            taps,
+  U16            factor,
+  Q15 *          pState,
+  U16            blockSize
+)
+{
+  FIR_Q15_Init(&pDecim->Fir, pCoeffs, taps, pState, blockSize);
+  pDecim->Factor = factor;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The output is aligned to the last input of each group of Factor samples */
+
+void FIRDecim_Q15_Run(FIRDecim_Q15 * pDecim, const Q15 * pIn, Q15 * pOut, U32 count)
+{
+  FIR_Q15 * pFir = &pDecim->Fir;
+  const Q15 * pLast = &pFir->pCoeffs[pFir->Taps - 1];
+  Q15 * pState = pFir->pState;
+  U32 taps = pFir->Taps, factor = pDecim->Factor, block, n;
+
+  while (0 < count)
+  {
+    block = (count > pFir->BlockSize) ? pFir->BlockSize : count;
+    memcpy(&pState[taps - 1], pIn, block * sizeof(Q15));
+
+    for (n = factor - 1; n < block; n += factor)
+    {
+      *pOut++ = Q15_Sat((S32)((fir_DotQ15(&pState[n], pLast, taps) + 0x4000) >> 15));
+    }
+
+    memmove(pState, &pState[block], (taps - 1) * sizeof(Q15));
+
+    pIn   += block;
+    count -= block;
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef __FIR_H__
+#define __FIR_H__
+
+#include "types.h"
+#include "dsp.h"
+
+/* Block FIR filters. The state holds the last Taps - 1 inputs followed by the current block, so
+   the inner loop walks two linear arrays with no wrap-around. Coefficients are in time order:
+   y[n] = b[0] x[n] + b[1] x[n - 1] + ... + b[Taps - 1] x[n - Taps + 1]                           */
+
+/* Size of the state buffer in samples */
+#define FIR_STATE_SIZE(taps, blockSize)    ((taps) + (blockSize) - 1)
+
+/* The 64-bit accumulator can not overflow for any number of taps */
+typedef struct
+{
+  const Q15 * pCoeffs;
+  Q15 *       pState;                      /* FIR_STATE_SIZE()                                    */
+  U16         Taps;
+  U16         BlockSize;
+} FIR_Q15;
+
+typedef struct
+{
+  const Q31 * pCoeffs;
+  Q31 *       pState;                      /* FIR_STATE_SIZE()                                    */
+  U16         Taps;
+  U16         BlockSize;
+} FIR_Q31;
+
+void FIR_Q15_Init(FIR_Q15 * pFir, const Q15 * pCoeffs, U16 taps, Q15 * pState, U16 blockSize);
+void FIR_Q15_Run(FIR_Q15 * pFir, const Q15 * pIn, Q15 * pOut, U32 count);
+
+/* The accumulator has one guard bit: keep sum(|b|) * max(|x|) below 2 */
+void FIR_Q31_Init(FIR_Q31 * pFir, const Q31 * pCoeffs, U16 taps, Q31 * pState, U16 blockSize);
+void FIR_Q31_Run(FIR_Q31 * pFir, const Q31 * pIn, Q31 * pOut, U32 count);
+
+/* Decimating FIR: only every Factor-th output is computed. Both 'blockSize' and 'count' must be
+   multiples of the factor.                                                                       */
+typedef struct
+{
+  FIR_Q15     Fir;
+  U16         Factor;
+} FIRDecim_Q15;
+
+void FIRDecim_Q15_Init
+(
+  FIRDecim_Q15 * pDecim,
+  const Q15 *    pCoeffs,
+  U16            taps,
+  U16            factor,
+  Q15 *          pState,
+  U16            blockSize
+);
+void FIRDecim_Q15_Run(FIRDecim_Q15 * pDecim, const Q15 * pIn, Q15 * pOut, U32 count);
+
+#endif /* __FIR_H__ */
@@ -0,0 +1,182 @@
+#include "types.h"
+#include "dsp.h"
+#include "fixmath.h"
+#include "fixmath_table.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* One quadrant is 128 segments of 128 angle steps. The second quadrant mirrors the first, the
+   second half turn negates the first.                                                            */
+
+Q15 Math_Sin(Math_Angle angle)
+{
+  U32 phase = angle & 0x3FFF;
+  U32 index, frac;
+  S32 y;
+
+  if (0 != (angle & 0x4000)) phase = 0x4000 - phase;
+
+  index = phase >> 7;
+  frac  = phase & 0x7F;
+  y = Math_SinTable[index];
+  y += ((Math_SinTable[index + 1] - y) * (S32)frac + 64) >> 7;
+
+  return (Q15)((0 != (angle & 0x8000)) ? -y : y);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+Q15 Math_Cos(Math_Angle angle)
+{
+  return Math_Sin((Math_Angle)(angle + MATH_ANGLE_PI_2));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The angle is folded into the first octant, where the ratio of the smaller to the larger
+   coordinate is in [0, 1]: one division and one interpolation, then the octant is unfolded.      */
+
+Math_Angle Math_Atan2(S32 y, S32 x)
+{
+  U32 ax = (0 > x) ? (0 - (U32)x) : (U32)x;
+  U32 ay = (0 > y) ? (0 - (U32)y) : (U32)y;
+  U32 num, den, shift, ratio, remainder, index, frac;
+  S32 angle;
+
+  if (ay > ax)
+  {
+    num = ax;
+    den = ay;
+  }
+  else
+  {
+    num = ay;
+    den = ax;
+  }
+  if (0 == den) return 0;
+
+  /* num << 15 must fit: both are scaled below 2^17, which still leaves 16 bits for the ratio */
+  shift = __CLZ(den);
+  if (15 > shift)
+  {
+    num >>= (15 - shift);
+    den >>= (15 - shift);
+  }
+
+  /* Rounded to the nearest, truncating it added up to 0.3/65536 of a turn to the error */
+  ratio     = (num << 15) / den;
+  remainder = (num << 15) - ratio * den;
+  if (remainder >= den - remainder) ratio++;
+  index = ratio >> 8;
+  frac  = ratio & 0xFF;
+  angle = Math_AtanTable[index];
+  angle += ((Math_AtanTable[index + 1] - angle) * (S32)frac + 128) >> 8;
+
+  if (ay > ax) angle = 0x4000 - angle;
+  if (0 > x) angle = 0x8000 - angle;
+  if (0 > y) angle = -angle;
+
+  return (Math_Angle)angle;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A guess from the top bits of the normalized argument is within 6%, two Newton steps bring it
+   within 1 and the last steps make it exact. About 40 cycles, the divisions take most of them.  */
+
+U32 Math_Sqrt(U32 x)
+{
+  U32 shift, root;
+
+  if (2 > x) return x;
+
+  /* An even shift, so the top bit pair of the normalized argument is not zero */
+  shift = __CLZ(x) & ~1U;
+  root  = Math_SqrtTable[(x << shift) >> 28] >> (shift >> 1);
+
+  root = (root + x / root) >> 1;
+  root = (root + x / root) >> 1;
+
+  if (0xFFFF < root) root = 0xFFFF;
+  while ((root * root) > x)
+  {
+    root--;
+  }
+  while ((0xFFFF > root) && (((root + 1) * (root + 1)) <= x))
+  {
+    root++;
+  }
+
+  return root;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+Q15 Math_SqrtQ15(Q15 x)
+{
+  return (0 < x) ? (Q15)Math_Sqrt((U32)x << 15) : 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The M3 divides in 2 to 12 cycles, a table and Newton steps would be slower. 2^32 does not fit:
+   2^32 - 1 is divided, and the remainder of 2^32 (one more, up to the divisor itself) rounds the
+   quotient to the nearest.                                                                       */
+
+S32 Math_RecipQ16(S32 x)
+{
+  U32 ax = (0 > x) ? (0 - (U32)x) : (U32)x;
+  U32 result, remainder;
+
+  if (1 >= ax) return (0 > x) ? -0x7FFFFFFF : 0x7FFFFFFF;
+
+  result    = 0xFFFFFFFFU / ax;
+  remainder = 0xFFFFFFFFU - result * ax + 1;
+  if (remainder >= ax - remainder) result++;
+  if (0x7FFFFFFF < result) result = 0x7FFFFFFF;
+
+  return (0 > x) ? -(S32)result : (S32)result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The integer part is the position of the top bit, the fraction is log2 of the normalized
+   mantissa in [1, 2): 7 bits select the segment and the next 16 bits interpolate it.             */
+
+S32 Math_Log2(U32 x)
+{
+  U32 shift, mantissa, index, frac, y;
+
+  if (0 == x) return (-0x7FFFFFFF - 1);
+
+  shift    = __CLZ(x);
+  mantissa = x << shift;
+  index    = (mantissa >> 24) & 0x7F;
+  frac     = (mantissa >> 8) & 0xFFFF;
+  y = Math_Log2Table[index];
+  y += ((Math_Log2Table[index + 1] - y) * frac + 0x8000) >> 16;
+
+  return (S32)(((31 - shift) << 16) + y);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* 2^x = 2^int * 2^frac: the fraction is interpolated in Q30 and shifted by the integer part */
+
+U32 Math_Exp2(S32 x)
+{
+  S32 integer = x >> 16;
+  U32 index = (x >> 9) & 0x7F;
+  U32 frac  = x & 0x1FF;
+  U32 y;
+
+  if (16 <= integer) return 0xFFFFFFFF;
+  if (-16 > integer) return 0;
+
+  y = Math_Exp2Table[index];
+  y += (U32)(((U64)(Math_Exp2Table[index + 1] - y) * frac + 0x100) >> 9);
+
+  /* Q30 to Q16 with rounding */
+  if (14 <= integer) return (y << (integer - 14));
+  return ((y >> (13 - integer)) + 1) >> 1;
+}
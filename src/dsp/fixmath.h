@@ -0,0 +1,43 @@
+#ifndef __FIXMATH_H__
+#define __FIXMATH_H__
+
+#include "types.h"
+#include "dsp.h"
+
+/* Fixed-point replacements for the libm calls. Table driven with linear interpolation between 128
+   segments (about 1.6 KB of flash in total); the hardware divider does the rest. The error bounds
+   below were measured with exhaustive or dense sweeps against the double precision libm on the
+   host. The float versions are emulated in software and cost hundreds of cycles each.            */
+
+/* Binary angle: one turn is 65536, so angle arithmetic wraps for free. As S16 it is [-pi, pi) */
+typedef U16 Math_Angle;
+
+#define MATH_ANGLE(degrees)                ((Math_Angle)(S32)((degrees) * 65536.0 / 360.0))
+#define MATH_ANGLE_PI                      ((Math_Angle)0x8000)
+#define MATH_ANGLE_PI_2                    ((Math_Angle)0x4000)
+
+/* Q15, max error 1.5 LSB over all 65536 angles */
+Q15        Math_Sin(Math_Angle angle);
+Q15        Math_Cos(Math_Angle angle);
+
+/* Angle of (x, y) at any scale, max error 1.2/65536 of a turn (0.007 deg), atan2(0, 0) is 0 */
+Math_Angle Math_Atan2(S32 y, S32 x);
+
+/* floor(sqrt(x)), exact */
+U32        Math_Sqrt(U32 x);
+
+/* sqrt(x) for x in [0, 1), exact to the LSB (floor), negative arguments give 0 */
+Q15        Math_SqrtQ15(Q15 x);
+
+/* 1 / x, Q16.16 in and out, rounded to the nearest, saturated for |x| <= 2/65536 and 0 */
+S32        Math_RecipQ16(S32 x);
+
+/* log2(x) of an integer as Q16.16, max error 1.6 LSB. For a Qn argument subtract n << 16.
+   log2(0) gives the most negative value.                                                         */
+S32        Math_Log2(U32 x);
+
+/* 2^x of a Q16.16 argument as Q16.16, relative error below 2^-16 (plus 1/2 LSB of rounding),
+   saturated above 2^16                                                                           */
+U32        Math_Exp2(S32 x);
+
+#endif /* __FIXMATH_H__ */
@@ -0,0 +1,99 @@
+#ifndef __FIXMATH_TABLE_H__
+#define __FIXMATH_TABLE_H__
+
+/* Generated by tools/math_table.py, do not edit */
+#define MATH_SEGMENTS                      (128)
+
+/* sin(pi / 2 * i / 128), Q15 */
+static const Q15 Math_SinTable[128 + 2] =
+{
+       0,    402,    804,   1206,   1608,   2009,   2411,   2811,   3212,   3612,
+    4011,   4410,   4808,   5205,   5602,   5998,   6393,   6787,   7180,   7571,
+    7962,   8351,   8740,   9127,   9512,   9896,  10279,  10660,  11039,  11417,
+   11793,  12167,  12540,  12910,  13279,  13646,  14010,  14373,  14733,  15091,
+   15447,  15800,  16151,  16500,  16846,  17190,  17531,  17869,  18205,  18538,
+   18868,  19195,  19520,  19841,  20160,  20475,  20788,  21097,  21403,  21706,
+   22006,  22302,  22595,  22884,  23170,  23453,  23732,  24008,  24279,  24548,
+   24812,  25073,  25330,  25583,  25833,  26078,  26320,  26557,  26791,  27020,
+   27246,  27467,  27684,  27897,  28106,  28311,  28511,  28707,  28899,  29086,
+   29269,  29448,  29622,  29792,  29957,  30118,  30274,  30425,  30572,  30715,
+   30853,  30986,  31114,  31238,  31357,  31471,  31581,  31686,  31786,  31881,
+   31972,  32058,  32138,  32214,  32286,  32352,  32413,  32470,  32522,  32568,
+   32610,  32647,  32679,  32706,  32729,  32746,  32758,  32766,  32767,  32766,
+};
+
+/* atan(i / 128) in 1/65536 of a turn */
+static const U16 Math_AtanTable[128 + 2] =
+{
+      0,    81,   163,   244,   326,   407,   489,   570,   651,   732,
+    813,   894,   975,  1056,  1136,  1217,  1297,  1377,  1457,  1537,
+   1617,  1696,  1775,  1854,  1933,  2012,  2090,  2168,  2246,  2324,
+   2401,  2478,  2555,  2632,  2708,  2784,  2860,  2935,  3010,  3085,
+   3159,  3233,  3307,  3380,  3453,  3526,  3599,  3670,  3742,  3813,
+   3884,  3955,  4025,  4095,  4164,  4233,  4302,  4370,  4438,  4505,
+   4572,  4639,  4705,  4771,  4836,  4901,  4966,  5030,  5094,  5157,
+   5220,  5282,  5344,  5406,  5467,  5528,  5589,  5649,  5708,  5768,
+   5826,  5885,  5943,  6000,  6058,  6114,  6171,  6227,  6282,  6337,
+   6392,  6446,  6500,  6554,  6607,  6660,  6712,  6764,  6815,  6867,
+   6917,  6968,  7018,  7068,  7117,  7166,  7214,  7262,  7310,  7358,
+   7405,  7451,  7498,  7544,  7589,  7635,  7679,  7724,  7768,  7812,
+   7856,  7899,  7942,  7984,  8026,  8068,  8110,  8151,  8192,  8233,
+};
+
+/* log2(1 + i / 128), Q16 */
+static const U32 Math_Log2Table[128 + 1] =
+{
+       0,    736,   1466,   2190,   2909,   3623,   4331,   5034,
+    5732,   6425,   7112,   7795,   8473,   9146,   9814,  10477,
+   11136,  11791,  12440,  13086,  13727,  14363,  14996,  15624,
+   16248,  16868,  17484,  18096,  18704,  19308,  19909,  20505,
+   21098,  21687,  22272,  22854,  23433,  24007,  24579,  25146,
+   25711,  26272,  26830,  27384,  27936,  28484,  29029,  29571,
+   30109,  30645,  31178,  31707,  32234,  32758,  33279,  33797,
+   34312,  34825,  35334,  35841,  36346,  36847,  37346,  37842,
+   38336,  38827,  39316,  39802,  40286,  40767,  41246,  41722,
+   42196,  42667,  43137,  43603,  44068,  44530,  44990,  45448,
+   45904,  46357,  46809,  47258,  47705,  48150,  48593,  49034,
+   49472,  49909,  50344,  50776,  51207,  51636,  52063,  52488,
+   52911,  53332,  53751,  54169,  54584,  54998,  55410,  55820,
+   56229,  56635,  57040,  57443,  57845,  58245,  58643,  59039,
+   59434,  59827,  60219,  60609,  60997,  61384,  61769,  62152,
+   62534,  62915,  63294,  63671,  64047,  64421,  64794,  65166,
+   65536,
+};
+
+/* 2^(i / 128), Q30 */
+static const U32 Math_Exp2Table[128 + 1] =
+{
+  1073741824, 1079572136, 1085434106, 1091327906, 1097253708, 1103211687,
+  1109202018, 1115224875, 1121280436, 1127368878, 1133490379, 1139645120,
+  1145833280, 1152055042, 1158310587, 1164600099, 1170923762, 1177281762,
+  1183674286, 1190101520, 1196563654, 1203060876, 1209593378, 1216161350,
+  1222764986, 1229404479, 1236080024, 1242791816, 1249540052, 1256324931,
+  1263146652, 1270005413, 1276901417, 1283834865, 1290805962, 1297814910,
+  1304861917, 1311947188, 1319070932, 1326233356, 1333434672, 1340675091,
+  1347954824, 1355274085, 1362633090, 1370032052, 1377471191, 1384950723,
+  1392470869, 1400031848, 1407633882, 1415277195, 1422962010, 1430688553,
+  1438457051, 1446267730, 1454120821, 1462016553, 1469955159, 1477936870,
+  1485961921, 1494030547, 1502142985, 1510299473, 1518500250, 1526745556,
+  1535035634, 1543370725, 1551751076, 1560176931, 1568648537, 1577166143,
+  1585730000, 1594340357, 1602997467, 1611701585, 1620452965, 1629251865,
+  1638098541, 1646993254, 1655936265, 1664927835, 1673968228, 1683057710,
+  1692196547, 1701385007, 1710623359, 1719911875, 1729250827, 1738640488,
+  1748081133, 1757573041, 1767116489, 1776711757, 1786359126, 1796058879,
+  1805811301, 1815616678, 1825475297, 1835387448, 1845353420, 1855373507,
+  1865448001, 1875577199, 1885761398, 1896000896, 1906295993, 1916646992,
+  1927054196, 1937517909, 1948038440, 1958616096, 1969251188, 1979944027,
+  1990694927, 2001504204, 2012372174, 2023299156, 2034285470, 2045331439,
+  2056437387, 2067603638, 2078830522, 2090118366, 2101467502, 2112878262,
+  2124350982, 2135885998, 2147483648,
+};
+
+/* sqrt(i + 0.5) * 2^14, a first guess from the top 4 bits of a normalized argument */
+static const U16 Math_SqrtTable[16] =
+{
+  11585, 20066, 25905, 30652, 34756, 38424, 41771, 44869,
+  47767, 50499, 53090, 55561, 57926, 60199, 62388, 64504,
+};
+
+#endif /* __FIXMATH_TABLE_H__ */
@@ -0,0 +1,226 @@
+#include <string.h>
+
+#include "types.h"
+#include "dsp.h"
+#include "matrix.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Rounded to nearest, the shift is applied to the whole sum */
+
+__STATIC_INLINE S32 matrix_Round(S64 acc, U32 frac)
+{
+  if (0 < frac) acc += ((S64)1 << (frac - 1));
+  return Q31_Sat(acc >> frac);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mat3_Identity(Mat3 * pOut, U32 frac)
+{
+  memset(pOut, 0, sizeof(Mat3));
+  pOut->M[0][0] = pOut->M[1][1] = pOut->M[2][2] = (S32)(1U << frac);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mat3_Add(Mat3 * pOut, const Mat3 * pA, const Mat3 * pB)
+{
+  U32 i, j;
+
+  for (i = 0; i < 3; i++)
+  {
+    for (j = 0; j < 3; j++)
+    {
+      pOut->M[i][j] = Q31_Add(pA->M[i][j], pB->M[i][j]);
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mat3_Transpose(Mat3 * pOut, const Mat3 * pA)
+{
+  S32 tmp;
+  U32 i, j;
+
+  for (i = 0; i < 3; i++)
+  {
+    pOut->M[i][i] = pA->M[i][i];
+    for (j = i + 1; j < 3; j++)
+    {
+      tmp           = pA->M[i][j];
+      pOut->M[i][j] = pA->M[j][i];
+      pOut->M[j][i] = tmp;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The loops are fully unrolled by the compiler at these sizes, the result goes through a copy
+   so that the output may be an input                                                             */
+
+void Mat3_Mul(Mat3 * pOut, const Mat3 * pA, const Mat3 * pB, U32 frac)
+{
+  Mat3 result;
+  U32 i, j;
+
+  for (i = 0; i < 3; i++)
+  {
+    for (j = 0; j < 3; j++)
+    {
+      result.M[i][j] = matrix_Round((S64)pA->M[i][0] * pB->M[0][j] +
+                                    (S64)pA->M[i][1] * pB->M[1][j] +
+                                    (S64)pA->M[i][2] * pB->M[2][j], frac);
+    }
+  }
+
+  *pOut = result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mat3_MulVec(Vec3 * pOut, const Mat3 * pA, const Vec3 * pV, U32 frac)
+{
+  S64 x = pV->X, y = pV->Y, z = pV->Z;
+
+  pOut->X = matrix_Round(pA->M[0][0] * x + pA->M[0][1] * y + pA->M[0][2] * z, frac);
+  pOut->Y = matrix_Round(pA->M[1][0] * x + pA->M[1][1] * y + pA->M[1][2] * z, frac);
+  pOut->Z = matrix_Round(pA->M[2][0] * x + pA->M[2][1] * y + pA->M[2][2] * z, frac);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Cofactor of the element (i, j), scaled back to the Q format of the matrix */
+
+static S32 matrix_Cofactor(const Mat3 * pA, U32 i, U32 j, U32 frac)
+{
+  U32 r0 = (i + 1) % 3, r1 = (i + 2) % 3;
+  U32 c0 = (j + 1) % 3, c1 = (j + 2) % 3;
+
+  return matrix_Round((S64)pA->M[r0][c0] * pA->M[r1][c1] -
+                      (S64)pA->M[r0][c1] * pA->M[r1][c0], frac);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+S32 Mat3_Det(const Mat3 * pA, U32 frac)
+{
+  return matrix_Round((S64)pA->M[0][0] * matrix_Cofactor(pA, 0, 0, frac) +
+                      (S64)pA->M[0][1] * matrix_Cofactor(pA, 0, 1, frac) +
+                      (S64)pA->M[0][2] * matrix_Cofactor(pA, 0, 2, frac), frac);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Adjugate over the determinant. The 9 divisions are 64-bit and run in the library, about 1000
+   cycles each on the M3: fine for calibration, not for a per-sample loop.                        */
+
+U32 Mat3_Inverse(Mat3 * pOut, const Mat3 * pA, U32 frac)
+{
+  Mat3 cofactors;
+  S64 det = 0;
+  U32 i, j;
+
+  for (i = 0; i < 3; i++)
+  {
+    for (j = 0; j < 3; j++)
+    {
+      cofactors.M[i][j] = matrix_Cofactor(pA, i, j, frac);
+    }
+    det += (S64)pA->M[0][i] * cofactors.M[0][i];
+  }
+
+  det = (S64)matrix_Round(det, frac);
+  if (0 == det) return FALSE;
+
+  for (i = 0; i < 3; i++)
+  {
+    for (j = 0; j < 3; j++)
+    {
+      pOut->M[i][j] = Q31_Sat(((S64)cofactors.M[j][i] << frac) / det);
+    }
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mat4_Identity(Mat4 * pOut, U32 frac)
+{
+  memset(pOut, 0, sizeof(Mat4));
+  pOut->M[0][0] = pOut->M[1][1] = pOut->M[2][2] = pOut->M[3][3] = (S32)(1U << frac);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mat4_Add(Mat4 * pOut, const Mat4 * pA, const Mat4 * pB)
+{
+  U32 i, j;
+
+  for (i = 0; i < 4; i++)
+  {
+    for (j = 0; j < 4; j++)
+    {
+      pOut->M[i][j] = Q31_Add(pA->M[i][j], pB->M[i][j]);
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mat4_Transpose(Mat4 * pOut, const Mat4 * pA)
+{
+  S32 tmp;
+  U32 i, j;
+
+  for (i = 0; i < 4; i++)
+  {
+    pOut->M[i][i] = pA->M[i][i];
+    for (j = i + 1; j < 4; j++)
+    {
+      tmp           = pA->M[i][j];
+      pOut->M[i][j] = pA->M[j][i];
+      pOut->M[j][i] = tmp;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mat4_Mul(Mat4 * pOut, const Mat4 * pA, const Mat4 * pB, U32 frac)
+{
+  Mat4 result;
+  U32 i, j;
+
+  for (i = 0; i < 4; i++)
+  {
+    for (j = 0; j < 4; j++)
+    {
+      result.M[i][j] = matrix_Round((S64)pA->M[i][0] * pB->M[0][j] +
+                                    (S64)pA->M[i][1] * pB->M[1][j] +
+                                    (S64)pA->M[i][2] * pB->M[2][j] +
+                                    (S64)pA->M[i][3] * pB->M[3][j], frac);
+    }
+  }
+
+  *pOut = result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Mat4_MulVec(S32 * pOut, const Mat4 * pA, const S32 * pV, U32 frac)
+{
+  S32 v[4];
+  U32 i;
+
+  memcpy(v, pV, sizeof(v));
+
+  for (i = 0; i < 4; i++)
+  {
+    pOut[i] = matrix_Round((S64)pA->M[i][0] * v[0] + (S64)pA->M[i][1] * v[1] +
+                           (S64)pA->M[i][2] * v[2] + (S64)pA->M[i][3] * v[3], frac);
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef __MATRIX_H__
+#define __MATRIX_H__
+
+#include "types.h"
+#include "dsp.h"
+
+/* Small fixed-size matrices of S32 in any Q format: 'frac' is the number of fraction bits (30 for
+   rotations and quaternions, 16 for Q16.16 and so on). The products accumulate in 64 bits and
+   saturate once per element. The output may be one of the inputs.                                */
+
+typedef struct
+{
+  S32 X;
+  S32 Y;
+  S32 Z;
+} Vec3;
+
+typedef struct
+{
+  S32 M[3][3];                             /* Row, column                                         */
+} Mat3;
+
+typedef struct
+{
+  S32 M[4][4];
+} Mat4;
+
+void Mat3_Identity(Mat3 * pOut, U32 frac);
+void Mat3_Add(Mat3 * pOut, const Mat3 * pA, const Mat3 * pB);
+void Mat3_Transpose(Mat3 * pOut, const Mat3 * pA);
+void Mat3_Mul(Mat3 * pOut, const Mat3 * pA, const Mat3 * pB, U32 frac);
+void Mat3_MulVec(Vec3 * pOut, const Mat3 * pA, const Vec3 * pV, U32 frac);
+S32  Mat3_Det(const Mat3 * pA, U32 frac);
+
+/* FALSE if the matrix is singular at this precision */
+U32  Mat3_Inverse(Mat3 * pOut, const Mat3 * pA, U32 frac);
+
+void Mat4_Identity(Mat4 * pOut, U32 frac);
+void Mat4_Add(Mat4 * pOut, const Mat4 * pA, const Mat4 * pB);
+void Mat4_Transpose(Mat4 * pOut, const Mat4 * pA);
+void Mat4_Mul(Mat4 * pOut, const Mat4 * pA, const Mat4 * pB, U32 frac);
+void Mat4_MulVec(S32 * pOut, const Mat4 * pA, const S32 * pV, U32 frac);
+
+#endif /* __MATRIX_H__ */
@@ -0,0 +1,108 @@
+#include <string.h>
+
+#include "types.h"
+#include "dsp.h"
+#include "moving.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void MovAvg_Q15_Init(MovAvg_Q15 * pAvg, Q15 * pBuffer, U16 log2)
+{
+  pAvg->pBuffer = pBuffer;
+  pAvg->Sum     = 0;
+  pAvg->Index   = 0;
+  pAvg->Log2    = log2;
+
+  memset(pBuffer, 0, (1 << log2) * sizeof(Q15));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The sum is exact (15 + Log2 bits), the output is rounded. pIn and pOut may be the same. */
+
+void MovAvg_Q15_Run(MovAvg_Q15 * pAvg, const Q15 * pIn, Q15 * pOut, U32 count)
+{
+  Q15 * pBuffer = pAvg->pBuffer;
+  U32 mask = (1 << pAvg->Log2) - 1, index = pAvg->Index, log2 = pAvg->Log2, n;
+  S32 sum = pAvg->Sum, round = (1 << log2) >> 1;
+  Q15 x;
+
+  for (n = 0; n < count; n++)
+  {
+    x = pIn[n];
+    sum += x - pBuffer[index];
+    pBuffer[index] = x;
+    index = (index + 1) & mask;
+    pOut[n] = (Q15)((sum + round) >> log2);
+  }
+
+  pAvg->Sum   = sum;
+  pAvg->Index = index;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void MovMedian_Q15_Init(MovMedian_Q15 * pMedian, Q15 * pWindow, Q15 * pSorted, U16 size)
+{
+  pMedian->pWindow = pWindow;
+  pMedian->pSorted = pSorted;
+  pMedian->Size    = size;
+  pMedian->Index   = 0;
+
+  memset(pWindow, 0, size * sizeof(Q15));
+  memset(pSorted, 0, size * sizeof(Q15));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The slot of the oldest value is found first, then the elements between it and the place of the
+   new value are shifted by one towards the freed slot.                                          */
+
+void MovMedian_Q15_Run(MovMedian_Q15 * pMedian, const Q15 * pIn, Q15 * pOut, U32 count)
+{
+  Q15 * pSorted = pMedian->pSorted;
+  U32 size = pMedian->Size, index = pMedian->Index, n, i;
+  Q15 x, old;
+
+  for (n = 0; n < count; n++)
+  {
+    x = pIn[n];
+    old = pMedian->pWindow[index];
+    pMedian->pWindow[index] = x;
+    if (++index == size) index = 0;
+
+    for (i = 0; pSorted[i] != old; i++)
+    {
+      //
+    }
+
+    if (x > old)
+    {
+      for (; ((i + 1) < size) && (pSorted[i + 1] < x); i++) pSorted[i] = pSorted[i + 1];
+    }
+    else
+    {
+      for (; (0 < i) && (pSorted[i - 1] > x); i--) pSorted[i] = pSorted[i - 1];
+    }
+    pSorted[i] = x;
+
+    pOut[n] = pSorted[size >> 1];
+  }
+
+  pMedian->Index = index;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Decim_Q15_Average(const Q15 * pIn, Q15 * pOut, U32 count, U32 log2)
+{
+  U32 length = 1 << log2, k;
+  S32 sum, round = length >> 1;
+
+  for (; count >= length; count -= length)
+  {
+    sum = 0;
+    for (k = 0; k < length; k++) sum += *pIn++;
+    *pOut++ = (Q15)((sum + round) >> log2);
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef __MOVING_H__
+#define __MOVING_H__
+
+#include "types.h"
+#include "dsp.h"
+
+/* Moving average over 2^Log2 samples: a running sum, so the cost does not depend on the length */
+typedef struct
+{
+  Q15 * pBuffer;                           /* 2^Log2 samples                                      */
+  S32   Sum;
+  U16   Index;
+  U16   Log2;
+} MovAvg_Q15;
+
+/* Moving median over an odd number of samples. The window is kept sorted: each sample removes
+   the oldest value and inserts the new one with a single pass, O(Size) per sample.               */
+typedef struct
+{
+  Q15 * pWindow;                           /* Size samples, in arrival order                      */
+  Q15 * pSorted;                           /* Size samples, ascending                             */
+  U16   Size;
+  U16   Index;
+} MovMedian_Q15;
+
+void MovAvg_Q15_Init(MovAvg_Q15 * pAvg, Q15 * pBuffer, U16 log2);
+void MovAvg_Q15_Run(MovAvg_Q15 * pAvg, const Q15 * pIn, Q15 * pOut, U32 count);
+
+void MovMedian_Q15_Init(MovMedian_Q15 * pMedian, Q15 * pWindow, Q15 * pSorted, U16 size);
+void MovMedian_Q15_Run(MovMedian_Q15 * pMedian, const Q15 * pIn, Q15 * pOut, U32 count);
+
+/* Block average decimator: every 2^log2 inputs become one output, 'count' is a multiple of it */
+void Decim_Q15_Average(const Q15 * pIn, Q15 * pOut, U32 count, U32 log2);
+
+#endif /* __MOVING_H__ */
@@ -0,0 +1,168 @@
+#include "types.h"
+#include "dsp.h"
+#include "fixmath.h"
+#include "matrix.h"
+#include "quat.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+__STATIC_INLINE S32 quat_Round(S64 acc, U32 frac)
+{
+  return Q31_Sat((acc + ((S64)1 << (frac - 1))) >> frac);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The first pass scales by the inverse of a 16-bit square root, which leaves a relative error e
+   of the length up to 2^-15. With |v|^2 = 1 + d the second pass scales by 1 - d/2 + 3/8 d^2, the
+   series of 1 / sqrt(1 + d): the error left is of the order of e^3. The factor is summed in Q60
+   and applied in Q31, so the rounding of the first pass and of the result dominate, 1.3 LSB.    */
+
+static U32 quat_Normalize(S32 * pV, U32 count)
+{
+  U64 sum = 0;
+  S64 length, d, correction;
+  S32 shift, scale;
+  U32 i, msb, root, inverse;
+
+  for (i = 0; i < count; i++)
+  {
+    sum += (U64)((S64)pV[i] * pV[i]);
+  }
+  if (0 == sum) return FALSE;
+
+  /* An even shift brings the sum into [2^30, 2^32), the root into [2^15, 2^16) */
+  msb = (0 != (sum >> 32)) ? (63 - __CLZ((U32)(sum >> 32))) : (31 - __CLZ((U32)sum));
+  shift = ((S32)msb - 30) & ~1;
+  root = Math_Sqrt((U32)((0 <= shift) ? (sum >> shift) : (sum << -shift)));
+
+  /* length = root * 2^(shift / 2), v / length in Q30 = v * (2^32 / root) >> (2 + shift / 2) */
+  inverse = 0xFFFFFFFFU / root;
+  scale = 2 + shift / 2;
+  for (i = 0; i < count; i++)
+  {
+    length = (S64)pV[i] * inverse;
+    pV[i] = (S32)((0 < scale) ? quat_Round(length, scale) : (length << -scale));
+  }
+
+  /* d in Q60 from |v|^2 in Q60, d^2 from d in Q40, then 1 - d/2 + 3/8 d^2 from Q60 to Q31 */
+  for (length = 0, i = 0; i < count; i++)
+  {
+    length += (S64)pV[i] * pV[i];
+  }
+  length -= (S64)1 << 60;
+  d = (length + ((S64)1 << 19)) >> 20;
+  correction = ((S64)1 << 60) - (length >> 1) + ((3 * d * d) >> 23);
+  correction = (correction + ((S64)1 << 28)) >> 29;
+  for (i = 0; i < count; i++)
+  {
+    pV[i] = quat_Round((S64)pV[i] * correction, QUAT_FRAC + 1);
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Quat_Identity(Quat * pOut)
+{
+  pOut->W = QUAT_ONE;
+  pOut->X = 0;
+  pOut->Y = 0;
+  pOut->Z = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Quat_Mul(Quat * pOut, const Quat * pA, const Quat * pB)
+{
+  S64 aw = pA->W, ax = pA->X, ay = pA->Y, az = pA->Z;
+  S64 bw = pB->W, bx = pB->X, by = pB->Y, bz = pB->Z;
+
+  pOut->W = quat_Round(aw * bw - ax * bx - ay * by - az * bz, QUAT_FRAC);
+  pOut->X = quat_Round(aw * bx + ax * bw + ay * bz - az * by, QUAT_FRAC);
+  pOut->Y = quat_Round(aw * by - ax * bz + ay * bw + az * bx, QUAT_FRAC);
+  pOut->Z = quat_Round(aw * bz + ax * by - ay * bx + az * bw, QUAT_FRAC);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Quat_Conj(Quat * pOut, const Quat * pA)
+{
+  pOut->W =  pA->W;
+  pOut->X = -pA->X;
+  pOut->Y = -pA->Y;
+  pOut->Z = -pA->Z;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Quat_Normalize(Quat * pQ)
+{
+  return quat_Normalize(&pQ->W, 4);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Vec3_Normalize(Vec3 * pV)
+{
+  return quat_Normalize(&pV->X, 3);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* t = 2 (q.xyz x v), v' = v + w t + q.xyz x t: 18 multiplications instead of the 32 of q v q*  */
+
+void Quat_Rotate(Vec3 * pOut, const Quat * pQ, const Vec3 * pV)
+{
+  S64 x = pQ->X, y = pQ->Y, z = pQ->Z;
+  S64 tx, ty, tz;
+
+  tx = quat_Round(y * pV->Z - z * pV->Y, QUAT_FRAC - 1);
+  ty = quat_Round(z * pV->X - x * pV->Z, QUAT_FRAC - 1);
+  tz = quat_Round(x * pV->Y - y * pV->X, QUAT_FRAC - 1);
+
+  pOut->X = Q31_Sat(pV->X + (S64)quat_Round(pQ->W * tx + y * tz - z * ty, QUAT_FRAC));
+  pOut->Y = Q31_Sat(pV->Y + (S64)quat_Round(pQ->W * ty + z * tx - x * tz, QUAT_FRAC));
+  pOut->Z = Q31_Sat(pV->Z + (S64)quat_Round(pQ->W * tz + x * ty - y * tx, QUAT_FRAC));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Quat_ToMatrix(Mat3 * pOut, const Quat * pQ)
+{
+  S64 w = pQ->W, x = pQ->X, y = pQ->Y, z = pQ->Z;
+
+  /* Products are Q60, twice a product is the product shifted by 29 */
+  pOut->M[0][0] = QUAT_ONE - quat_Round(y * y + z * z, QUAT_FRAC - 1);
+  pOut->M[0][1] = quat_Round(x * y - w * z, QUAT_FRAC - 1);
+  pOut->M[0][2] = quat_Round(x * z + w * y, QUAT_FRAC - 1);
+  pOut->M[1][0] = quat_Round(x * y + w * z, QUAT_FRAC - 1);
+  pOut->M[1][1] = QUAT_ONE - quat_Round(x * x + z * z, QUAT_FRAC - 1);
+  pOut->M[1][2] = quat_Round(y * z - w * x, QUAT_FRAC - 1);
+  pOut->M[2][0] = quat_Round(x * z - w * y, QUAT_FRAC - 1);
+  pOut->M[2][1] = quat_Round(y * z + w * x, QUAT_FRAC - 1);
+  pOut->M[2][2] = QUAT_ONE - quat_Round(x * x + y * y, QUAT_FRAC - 1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* asin(s) = atan2(s, sqrt(1 - s^2)), the square root is taken in Q30 and has 15 significant bits,
+   which is still well below the resolution of the angle away from +-90 degrees                   */
+
+void Quat_ToEuler(const Quat * pQ, Math_Angle * pRoll, Math_Angle * pPitch, Math_Angle * pYaw)
+{
+  S64 w = pQ->W, x = pQ->X, y = pQ->Y, z = pQ->Z;
+  S32 s, c;
+
+  *pRoll = Math_Atan2(quat_Round(w * x + y * z, QUAT_FRAC - 1),
+                      QUAT_ONE - quat_Round(x * x + y * y, QUAT_FRAC - 1));
+  *pYaw  = Math_Atan2(quat_Round(w * z + x * y, QUAT_FRAC - 1),
+                      QUAT_ONE - quat_Round(y * y + z * z, QUAT_FRAC - 1));
+
+  s = quat_Round(w * y - z * x, QUAT_FRAC - 1);
+  if (QUAT_ONE < s) s = QUAT_ONE;
+  if (-QUAT_ONE > s) s = -QUAT_ONE;
+  c = (S32)(Math_Sqrt((U32)(QUAT_ONE - quat_Round((S64)s * s, QUAT_FRAC))) << 15);
+  *pPitch = Math_Atan2(s, c);
+}
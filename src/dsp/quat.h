@@ -0,0 +1,42 @@
+#ifndef __QUAT_H__
+#define __QUAT_H__
+
+#include "types.h"
+#include "dsp.h"
+#include "fixmath.h"
+#include "matrix.h"
+
+/* Quaternions in Q30: a unit quaternion has components in [-1, 1] and Q30 leaves a bit of
+   headroom for the drift between two normalizations. Hamilton convention, W is the scalar part,
+   the rotation is from the body to the earth frame.                                              */
+#define QUAT_FRAC                          (30)
+#define QUAT_ONE                           ((S32)1 << QUAT_FRAC)
+
+typedef struct
+{
+  S32 W;
+  S32 X;
+  S32 Y;
+  S32 Z;
+} Quat;
+
+void Quat_Identity(Quat * pOut);
+void Quat_Mul(Quat * pOut, const Quat * pA, const Quat * pB);
+void Quat_Conj(Quat * pOut, const Quat * pA);
+
+/* Scales to unit length, FALSE for a zero quaternion. Accurate to 1.3 LSB of Q30.                */
+U32  Quat_Normalize(Quat * pQ);
+
+/* Unit vector in Q30 from a vector at any scale (a raw sensor reading), FALSE for a zero vector */
+U32  Vec3_Normalize(Vec3 * pV);
+
+/* v' = q v q*, the vector keeps its Q format */
+void Quat_Rotate(Vec3 * pOut, const Quat * pQ, const Vec3 * pV);
+
+/* Rotation matrix in Q30 */
+void Quat_ToMatrix(Mat3 * pOut, const Quat * pQ);
+
+/* Aerospace sequence (yaw, then pitch, then roll), pitch within [-pi/2, pi/2] */
+void Quat_ToEuler(const Quat * pQ, Math_Angle * pRoll, Math_Angle * pPitch, Math_Angle * pYaw);
+
+#endif /* __QUAT_H__ */
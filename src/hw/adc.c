@@ -0,0 +1,381 @@
+#include <string.h>
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "gpio.h"
+#include "dwt.h"
+#include "irq.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "dma.h"
+#include "adc.h"
+
+/* EXTSEL = 0b100 - TIM3 TRGO, the timer sends TRGO on every update */
+#define ADC_CR2_EXTSEL_TIM3_TRGO           (ADC_CR2_EXTSEL_2)
+#define ADC_TIM_CR2_MMS_UPDATE             (TIM_CR2_MMS_1)
+#define ADC_CLOCK_MAX                      (14000000U)
+
+typedef struct
+{
+  ADC_Config     Config;
+  ADC_Block      Blocks[ADC_BLOCKS];
+  U32            Sequence;
+  U32            OutFrames;
+  U32            Channel;                  /* DMA channel, 0 when released                        */
+  ADC_Stats      Stats;
+  Clock_Notifier Notifier;
+} ADC_State;
+
+static ADC_State ADC_This;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* ADCCLK must not exceed 14 MHz. The smallest of the /2, /4, /6 and /8 prescalers is taken.
+
+   RCC->CFGR is shared with the clock manager, which may run from the NMI, so it is not read and
+   written back here: the two ADCPRE bits are stored one by one through the bit-band alias. The
+   bits to set go first, the prescaler in between is the larger of the old and the new one.       */
+
+static void adc_SetPrescaler(void)
+{
+  U32 pclk2 = Clock_GetPCLK2(), div, bit;
+
+  for (div = 0; div < 3; div++)
+  {
+    if ((pclk2 / ((div + 1) * 2)) <= ADC_CLOCK_MAX) break;
+  }
+
+  for (bit = 0; bit < 2; bit++)
+  {
+    if (0 != (div & (1U << bit))) BITBAND_PERIPH(&RCC->CFGR, RCC_CFGR_ADCPRE_Pos + bit) = 1;
+  }
+  for (bit = 0; bit < 2; bit++)
+  {
+    if (0 == (div & (1U << bit))) BITBAND_PERIPH(&RCC->CFGR, RCC_CFGR_ADCPRE_Pos + bit) = 0;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* TIM3 runs at PCLK1, doubled when the APB1 prescaler is not 1 */
+
+static void adc_SetRate(U32 rate)
+{
+  U32 clock = Clock_GetPCLK1(), ticks, psc;
+
+  if (0 != (RCC->CFGR & RCC_CFGR_PPRE1_2)) clock *= 2;
+
+  ticks = clock / rate;
+  if (0 == ticks) ticks = 1;
+  psc = (ticks - 1) / 0x10000;
+
+  TIM3->PSC = psc;
+  TIM3->ARR = (ticks / (psc + 1)) - 1;
+  TIM3->EGR = TIM_EGR_UG;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void adc_ClockChanged(U32 oldHz, U32 newHz, void * pContext)
+{
+  adc_SetPrescaler();
+  adc_SetRate(ADC_This.Config.Rate);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Boxcar decimator: 'factor' frames are summed into one. The running sums are kept per channel,
+   so the input is read once, in order, and the loop is one load and one add per sample.         */
+
+static void adc_Decimate(const U16 * pIn, U16 * pOut, U32 frames, U32 channels, U32 factor)
+{
+  U32 acc[ADC_CHANNELS_MAX];
+  U32 c, k;
+
+  for (; 0 < frames; frames--)
+  {
+    for (c = 0; c < channels; c++) acc[c] = *pIn++;
+    for (k = 1; k < factor; k++)
+    {
+      for (c = 0; c < channels; c++) acc[c] += *pIn++;
+    }
+    for (c = 0; c < channels; c++) *pOut++ = (U16)acc[c];
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void adc_Half(ADC_State * pThis, U32 half)
+{
+  ADC_Config * pConfig = &pThis->Config;
+  U32 samples = pConfig->Frames * pConfig->Channels;
+  const U16 * pIn = &pConfig->pRing[half * samples];
+  ADC_Block * pBlock;
+
+  if (1 == pConfig->Decimation)
+  {
+    /* Raw blocks are the ring halves themselves, the DMA overwrites them one half later */
+    pBlock = &pThis->Blocks[half];
+  }
+  else
+  {
+    pBlock = &pThis->Blocks[pThis->Sequence % ADC_BLOCKS];
+  }
+
+  pThis->Sequence++;
+#if (1 == ADC_PROFILE)
+  pThis->Stats.Samples += samples;
+#endif
+
+  if (0 != pBlock->Owned)
+  {
+    pThis->Stats.Dropped++;
+    return;
+  }
+
+  if (1 != pConfig->Decimation)
+  {
+    adc_Decimate(pIn, (U16 *)pBlock->pData, pThis->OutFrames, pConfig->Channels,
+                 pConfig->Decimation);
+  }
+
+  pBlock->Sequence = pThis->Sequence - 1;
+  pBlock->Owned = TRUE;
+  pThis->Stats.Blocks++;
+
+  pConfig->pCallback(pBlock, pConfig->pContext);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void adc_DMA(U32 channel, U32 events, void * pContext)
+{
+  ADC_State * pThis = (ADC_State *)pContext;
+#if (1 == ADC_PROFILE)
+  U32 cycles = DWT_Cycles();
+#endif
+
+  if (0 != (events & DMA_EVENT_ERROR)) pThis->Stats.Errors++;
+
+  /* Both events come if the interrupt was late, the halves are handed over in order */
+  if (0 != (events & DMA_EVENT_HALF)) adc_Half(pThis, 0);
+  if (0 != (events & DMA_EVENT_DONE)) adc_Half(pThis, 1);
+
+#if (1 == ADC_PROFILE)
+  pThis->Stats.Cycles += DWT_Cycles() - cycles;
+#endif
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void adc_Pin(U32 channel)
+{
+  U32 pin = channel & 7;
+
+  if (8 > channel)
+  {
+    GPIO_Init(GPIOA, pin, GPIO_TYPE_IN_ANALOG);
+  }
+  else if (10 > channel)
+  {
+    GPIO_Init(GPIOB, pin, GPIO_TYPE_IN_ANALOG);
+  }
+  else
+  {
+    ADC1->CR2 |= ADC_CR2_TSVREFE;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void adc_Calibrate(void)
+{
+  volatile U32 delay;
+
+  /* Power up, tSTAB is 1 us: at least 2 ADC clocks must pass before the calibration */
+  ADC1->CR2 = ADC_CR2_ADON;
+  for (delay = 0; delay < (SystemCoreClock / 1000000); delay++)
+  {
+    //
+  }
+
+  ADC1->CR2 |= ADC_CR2_RSTCAL;
+  while (0 != (ADC1->CR2 & ADC_CR2_RSTCAL))
+  {
+    //
+  }
+
+  ADC1->CR2 |= ADC_CR2_CAL;
+  while (0 != (ADC1->CR2 & ADC_CR2_CAL))
+  {
+    //
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 ADC_Init(const ADC_Config * pConfig)
+{
+  ADC_State * pThis = &ADC_This;
+  U32 i, channel, frames;
+
+  if ((NULL == pConfig) || (NULL == pConfig->pChannels) || (NULL == pConfig->pRing) ||
+      (NULL == pConfig->pCallback) || (0 == pConfig->Rate)) return FALSE;
+  if ((0 == pConfig->Channels) || (ADC_CHANNELS_MAX < pConfig->Channels)) return FALSE;
+  if ((0 == pConfig->Decimation) || (ADC_DECIMATION_MAX < pConfig->Decimation)) return FALSE;
+  if ((0 == pConfig->Frames) || (0 != (pConfig->Frames % pConfig->Decimation))) return FALSE;
+  if ((1 != pConfig->Decimation) && (NULL == pConfig->pOut)) return FALSE;
+
+  ADC_Stop();
+  pThis->Channel = DMA_Claim(DMA_REQ_ADC1, IRQ_PRIORITY_ADC, adc_DMA, pThis);
+  if (0 == pThis->Channel) return FALSE;
+
+  memset(pThis->Blocks, 0, sizeof(pThis->Blocks));
+  memset(&pThis->Stats, 0, sizeof(pThis->Stats));
+  memcpy(&pThis->Config, pConfig, sizeof(ADC_Config));
+  pThis->OutFrames = pConfig->Frames / pConfig->Decimation;
+  frames = (1 == pConfig->Decimation) ? pConfig->Frames : pThis->OutFrames;
+
+  for (i = 0; i < ADC_BLOCKS; i++)
+  {
+    pThis->Blocks[i].Frames   = frames;
+    pThis->Blocks[i].Channels = pConfig->Channels;
+    pThis->Blocks[i].pData    = (1 == pConfig->Decimation) ?
+      &pConfig->pRing[(i & 1) * pConfig->Frames * pConfig->Channels] :
+      &pConfig->pOut[i * frames * pConfig->Channels];
+  }
+
+  BITBAND_RCC_APB2ENR(RCC_APB2ENR_ADC1EN_Pos) = 1;
+  BITBAND_RCC_APB1ENR(RCC_APB1ENR_TIM3EN_Pos) = 1;
+
+  adc_SetPrescaler();
+  adc_Calibrate();
+
+  /* One scan of the sequence per trigger */
+  ADC1->CR1   = ADC_CR1_SCAN;
+  ADC1->SQR1  = (U32)(pConfig->Channels - 1) << ADC_SQR1_L_Pos;
+  ADC1->SQR2  = 0;
+  ADC1->SQR3  = 0;
+  ADC1->SMPR1 = 0;
+  ADC1->SMPR2 = 0;
+
+  for (i = 0; i < pConfig->Channels; i++)
+  {
+    channel = pConfig->pChannels[i] & 0x1F;
+
+    if (6 > i)
+    {
+      ADC1->SQR3 |= channel << (i * 5);
+    }
+    else if (12 > i)
+    {
+      ADC1->SQR2 |= channel << ((i - 6) * 5);
+    }
+    else
+    {
+      ADC1->SQR1 |= channel << ((i - 12) * 5);
+    }
+
+    if (10 > channel)
+    {
+      ADC1->SMPR2 |= (U32)(pConfig->SampleTime & 7) << (channel * 3);
+    }
+    else
+    {
+      ADC1->SMPR1 |= (U32)(pConfig->SampleTime & 7) << ((channel - 10) * 3);
+    }
+
+    adc_Pin(channel);
+  }
+
+  /* TIM3 only produces the trigger, no outputs */
+  TIM3->CR1 = 0;
+  TIM3->CR2 = ADC_TIM_CR2_MMS_UPDATE;
+  adc_SetRate(pConfig->Rate);
+
+  if (NULL == pThis->Notifier.pFunc)
+  {
+    Clock_Register(&pThis->Notifier, adc_ClockChanged, NULL);
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void ADC_Start(void)
+{
+  ADC_State * pThis = &ADC_This;
+  ADC_Config * pConfig = &pThis->Config;
+  U32 i;
+
+  /* Claimed again after a stop, by then another driver may have taken it */
+  if (0 == pThis->Channel)
+  {
+    pThis->Channel = DMA_Claim(DMA_REQ_ADC1, IRQ_PRIORITY_ADC, adc_DMA, pThis);
+    if (0 == pThis->Channel) return;
+  }
+
+  pThis->Sequence = 0;
+  for (i = 0; i < ADC_BLOCKS; i++) pThis->Blocks[i].Owned = FALSE;
+
+  DMA1_Channel1->CCR   = 0;
+  DMA1_Channel1->CPAR  = (U32)&ADC1->DR;
+  DMA1_Channel1->CMAR  = (U32)pConfig->pRing;
+  DMA1_Channel1->CNDTR = ADC_RING_SIZE(pConfig->Channels, pConfig->Frames);
+  DMA1->IFCR = DMA_IFCR_CGIF1;
+  DMA1_Channel1->CCR   = DMA_CCR_PL_1 | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 | DMA_CCR_MINC |
+                         DMA_CCR_CIRC | DMA_CCR_TEIE | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
+
+  /* Written at once with the other bits, so ADON does not start a conversion by itself */
+  ADC1->CR2 = (ADC1->CR2 & ADC_CR2_TSVREFE) | ADC_CR2_EXTTRIG | ADC_CR2_EXTSEL_TIM3_TRGO |
+              ADC_CR2_DMA | ADC_CR2_ADON;
+
+  TIM3->CNT = 0;
+  TIM3->CR1 = TIM_CR1_CEN;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void ADC_Stop(void)
+{
+  if (0 == (RCC->APB1ENR & RCC_APB1ENR_TIM3EN)) return;
+
+  TIM3->CR1 = 0;
+  ADC1->CR2 &= ~(ADC_CR2_EXTTRIG | ADC_CR2_DMA);
+  DMA_Release(ADC_This.Channel);
+  ADC_This.Channel = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* May be called from a task or an interrupt, a single store */
+
+void ADC_Release(const ADC_Block * pBlock)
+{
+  ((ADC_Block *)pBlock)->Owned = FALSE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void ADC_GetStats(ADC_Stats * pStats)
+{
+  U32 primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(pStats, &ADC_This.Stats, sizeof(ADC_Stats));
+  __set_PRIMASK(primask);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The frame rate actually produced by TIM3, the requested one is rounded to the timer clock */
+
+U32 ADC_GetRate(void)
+{
+  U32 clock = Clock_GetPCLK1();
+
+  if (0 != (RCC->CFGR & RCC_CFGR_PPRE1_2)) clock *= 2;
+
+  return clock / ((TIM3->PSC + 1) * (TIM3->ARR + 1));
+}
@@ -0,0 +1,89 @@
+#ifndef __ADC_H__
+#define __ADC_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* ADC1 acquisition engine. TIM3 triggers one scan of the channel sequence per frame, DMA1
+   channel 1 moves the samples into a circular ring of two halves. When a half is complete it is
+   handed to the consumer as a block: either directly (Decimation = 1, zero-copy from the ring)
+   or after an oversampling stage that sums Decimation frames into one (up to 16x, 16-bit sums).
+
+   A block belongs to the consumer until ADC_Release(). If it is not released by the time the
+   driver needs it again, the new block is dropped and counted, the ring itself never stops.
+
+   A raw block is valid only until the next half-transfer: the DMA starts writing into it again
+   one half later, whether it was released or not. Its consumer must copy or process it within
+   Frames / Rate seconds; ownership only decides whether the next block is handed over.           */
+
+/* Decimated blocks in flight (consumer + filling) */
+#define ADC_BLOCKS                         (4)
+#define ADC_CHANNELS_MAX                   (16)
+#define ADC_DECIMATION_MAX                 (16)
+
+/* Measure the cycles spent in the DMA interrupt */
+#ifndef ADC_PROFILE
+#define ADC_PROFILE                        (0)
+#endif
+
+/* Sizes of the buffers the caller provides, in samples (U16) */
+#define ADC_RING_SIZE(channels, frames) \
+  (2 * (channels) * (frames))
+#define ADC_OUT_SIZE(channels, frames, decimation) \
+  (ADC_BLOCKS * (channels) * ((frames) / (decimation)))
+
+/* Sample time in ADC clocks, the conversion adds 12.5 clocks */
+#define ADC_SAMPLE_1CYCLE5                 (0)
+#define ADC_SAMPLE_7CYCLES5                (1)
+#define ADC_SAMPLE_13CYCLES5               (2)
+#define ADC_SAMPLE_28CYCLES5               (3)
+#define ADC_SAMPLE_41CYCLES5               (4)
+#define ADC_SAMPLE_55CYCLES5               (5)
+#define ADC_SAMPLE_71CYCLES5               (6)
+#define ADC_SAMPLE_239CYCLES5              (7)
+
+typedef struct
+{
+  const U16 * pData;                       /* Frames x Channels, interleaved in sequence order    */
+  U16         Frames;
+  U8          Channels;
+  volatile U8 Owned;
+  U32         Sequence;                    /* Block number since ADC_Start(), gaps are drops      */
+} ADC_Block;
+
+/* Called from the DMA interrupt (IRQ_PRIORITY_ADC) */
+typedef void (*ADC_Callback)(const ADC_Block * pBlock, void * pContext);
+
+typedef struct
+{
+  const U8 *   pChannels;                  /* 0..9 - PA0..PA7, PB0..PB1, 16 - Temp, 17 - Vref     */
+  U8           Channels;
+  U8           SampleTime;                 /* ADC_SAMPLE_x, for all channels                      */
+  U16          Decimation;                 /* 1 - raw blocks, valid for one half of the ring      */
+  U16          Frames;                     /* Frames in one half of the ring                      */
+  U32          Rate;                       /* Frames per second                                   */
+  U16 *        pRing;                      /* ADC_RING_SIZE() samples                             */
+  U16 *        pOut;                       /* ADC_OUT_SIZE() samples, unused if Decimation = 1    */
+  ADC_Callback pCallback;
+  void *       pContext;
+} ADC_Config;
+
+typedef struct
+{
+  U32 Blocks;                              /* Blocks handed to the consumer                       */
+  U32 Dropped;                             /* Blocks lost because the consumer held the buffer    */
+  U32 Errors;                              /* DMA transfer errors                                 */
+#if (1 == ADC_PROFILE)
+  U32 Cycles;                              /* Spent in the interrupt                              */
+  U32 Samples;                             /* Moved by the DMA                                    */
+#endif
+} ADC_Stats;
+
+U32  ADC_Init(const ADC_Config * pConfig);
+void ADC_Start(void);
+void ADC_Stop(void);
+void ADC_Release(const ADC_Block * pBlock);
+void ADC_GetStats(ADC_Stats * pStats);
+U32  ADC_GetRate(void);
+
+#endif /* __ADC_H__ */
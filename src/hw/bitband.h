@@ -0,0 +1,73 @@
+#ifndef __BITBAND_H__
+#define __BITBAND_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* Cortex-M3 bit-band aliases. Every bit of the first 1 MB of SRAM (0x20000000) and of the        */
+/* peripheral space (0x40000000) has its own word in the alias region. A store to the alias word  */
+/* is an atomic read-modify-write of the single bit done by the bus matrix, so no interrupt       */
+/* masking is needed even when other bits of the same word are changed from interrupts.          */
+
+#define BITBAND_SRAM_ADDR(address,bit) \
+  (SRAM_BB_BASE + (((U32)(address) - SRAM_BASE) << 5) + ((U32)(bit) << 2))
+
+#define BITBAND_PERIPH_ADDR(address,bit) \
+  (PERIPH_BB_BASE + (((U32)(address) - PERIPH_BASE) << 5) + ((U32)(bit) << 2))
+
+/* Alias word of a bit in an SRAM variable, e.g. BITBAND_SRAM(&flags, 3) = 1 */
+#define BITBAND_SRAM(address,bit) \
+  (*(volatile U32 *)BITBAND_SRAM_ADDR(address, bit))
+
+/* Alias word of a bit in a peripheral register, e.g. BITBAND_PERIPH(&RCC->APB2ENR, 2) = 1 */
+#define BITBAND_PERIPH(address,bit) \
+  (*(volatile U32 *)BITBAND_PERIPH_ADDR(address, bit))
+
+/* Typed accessors of the most used peripheral bits. 'bit' is the bit position (the _Pos define) */
+#define BITBAND_RCC_APB1ENR(bit)           BITBAND_PERIPH(&RCC->APB1ENR, bit)
+#define BITBAND_RCC_APB2ENR(bit)           BITBAND_PERIPH(&RCC->APB2ENR, bit)
+#define BITBAND_RCC_AHBENR(bit)            BITBAND_PERIPH(&RCC->AHBENR, bit)
+#define BITBAND_GPIO_ODR(port,pin)         BITBAND_PERIPH(&(port)->ODR, pin)
+#define BITBAND_GPIO_IDR(port,pin)         BITBAND_PERIPH(&(port)->IDR, pin)
+#define BITBAND_TIM_CR1(tim,bit)           BITBAND_PERIPH(&(tim)->CR1, bit)
+#define BITBAND_TIM_DIER(tim,bit)          BITBAND_PERIPH(&(tim)->DIER, bit)
+#define BITBAND_TIM_SR(tim,bit)            BITBAND_PERIPH(&(tim)->SR, bit)
+
+/* Atomic flag set: up to 32 flags in one SRAM word. Set, clear and test are single bit-band     */
+/* accesses; test-and-clear uses the exclusive monitor because it has to return the old value.   */
+/* The object must be placed in SRAM (a global, static or stack variable).                       */
+
+typedef struct
+{
+  volatile U32 Bits;
+} Flags;
+
+__STATIC_INLINE void Flags_Set(Flags * pFlags, U32 flag)
+{
+  BITBAND_SRAM(&pFlags->Bits, flag) = 1;
+}
+
+__STATIC_INLINE void Flags_Clr(Flags * pFlags, U32 flag)
+{
+  BITBAND_SRAM(&pFlags->Bits, flag) = 0;
+}
+
+__STATIC_INLINE U32 Flags_Get(Flags * pFlags, U32 flag)
+{
+  return BITBAND_SRAM(&pFlags->Bits, flag);
+}
+
+__STATIC_INLINE U32 Flags_TestAndClr(Flags * pFlags, U32 flag)
+{
+  U32 bits;
+
+  do
+  {
+    bits = __LDREXW(&pFlags->Bits);
+  }
+  while (0 != __STREXW(bits & ~(1U << flag), &pFlags->Bits));
+
+  return ((bits >> flag) & 1U);
+}
+
+#endif /* __BITBAND_H__ */
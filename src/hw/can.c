@@ -0,0 +1,843 @@
+#include <string.h>
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "gpio.h"
+#include "bitband.h"
+#include "irq.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "can.h"
+
+#define CAN_MAILBOXES                      (3)
+
+/* Polls of INAK while the controller enters or leaves the initialization mode. Leaving it takes
+   11 recessive bits, 1.1 ms at 10 kbit/s.                                                        */
+#define CAN_TIMEOUT                        (1000000)
+
+#define CAN_IER                            (CAN_IER_FMPIE0 | CAN_IER_FOVIE0 | CAN_IER_FMPIE1 | \
+                                            CAN_IER_FOVIE1 | CAN_IER_TMEIE | CAN_IER_BOFIE | \
+                                            CAN_IER_ERRIE)
+
+/* CAN_State.Events: the clock changed, the bit timing is out of date */
+#define CAN_EVENT_REJOIN                   (0)
+
+/* Kinds of filter entries, by the bank layout that holds them */
+enum
+{
+  CAN_KIND_STD_LIST,                       /* 16-bit scale, list mode                             */
+  CAN_KIND_STD_MASK,                       /* 16-bit scale, mask mode                             */
+  CAN_KIND_EXT_LIST,                       /* 32-bit scale, list mode                             */
+  CAN_KIND_EXT_MASK,                       /* 32-bit scale, mask mode                             */
+  CAN_KINDS
+};
+
+/* Entries per bank */
+static const U8 CAN_Slots[CAN_KINDS] = {4, 2, 2, 1};
+
+typedef struct
+{
+  CAN_Banks *        pBanks;
+  U32                Fifo;
+  U32                Kind;
+  U32                Slot;                 /* Next slot of the open bank, 0 - no bank open        */
+  U32                Number;               /* Filter number of the first slot of the open bank    */
+  U32                Next;                 /* Filter number of the next bank of the FIFO          */
+  const CAN_Filter * pLast;                /* Repeated in the unused slots of a bank              */
+  U32                Last;
+} CAN_Compiler;
+
+typedef struct
+{
+  CAN_Config     Config;
+  CAN_Banks      Banks;
+  volatile U32   Head;                     /* Ring, written by the interrupt                      */
+  volatile U32   Tail;                     /* Ring, written by the application                    */
+  CAN_Frame      Queue[CAN_TX_QUEUE];      /* Falling priority: the next frame is the last one    */
+  U32            Queued;
+  CAN_Frame      Mailbox[CAN_MAILBOXES];   /* Copies, for the frames given back to the queue      */
+  U32            Busy;                     /* Mailboxes holding a frame                           */
+  U32            Aborting;                 /* Mailboxes with an abort requested                   */
+  CAN_Stats      Stats;
+  Flags          Events;                   /* CAN_EVENT_xxx, set from interrupts                  */
+  Clock_Notifier Notifier;
+} CAN_State;
+
+static CAN_State CAN_This;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Identifier in the layout of the TIxR, RIxR and 32-bit filter registers */
+
+static U32 can_Reg32(U32 id)
+{
+  U32 rtr = (0 != (id & CAN_ID_RTR)) ? CAN_TI0R_RTR : 0;
+
+  if (0 != (id & CAN_ID_EXT)) return ((id & CAN_ID_EXT_MASK) << 3) | CAN_TI0R_IDE | rtr;
+  return ((id & CAN_ID_STD_MASK) << 21) | rtr;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Standard identifier in the layout of a 16-bit filter register, IDE is bit 3 */
+
+static U32 can_Reg16(U32 id)
+{
+  return ((id & CAN_ID_STD_MASK) << 5) | ((0 != (id & CAN_ID_RTR)) ? 0x10 : 0);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Position of a frame in the bus arbitration, the lowest key wins: the 11 base bits, then RTR
+   (standard) or SRR (extended, recessive), IDE, the 18 extension bits and RTR (extended)         */
+
+static U32 can_Key(U32 id)
+{
+  U32 rtr = (0 != (id & CAN_ID_RTR));
+
+  if (0 == (id & CAN_ID_EXT)) return ((id & CAN_ID_STD_MASK) << 21) | (rtr << 20);
+  return (((id >> 18) & CAN_ID_STD_MASK) << 21) | (3U << 19) | ((id & 0x3FFFF) << 1) | rtr;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* An entry that compares all the identifier bits and RTR fits a list mode slot */
+
+static U32 can_Kind(const CAN_Filter * pFilter)
+{
+  U32 ext = (0 != (pFilter->Id & CAN_ID_EXT));
+  U32 exact = (ext ? CAN_ID_EXT_MASK : CAN_ID_STD_MASK) | CAN_ID_RTR;
+
+  if (exact == (pFilter->Mask & exact)) return ext ? CAN_KIND_EXT_LIST : CAN_KIND_STD_LIST;
+  return ext ? CAN_KIND_EXT_MASK : CAN_KIND_STD_MASK;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void can_Write(CAN_Compiler * pCompiler, U32 slot, const CAN_Filter * pFilter, U32 index)
+{
+  CAN_Banks * pBanks = pCompiler->pBanks;
+  U32 * pFR = pBanks->FR[pBanks->Banks - 1];
+  U32 exact = (0 != (pFilter->Id & CAN_ID_EXT)) ? CAN_ID_EXT_MASK : CAN_ID_STD_MASK;
+  U32 mask = (pFilter->Mask & (exact | CAN_ID_RTR)) | (pFilter->Id & CAN_ID_EXT);
+  U32 shift;
+
+  switch (pCompiler->Kind)
+  {
+    case CAN_KIND_STD_LIST:
+      shift = 16 * (slot & 1);
+      pFR[slot / 2] = (pFR[slot / 2] & ~(0xFFFFU << shift)) | (can_Reg16(pFilter->Id) << shift);
+      break;
+
+    case CAN_KIND_STD_MASK:
+      pFR[slot] = can_Reg16(pFilter->Id) | ((can_Reg16(mask) | 0x08) << 16);
+      break;
+
+    case CAN_KIND_EXT_LIST:
+      pFR[slot] = can_Reg32(pFilter->Id);
+      break;
+
+    default:
+      pFR[0] = can_Reg32(pFilter->Id);
+      pFR[1] = can_Reg32(mask) | CAN_TI0R_IDE;
+      break;
+  }
+
+  pBanks->Match[pCompiler->Fifo][pCompiler->Number + slot] = (U8)index;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The unused slots of the open bank repeat its last entry */
+
+static void can_Close(CAN_Compiler * pCompiler)
+{
+  if (0 == pCompiler->Slot) return;
+
+  while (pCompiler->Slot < CAN_Slots[pCompiler->Kind])
+  {
+    can_Write(pCompiler, pCompiler->Slot++, pCompiler->pLast, pCompiler->Last);
+  }
+  pCompiler->Slot = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 can_Put(CAN_Compiler * pCompiler, U32 kind, const CAN_Filter * pFilter, U32 index)
+{
+  CAN_Banks * pBanks = pCompiler->pBanks;
+  U32 bit;
+
+  if ((0 == pCompiler->Slot) || (kind != pCompiler->Kind))
+  {
+    can_Close(pCompiler);
+    if (CAN_BANKS == pBanks->Banks) return FALSE;
+
+    bit = 1U << pBanks->Banks++;
+    if ((CAN_KIND_STD_LIST == kind) || (CAN_KIND_EXT_LIST == kind)) pBanks->FM1R |= bit;
+    if ((CAN_KIND_EXT_LIST == kind) || (CAN_KIND_EXT_MASK == kind)) pBanks->FS1R |= bit;
+    if (0 != pCompiler->Fifo) pBanks->FFA1R |= bit;
+    pBanks->FA1R |= bit;
+
+    pCompiler->Kind   = kind;
+    pCompiler->Number = pCompiler->Next;
+    pCompiler->Next  += CAN_Slots[kind];
+  }
+
+  can_Write(pCompiler, pCompiler->Slot, pFilter, index);
+  pCompiler->pLast = pFilter;
+  pCompiler->Last  = index;
+  if (++pCompiler->Slot == CAN_Slots[kind]) pCompiler->Slot = 0;
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The banks of FIFO 0 come first, then those of FIFO 1, so that the filter match indexes of each
+   FIFO (numbered over its banks in order) only depend on its own entries. In a FIFO the entries
+   are grouped by kind. A single standard identifier left over from the list banks takes the free
+   slot of the last 16-bit mask bank when that saves a bank.                                      */
+
+U32 CAN_Compile(const CAN_Filter * pFilters, U32 count, CAN_Banks * pBanks)
+{
+  CAN_Compiler compiler;
+  U32 counts[CAN_KINDS], fifo, kind, listed, exact, i, k;
+
+  memset(pBanks, 0, sizeof(CAN_Banks));
+  if (2 * CAN_MATCHES < count) return FALSE;
+
+  compiler.pBanks = pBanks;
+  for (fifo = 0; fifo < 2; fifo++)
+  {
+    memset(counts, 0, sizeof(counts));
+    for (i = 0; i < count; i++)
+    {
+      if (1 < pFilters[i].Fifo) return FALSE;
+      if (fifo == pFilters[i].Fifo) counts[can_Kind(&pFilters[i])]++;
+    }
+
+    listed = counts[CAN_KIND_STD_LIST];
+    exact  = listed % CAN_Slots[CAN_KIND_STD_LIST];
+    if ((counts[CAN_KIND_STD_MASK] + exact + 1) / 2 < 1 + (counts[CAN_KIND_STD_MASK] + 1) / 2)
+    {
+      listed -= exact;
+    }
+
+    compiler.Fifo = fifo;
+    compiler.Slot = 0;
+    compiler.Next = 0;
+
+    for (kind = 0; kind < CAN_KINDS; kind++)
+    {
+      for (i = 0, k = 0; i < count; i++)
+      {
+        if (fifo != pFilters[i].Fifo) continue;
+
+        exact = can_Kind(&pFilters[i]);
+        if ((CAN_KIND_STD_LIST == exact) && (k++ >= listed)) exact = CAN_KIND_STD_MASK;
+        if (kind != exact) continue;
+
+        if (FALSE == can_Put(&compiler, kind, &pFilters[i], i)) return FALSE;
+      }
+      can_Close(&compiler);
+    }
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Walks the banks as the hardware does. The frame is compared in the 32-bit layout, or in the
+   16-bit one (base identifier, RTR, IDE and extension bits 17..15). Of several matching entries
+   the winner is the one in 32-bit scale, then in list mode, then with the lowest number.        */
+
+U32 CAN_Match(const CAN_Banks * pBanks, U32 id, U32 * pFifo, U32 * pFilter)
+{
+  U32 reg32 = can_Reg32(id), reg16, numbers[2] = {0, 0}, best = 0, bank, bit, fifo, kind, k;
+  const U32 * pFR;
+
+  reg16 = ((reg32 >> 16) & 0xFFE0) | ((0 != (reg32 & CAN_TI0R_RTR)) ? 0x10 : 0) |
+          ((0 != (reg32 & CAN_TI0R_IDE)) ? 0x08 : 0) | ((reg32 >> 18) & 0x07);
+
+  for (bank = 0; bank < CAN_BANKS; bank++)
+  {
+    bit  = 1U << bank;
+    fifo = (0 != (pBanks->FFA1R & bit));
+    pFR  = pBanks->FR[bank];
+    kind = ((0 != (pBanks->FS1R & bit)) ? CAN_KIND_EXT_LIST : CAN_KIND_STD_LIST) +
+           ((0 != (pBanks->FM1R & bit)) ? 0 : 1);
+
+    for (k = 0; (0 != (pBanks->FA1R & bit)) && (k < CAN_Slots[kind]); k++)
+    {
+      switch (kind)
+      {
+        case CAN_KIND_STD_LIST:
+          if (reg16 != ((pFR[k / 2] >> (16 * (k & 1))) & 0xFFFF)) continue;
+          break;
+
+        case CAN_KIND_STD_MASK:
+          if (0 != ((reg16 ^ pFR[k]) & (pFR[k] >> 16))) continue;
+          break;
+
+        case CAN_KIND_EXT_LIST:
+          if (reg32 != pFR[k]) continue;
+          break;
+
+        default:
+          if (0 != ((reg32 ^ pFR[0]) & pFR[1])) continue;
+          break;
+      }
+
+      /* Ranks 1 to 4: 16-bit mask, 16-bit list, 32-bit mask, 32-bit list */
+      if (best < (kind ^ 1) + 1)
+      {
+        best     = (kind ^ 1) + 1;
+        *pFifo   = fifo;
+        *pFilter = pBanks->Match[fifo][numbers[fifo] + k];
+      }
+    }
+    numbers[fifo] += CAN_Slots[kind];
+  }
+
+  return (0 != best);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Bit timing for PCLK1, 0 if there is none: 8 to 25 time quanta per bit, the sample point near
+   87.5 %, a resynchronization jump of 1 quantum                                                  */
+
+static U32 can_Timing(U32 bitrate)
+{
+  U32 clock = Clock_GetPCLK1(), quanta, brp, ts2;
+
+  for (quanta = 25; quanta >= 8; quanta--)
+  {
+    if (0 != clock % (bitrate * quanta)) continue;
+
+    brp = clock / (bitrate * quanta);
+    ts2 = (quanta + 4) / 8;
+    if ((1024 < brp) || (16 < quanta - 1 - ts2)) continue;
+
+    return ((brp - 1) << CAN_BTR_BRP_Pos) | ((quanta - 2 - ts2) << CAN_BTR_TS1_Pos) |
+           ((ts2 - 1) << CAN_BTR_TS2_Pos);
+  }
+
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 can_Request(U32 init)
+{
+  U32 timeout;
+
+  if (FALSE != init) CAN1->MCR |= CAN_MCR_INRQ;
+  else               CAN1->MCR &= ~CAN_MCR_INRQ;
+
+  for (timeout = 0; timeout < CAN_TIMEOUT; timeout++)
+  {
+    if ((0 != (CAN1->MSR & CAN_MSR_INAK)) == (FALSE != init)) return TRUE;
+  }
+  return FALSE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Enters the initialization mode and joins the bus again with the new bit timing, if any */
+
+static U32 can_Join(CAN_State * pThis)
+{
+  static const U32 modes[] =
+  {
+    0, CAN_BTR_SILM, CAN_BTR_LBKM, CAN_BTR_SILM | CAN_BTR_LBKM
+  };
+  U32 timing = can_Timing(pThis->Config.Bitrate);
+
+  if ((FALSE == can_Request(TRUE)) || (0 == timing)) return FALSE;
+
+  CAN1->BTR = timing | modes[pThis->Config.Mode];
+  return can_Request(FALSE);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* After a crystal failure this runs in the NMI, where the waits of can_Join() have no place. The
+   controller is only told to leave the bus, which it does at the end of the frame in progress;
+   the new bit timing is loaded by can_Rejoin() from the next call of the application.            */
+
+static void can_ClockChanged(U32 oldHz, U32 newHz, void * pContext)
+{
+  if (0 == (RCC->APB1ENR & RCC_APB1ENR_CAN1EN)) return;
+
+  CAN1->MCR |= CAN_MCR_INRQ;
+  Flags_Set(&CAN_This.Events, CAN_EVENT_REJOIN);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The flag is cleared first, in one step with its test: a clock change during the join sets it
+   again                                                                                          */
+
+static void can_Rejoin(CAN_State * pThis)
+{
+  if (0 != Flags_TestAndClr(&pThis->Events, CAN_EVENT_REJOIN)) can_Join(pThis);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Empties both FIFOs into the ring, waiting for each output mailbox release to take effect before
+   the next frame is read. A FIFO is left alone, its interrupt masked, when the ring is full.     */
+
+static void can_Drain(CAN_State * pThis)
+{
+  CAN_Config * pConfig = &pThis->Config;
+  CAN_FIFOMailBox_TypeDef * pBox;
+  volatile U32 * pRFR;
+  CAN_Frame * pFrame;
+  U32 head = pThis->Head, fifo, pending, rir, rdtr;
+
+  for (fifo = 0; fifo < 2; fifo++)
+  {
+    pRFR = (0 == fifo) ? &CAN1->RF0R : &CAN1->RF1R;
+    pBox = &CAN1->sFIFOMailBox[fifo];
+
+    if (0 != (*pRFR & CAN_RF0R_FOVR0))
+    {
+      *pRFR = CAN_RF0R_FOVR0;
+      pThis->Stats.Overruns++;
+    }
+
+    for (pending = *pRFR & CAN_RF0R_FMP0; 0 != pending; pending--)
+    {
+      if (head - pThis->Tail == pConfig->Frames)
+      {
+        CAN1->IER &= ~((0 == fifo) ? CAN_IER_FMPIE0 : CAN_IER_FMPIE1);
+        pThis->Stats.Deferred++;
+        break;
+      }
+
+      pFrame = &pConfig->pRing[head & (pConfig->Frames - 1)];
+      rir  = pBox->RIR;
+      rdtr = pBox->RDTR;
+
+      pFrame->Id = (0 != (rir & CAN_RI0R_IDE)) ? ((rir >> 3) | CAN_ID_EXT) : (rir >> 21);
+      if (0 != (rir & CAN_RI0R_RTR)) pFrame->Id |= CAN_ID_RTR;
+      pFrame->Length = (U8)(rdtr & CAN_RDT0R_DLC);
+      if (8 < pFrame->Length) pFrame->Length = 8;
+      pFrame->Filter = pThis->Banks.Match[fifo][((rdtr >> CAN_RDT0R_FMI_Pos) & 0xFF) % CAN_MATCHES];
+      pFrame->Time   = (U16)(rdtr >> CAN_RDT0R_TIME_Pos);
+      ((U32 *)pFrame->Data)[0] = pBox->RDLR;
+      ((U32 *)pFrame->Data)[1] = pBox->RDHR;
+
+      *pRFR = CAN_RF0R_RFOM0;
+      while (0 != (*pRFR & CAN_RF0R_RFOM0)) {};
+      head++;
+    }
+  }
+
+  if (head != pThis->Head)
+  {
+    pThis->Stats.Received += head - pThis->Head;
+    pThis->Head = head;
+    if (NULL != pConfig->pNotify) pConfig->pNotify(CAN_EVENT_RX, pConfig->pContext);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Entries of the queue, those it has to take back from the aborted mailboxes included */
+
+static U32 can_Reserved(CAN_State * pThis)
+{
+  U32 aborting = pThis->Aborting;
+
+  return pThis->Queued + (aborting & 1) + ((aborting >> 1) & 1) + ((aborting >> 2) & 1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Inserted behind the frames that win the arbitration against it, and behind those with the same
+   key, which were queued earlier. A frame taken back from a mailbox is older than them all.     */
+
+static void can_Queue(CAN_State * pThis, const CAN_Frame * pFrame, U32 back)
+{
+  U32 key = can_Key(pFrame->Id), i = pThis->Queued, other;
+
+  while (0 != i)
+  {
+    other = can_Key(pThis->Queue[i - 1].Id);
+    if ((other > key) || ((other == key) && (FALSE != back))) break;
+
+    pThis->Queue[i] = pThis->Queue[i - 1];
+    i--;
+  }
+
+  pThis->Queue[i] = *pFrame;
+  pThis->Queued++;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void can_Load(CAN_State * pThis, U32 box, const CAN_Frame * pFrame)
+{
+  CAN_TxMailBox_TypeDef * pBox = &CAN1->sTxMailBox[box];
+
+  pThis->Mailbox[box] = *pFrame;
+  pThis->Busy |= 1U << box;
+
+  pBox->TDTR = pFrame->Length;
+  pBox->TDLR = ((const U32 *)pFrame->Data)[0];
+  pBox->TDHR = ((const U32 *)pFrame->Data)[1];
+  pBox->TIR  = can_Reg32(pFrame->Id) | CAN_TI0R_TXRQ;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Moves the head of the queue to the free mailboxes. The controller sends the mailbox with the
+   lowest identifier first (TXFP = 0), so two frames of the same identifier must not be in the
+   mailboxes together. With all the mailboxes full, the one the head outranks the most is
+   aborted; its frame comes back to the queue in the transmit interrupt.                          */
+
+static void can_Fill(CAN_State * pThis)
+{
+  const CAN_Frame * pHead;
+  U32 key, free, lowest, box;
+
+  while (0 != pThis->Queued)
+  {
+    pHead  = &pThis->Queue[pThis->Queued - 1];
+    key    = can_Key(pHead->Id);
+    free   = CAN_MAILBOXES;
+    lowest = CAN_MAILBOXES;
+
+    for (box = 0; box < CAN_MAILBOXES; box++)
+    {
+      if (0 == (pThis->Busy & (1U << box)))
+      {
+        if (CAN_MAILBOXES == free) free = box;
+        continue;
+      }
+      if (can_Key(pThis->Mailbox[box].Id) == key) return;
+      if ((0 == (pThis->Aborting & (1U << box))) && ((CAN_MAILBOXES == lowest) ||
+          (can_Key(pThis->Mailbox[box].Id) > can_Key(pThis->Mailbox[lowest].Id))))
+      {
+        lowest = box;
+      }
+    }
+
+    if (CAN_MAILBOXES != free)
+    {
+      can_Load(pThis, free, pHead);
+      pThis->Queued--;
+      continue;
+    }
+
+    if ((CAN_MAILBOXES != lowest) && (key < can_Key(pThis->Mailbox[lowest].Id)) &&
+        (CAN_TX_QUEUE > can_Reserved(pThis)))
+    {
+      CAN1->TSR = CAN_TSR_ABRQ0 << (8 * lowest);
+      pThis->Aborting |= 1U << lowest;
+    }
+    return;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* RQCPx: the mailbox is done, sent (TXOKx) or aborted */
+
+static void can_TX(void * pContext)
+{
+  CAN_State * pThis = (CAN_State *)pContext;
+  U32 tsr = CAN1->TSR, sent = 0, box, bits;
+
+  for (box = 0; box < CAN_MAILBOXES; box++)
+  {
+    bits = tsr >> (8 * box);
+    if (0 == (bits & CAN_TSR_RQCP0)) continue;
+
+    CAN1->TSR = CAN_TSR_RQCP0 << (8 * box);
+    if (0 != (bits & CAN_TSR_TXOK0))
+    {
+      sent++;
+    }
+    else
+    {
+      can_Queue(pThis, &pThis->Mailbox[box], TRUE);
+      pThis->Stats.Requeued++;
+    }
+    pThis->Busy     &= ~(1U << box);
+    pThis->Aborting &= ~(1U << box);
+  }
+
+  can_Fill(pThis);
+
+  if (0 != sent)
+  {
+    pThis->Stats.Sent += sent;
+    if (NULL != pThis->Config.pNotify) pThis->Config.pNotify(CAN_EVENT_TX, pThis->Config.pContext);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void can_RX(void * pContext)
+{
+  can_Drain((CAN_State *)pContext);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The controller recovers from bus-off by itself (ABOM), after 128 x 11 recessive bits */
+
+static void can_SCE(void * pContext)
+{
+  CAN_State * pThis = (CAN_State *)pContext;
+
+  CAN1->MSR = CAN_MSR_ERRI;
+  if (0 != (CAN1->ESR & CAN_ESR_BOFF))
+  {
+    pThis->Stats.BusOff++;
+    if (NULL != pThis->Config.pNotify)
+    {
+      pThis->Config.pNotify(CAN_EVENT_BUS_OFF, pThis->Config.pContext);
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Remapping writes SWJ_CFG, which reads back undefined, as 0: the full SWJ of the reset */
+
+static void can_Pins(CAN_Pins pins)
+{
+  GPIO * pPort = (GPIO *)GPIOA;
+  U32 rx = 11, tx = 12, remap = AFIO_MAPR_CAN_REMAP_REMAP1;
+
+  if (CAN_PINS_PB8_PB9 == pins)
+  {
+    pPort = (GPIO *)GPIOB;
+    rx    = 8;
+    tx    = 9;
+    remap = AFIO_MAPR_CAN_REMAP_REMAP2;
+  }
+
+  GPIO_Hi(pPort, rx);
+  GPIO_Init(pPort, rx, GPIO_TYPE_IN_PUP_PDN);
+  GPIO_Init(pPort, tx, GPIO_TYPE_ALT_PP_50MHZ);
+  AFIO->MAPR = (AFIO->MAPR & ~(AFIO_MAPR_SWJ_CFG | AFIO_MAPR_CAN_REMAP)) | remap;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Joins the bus. Fails while USB is started, when the bitrate can not be made from PCLK1 or the
+   filters do not fit in the banks.                                                               */
+
+U32 CAN_Init(const CAN_Config * pConfig)
+{
+  CAN_State * pThis = &CAN_This;
+
+  if ((NULL == pConfig) || (0 == pConfig->Bitrate) || (NULL == pConfig->pRing)) return FALSE;
+  if ((0 == pConfig->Frames) || (0 != (pConfig->Frames & (pConfig->Frames - 1)))) return FALSE;
+  if ((CAN_MODE_SELFTEST < pConfig->Mode) || (0 != (RCC->APB1ENR & RCC_APB1ENR_USBEN)))
+  {
+    return FALSE;
+  }
+
+  CAN_Stop();
+
+  memcpy(&pThis->Config, pConfig, sizeof(CAN_Config));
+  pThis->Head     = 0;
+  pThis->Tail     = 0;
+  pThis->Queued   = 0;
+  pThis->Busy     = 0;
+  pThis->Aborting = 0;
+  Flags_Clr(&pThis->Events, CAN_EVENT_REJOIN);
+  memset(&pThis->Stats, 0, sizeof(CAN_Stats));
+
+  RCC->APB1RSTR |= RCC_APB1RSTR_CAN1RST;
+  RCC->APB1RSTR &= ~RCC_APB1RSTR_CAN1RST;
+  BITBAND_RCC_APB1ENR(RCC_APB1ENR_CAN1EN_Pos) = 1;
+
+  if (CAN_MODE_SELFTEST != pConfig->Mode) can_Pins(pConfig->Pins);
+
+  /* Out of sleep, automatic bus-off recovery, time stamps, mailboxes sent by identifier */
+  CAN1->MCR = CAN_MCR_INRQ | CAN_MCR_ABOM | CAN_MCR_TTCM;
+  CAN1->IER = 0;
+
+  IRQ_ATTACH(USB_HP_CAN1_TX_IRQn, can_TX, pThis);
+  IRQ_ATTACH(USB_LP_CAN1_RX0_IRQn, can_RX, pThis);
+  IRQ_ATTACH(CAN1_RX1_IRQn, can_RX, pThis);
+  IRQ_ATTACH(CAN1_SCE_IRQn, can_SCE, pThis);
+  NVIC_SetPriority(USB_HP_CAN1_TX_IRQn, IRQ_PRIORITY_CAN);
+  NVIC_SetPriority(USB_LP_CAN1_RX0_IRQn, IRQ_PRIORITY_CAN);
+  NVIC_SetPriority(CAN1_RX1_IRQn, IRQ_PRIORITY_CAN);
+  NVIC_SetPriority(CAN1_SCE_IRQn, IRQ_PRIORITY_CAN);
+  NVIC_EnableIRQ(USB_HP_CAN1_TX_IRQn);
+  NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+  NVIC_EnableIRQ(CAN1_RX1_IRQn);
+  NVIC_EnableIRQ(CAN1_SCE_IRQn);
+
+  if (FALSE == CAN_SetFilters(pConfig->pFilters, pConfig->Filters))
+  {
+    CAN_Stop();
+    return FALSE;
+  }
+  CAN1->IER = CAN_IER;
+
+  if (NULL == pThis->Notifier.pFunc)
+  {
+    Clock_Register(&pThis->Notifier, can_ClockChanged, NULL);
+  }
+
+  if (FALSE == can_Join(pThis))
+  {
+    CAN_Stop();
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Leaves the bus and stops the clock, which frees the packet memory for USB */
+
+void CAN_Stop(void)
+{
+  if (0 == (RCC->APB1ENR & RCC_APB1ENR_CAN1EN)) return;
+
+  NVIC_DisableIRQ(USB_HP_CAN1_TX_IRQn);
+  NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+  NVIC_DisableIRQ(CAN1_RX1_IRQn);
+  NVIC_DisableIRQ(CAN1_SCE_IRQn);
+  CAN1->IER = 0;
+  can_Request(TRUE);
+  BITBAND_RCC_APB1ENR(RCC_APB1ENR_CAN1EN_Pos) = 0;
+  Flags_Clr(&CAN_This.Events, CAN_EVENT_REJOIN);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The frames already in the FIFOs are drained first, their filter indexes refer to the old list.
+   A list that does not fit turns all the banks off.                                              */
+
+U32 CAN_SetFilters(const CAN_Filter * pFilters, U32 count)
+{
+  CAN_State * pThis = &CAN_This;
+  CAN_Banks * pBanks = &pThis->Banks;
+  U32 result, i;
+
+  if (0 == (RCC->APB1ENR & RCC_APB1ENR_CAN1EN)) return FALSE;
+
+  NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+  NVIC_DisableIRQ(CAN1_RX1_IRQn);
+
+  can_Drain(pThis);
+  result = CAN_Compile(pFilters, count, pBanks);
+
+  CAN1->FMR |= CAN_FMR_FINIT;
+  CAN1->FA1R = 0;
+  if (FALSE != result)
+  {
+    CAN1->FM1R  = pBanks->FM1R;
+    CAN1->FS1R  = pBanks->FS1R;
+    CAN1->FFA1R = pBanks->FFA1R;
+    for (i = 0; i < CAN_BANKS; i++)
+    {
+      CAN1->sFilterRegister[i].FR1 = pBanks->FR[i][0];
+      CAN1->sFilterRegister[i].FR2 = pBanks->FR[i][1];
+    }
+    CAN1->FA1R = pBanks->FA1R;
+  }
+  CAN1->FMR &= ~CAN_FMR_FINIT;
+
+  NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+  NVIC_EnableIRQ(CAN1_RX1_IRQn);
+
+  return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 CAN_GetRead(CAN_Frame ** ppFrames)
+{
+  CAN_State * pThis = &CAN_This;
+  U32 tail = pThis->Tail, index = tail & (pThis->Config.Frames - 1);
+  U32 count = pThis->Head - tail;
+
+  can_Rejoin(pThis);
+
+  if (count > pThis->Config.Frames - index) count = pThis->Config.Frames - index;
+
+  *ppFrames = &pThis->Config.pRing[index];
+  return count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The FIFO interrupts masked by a full ring are enabled again, the frames they hold come in */
+
+void CAN_Consume(U32 count)
+{
+  CAN_State * pThis = &CAN_This;
+  U32 primask;
+
+  pThis->Tail += count;
+
+  if ((CAN_IER_FMPIE0 | CAN_IER_FMPIE1) != (CAN1->IER & (CAN_IER_FMPIE0 | CAN_IER_FMPIE1)))
+  {
+    primask = __get_PRIMASK();
+    __disable_irq();
+    CAN1->IER |= CAN_IER_FMPIE0 | CAN_IER_FMPIE1;
+    __set_PRIMASK(primask);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 CAN_Send(const CAN_Frame * pFrame)
+{
+  CAN_State * pThis = &CAN_This;
+  U32 primask, result = FALSE;
+
+  if ((8 < pFrame->Length) || (0 == (RCC->APB1ENR & RCC_APB1ENR_CAN1EN))) return FALSE;
+  can_Rejoin(pThis);
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (CAN_TX_QUEUE > can_Reserved(pThis))
+  {
+    can_Queue(pThis, pFrame, FALSE);
+    can_Fill(pThis);
+    result = TRUE;
+  }
+  __set_PRIMASK(primask);
+
+  return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 CAN_GetTxFree(void)
+{
+  return CAN_TX_QUEUE - can_Reserved(&CAN_This);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void CAN_GetStats(CAN_Stats * pStats)
+{
+  U32 primask = __get_PRIMASK(), esr;
+
+  __disable_irq();
+  memcpy(pStats, &CAN_This.Stats, sizeof(CAN_Stats));
+  __set_PRIMASK(primask);
+
+  esr = (0 != (RCC->APB1ENR & RCC_APB1ENR_CAN1EN)) ? CAN1->ESR : 0;
+  pStats->TxErrors = (esr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos;
+  pStats->RxErrors = (esr & CAN_ESR_REC) >> CAN_ESR_REC_Pos;
+}
@@ -0,0 +1,140 @@
+#ifndef __CAN_H__
+#define __CAN_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* bxCAN driver. Only the wanted frames reach the CPU: the list of identifiers and masks is
+   compiled into the 14 hardware filter banks, each group of entries in the densest layout that
+   holds it (four standard identifiers per bank in 16-bit list mode, two standard pairs in 16-bit
+   mask mode, two extended identifiers in 32-bit list mode, one extended pair in 32-bit mask mode).
+
+   Reception: the interrupt of either FIFO drains both FIFOs into a ring of frames, which the
+   application reads in place (CAN_GetRead/CAN_Consume). When the ring is full the frames are left
+   in the FIFOs (3 each) and their interrupts are masked until the application consumes some.
+
+   Transmission: the frames wait in a queue sorted as the bus arbitration sorts them, the three
+   mailboxes are refilled from its head in the interrupt. A frame that outranks the three full
+   mailboxes has the lowest of them aborted and queued again. Frames with the same identifier are
+   never in two mailboxes at once, so they are sent in order.
+
+   On the F103 CAN and USB share the 512 bytes of packet memory and two interrupt vectors: only
+   one of them can be running, CAN_Init() fails while USB is started and USB_Start() the other way
+   round. A clock change takes the controller off the bus at once, even from the NMI of a crystal
+   failure; the next CAN_GetRead() or CAN_Send() loads the new bit timing and joins again, or
+   leaves it off the bus if the new PCLK1 can not produce the bitrate.                            */
+
+#ifndef CAN_TX_QUEUE
+#define CAN_TX_QUEUE                       (16)
+#endif
+
+#define CAN_BANKS                          (14)
+#define CAN_MATCHES                        (4 * CAN_BANKS)   /* Filter match indexes per FIFO  */
+
+/* Identifier flags, in CAN_Frame.Id and CAN_Filter.Id */
+#define CAN_ID_EXT                         (0x80000000U)     /* 29-bit identifier              */
+#define CAN_ID_RTR                         (0x40000000U)     /* Remote frame                   */
+#define CAN_ID_STD_MASK                    (0x000007FFU)
+#define CAN_ID_EXT_MASK                    (0x1FFFFFFFU)
+
+/* Events of CAN_Notify */
+#define CAN_EVENT_RX                       (0x01)            /* Frames added to the ring       */
+#define CAN_EVENT_TX                       (0x02)            /* Room in the send queue         */
+#define CAN_EVENT_BUS_OFF                  (0x04)
+
+typedef enum
+{
+  CAN_MODE_NORMAL,
+  CAN_MODE_SILENT,                         /* Listen only, no acknowledge                         */
+  CAN_MODE_LOOPBACK,                       /* Own frames received, sent on the bus too            */
+  CAN_MODE_SELFTEST                        /* Silent loopback: nothing on the pins                */
+} CAN_Mode;
+
+typedef enum
+{
+  CAN_PINS_PA11_PA12,                      /* RX, TX. The USB pins.                               */
+  CAN_PINS_PB8_PB9                         /* Remapped                                            */
+} CAN_Pins;
+
+typedef struct
+{
+  U32 Id;                                  /* CAN_ID_EXT for a 29-bit identifier                  */
+  U32 Mask;                                /* Identifier bits compared, with CAN_ID_RTR to tell   */
+                                           /* data and remote frames apart                        */
+  U8  Fifo;                                /* 0 or 1                                              */
+} CAN_Filter;
+
+typedef struct
+{
+  U32 Id;                                  /* With CAN_ID_EXT and CAN_ID_RTR                      */
+  U8  Length;
+  U8  Filter;                              /* Received: index of the matching CAN_Filter          */
+  U16 Time;                                /* Received: bit time at the start of frame            */
+  U8  Data[8];
+} CAN_Frame;
+
+/* Called from the CAN interrupts (IRQ_PRIORITY_CAN) with CAN_EVENT_* flags */
+typedef void (*CAN_Notify)(U32 events, void * pContext);
+
+typedef struct
+{
+  U32                Bitrate;
+  CAN_Mode           Mode;
+  CAN_Pins           Pins;
+  const CAN_Filter * pFilters;
+  U32                Filters;              /* None receives nothing                               */
+  CAN_Frame *        pRing;
+  U32                Frames;               /* Size of the ring, a power of two                    */
+  CAN_Notify         pNotify;              /* May be NULL                                         */
+  void *             pContext;
+} CAN_Config;
+
+/* Image of the filter registers, as written by CAN_Compile() and loaded by CAN_SetFilters() */
+typedef struct
+{
+  U32 FM1R;                                /* 1 - list mode, 0 - mask mode                        */
+  U32 FS1R;                                /* 1 - 32-bit scale, 0 - 16-bit scale                  */
+  U32 FFA1R;                               /* 1 - FIFO 1                                          */
+  U32 FA1R;                                /* Active banks                                        */
+  U32 FR[CAN_BANKS][2];
+  U8  Match[2][CAN_MATCHES];               /* Filter match index of a FIFO to the CAN_Filter      */
+  U32 Banks;
+} CAN_Banks;
+
+typedef struct
+{
+  U32 Received;
+  U32 Sent;
+  U32 Requeued;                            /* Mailboxes aborted for a higher priority frame       */
+  U32 Deferred;                            /* Times the ring was full and the FIFOs held frames   */
+  U32 Overruns;                            /* Frames lost by a full FIFO                          */
+  U32 BusOff;
+  U32 TxErrors;                            /* Error counters of the controller, now               */
+  U32 RxErrors;
+} CAN_Stats;
+
+U32  CAN_Init(const CAN_Config * pConfig);
+void CAN_Stop(void);
+
+/* Replaces the filters while running, reception pauses while the banks are written */
+U32  CAN_SetFilters(const CAN_Filter * pFilters, U32 count);
+
+/* Pure: no register access, FALSE when the list does not fit in the banks */
+U32  CAN_Compile(const CAN_Filter * pFilters, U32 count, CAN_Banks * pBanks);
+
+/* Pure model of the filter hardware on an image, for checking CAN_Compile() on a host or
+   against the controller: TRUE when a frame with that identifier is accepted, with its FIFO
+   and the index of the CAN_Filter it is reported under                                          */
+U32  CAN_Match(const CAN_Banks * pBanks, U32 id, U32 * pFifo, U32 * pFilter);
+
+/* Zero copy reception: the contiguous frames waiting in the ring, then how many are done */
+U32  CAN_GetRead(CAN_Frame ** ppFrames);
+void CAN_Consume(U32 count);
+
+/* FALSE when the send queue is full */
+U32  CAN_Send(const CAN_Frame * pFrame);
+U32  CAN_GetTxFree(void);
+
+void CAN_GetStats(CAN_Stats * pStats);
+
+#endif /* __CAN_H__ */
@@ -0,0 +1,356 @@
+#include <string.h>
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "gpio.h"
+#include "irq.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "dma.h"
+#include "capture.h"
+
+/* TS = 0b100 - TI1F_ED (both edges of TI1), SMS = 0b100 - reset mode */
+#define CAPTURE_SMCR_RESET_ON_EDGE         (TIM_SMCR_TS_2 | TIM_SMCR_SMS_2)
+#define CAPTURE_DMA_CCR                    (DMA_CCR_PL_0 | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 | \
+                                            DMA_CCR_MINC | DMA_CCR_TEIE | DMA_CCR_EN)
+#define CAPTURE_DMA_FLAGS                  (DMA_IFCR_CGIF2 | DMA_IFCR_CGIF3)
+
+typedef struct
+{
+  Capture_Config        Config;
+  Capture_Frame         Frames[CAPTURE_FRAMES];
+  U32                   Filling;
+  U32                   Sequence;
+  U32                   Continued;         /* The filling frame has no leading idle capture       */
+  DMA_Channel_TypeDef * pActive;
+  DMA_Channel_TypeDef * pIdle;
+  U32                   IdleChannel;
+  U32                   Claimed;           /* Both DMA channels                                   */
+  Capture_Stats         Stats;
+  Clock_Notifier        Notifier;
+} Capture_State;
+
+static Capture_State Capture_This;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* TIM1 runs at PCLK2, doubled when the APB2 prescaler is not 1 */
+
+static U32 capture_TimerClock(void)
+{
+  U32 clock = Clock_GetPCLK2();
+
+  if (0 != (RCC->CFGR & RCC_CFGR_PPRE2_2)) clock *= 2;
+  return clock;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void capture_SetTick(U32 tickHz)
+{
+  U32 psc = capture_TimerClock() / tickHz;
+
+  if (0 == psc) psc = 1;
+  if (0x10000 < psc) psc = 0x10000;
+
+  /* URS is set: the update event only loads the prescaler, no interrupt */
+  TIM1->PSC = psc - 1;
+  TIM1->EGR = TIM_EGR_UG;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void capture_ClockChanged(U32 oldHz, U32 newHz, void * pContext)
+{
+  capture_SetTick(Capture_This.Config.TickHz);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Points both DMA channels at a frame. A frame that starts from the idle level begins with the
+   capture of the idle period itself, which lands in the slot before pIdle[0]. A capture taken
+   while the channels are off stays pending in the timer and is moved when they are enabled.     */
+
+static void capture_Arm(Capture_State * pThis, Capture_Frame * pFrame, U32 continued)
+{
+  U32 pulses = pThis->Config.Pulses;
+
+  pThis->pActive->CCR   = 0;
+  pThis->pIdle->CCR     = 0;
+  DMA1->IFCR            = CAPTURE_DMA_FLAGS;
+
+  pThis->pActive->CMAR  = (U32)pFrame->pActive;
+  pThis->pActive->CNDTR = pulses;
+  pThis->pIdle->CMAR    = (U32)((TRUE == continued) ? pFrame->pIdle : (pFrame->pIdle - 1));
+  pThis->pIdle->CNDTR   = (TRUE == continued) ? pulses : (pulses + 1);
+
+  pThis->pActive->CCR   = CAPTURE_DMA_CCR;
+  pThis->pIdle->CCR     = CAPTURE_DMA_CCR | DMA_CCR_TCIE;
+  pThis->Continued      = continued;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Ends the filling frame, re-arms the capture on the other one and hands the frame over. 'full'
+   is TRUE when the idle channel completed: the line has just left the idle level and the next
+   frame continues the train.                                                                    */
+
+static void capture_Close(Capture_State * pThis, U32 full)
+{
+  Capture_Frame * pFrame = &pThis->Frames[pThis->Filling];
+  U32 pulses = pThis->Config.Pulses - pThis->pActive->CNDTR, next;
+
+  if (0 == pulses)
+  {
+    /* Only the edge leaving the idle level, the line stayed active: nothing to decode */
+    pThis->Stats.Errors++;
+    capture_Arm(pThis, pFrame, FALSE);
+    return;
+  }
+
+  if (FALSE == full)
+  {
+    /* The last idle phase is the timeout, it was never captured */
+    ((U16 *)pFrame->pIdle)[pulses - 1] = CAPTURE_TIMEOUT;
+  }
+
+  pFrame->Pulses = pulses;
+  pFrame->Full   = full;
+  pThis->Sequence++;
+
+  next = pThis->Filling ^ 1;
+  if (0 != pThis->Frames[next].Owned)
+  {
+    pThis->Stats.Dropped++;
+    capture_Arm(pThis, pFrame, full);
+    return;
+  }
+
+  capture_Arm(pThis, &pThis->Frames[next], full);
+  pThis->Filling = next;
+
+  pFrame->Sequence = pThis->Sequence - 1;
+  pFrame->Owned = TRUE;
+  pThis->Stats.Frames++;
+
+  pThis->Config.pCallback(pFrame, pThis->Config.pContext);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Overflow: no edge for Timeout ticks. Until the next edge only the trigger interrupt is kept. */
+
+static void capture_Update(Capture_State * pThis)
+{
+  U32 pulses = pThis->Config.Pulses + ((TRUE == pThis->Continued) ? 0 : 1);
+
+  TIM1->SR   = ~TIM_SR_UIF;
+  TIM1->DIER = (TIM1->DIER & ~TIM_DIER_UIE) | TIM_DIER_TIE;
+
+  if ((pThis->Config.Pulses != pThis->pActive->CNDTR) || (pulses != pThis->pIdle->CNDTR))
+  {
+    capture_Close(pThis, FALSE);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* First edge after an idle period: the timeout is watched again until the frame ends */
+
+static void capture_Trigger(Capture_State * pThis)
+{
+  TIM1->SR   = ~(TIM_SR_TIF | TIM_SR_UIF);
+  TIM1->DIER = (TIM1->DIER & ~TIM_DIER_TIE) | TIM_DIER_UIE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void capture_DMA(U32 channel, U32 events, void * pContext)
+{
+  Capture_State * pThis = (Capture_State *)pContext;
+
+  if (0 != (events & DMA_EVENT_ERROR)) pThis->Stats.Errors++;
+  if ((0 != (events & DMA_EVENT_DONE)) && (pThis->IdleChannel == channel))
+  {
+    capture_Close(pThis, TRUE);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 capture_Claim(Capture_State * pThis)
+{
+  if (FALSE != pThis->Claimed) return TRUE;
+
+  if (0 == DMA_Claim(DMA_REQ_TIM1_CH1, IRQ_PRIORITY_CAPTURE, capture_DMA, pThis)) return FALSE;
+  if (0 == DMA_Claim(DMA_REQ_TIM1_CH2, IRQ_PRIORITY_CAPTURE, capture_DMA, pThis))
+  {
+    DMA_Release(DMA_REQ_TIM1_CH1);
+    return FALSE;
+  }
+  pThis->Claimed = TRUE;
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Capture_Init(const Capture_Config * pConfig)
+{
+  Capture_State * pThis = &Capture_This;
+  U32 i, size;
+
+  if ((NULL == pConfig) || (NULL == pConfig->pBuffer) || (NULL == pConfig->pCallback)) return FALSE;
+  if ((0 == pConfig->TickHz) || (0 == pConfig->Timeout)) return FALSE;
+  if (CAPTURE_TIMEOUT <= pConfig->Timeout) return FALSE;
+  if ((0 == pConfig->Pulses) || (0xFFFE < pConfig->Pulses)) return FALSE;
+
+  Capture_Stop();
+  if (FALSE == capture_Claim(pThis)) return FALSE;
+
+  memset(pThis->Frames, 0, sizeof(pThis->Frames));
+  memset(&pThis->Stats, 0, sizeof(pThis->Stats));
+  memcpy(&pThis->Config, pConfig, sizeof(Capture_Config));
+
+  /* Per frame: Pulses active phases, then the leading idle slot and Pulses idle phases */
+  size = 2 * pConfig->Pulses + 1;
+  for (i = 0; i < CAPTURE_FRAMES; i++)
+  {
+    pThis->Frames[i].pActive = &pConfig->pBuffer[i * size];
+    pThis->Frames[i].pIdle   = &pConfig->pBuffer[i * size + pConfig->Pulses + 1];
+  }
+
+  /* IC1 (rising edges, DMA1 channel 2) ends the low phases, IC2 (falling edges, channel 3) the
+     high ones: which one is active depends on the idle level                                    */
+  if (FALSE != pConfig->IdleHigh)
+  {
+    pThis->pActive     = DMA_CHANNEL(DMA_REQ_TIM1_CH1);
+    pThis->pIdle       = DMA_CHANNEL(DMA_REQ_TIM1_CH2);
+    pThis->IdleChannel = DMA_REQ_TIM1_CH2;
+  }
+  else
+  {
+    pThis->pActive     = DMA_CHANNEL(DMA_REQ_TIM1_CH2);
+    pThis->pIdle       = DMA_CHANNEL(DMA_REQ_TIM1_CH1);
+    pThis->IdleChannel = DMA_REQ_TIM1_CH1;
+  }
+
+  BITBAND_RCC_APB2ENR(RCC_APB2ENR_TIM1EN_Pos) = 1;
+
+  GPIO_Init(GPIOA, 8, GPIO_TYPE_IN_FLOATING);
+
+  /* Both captures on TI1, the counter restarts from 0 on every edge and overflows after Timeout */
+  TIM1->CR1   = TIM_CR1_URS;
+  TIM1->CR2   = 0;
+  TIM1->CCER  = 0;
+  TIM1->CCMR1 = TIM_CCMR1_CC1S_0 | ((U32)(pConfig->Filter & 0x0F) << TIM_CCMR1_IC1F_Pos) |
+                TIM_CCMR1_CC2S_1;
+  TIM1->CCER  = TIM_CCER_CC1E | TIM_CCER_CC2E | TIM_CCER_CC2P;
+  TIM1->SMCR  = CAPTURE_SMCR_RESET_ON_EDGE;
+  TIM1->ARR   = pConfig->Timeout;
+  capture_SetTick(pConfig->TickHz);
+
+  IRQ_ATTACH(TIM1_UP_IRQn, capture_Update, pThis);
+  IRQ_ATTACH(TIM1_TRG_COM_IRQn, capture_Trigger, pThis);
+  NVIC_SetPriority(TIM1_UP_IRQn, IRQ_PRIORITY_CAPTURE);
+  NVIC_SetPriority(TIM1_TRG_COM_IRQn, IRQ_PRIORITY_CAPTURE);
+
+  if (NULL == pThis->Notifier.pFunc)
+  {
+    Clock_Register(&pThis->Notifier, capture_ClockChanged, NULL);
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Capture_Start(void)
+{
+  Capture_State * pThis = &Capture_This;
+  U32 i;
+
+  /* Claimed again after a stop, by then another driver may have taken them */
+  if (FALSE == capture_Claim(pThis)) return;
+
+  pThis->Filling  = 0;
+  pThis->Sequence = 0;
+  for (i = 0; i < CAPTURE_FRAMES; i++) pThis->Frames[i].Owned = FALSE;
+
+  DMA_CHANNEL(DMA_REQ_TIM1_CH1)->CPAR = (U32)&TIM1->CCR1;
+  DMA_CHANNEL(DMA_REQ_TIM1_CH2)->CPAR = (U32)&TIM1->CCR2;
+  capture_Arm(pThis, &pThis->Frames[0], FALSE);
+
+  TIM1->CNT  = 0;
+  TIM1->SR   = 0;
+  TIM1->DIER = TIM_DIER_CC1DE | TIM_DIER_CC2DE | TIM_DIER_TIE;
+
+  NVIC_EnableIRQ(TIM1_UP_IRQn);
+  NVIC_EnableIRQ(TIM1_TRG_COM_IRQn);
+
+  TIM1->CR1 = TIM_CR1_URS | TIM_CR1_CEN;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Capture_Stop(void)
+{
+  if (0 == (RCC->APB2ENR & RCC_APB2ENR_TIM1EN)) return;
+
+  TIM1->CR1  = TIM_CR1_URS;
+  TIM1->DIER = 0;
+  NVIC_DisableIRQ(TIM1_UP_IRQn);
+  NVIC_DisableIRQ(TIM1_TRG_COM_IRQn);
+  if (FALSE != Capture_This.Claimed)
+  {
+    DMA_Release(DMA_REQ_TIM1_CH1);
+    DMA_Release(DMA_REQ_TIM1_CH2);
+    Capture_This.Claimed = FALSE;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* May be called from a task or an interrupt, a single store */
+
+void Capture_Release(const Capture_Frame * pFrame)
+{
+  ((Capture_Frame *)pFrame)->Owned = FALSE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Capture_GetStats(Capture_Stats * pStats)
+{
+  U32 primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(pStats, &Capture_This.Stats, sizeof(Capture_Stats));
+  __set_PRIMASK(primask);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The tick actually produced by the prescaler, the requested one is rounded to the timer clock */
+
+U32 Capture_GetTickHz(void)
+{
+  return capture_TimerClock() / (TIM1->PSC + 1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The input path stays connected in output mode, the timer sees the level the pin really has */
+
+void Capture_Drive(U32 level)
+{
+  if (FALSE == level)
+  {
+    GPIO_Lo(GPIOA, 8);
+    GPIO_Init(GPIOA, 8, GPIO_TYPE_OUT_OD_2MHZ);
+  }
+  else
+  {
+    GPIO_Init(GPIOA, 8, GPIO_TYPE_IN_FLOATING);
+  }
+}
@@ -0,0 +1,80 @@
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* Pulse train capture on PA8 (TIM1 channel 1). The timer is reset by every edge of the line, so
+   a capture is directly the length of the phase that just ended: IC1 latches the low phases on
+   the rising edges, IC2 the high phases on the falling edges. DMA1 channels 2 and 3 move them
+   into the frame buffer, no interrupt is taken per edge.
+
+   A frame is the pulse train between two idle periods: it ends when the line has stayed at its
+   idle level for Timeout ticks (the timer overflows), or when the buffer is full. Only then an
+   interrupt runs and hands the frame to the consumer, a continuous signal (PWM) is cut into
+   frames of Pulses periods that follow each other without a gap. While the line is idle the only
+   interrupt enabled is the trigger of the next edge.
+
+   A frame belongs to the consumer until Capture_Release(). If it is still held when the driver
+   needs it again, the new frame is dropped and counted, capture itself never stops.             */
+
+#define CAPTURE_FRAMES                     (2)
+
+/* Idle phase that ended the frame (the line went quiet) */
+#define CAPTURE_TIMEOUT                    ((U16)0xFFFF)
+
+/* Size of the buffer the caller provides, in U16 */
+#define CAPTURE_BUFFER_SIZE(pulses) \
+  (CAPTURE_FRAMES * (2 * (pulses) + 1))
+
+/* Convert microseconds to ticks and back */
+#define CAPTURE_TICKS(us, tickHz) \
+  ((U32)(((U64)(us) * (tickHz) + 500000) / 1000000))
+#define CAPTURE_US(ticks, tickHz) \
+  ((U32)(((U64)(ticks) * 1000000 + (tickHz) / 2) / (tickHz)))
+
+/* A pulse is an active phase (away from the idle level) followed by an idle phase */
+typedef struct
+{
+  const U16 * pActive;                     /* Ticks of the active phases                          */
+  const U16 * pIdle;                       /* pIdle[i] follows pActive[i]                         */
+  U16         Pulses;
+  U8          Full;                        /* Cut by the buffer, the next frame continues it      */
+  volatile U8 Owned;
+  U32         Sequence;                    /* Frame number since Capture_Start(), gaps are drops  */
+} Capture_Frame;
+
+/* Called from the capture interrupts (IRQ_PRIORITY_CAPTURE) */
+typedef void (*Capture_Callback)(const Capture_Frame * pFrame, void * pContext);
+
+typedef struct
+{
+  U32              TickHz;                 /* Timer resolution, 1000000 - 1 us                    */
+  U16              Timeout;                /* Idle ticks that end a frame, below CAPTURE_TIMEOUT  */
+  U16              Pulses;                 /* Largest frame                                       */
+  U8               IdleHigh;               /* Level of the line between frames                    */
+  U8               Filter;                 /* Input filter, IC1F 0..15                            */
+  U16 *            pBuffer;                /* CAPTURE_BUFFER_SIZE(Pulses)                         */
+  Capture_Callback pCallback;
+  void *           pContext;
+} Capture_Config;
+
+typedef struct
+{
+  U32 Frames;                              /* Frames handed to the consumer                       */
+  U32 Dropped;                             /* Frames lost because the consumer held the buffer    */
+  U32 Errors;                              /* DMA errors, timeouts at the active level            */
+} Capture_Stats;
+
+U32  Capture_Init(const Capture_Config * pConfig);
+void Capture_Start(void);
+void Capture_Stop(void);
+void Capture_Release(const Capture_Frame * pFrame);
+void Capture_GetStats(Capture_Stats * pStats);
+U32  Capture_GetTickHz(void);
+
+/* Pulls the line low (open drain) or releases it, for the start pulse of single-wire sensors.
+   The edges the driver makes are captured like the others.                                      */
+void Capture_Drive(U32 level);
+
+#endif /* __CAPTURE_H__ */
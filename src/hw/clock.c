@@ -0,0 +1,281 @@
+#include "types.h"
+#include "stm32f1xx.h"
+#include "system_stm32f1xx.h"
+#include "clock.h"
+
+#define RCC_CFGR_PLLSRC_HSI        (0U << RCC_CFGR_PLLSRC_Pos)
+#define RCC_CFGR_PLLSRC_HSE        (1U << RCC_CFGR_PLLSRC_Pos)
+#define CLOCK_LATENCY_0WS          (0U)
+#define CLOCK_LATENCY_1WS          (FLASH_ACR_LATENCY_0)
+#define CLOCK_LATENCY_2WS          (FLASH_ACR_LATENCY_1)
+
+typedef struct
+{
+  U32 Hz;
+  U32 Cfgr;                                /* PLL source/multiplier and APB1 prescaler            */
+  U32 Latency;
+} Clock_Config;
+
+static const Clock_Config Clock_ConfigsHSE[CLOCK_LEVELS] =
+{
+  {  8000000, RCC_CFGR_PPRE1_DIV1,                                            CLOCK_LATENCY_0WS },
+  { 24000000, RCC_CFGR_PPRE1_DIV1 | RCC_CFGR_PLLSRC_HSE | RCC_CFGR_PLLMULL3,  CLOCK_LATENCY_0WS },
+  { 48000000, RCC_CFGR_PPRE1_DIV2 | RCC_CFGR_PLLSRC_HSE | RCC_CFGR_PLLMULL6,  CLOCK_LATENCY_1WS },
+  { 72000000, RCC_CFGR_PPRE1_DIV2 | RCC_CFGR_PLLSRC_HSE | RCC_CFGR_PLLMULL9,  CLOCK_LATENCY_2WS },
+};
+
+static const Clock_Config Clock_ConfigsHSI[CLOCK_LEVELS] =
+{
+  {  8000000, RCC_CFGR_PPRE1_DIV1,                                            CLOCK_LATENCY_0WS },
+  { 24000000, RCC_CFGR_PPRE1_DIV1 | RCC_CFGR_PLLSRC_HSI | RCC_CFGR_PLLMULL6,  CLOCK_LATENCY_0WS },
+  { 48000000, RCC_CFGR_PPRE1_DIV2 | RCC_CFGR_PLLSRC_HSI | RCC_CFGR_PLLMULL12, CLOCK_LATENCY_1WS },
+  { 64000000, RCC_CFGR_PPRE1_DIV2 | RCC_CFGR_PLLSRC_HSI | RCC_CFGR_PLLMULL16, CLOCK_LATENCY_2WS },
+};
+
+static const Clock_Config * Clock_pConfigs = Clock_ConfigsHSE;
+static volatile Clock_Level Clock_Current = CLOCK_LEVEL_8MHZ;
+static volatile U32 Clock_Busy = FALSE;
+static Clock_Notifier * Clock_pNotifiers = NULL;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void clock_SetLatency(U32 latency)
+{
+  FLASH->ACR = (FLASH->ACR & ~FLASH_ACR_LATENCY) | latency;
+
+  /* The new value must be in effect before the clock changes */
+  while (latency != (FLASH->ACR & FLASH_ACR_LATENCY))
+  {
+    //
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 clock_HSELost(const Clock_Config * pConfig)
+{
+  return ((RCC_CFGR_PLLSRC_HSE == (pConfig->Cfgr & RCC_CFGR_PLLSRC)) &&
+          (0 == (RCC->CR & RCC_CR_HSERDY)));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Called with the interrupts disabled. The PLL can not be reprogrammed while it is running, so
+   the core is moved to HSI first. The PLL lock (up to 200 us) is the longest part of the switch.
+   Returns FALSE if the crystal stopped during the switch, the PLL would never lock then.         */
+
+static U32 clock_Switch(const Clock_Config * pConfig)
+{
+  U32 rate = 0;
+
+  /* SysTick keeps its rate: the rate is derived from the reload value at the old clock */
+  if (0 != (SysTick->CTRL & SysTick_CTRL_ENABLE_Msk))
+  {
+    rate = SystemCoreClock / (SysTick->LOAD + 1);
+  }
+
+  /* Wait states are added before the clock goes up */
+  if (pConfig->Latency > (FLASH->ACR & FLASH_ACR_LATENCY))
+  {
+    clock_SetLatency(pConfig->Latency);
+  }
+
+  RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_HSI;
+  while (RCC_CFGR_SWS_HSI != (RCC->CFGR & RCC_CFGR_SWS))
+  {
+    //
+  }
+
+  RCC->CR &= ~RCC_CR_PLLON;
+  while (0 != (RCC->CR & RCC_CR_PLLRDY))
+  {
+    //
+  }
+
+  /* The APB1 prescaler is changed at HSI, so PCLK1 never exceeds 36 MHz */
+  RCC->CFGR &= ~(RCC_CFGR_PPRE1 | RCC_CFGR_PLLSRC | RCC_CFGR_PLLXTPRE | RCC_CFGR_PLLMULL);
+  RCC->CFGR |= pConfig->Cfgr;
+
+  if (0 != (pConfig->Cfgr & RCC_CFGR_PLLMULL))
+  {
+    RCC->CR |= RCC_CR_PLLON;
+    while (0 == (RCC->CR & RCC_CR_PLLRDY))
+    {
+      if (TRUE == clock_HSELost(pConfig)) return FALSE;
+    }
+
+    RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL;
+    while (RCC_CFGR_SWS_PLL != (RCC->CFGR & RCC_CFGR_SWS))
+    {
+      if (TRUE == clock_HSELost(pConfig)) return FALSE;
+    }
+  }
+
+  /* ... and removed after it went down */
+  if (pConfig->Latency < (FLASH->ACR & FLASH_ACR_LATENCY))
+  {
+    clock_SetLatency(pConfig->Latency);
+  }
+
+  SystemCoreClockUpdate();
+
+  if (0 != rate)
+  {
+    SysTick->LOAD = (SystemCoreClock / rate) - 1;
+
+    /* The running period finishes with the old count. If it is longer than a new period, it is
+       cut (any write clears the counter), so the current tick is never stretched.                */
+    if (SysTick->VAL > SysTick->LOAD)
+    {
+      SysTick->VAL = 0;
+    }
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void clock_Notify(U32 oldHz)
+{
+  Clock_Notifier * pNotifier;
+
+  for (pNotifier = Clock_pNotifiers; NULL != pNotifier; pNotifier = pNotifier->pNext)
+  {
+    pNotifier->pFunc(oldHz, SystemCoreClock, pNotifier->pContext);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Finds the source and the level the boot code has left the clock at */
+
+void Clock_Init(void)
+{
+  U32 i;
+
+  SystemCoreClockUpdate();
+
+  if ((0 == (RCC->CR & RCC_CR_HSERDY)) || (RCC_CFGR_PLLSRC_HSI == (RCC->CFGR & RCC_CFGR_PLLSRC)))
+  {
+    Clock_pConfigs = Clock_ConfigsHSI;
+  }
+
+  Clock_Current = CLOCK_LEVEL_MAX;
+  for (i = 0; i < CLOCK_LEVELS; i++)
+  {
+    if (SystemCoreClock == Clock_pConfigs[i].Hz)
+    {
+      Clock_Current = (Clock_Level)i;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Must be called from the thread context, by one caller at a time (the governor). The notifiers
+   run in the caller's context after the switch.
+
+   The crystal may fail at any moment, the NMI can not be masked. While a switch is in progress
+   the NMI only selects the HSI table and the switch is repeated here with it.                    */
+
+U32 Clock_Set(Clock_Level level)
+{
+  const Clock_Config * pConfig;
+  U32 oldHz = SystemCoreClock, primask, result;
+
+  if (CLOCK_LEVELS <= level) return FALSE;
+  if (Clock_Current == level) return TRUE;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  do
+  {
+    Clock_Busy = TRUE;
+    pConfig = &Clock_pConfigs[level];
+    result = clock_Switch(pConfig);
+    Clock_Busy = FALSE;
+  }
+  while ((FALSE == result) || (pConfig != &Clock_pConfigs[level]));
+  Clock_Current = level;
+  __set_PRIMASK(primask);
+
+  clock_Notify(oldHz);
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+Clock_Level Clock_Get(void)
+{
+  return Clock_Current;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Clock_GetHz(Clock_Level level)
+{
+  return (CLOCK_LEVELS > level) ? Clock_pConfigs[level].Hz : 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Clock_IsHSE(void)
+{
+  return (Clock_ConfigsHSE == Clock_pConfigs);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Clock_GetPCLK1(void)
+{
+  return SystemCoreClock >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos];
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Clock_GetPCLK2(void)
+{
+  return SystemCoreClock >> APBPrescTable[(RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos];
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The notifier is owned by the driver (usually static), registration happens once at init */
+
+void Clock_Register(Clock_Notifier * pNotifier, Clock_Callback pFunc, void * pContext)
+{
+  U32 primask = __get_PRIMASK();
+
+  pNotifier->pFunc    = pFunc;
+  pNotifier->pContext = pContext;
+
+  __disable_irq();
+  pNotifier->pNext = Clock_pNotifiers;
+  Clock_pNotifiers = pNotifier;
+  __set_PRIMASK(primask);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Called from the NMI when the Clock Security System detects the HSE failure. By then the hardware
+   has stopped the HSE and the PLL and the core runs from HSI at 8 MHz, but SystemCoreClock and
+   all the dividers still hold the values for the crystal. The current level is restored from
+   HSI/2, so the timing is right again and the unit loses at most 11% of the speed.              */
+
+void Clock_HSEFailed(void)
+{
+  U32 oldHz = SystemCoreClock;
+
+  RCC->CIR = RCC_CIR_CSSC;
+  RCC->CR &= ~(RCC_CR_CSSON | RCC_CR_HSEON);
+
+  Clock_pConfigs = Clock_ConfigsHSI;
+
+  /* Clock_Set() is interrupted in the middle of a switch, it repeats the switch itself */
+  if (TRUE == Clock_Busy) return;
+
+  clock_Switch(&Clock_pConfigs[Clock_Current]);
+  clock_Notify(oldHz);
+}
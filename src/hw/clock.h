@@ -0,0 +1,41 @@
+#ifndef __CLOCK_H__
+#define __CLOCK_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* System clock levels, from the slowest. HCLK = SYSCLK and PCLK2 = HCLK at every level, PCLK1 is
+   halved above 36 MHz. The PLL runs from HSE (8 MHz) while the crystal works, after a failure it
+   runs from HSI/2 and the top level is 64 MHz instead of 72 MHz.                                 */
+typedef enum
+{
+  CLOCK_LEVEL_8MHZ  = 0,                   /* HSI, PLL off, 0 WS                                  */
+  CLOCK_LEVEL_24MHZ,                       /* PLL = HSE * 3 or HSI/2 * 6, 0 WS                    */
+  CLOCK_LEVEL_48MHZ,                       /* PLL = HSE * 6 or HSI/2 * 12, 1 WS                   */
+  CLOCK_LEVEL_MAX,                         /* PLL = HSE * 9 or HSI/2 * 16, 2 WS                   */
+  CLOCK_LEVELS
+} Clock_Level;
+
+/* Called after every change of the system clock. Drivers that derive baud rates, prescalers or
+   timeouts from the bus clocks reprogram them here. After a crystal failure it is called from
+   the NMI, so it must only touch the peripheral registers.                                       */
+typedef void (*Clock_Callback)(U32 oldHz, U32 newHz, void * pContext);
+
+typedef struct Clock_Notifier_s
+{
+  Clock_Callback            pFunc;
+  void *                    pContext;
+  struct Clock_Notifier_s * pNext;
+} Clock_Notifier;
+
+void        Clock_Init(void);
+U32         Clock_Set(Clock_Level level);
+Clock_Level Clock_Get(void);
+U32         Clock_GetHz(Clock_Level level);
+U32         Clock_IsHSE(void);
+U32         Clock_GetPCLK1(void);
+U32         Clock_GetPCLK2(void);
+void        Clock_Register(Clock_Notifier * pNotifier, Clock_Callback pFunc, void * pContext);
+void        Clock_HSEFailed(void);
+
+#endif /* __CLOCK_H__ */
@@ -1,6 +1,32 @@
 #include <string.h>
 #include <stdio.h>
 #include "debug.h"
+#include "clock.h"
+
+static Clock_Notifier Debug_ClockNotifier;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The SWO prescaler is programmed by the debugger for the boot clock. The bit rate the debugger
+   expects is derived from the old clock and kept when the system clock changes.                  */
+
+static void debug_ClockChanged(U32 oldHz, U32 newHz, void * pContext)
+{
+  U32 baud = oldHz / ((TPI->ACPR & TPI_ACPR_PRESCALER_Msk) + 1);
+
+  if ((0 == baud) || (newHz < baud)) return;
+
+  TPI->ACPR = (newHz / baud) - 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Debug_Init(void)
+{
+  Clock_Register(&Debug_ClockNotifier, debug_ClockChanged, NULL);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
 
 #if defined(__ARMCC_VERSION)
 #include <rt_misc.h>
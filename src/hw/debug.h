@@ -4,4 +4,6 @@
 #include "types.h"
 #include "stm32f1xx.h"
 
+void Debug_Init(void);
+
 #endif //__H_DUART_H__
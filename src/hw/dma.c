@@ -0,0 +1,274 @@
+#include <string.h>
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "bitband.h"
+#include "irq.h"
+#include "interrupts.h"
+#include "dma.h"
+
+#define DMA_EVENTS                         (DMA_EVENT_DONE | DMA_EVENT_HALF | DMA_EVENT_ERROR)
+
+/* What a DMA_Transfer may set in CCR: a chain needs the end of each transfer, no circular mode */
+#define DMA_TRANSFER_FLAGS                 (DMA_CCR_DIR | DMA_CCR_PINC | DMA_CCR_MINC | \
+                                            DMA_CCR_PSIZE | DMA_CCR_MSIZE | DMA_CCR_PL | \
+                                            DMA_CCR_MEM2MEM | DMA_CCR_HTIE)
+
+/* Interrupt and flags (ISR, IFCR) of channel 1..7 */
+#define DMA_IRQ(channel)                   ((IRQn_Type)(DMA1_Channel1_IRQn + (channel) - 1))
+#define DMA_SHIFT(channel)                 (4 * ((channel) - 1))
+
+typedef struct
+{
+  U32            Owned;
+  DMA_Handler    pHandler;
+  void *         pContext;
+  DMA_Transfer * pCurrent;                 /* Running chain, NULL when idle                       */
+  DMA_Transfer * pLast;
+} DMA_Slot;
+
+static DMA_Slot DMA_Slots[DMA_CHANNELS];
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void dma_Load(U32 channel, const DMA_Transfer * pTransfer)
+{
+  DMA_Channel_TypeDef * pChannel = DMA_CHANNEL(channel);
+
+  pChannel->CCR   = 0;
+  pChannel->CPAR  = (U32)pTransfer->pPeripheral;
+  pChannel->CMAR  = (U32)pTransfer->pMemory;
+  pChannel->CNDTR = pTransfer->Count;
+  DMA1->IFCR      = DMA_EVENTS << DMA_SHIFT(channel);
+  pChannel->CCR   = (pTransfer->Flags & DMA_TRANSFER_FLAGS) | DMA_CCR_TCIE | DMA_CCR_TEIE |
+                    DMA_CCR_EN;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static DMA_Transfer * dma_Last(DMA_Transfer * pTransfer)
+{
+  while (NULL != pTransfer->pNext) pTransfer = pTransfer->pNext;
+  return pTransfer;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Only the flags that were read are cleared (not GIF, which would clear them all): an event that
+   comes in the meantime raises the interrupt again. The next transfer of a chain is started
+   before anyone is told of the end of the previous one.                                          */
+
+static void dma_IRQ(DMA_Slot * pSlot)
+{
+  U32 channel = (U32)(pSlot - DMA_Slots) + 1;
+  U32 flags = (DMA1->ISR >> DMA_SHIFT(channel)) & DMA_EVENTS;
+  U32 events = flags & DMA_CHANNEL(channel)->CCR;
+  DMA_Transfer * pTransfer = pSlot->pCurrent;
+
+  DMA1->IFCR = flags << DMA_SHIFT(channel);
+  if (0 == events) return;
+
+  if ((NULL != pTransfer) && (0 != (events & (DMA_EVENT_DONE | DMA_EVENT_ERROR))))
+  {
+    pSlot->pCurrent = (0 != (events & DMA_EVENT_ERROR)) ? NULL : pTransfer->pNext;
+    if (NULL != pSlot->pCurrent)
+    {
+      dma_Load(channel, pSlot->pCurrent);
+    }
+    else
+    {
+      DMA_CHANNEL(channel)->CCR = 0;
+      pSlot->pLast = NULL;
+    }
+  }
+
+  if ((NULL != pTransfer) && (NULL != pTransfer->pDone)) pTransfer->pDone(pTransfer, events);
+  if (NULL != pSlot->pHandler) pSlot->pHandler(channel, events, pSlot->pContext);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A memory to memory request takes the free channel with the lowest hardware priority (the
+   highest number), the others go to the one their line is wired to                               */
+
+U32 DMA_Claim(U32 request, U32 priority, DMA_Handler pHandler, void * pContext)
+{
+  DMA_Slot * pSlot;
+  U32 primask, channel = 0, i;
+
+  if (DMA_CHANNELS < request) return 0;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  for (i = DMA_CHANNELS; (0 == channel) && (0 != i); i--)
+  {
+    pSlot = &DMA_Slots[i - 1];
+    if ((DMA_REQ_MEMORY != request) && (i != request)) continue;
+
+    if ((FALSE == pSlot->Owned) ||
+        ((DMA_REQ_MEMORY != request) && (pHandler == pSlot->pHandler) &&
+         (pContext == pSlot->pContext)))
+    {
+      pSlot->Owned    = TRUE;
+      pSlot->pHandler = pHandler;
+      pSlot->pContext = pContext;
+      channel = i;
+    }
+  }
+  __set_PRIMASK(primask);
+
+  if (0 == channel) return 0;
+
+  BITBAND_RCC_AHBENR(RCC_AHBENR_DMA1EN_Pos) = 1;
+  IRQ_ATTACH(DMA_IRQ(channel), dma_IRQ, &DMA_Slots[channel - 1]);
+  NVIC_SetPriority(DMA_IRQ(channel), priority);
+  NVIC_EnableIRQ(DMA_IRQ(channel));
+
+  return channel;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void DMA_Release(U32 channel)
+{
+  DMA_Slot * pSlot;
+
+  if ((0 == channel) || (DMA_CHANNELS < channel)) return;
+  pSlot = &DMA_Slots[channel - 1];
+  if (FALSE == pSlot->Owned) return;
+
+  NVIC_DisableIRQ(DMA_IRQ(channel));
+  DMA_CHANNEL(channel)->CCR = 0;
+  DMA1->IFCR = DMA_EVENTS << DMA_SHIFT(channel);
+  memset(pSlot, 0, sizeof(DMA_Slot));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 DMA_Start(U32 channel, DMA_Transfer * pTransfer)
+{
+  DMA_Slot * pSlot = &DMA_Slots[channel - 1];
+  U32 primask, result = FALSE;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (NULL == pSlot->pCurrent)
+  {
+    pSlot->pCurrent = pTransfer;
+    pSlot->pLast    = dma_Last(pTransfer);
+    dma_Load(channel, pTransfer);
+    result = TRUE;
+  }
+  __set_PRIMASK(primask);
+
+  return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* With the interrupts masked, the chain is either still running and picks the new transfers up
+   from pNext, or it has ended and they are started here                                          */
+
+void DMA_Queue(U32 channel, DMA_Transfer * pTransfer)
+{
+  DMA_Slot * pSlot = &DMA_Slots[channel - 1];
+  U32 primask;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  if (NULL == pSlot->pCurrent)
+  {
+    pSlot->pCurrent = pTransfer;
+    dma_Load(channel, pTransfer);
+  }
+  else
+  {
+    pSlot->pLast->pNext = pTransfer;
+  }
+  pSlot->pLast = dma_Last(pTransfer);
+  __set_PRIMASK(primask);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The transfers of the chain are dropped without their callbacks */
+
+void DMA_Abort(U32 channel)
+{
+  DMA_Slot * pSlot = &DMA_Slots[channel - 1];
+  U32 primask;
+
+  primask = __get_PRIMASK();
+  __disable_irq();
+  DMA_CHANNEL(channel)->CCR = 0;
+  DMA1->IFCR = DMA_EVENTS << DMA_SHIFT(channel);
+  pSlot->pCurrent = NULL;
+  pSlot->pLast    = NULL;
+  __set_PRIMASK(primask);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 DMA_IsBusy(U32 channel)
+{
+  return (NULL != DMA_Slots[channel - 1].pCurrent);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The widest unit both addresses share an alignment for: the head up to it and the tail that
+   does not fill a unit are copied by the CPU. The channel is polled, its interrupts stay off;
+   it has the lowest priority, so the streams of the peripherals go first.                        */
+
+void DMA_Memcpy(void * pTo, const void * pFrom, U32 count)
+{
+  U8 * pDest = (U8 *)pTo;
+  const U8 * pSource = (const U8 *)pFrom;
+  DMA_Channel_TypeDef * pChannel;
+  U32 channel = 0, width, flags, items, done;
+
+  if (DMA_MEMCPY_MIN <= count) channel = DMA_Claim(DMA_REQ_MEMORY, IRQ_PRIORITY_DMA, NULL, NULL);
+  if (0 == channel)
+  {
+    memcpy(pTo, pFrom, count);
+    return;
+  }
+
+  width = (0 == (((U32)pDest ^ (U32)pSource) & 3)) ? 4 :
+          (0 == (((U32)pDest ^ (U32)pSource) & 1)) ? 2 : 1;
+  flags = DMA_MEMORY_TO_MEMORY | DMA_PRIORITY_LOW |
+          ((4 == width) ? DMA_WORDS : (2 == width) ? DMA_HALFWORDS : DMA_BYTES);
+
+  while ((0 != ((U32)pDest & (width - 1))) && (0 != count))
+  {
+    *pDest++ = *pSource++;
+    count--;
+  }
+
+  pChannel = DMA_CHANNEL(channel);
+  while (width <= count)
+  {
+    items = count / width;
+    if (0xFFFF < items) items = 0xFFFF;
+
+    pChannel->CCR   = 0;
+    pChannel->CPAR  = (U32)pSource;
+    pChannel->CMAR  = (U32)pDest;
+    pChannel->CNDTR = items;
+    DMA1->IFCR      = DMA_EVENTS << DMA_SHIFT(channel);
+    pChannel->CCR   = flags | DMA_CCR_EN;
+
+    do
+    {
+      done = (DMA1->ISR >> DMA_SHIFT(channel)) & (DMA_EVENT_DONE | DMA_EVENT_ERROR);
+    } while (0 == done);
+    if (0 != (done & DMA_EVENT_ERROR)) break;
+
+    pDest   += items * width;
+    pSource += items * width;
+    count   -= items * width;
+  }
+
+  DMA_Release(channel);
+  memcpy(pDest, pSource, count);
+}
@@ -0,0 +1,124 @@
+#ifndef __DMA_H__
+#define __DMA_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* DMA1 service. Each of the 7 channels is wired to fixed request lines (RM0008 table 78), so a
+   driver claims the channel of its line with DMA_Claim() and owns it until DMA_Release(): two
+   drivers on the same channel fail at the claim instead of corrupting each other's transfers.
+
+   The channel interrupts all go to one dispatcher. It clears the flags of the channel and hands
+   the events whose interrupts are enabled in CCR to the owner, so events left over from a
+   stopped channel are not delivered. An owner may program its channel itself (DMA_CHANNEL()),
+   as the circular rings of the engines do, or describe transfers: DMA_Start() and DMA_Queue()
+   run a chain of DMA_Transfer, the next one is loaded from the interrupt of the previous one's
+   completion, before its callback, so a chain runs without a task.
+
+   Memory to memory transfers use any free channel (DMA_REQ_MEMORY), DMA_Memcpy() is a blocking
+   copy on one for large buffers.                                                                 */
+
+#define DMA_CHANNELS                       (7)
+
+/* Registers of channel 1..7 */
+#define DMA_CHANNEL(channel) \
+  ((DMA_Channel_TypeDef *)(DMA1_Channel1_BASE + ((channel) - 1) * 0x14))
+
+/* Request lines, by the channel they are wired to */
+#define DMA_REQ_MEMORY                     (0)      /* Any free channel, the highest first      */
+#define DMA_REQ_ADC1                       (1)
+#define DMA_REQ_TIM2_CH3                   (1)
+#define DMA_REQ_TIM4_CH1                   (1)
+#define DMA_REQ_SPI1_RX                    (2)
+#define DMA_REQ_USART3_TX                  (2)
+#define DMA_REQ_TIM1_CH1                   (2)
+#define DMA_REQ_TIM2_UP                    (2)
+#define DMA_REQ_TIM3_CH3                   (2)
+#define DMA_REQ_SPI1_TX                    (3)
+#define DMA_REQ_USART3_RX                  (3)
+#define DMA_REQ_TIM1_CH2                   (3)
+#define DMA_REQ_TIM3_CH4                   (3)
+#define DMA_REQ_TIM3_UP                    (3)
+#define DMA_REQ_SPI2_RX                    (4)
+#define DMA_REQ_USART1_TX                  (4)
+#define DMA_REQ_I2C2_TX                    (4)
+#define DMA_REQ_TIM1_CH4                   (4)
+#define DMA_REQ_TIM1_TRIG                  (4)
+#define DMA_REQ_TIM4_CH2                   (4)
+#define DMA_REQ_SPI2_TX                    (5)
+#define DMA_REQ_USART1_RX                  (5)
+#define DMA_REQ_I2C2_RX                    (5)
+#define DMA_REQ_TIM1_UP                    (5)
+#define DMA_REQ_TIM2_CH1                   (5)
+#define DMA_REQ_TIM4_CH3                   (5)
+#define DMA_REQ_USART2_RX                  (6)
+#define DMA_REQ_I2C1_TX                    (6)
+#define DMA_REQ_TIM1_CH3                   (6)
+#define DMA_REQ_TIM3_CH1                   (6)
+#define DMA_REQ_TIM3_TRIG                  (6)
+#define DMA_REQ_USART2_TX                  (7)
+#define DMA_REQ_I2C1_RX                    (7)
+#define DMA_REQ_TIM2_CH2                   (7)
+#define DMA_REQ_TIM2_CH4                   (7)
+#define DMA_REQ_TIM4_UP                    (7)
+
+/* Events, at the positions of their flags in ISR (channel 1) and of their enables in CCR */
+#define DMA_EVENT_DONE                     (0x02)
+#define DMA_EVENT_HALF                     (0x04)
+#define DMA_EVENT_ERROR                    (0x08)
+
+/* DMA_Transfer.Flags: a direction, a width and a priority, DMA_HALF for the half event */
+#define DMA_TO_PERIPHERAL                  (DMA_CCR_DIR | DMA_CCR_MINC)
+#define DMA_FROM_PERIPHERAL                (DMA_CCR_MINC)
+#define DMA_MEMORY_TO_MEMORY               (DMA_CCR_MEM2MEM | DMA_CCR_PINC | DMA_CCR_MINC)
+#define DMA_BYTES                          (0)
+#define DMA_HALFWORDS                      (DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0)
+#define DMA_WORDS                          (DMA_CCR_PSIZE_1 | DMA_CCR_MSIZE_1)
+#define DMA_PRIORITY_LOW                   (0)
+#define DMA_PRIORITY_MEDIUM                (DMA_CCR_PL_0)
+#define DMA_PRIORITY_HIGH                  (DMA_CCR_PL_1)
+#define DMA_PRIORITY_VERY_HIGH             (DMA_CCR_PL_1 | DMA_CCR_PL_0)
+#define DMA_HALF                           (DMA_CCR_HTIE)
+
+/* Shorter copies are left to the CPU by DMA_Memcpy() */
+#ifndef DMA_MEMCPY_MIN
+#define DMA_MEMCPY_MIN                     (64)
+#endif
+
+/* Events of a channel, from its interrupt */
+typedef void (*DMA_Handler)(U32 channel, U32 events, void * pContext);
+
+struct DMA_Transfer_s;
+
+/* End of a transfer (DMA_EVENT_DONE or DMA_EVENT_ERROR) or its half (DMA_EVENT_HALF) */
+typedef void (*DMA_Done)(struct DMA_Transfer_s * pTransfer, U32 events);
+
+typedef struct DMA_Transfer_s
+{
+  U32                     Flags;
+  volatile void *         pPeripheral;     /* Register, or the source of a memory to memory copy  */
+  void *                  pMemory;         /* Destination of a memory to memory copy              */
+  U16                     Count;           /* Items of the width in Flags, 1..65535               */
+  DMA_Done                pDone;           /* May be NULL                                         */
+  void *                  pContext;
+  struct DMA_Transfer_s * pNext;           /* Started when this one is done                       */
+} DMA_Transfer;
+
+/* Returns the channel (1..7), 0 when it is owned by another handler or context. Claiming again
+   with the same handler and context succeeds. The interrupt is enabled at 'priority'.            */
+U32  DMA_Claim(U32 request, U32 priority, DMA_Handler pHandler, void * pContext);
+void DMA_Release(U32 channel);
+
+/* FALSE if the channel runs a chain. An error stops the chain, its transfer is told and the
+   following ones are dropped.                                                                    */
+U32  DMA_Start(U32 channel, DMA_Transfer * pTransfer);
+
+/* Appends to the running chain, or starts it */
+void DMA_Queue(U32 channel, DMA_Transfer * pTransfer);
+void DMA_Abort(U32 channel);
+U32  DMA_IsBusy(U32 channel);
+
+/* Blocking copy on a free channel, by the CPU when it is short or no channel is free */
+void DMA_Memcpy(void * pTo, const void * pFrom, U32 count);
+
+#endif /* __DMA_H__ */
@@ -0,0 +1,19 @@
+#ifndef __DWT_H__
+#define __DWT_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* Cycle counter of the Data Watchpoint and Trace unit, runs at HCLK */
+
+/* The counter is started and zeroed once at boot (ApplicationInit). DWT_Init() never resets it,  */
+/* so the boot time stamps stay valid when other modules call it again.                           */
+
+#define DWT_Init() \
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; \
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+#define DWT_Cycles() \
+  (DWT->CYCCNT)
+
+#endif /* __DWT_H__ */
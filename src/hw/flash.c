@@ -0,0 +1,84 @@
+#include "types.h"
+#include "stm32f1xx.h"
+#include "flash.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 flash_Wait(void)
+{
+  while (0 != (FLASH->SR & FLASH_SR_BSY))
+  {
+    //
+  }
+
+  if (0 != (FLASH->SR & (FLASH_SR_PGERR | FLASH_SR_WRPRTERR)))
+  {
+    FLASH->SR = (FLASH_SR_PGERR | FLASH_SR_WRPRTERR);
+    return FALSE;
+  }
+
+  FLASH->SR = FLASH_SR_EOP;
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void FLASH_Unlock(void)
+{
+  if (0 != (FLASH->CR & FLASH_CR_LOCK))
+  {
+    FLASH->KEYR = FLASH_KEY1;
+    FLASH->KEYR = FLASH_KEY2;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void FLASH_Lock(void)
+{
+  FLASH->CR |= FLASH_CR_LOCK;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 FLASH_ErasePage(U32 address)
+{
+  U32 result;
+
+  FLASH->CR |= FLASH_CR_PER;
+  FLASH->AR  = address;
+  FLASH->CR |= FLASH_CR_STRT;
+  result = flash_Wait();
+  FLASH->CR &= ~FLASH_CR_PER;
+
+  return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The flash is programmed by half-words, so the address must be even. An odd size is padded
+   with 0xFF.                                                                                     */
+
+U32 FLASH_Write(U32 address, const void * pData, U32 size)
+{
+  const U8 * pSrc = (const U8 *)pData;
+  U32 result = TRUE;
+  U16 value;
+
+  FLASH->CR |= FLASH_CR_PG;
+  while ((0 < size) && (TRUE == result))
+  {
+    value = pSrc[0];
+    value |= (1 < size) ? (pSrc[1] << 8) : 0xFF00;
+
+    *(volatile U16 *)address = value;
+    result = flash_Wait();
+
+    address += 2;
+    pSrc    += 2;
+    size    -= (1 < size) ? 2 : 1;
+  }
+  FLASH->CR &= ~FLASH_CR_PG;
+
+  return result;
+}
@@ -0,0 +1,14 @@
+#ifndef __FLASH_H__
+#define __FLASH_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+#define FLASH_PAGE_SIZE                    (1024U)
+
+void FLASH_Unlock(void);
+void FLASH_Lock(void);
+U32  FLASH_ErasePage(U32 address);
+U32  FLASH_Write(U32 address, const void * pData, U32 size);
+
+#endif /* __FLASH_H__ */
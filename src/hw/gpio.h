@@ -3,6 +3,7 @@
 
 #include "types.h"
 #include "stm32f1xx.h"
+#include "bitband.h"
 
 /* PIN MODE ****************************************/
 /* 0b00 = 0 - Input mode (reset state).            */
@@ -52,9 +53,11 @@ typedef struct
 } GPIO;
 
 
+/* The clock enable bits are set through the bit-band alias, so concurrent GPIO_Init calls do not */
+/* need a critical section around RCC->APB2ENR                                                    */
 #define GPIO_Init(port,pin,mode) \
-  RCC->APB2ENR |= \
-  (U32)((1 << (((U32)port >> 10) & 0x0F)) | (RCC_APB2ENR_AFIOEN * (U8)(mode > 8))); \
+  BITBAND_RCC_APB2ENR(((U32)port >> 10) & 0x0F) = 1; \
+  if (mode > 8) { BITBAND_RCC_APB2ENR(RCC_APB2ENR_AFIOEN_Pos) = 1; } \
   ((GPIO *)port)->CR[pin / 8] &= ~(GPIO_TYPE_MASK << ((pin % 8) * 4)); \
 	((GPIO *)port)->CR[pin / 8] |= (mode << ((pin % 8) * 4));
 
@@ -67,4 +70,57 @@ typedef struct
 #define GPIO_In(port,pin) \
   ((port->IDR >> pin) & 1)
 
+/* Multi-pin operations. Every macro is a single access to the port. */
+
+#define GPIO_Set(port,mask) \
+  ((port)->BSRR = (U32)(mask))
+
+#define GPIO_Clr(port,mask) \
+  ((port)->BRR = (U32)(mask))
+
+#define GPIO_Write(port,mask,value) \
+  ((port)->BSRR = ((U32)(value) & (U32)(mask)) | ((~(U32)(value) & (U32)(mask)) << 16))
+
+#define GPIO_Read(port,mask) \
+  ((port)->IDR & (U32)(mask))
+
+/* Locks the configuration of the pins in 'mask' until the next reset (LCKR key sequence) */
+#define GPIO_Lock(port,mask) \
+  (port)->LCKR = GPIO_LCKR_LCKK | (U32)(mask); \
+  (port)->LCKR = (U32)(mask); \
+  (port)->LCKR = GPIO_LCKR_LCKK | (U32)(mask); \
+  (void)(port)->LCKR; \
+  (void)(port)->LCKR;
+
+/* Pin groups (buses). A group is an X-macro list of (value bit, pin) pairs on one port:          */
+/*                                                                                                */
+/*   #define LCD_DATA(BIT) BIT(0, 8) BIT(1, 9) BIT(2, 12) BIT(3, 13)                              */
+/*   GPIO_GROUP_DEFINE(LCD_Data, GPIOB, LCD_DATA)                                                 */
+/*                                                                                                */
+/* defines LCD_Data_Write(value) - all pins change with one BSRR store, and LCD_Data_Read() -    */
+/* one IDR load followed by the bit gather unrolled at compile time.                              */
+
+#define GPIO_GROUP_MASK_BIT(bit,pin)       | (1U << (pin))
+#define GPIO_GROUP_SCATTER_BIT(bit,pin)    | ((((U32)value >> (bit)) & 1U) << (pin))
+#define GPIO_GROUP_GATHER_BIT(bit,pin)     | ((((U32)idr >> (pin)) & 1U) << (bit))
+
+#define GPIO_GROUP_MASK(group) \
+  (0U group(GPIO_GROUP_MASK_BIT))
+
+#define GPIO_GROUP_DEFINE(name,port,group) \
+  __STATIC_INLINE void name##_Write(U32 value) \
+  { \
+    U32 bits = (0U group(GPIO_GROUP_SCATTER_BIT)); \
+    (port)->BSRR = bits | ((GPIO_GROUP_MASK(group) & ~bits) << 16); \
+  } \
+  __STATIC_INLINE U32 name##_Read(void) \
+  { \
+    U32 idr = (port)->IDR; \
+    return (0U group(GPIO_GROUP_GATHER_BIT)); \
+  } \
+  __STATIC_INLINE void name##_Lock(void) \
+  { \
+    GPIO_Lock(port, GPIO_GROUP_MASK(group)) \
+  }
+
 #endif /* __GPIO_H__ */
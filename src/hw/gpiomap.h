@@ -0,0 +1,102 @@
+#ifndef __GPIOMAP_H__
+#define __GPIOMAP_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "gpio.h"
+
+/* Compile-time pin map. A board describes all its pins in one X-macro list:                      */
+/*                                                                                                */
+/*   #define BOARD_PINS(PIN, a, b) \                                                              */
+/*     PIN(a, b, C, 13, GPIO_TYPE_OUT_OD_2MHZ, 1) \                                               */
+/*     PIN(a, b, A,  9, GPIO_TYPE_ALT_PP_50MHZ, 0)                                                */
+/*                                                                                                */
+/* Every entry is (port letter A..D, pin 0..15, GPIO_TYPE_xxx, level). Level is the initial ODR   */
+/* bit: the output level, or pull-up (1) / pull-down (0) for GPIO_TYPE_IN_PUP_PDN.                */
+/*                                                                                                */
+/* GPIO_MAP_Check(BOARD_PINS) rejects a pin assigned twice at compile time.                       */
+/* GPIO_MAP_Apply(BOARD_PINS) folds the list into constants and issues one RCC->APB2ENR update    */
+/* and one store per ODR/CRL/CRH of every used port. Pins missing from the list get the reset     */
+/* configuration (floating input), so the list must describe the used ports completely.           */
+
+#define GPIO_MAP_IDX_A                     0
+#define GPIO_MAP_IDX_B                     1
+#define GPIO_MAP_IDX_C                     2
+#define GPIO_MAP_IDX_D                     3
+
+#define GPIO_MAP_CR_RESET                  (0x44444444U)
+
+/* Terms of the folded expressions ------------------------------------------------------------- */
+
+#define GPIO_MAP_IS(port, P) \
+  (GPIO_MAP_IDX_##P == (port))
+
+#define GPIO_MAP_TERM_CR(port, half, P, N, MODE, LEVEL) \
+  | ((GPIO_MAP_IS(port, P) && (((N) / 8) == (half))) ? ((U32)(MODE) << (((N) % 8) * 4)) : 0U)
+
+#define GPIO_MAP_TERM_CR_MASK(port, half, P, N, MODE, LEVEL) \
+  | ((GPIO_MAP_IS(port, P) && (((N) / 8) == (half))) ? (GPIO_TYPE_MASK << (((N) % 8) * 4)) : 0U)
+
+#define GPIO_MAP_TERM_ODR(port, unused, P, N, MODE, LEVEL) \
+  | (GPIO_MAP_IS(port, P) ? ((U32)(LEVEL) << (N)) : 0U)
+
+#define GPIO_MAP_TERM_PINS(port, unused, P, N, MODE, LEVEL) \
+  | (GPIO_MAP_IS(port, P) ? (1U << (N)) : 0U)
+
+#define GPIO_MAP_TERM_PINS_SUM(port, unused, P, N, MODE, LEVEL) \
+  + (GPIO_MAP_IS(port, P) ? (1U << (N)) : 0U)
+
+#define GPIO_MAP_TERM_INVALID(u1, u2, P, N, MODE, LEVEL) \
+  + ((15 < (N)) || (GPIO_TYPE_MASK < (MODE)) || (1 < (LEVEL)))
+
+#define GPIO_MAP_TERM_RCC(u1, u2, P, N, MODE, LEVEL) \
+  | (RCC_APB2ENR_IOPAEN << GPIO_MAP_IDX_##P) | ((8 < (MODE)) ? RCC_APB2ENR_AFIOEN : 0U)
+
+/* Folded register values ---------------------------------------------------------------------- */
+
+#define GPIO_MAP_CR(map, port, half) \
+  ((GPIO_MAP_CR_RESET & ~(0U map(GPIO_MAP_TERM_CR_MASK, port, half))) | \
+   (0U map(GPIO_MAP_TERM_CR, port, half)))
+
+#define GPIO_MAP_ODR(map, port) \
+  (0U map(GPIO_MAP_TERM_ODR, port, 0))
+
+#define GPIO_MAP_PINS(map, port) \
+  (0U map(GPIO_MAP_TERM_PINS, port, 0))
+
+#define GPIO_MAP_RCC(map) \
+  (0U map(GPIO_MAP_TERM_RCC, 0, 0))
+
+/* Compile-time checks ------------------------------------------------------------------------- */
+
+/* A pin listed twice makes the sum of the pin bits differ from their OR */
+#define GPIO_MAP_CHECK_PORT(map, P) \
+  typedef char map##_pin_conflict_on_port_##P \
+    [(GPIO_MAP_PINS(map, GPIO_MAP_IDX_##P) == (0U map(GPIO_MAP_TERM_PINS_SUM, GPIO_MAP_IDX_##P, 0))) ? 1 : -1];
+
+#define GPIO_MAP_Check(map) \
+  typedef char map##_invalid_entry[(0 == (0 map(GPIO_MAP_TERM_INVALID, 0, 0))) ? 1 : -1]; \
+  GPIO_MAP_CHECK_PORT(map, A) \
+  GPIO_MAP_CHECK_PORT(map, B) \
+  GPIO_MAP_CHECK_PORT(map, C) \
+  GPIO_MAP_CHECK_PORT(map, D)
+
+/* Register writes ----------------------------------------------------------------------------- */
+
+/* ODR goes first, so the outputs start driving at the requested level */
+#define GPIO_MAP_APPLY_PORT(map, P) \
+  if (0 != GPIO_MAP_PINS(map, GPIO_MAP_IDX_##P)) \
+  { \
+    ((GPIO *)GPIO##P)->ODR   = GPIO_MAP_ODR(map, GPIO_MAP_IDX_##P); \
+    ((GPIO *)GPIO##P)->CR[0] = GPIO_MAP_CR(map, GPIO_MAP_IDX_##P, 0); \
+    ((GPIO *)GPIO##P)->CR[1] = GPIO_MAP_CR(map, GPIO_MAP_IDX_##P, 1); \
+  }
+
+#define GPIO_MAP_Apply(map) \
+  RCC->APB2ENR |= GPIO_MAP_RCC(map); \
+  GPIO_MAP_APPLY_PORT(map, A) \
+  GPIO_MAP_APPLY_PORT(map, B) \
+  GPIO_MAP_APPLY_PORT(map, C) \
+  GPIO_MAP_APPLY_PORT(map, D)
+
+#endif /* __GPIOMAP_H__ */
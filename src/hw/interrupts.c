@@ -1,7 +1,13 @@
 #include "interrupts.h"
+#include "clock.h"
 
 void NMI_Handler(void)
 {
+  /* Clock Security System: the HSE has failed */
+  if (0 != (RCC->CIR & RCC_CIR_CSSF))
+  {
+    Clock_HSEFailed();
+  }
 }
 
 //void HardFault_Handler(void)
@@ -12,40 +18,40 @@ void NMI_Handler(void)
 //  }
 //}
 
-void MemManage_Handler(void)
-{
-  /* Go to infinite loop when Memory Manage exception occurs */
-  //ShowInfo("-Mem Manage-");
-  while (1)
-  {
-  }
-}
+//void MemManage_Handler(void)
+//{
+//  /* Go to infinite loop when Memory Manage exception occurs */
+//  //ShowInfo("-Mem Manage-");
+//  while (1)
+//  {
+//  }
+//}
 
-void BusFault_Handler(void)
-{
-  /* Go to infinite loop when Bus Fault exception occurs */
-  //ShowInfo("-Bus Fault-");
-  while (1)
-  {
-  }
-}
+//void BusFault_Handler(void)
+//{
+//  /* Go to infinite loop when Bus Fault exception occurs */
+//  //ShowInfo("-Bus Fault-");
+//  while (1)
+//  {
+//  }
+//}
 
-void UsageFault_Handler(void)
-{
-  /* Go to infinite loop when Usage Fault exception occurs */
-  //ShowInfo("-Usage Fault-");
-  while (1)
-  {
-  }
-}
+//void UsageFault_Handler(void)
+//{
+//  /* Go to infinite loop when Usage Fault exception occurs */
+//  //ShowInfo("-Usage Fault-");
+//  while (1)
+//  {
+//  }
+//}
 
 //void SVC_Handler(void)
 //{
 //}
 
-void DebugMon_Handler(void)
-{
-}
+//void DebugMon_Handler(void)
+//{
+//}
 
 //void PendSV_Handler(void)
 //{
@@ -75,11 +81,6 @@ void I2C2_ER_IRQHandler(void)
   //I2C_ER_IRQHandler(I2C2);
 }
 
-void TIM1_CC_IRQHandler(void)
-{
-  //DHT21_TIM_IRQHandler();
-}
-
 /*void PPP_IRQHandler(void)
 {
 }*/
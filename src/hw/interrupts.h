@@ -6,6 +6,15 @@
 /*      IRQ_PRIORITY_SYSTICK    255 */
 /*      IRQ_PRIORITY_PENDSV     255 */
 #define IRQ_PRIORITY_USB        255
+/* NVIC priority 0..15. Interrupts that use the FreeRTOS FromISR API must not be above 11
+   (configMAX_SYSCALL_INTERRUPT_PRIORITY)                                                         */
+#define IRQ_PRIORITY_WAVE       11
+#define IRQ_PRIORITY_LOGIC      11
+#define IRQ_PRIORITY_ADC        12
+#define IRQ_PRIORITY_CAPTURE    12
+#define IRQ_PRIORITY_CAN        12
+#define IRQ_PRIORITY_MODBUS     12
+#define IRQ_PRIORITY_DMA        12
 
 void NMI_Handler(void);
 void HardFault_Handler(void);
@@ -0,0 +1,99 @@
+#include "types.h"
+#include "stm32f1xx.h"
+#include "irq.h"
+
+typedef struct
+{
+  IRQ_Handler pFunc;
+  void *      pContext;
+} IRQ_Slot;
+
+/* VTOR needs the table aligned to its size rounded up to a power of two: 59 words -> 256 bytes */
+#if defined(__ICCARM__)
+#pragma data_alignment = 256
+static IRQ_Vector IRQ_Table[IRQ_VECTORS];
+#else
+static IRQ_Vector IRQ_Table[IRQ_VECTORS] __attribute__((aligned(256)));
+#endif
+
+static IRQ_Slot IRQ_Slots[IRQ_VECTORS - 16];
+static const IRQ_Vector * IRQ_pFlash = NULL;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Common entry of the attached handlers. The active vector number comes from IPSR, so one
+   function serves every interrupt and the table stays the hardware one (no dispatch switch).    */
+
+static void irq_Trampoline(void)
+{
+  IRQ_Slot * pSlot = &IRQ_Slots[__get_IPSR() - 16];
+
+  pSlot->pFunc(pSlot->pContext);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Copies the link time table to SRAM and moves VTOR there. Must be called before any interrupt
+   is attached, the handlers from the startup file stay in place until then.                      */
+
+void IRQ_Init(void)
+{
+  U32 i;
+
+  IRQ_pFlash = (const IRQ_Vector *)SCB->VTOR;
+
+  for (i = 0; i < IRQ_VECTORS; i++)
+  {
+    IRQ_Table[i] = IRQ_pFlash[i];
+  }
+
+  IRQ_UseFlash(FALSE);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The handler is called directly by the hardware, with no trampoline */
+
+void IRQ_SetVector(IRQn_Type irq, IRQ_Vector pVector)
+{
+  IRQ_Table[16 + irq] = pVector;
+  __DSB();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The interrupt should be disabled while it is being attached. The slot is written before the
+   vector, so the trampoline never sees a half written slot.                                      */
+
+void IRQ_Attach(IRQn_Type irq, IRQ_Handler pFunc, void * pContext)
+{
+  if (0 > irq) return;
+
+  IRQ_Slots[irq].pFunc    = pFunc;
+  IRQ_Slots[irq].pContext = pContext;
+  IRQ_SetVector(irq, irq_Trampoline);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Disables the interrupt and restores the handler from the startup file */
+
+void IRQ_Detach(IRQn_Type irq)
+{
+  if (0 > irq) return;
+
+  NVIC_DisableIRQ(irq);
+  IRQ_SetVector(irq, IRQ_pFlash[16 + irq]);
+  IRQ_Slots[irq].pFunc    = NULL;
+  IRQ_Slots[irq].pContext = NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Switches between the link time table and the SRAM one, only the benchmark needs it */
+
+void IRQ_UseFlash(U32 flash)
+{
+  SCB->VTOR = (FALSE == flash) ? (U32)IRQ_Table : (U32)IRQ_pFlash;
+  __DSB();
+}
@@ -0,0 +1,24 @@
+#ifndef __IRQ_H__
+#define __IRQ_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* 16 system exceptions + 43 peripheral interrupts (USBWakeUp_IRQn is the last one) */
+#define IRQ_VECTORS                        (16 + USBWakeUp_IRQn + 1)
+
+typedef void (*IRQ_Vector)(void);
+typedef void (*IRQ_Handler)(void * pContext);
+
+void IRQ_Init(void);
+void IRQ_SetVector(IRQn_Type irq, IRQ_Vector pVector);
+void IRQ_Attach(IRQn_Type irq, IRQ_Handler pFunc, void * pContext);
+void IRQ_Detach(IRQn_Type irq);
+void IRQ_UseFlash(U32 flash);
+
+/* Attaches 'pFunc' with its own context type, e.g. void UART_IRQ(UART * pUart). The call in
+   sizeof() is never executed, it only makes the compiler check that pFunc accepts pContext.      */
+#define IRQ_ATTACH(irq, pFunc, pContext) \
+  ((void)sizeof(((pFunc)(pContext)), 0), IRQ_Attach((irq), (IRQ_Handler)(pFunc), (pContext)))
+
+#endif /* __IRQ_H__ */
@@ -0,0 +1,347 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "gpio.h"
+#include "irq.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "dma.h"
+#include "logic.h"
+
+/* Peripheral to memory, 16-bit both sides, very high priority: ahead of the other channels */
+#define LOGIC_DMA_CCR                      (DMA_CCR_PL_1 | DMA_CCR_PL_0 | DMA_CCR_MSIZE_0 | \
+                                            DMA_CCR_PSIZE_0 | DMA_CCR_MINC | DMA_CCR_CIRC | \
+                                            DMA_CCR_TEIE | DMA_CCR_HTIE | DMA_CCR_TCIE | \
+                                            DMA_CCR_EN)
+
+#define LOGIC_PRINT_LINE                   (32)
+
+typedef struct
+{
+  Logic_Config          Config;
+  volatile Logic_Status Status;
+  U32                   Filled;            /* Samples written, up to Samples                      */
+  U32                   Matched;           /* The last sample scanned matched the pattern         */
+  U32                   Trigger;           /* Index of the trigger sample in the ring             */
+  S32                   Remaining;         /* Post-trigger samples still to come                  */
+  U32                   Channel;           /* DMA channel, 0 when released                        */
+  Clock_Notifier        Notifier;
+} Logic_State;
+
+static Logic_State Logic_This;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* TIM2 runs at PCLK1, doubled when the APB1 prescaler is not 1 */
+
+static U32 logic_TimerClock(void)
+{
+  U32 clock = Clock_GetPCLK1();
+
+  if (0 != (RCC->CFGR & RCC_CFGR_PPRE1_2)) clock *= 2;
+  return clock;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void logic_SetRate(U32 rate)
+{
+  U32 ticks = (logic_TimerClock() + rate / 2) / rate, psc;
+
+  if (LOGIC_TICKS_MIN > ticks) ticks = LOGIC_TICKS_MIN;
+  psc = (ticks - 1) / 0x10000;
+
+  TIM2->PSC = psc;
+  TIM2->ARR = (ticks / (psc + 1)) - 1;
+  TIM2->EGR = TIM_EGR_UG;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void logic_ClockChanged(U32 oldHz, U32 newHz, void * pContext)
+{
+  logic_SetRate(Logic_This.Config.Rate);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void logic_Stop(void)
+{
+  TIM2->CR1  = 0;
+  TIM2->DIER = 0;
+  if (0 != Logic_This.Channel) DMA_CHANNEL(Logic_This.Channel)->CCR = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* 'index' is the ring position of pSamples[0]. A match is only taken once Pre samples are in,
+   so that the pre-trigger part of the window exists.                                             */
+
+static void logic_Scan(Logic_State * pThis, const U16 * pSamples, U32 count, U32 index)
+{
+  Logic_Config * pConfig = &pThis->Config;
+  U32 mask = pConfig->TriggerMask, value = pConfig->TriggerValue & mask;
+  U32 i = 0, matched = pThis->Matched;
+
+  if (pThis->Filled < pConfig->Pre)
+  {
+    i = pConfig->Pre - pThis->Filled;
+    if (i > count) i = count;
+    if (0 != i) matched = ((pSamples[i - 1] & mask) == value);
+  }
+
+  if (FALSE == pConfig->TriggerEdge)
+  {
+    for (; i < count; i++)
+    {
+      if ((pSamples[i] & mask) == value) break;
+    }
+  }
+  else
+  {
+    for (; i < count; i++)
+    {
+      if ((pSamples[i] & mask) != value) matched = FALSE;
+      else if (FALSE == matched) break;
+    }
+  }
+
+  if (i < count)
+  {
+    pThis->Trigger   = index + i;
+    pThis->Remaining = (S32)pConfig->Post - (S32)(count - i);
+    pThis->Status    = LOGIC_TRIGGERED;
+  }
+  else
+  {
+    pThis->Matched = (0 != count) ? ((pSamples[count - 1] & mask) == value) : matched;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The DMA has just filled 'half' */
+
+static void logic_Half(Logic_State * pThis, U32 half)
+{
+  Logic_Config * pConfig = &pThis->Config;
+  U32 count = pConfig->Samples / 2, index = half * count;
+
+  if (LOGIC_ARMED == pThis->Status)
+  {
+    logic_Scan(pThis, &pConfig->pRing[index], count, index);
+  }
+  else if (LOGIC_TRIGGERED == pThis->Status)
+  {
+    pThis->Remaining -= (S32)count;
+  }
+  else
+  {
+    return;
+  }
+
+  pThis->Filled += count;
+  if (pThis->Filled > pConfig->Samples) pThis->Filled = pConfig->Samples;
+
+  if ((LOGIC_TRIGGERED == pThis->Status) && (0 >= pThis->Remaining))
+  {
+    logic_Stop();
+    pThis->Status = LOGIC_DONE;
+
+    if (NULL != pConfig->pDone) pConfig->pDone(pConfig->pContext);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void logic_DMA(U32 channel, U32 events, void * pContext)
+{
+  Logic_State * pThis = (Logic_State *)pContext;
+
+  if (0 != (events & DMA_EVENT_ERROR))
+  {
+    logic_Stop();
+    pThis->Status = LOGIC_IDLE;
+    return;
+  }
+
+  if (0 != (events & DMA_EVENT_HALF)) logic_Half(pThis, 0);
+  if (0 != (events & DMA_EVENT_DONE)) logic_Half(pThis, 1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Logic_Init(const Logic_Config * pConfig)
+{
+  Logic_State * pThis = &Logic_This;
+
+  if ((NULL == pConfig) || (NULL == pConfig->pPort) || (NULL == pConfig->pRing)) return FALSE;
+  if ((0 == pConfig->Rate) || (0 == pConfig->Mask)) return FALSE;
+  if ((0 == pConfig->Samples) || (0 != (pConfig->Samples & 1))) return FALSE;
+  if ((U32)pConfig->Pre + pConfig->Post + LOGIC_MARGIN > pConfig->Samples / 2) return FALSE;
+  if ((0 == pConfig->Post) || ((0 == pConfig->TriggerMask) && (FALSE != pConfig->TriggerEdge)))
+  {
+    return FALSE;
+  }
+
+  Logic_Abort();
+  pThis->Channel = DMA_Claim(DMA_REQ_TIM2_CH1, IRQ_PRIORITY_LOGIC, logic_DMA, pThis);
+  if (0 == pThis->Channel) return FALSE;
+
+  memcpy(&pThis->Config, pConfig, sizeof(Logic_Config));
+  pThis->Status = LOGIC_IDLE;
+
+  BITBAND_RCC_APB1ENR(RCC_APB1ENR_TIM2EN_Pos) = 1;
+  BITBAND_RCC_APB2ENR(((U32)pConfig->pPort >> 10) & 0x0F) = 1;
+
+  /* CC1 with CCR1 = 0 requests the DMA once per period, the channel is frozen: no output */
+  TIM2->CR1   = 0;
+  TIM2->CR2   = 0;
+  TIM2->DIER  = 0;
+  TIM2->CCMR1 = 0;
+  TIM2->CCER  = 0;
+  TIM2->CCR1  = 0;
+  logic_SetRate(pConfig->Rate);
+
+  if (NULL == pThis->Notifier.pFunc)
+  {
+    Clock_Register(&pThis->Notifier, logic_ClockChanged, NULL);
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Logic_Arm(void)
+{
+  Logic_State * pThis = &Logic_This;
+  Logic_Config * pConfig = &pThis->Config;
+  DMA_Channel_TypeDef * pChannel;
+
+  Logic_Abort();
+
+  /* Claimed again after an abort, by then another driver may have taken it */
+  pThis->Channel = DMA_Claim(DMA_REQ_TIM2_CH1, IRQ_PRIORITY_LOGIC, logic_DMA, pThis);
+  if (0 == pThis->Channel) return;
+  pChannel = DMA_CHANNEL(pThis->Channel);
+
+  pThis->Filled  = 0;
+  pThis->Matched = FALSE;
+  pThis->Status  = LOGIC_ARMED;
+
+  pChannel->CCR   = 0;
+  pChannel->CPAR  = (U32)&pConfig->pPort->IDR;
+  pChannel->CMAR  = (U32)pConfig->pRing;
+  pChannel->CNDTR = pConfig->Samples;
+  DMA1->IFCR      = DMA_IFCR_CGIF5;
+  pChannel->CCR   = LOGIC_DMA_CCR;
+
+  TIM2->CNT  = 0;
+  TIM2->SR   = 0;
+  TIM2->DIER = TIM_DIER_CC1DE;
+  TIM2->CR1  = TIM_CR1_CEN;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A finished capture stays available to Logic_Compress() */
+
+void Logic_Abort(void)
+{
+  if (0 == (RCC->APB1ENR & RCC_APB1ENR_TIM2EN)) return;
+
+  logic_Stop();
+  DMA_Release(Logic_This.Channel);
+  Logic_This.Channel = 0;
+  if (LOGIC_DONE != Logic_This.Status) Logic_This.Status = LOGIC_IDLE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+Logic_Status Logic_GetStatus(void)
+{
+  return Logic_This.Status;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The sample rate actually produced by TIM2, the requested one is rounded to the timer clock */
+
+U32 Logic_GetRate(void)
+{
+  return logic_TimerClock() / ((TIM2->PSC + 1) * (TIM2->ARR + 1));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Walks the window from Pre samples before the trigger, merging equal samples into runs of at
+   most 0xFFFF. The dump ends early, with Samples telling how far it got, if pOut is too small.   */
+
+U32 Logic_Compress(U8 * pOut, U32 size)
+{
+  Logic_State * pThis = &Logic_This;
+  Logic_Config * pConfig = &pThis->Config;
+  Logic_Header * pHeader = (Logic_Header *)pOut;
+  U16 * pRun = (U16 *)(pOut + sizeof(Logic_Header));
+  U32 samples = pConfig->Samples, total = (U32)pConfig->Pre + pConfig->Post;
+  U32 index, value, count = 0, runs = 0, done = 0, sample, i;
+
+  if ((LOGIC_DONE != pThis->Status) || (LOGIC_DUMP_SIZE(1) > size)) return 0;
+
+  index = (pThis->Trigger + samples - pConfig->Pre) % samples;
+  value = pConfig->pRing[index] & pConfig->Mask;
+
+  for (i = 0; i < total; i++)
+  {
+    sample = pConfig->pRing[index] & pConfig->Mask;
+    if (++index == samples) index = 0;
+
+    if ((sample == value) && (0xFFFF > count))
+    {
+      count++;
+      continue;
+    }
+
+    if (LOGIC_DUMP_SIZE(runs + 2) > size) break;
+    pRun[2 * runs]     = (U16)value;
+    pRun[2 * runs + 1] = (U16)count;
+    runs++;
+    done += count;
+    value = sample;
+    count = 1;
+  }
+
+  pRun[2 * runs]     = (U16)value;
+  pRun[2 * runs + 1] = (U16)count;
+  runs++;
+  done += count;
+
+  pHeader->Magic   = LOGIC_MAGIC;
+  pHeader->Version = LOGIC_VERSION;
+  pHeader->Runs    = (U16)runs;
+  pHeader->Rate    = Logic_GetRate();
+  pHeader->Mask    = pConfig->Mask;
+  pHeader->Port    = (U16)((((U32)pConfig->pPort >> 10) & 0x0F) - RCC_APB2ENR_IOPAEN_Pos);
+  pHeader->Pre     = pConfig->Pre;
+  pHeader->Samples = (U16)done;
+
+  return LOGIC_DUMP_SIZE(runs);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Logic_Print(const U8 * pDump, U32 size)
+{
+  U32 i;
+
+  printf("LOGIC %d\r\n", size);
+  for (i = 0; i < size; i++)
+  {
+    printf("%02X", pDump[i]);
+    if ((LOGIC_PRINT_LINE - 1 == i % LOGIC_PRINT_LINE) || (size - 1 == i)) printf("\r\n");
+  }
+  printf("END\r\n");
+}
@@ -0,0 +1,85 @@
+#ifndef __LOGIC_H__
+#define __LOGIC_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "gpio.h"
+
+/* On-chip logic analyzer. TIM2 compare events pace DMA1 channel 5, which reads the IDR of a
+   GPIO port into a circular ring of 16-bit samples. While armed, the DMA interrupt scans every
+   completed half of the ring for the trigger (a pattern on some pins, or its appearance), then
+   lets Post more samples in and stops. The Pre samples before the trigger are kept by the ring.
+
+   The scan costs a few cycles per sample while the analyzer waits for the trigger, nothing
+   after it. The DMA has no overrun flag: above the rate the bus sustains samples are silently
+   lost, Bench_Logic() finds that rate (several MHz at 72 MHz, less with other DMA traffic).
+
+   The window is compressed into runs of equal samples and dumped as text through printf, which
+   tools/logic_vcd.py turns into a VCD file for any waveform viewer.                              */
+
+/* Samples written while the interrupt that stops the capture is entered */
+#define LOGIC_MARGIN                       (32)
+
+/* Fastest timer period, in timer clocks per sample */
+#define LOGIC_TICKS_MIN                    (8)
+
+#define LOGIC_MAGIC                        (0x43474F4CU)  /* "LOGC" */
+#define LOGIC_VERSION                      (1)
+
+typedef enum
+{
+  LOGIC_IDLE,
+  LOGIC_ARMED,                             /* Sampling, looking for the trigger                   */
+  LOGIC_TRIGGERED,                         /* Sampling the post-trigger part                      */
+  LOGIC_DONE
+} Logic_Status;
+
+/* Called from the DMA interrupt (IRQ_PRIORITY_LOGIC) when the capture is complete, may be NULL */
+typedef void (*Logic_Done)(void * pContext);
+
+typedef struct
+{
+  GPIO *     pPort;
+  U32        Rate;                         /* Samples per second                                  */
+  U16 *      pRing;
+  U16        Samples;                      /* Size of the ring, even                              */
+  U16        Pre;                          /* Samples kept before the trigger                     */
+  U16        Post;                         /* From the trigger on, Pre + Post + LOGIC_MARGIN must */
+                                           /* not exceed Samples / 2                              */
+  U16        Mask;                         /* Pins recorded                                       */
+  U16        TriggerMask;                  /* Pins compared, 0 - trigger at once                  */
+  U16        TriggerValue;
+  U8         TriggerEdge;                  /* TRUE - the pattern must appear, not be there        */
+  Logic_Done pDone;
+  void *     pContext;
+} Logic_Config;
+
+/* The dump: a header followed by Runs records {U16 Value, U16 Count}, little endian */
+typedef struct
+{
+  U32 Magic;
+  U16 Version;
+  U16 Runs;
+  U32 Rate;                                /* Samples per second, as produced                     */
+  U16 Mask;
+  U16 Port;                                /* 0 - GPIOA, 1 - GPIOB ...                            */
+  U16 Pre;                                 /* Index of the trigger sample                         */
+  U16 Samples;                             /* Covered by the runs, less than Pre + Post if the    */
+                                           /* output was too small                                */
+} Logic_Header;
+
+#define LOGIC_DUMP_SIZE(runs)              (sizeof(Logic_Header) + 4 * (runs))
+
+U32          Logic_Init(const Logic_Config * pConfig);
+void         Logic_Arm(void);
+void         Logic_Abort(void);
+Logic_Status Logic_GetStatus(void);
+U32          Logic_GetRate(void);
+
+/* After LOGIC_DONE: writes the dump to the word aligned pOut, returns its size in bytes */
+U32          Logic_Compress(U8 * pOut, U32 size);
+
+/* Hex text for tools/logic_vcd.py: "LOGIC <size>", lines of 32 bytes, "END" */
+void         Logic_Print(const U8 * pDump, U32 size);
+
+#endif /* __LOGIC_H__ */
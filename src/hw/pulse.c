@@ -0,0 +1,123 @@
+#include "types.h"
+#include "capture.h"
+#include "pulse.h"
+
+/* Response of the DHT sensor, 40 data bits and the stop pulse */
+#define DHT_BITS                           (40)
+#define DHT_PULSES                         (DHT_BITS + 2)
+
+#define NEC_BITS                           (32)
+#define NEC_PULSES                         (NEC_BITS + 2)
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Within +-25% of the nominal length */
+
+static U32 pulse_Near(U32 ticks, U32 us, U32 tickHz)
+{
+  U32 nominal = CAPTURE_TICKS(us, tickHz);
+
+  return ((ticks >= nominal - nominal / 4) && (ticks <= nominal + nominal / 4)) ? TRUE : FALSE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The frame is taken from its end, so the start pulse of the host may or may not be in it:
+     active  ... 80  50  50 ... 50  50
+     idle    ... 80  b0  b1 ... b39 timeout
+   A bit is 26..28 us high for 0, 70 us for 1. MSB first: humidity, temperature, checksum.       */
+
+U32 DHT_Decode(const Capture_Frame * pFrame, U32 tickHz, DHT_Reading * pReading)
+{
+  const U16 * pBits;
+  U32 n = pFrame->Pulses, threshold, i;
+  U8 data[DHT_BITS / 8] = {0, 0, 0, 0, 0};
+  S32 temperature;
+
+  if ((FALSE != pFrame->Full) || (DHT_PULSES > n)) return FALSE;
+  if ((FALSE == pulse_Near(pFrame->pActive[n - DHT_PULSES], 80, tickHz)) ||
+      (FALSE == pulse_Near(pFrame->pIdle[n - DHT_PULSES], 80, tickHz))) return FALSE;
+
+  threshold = CAPTURE_TICKS(48, tickHz);
+  pBits = &pFrame->pIdle[n - DHT_PULSES + 1];
+  for (i = 0; i < DHT_BITS; i++)
+  {
+    data[i / 8] = (U8)((data[i / 8] << 1) | ((pBits[i] > threshold) ? 1 : 0));
+  }
+
+  if ((U8)(data[0] + data[1] + data[2] + data[3]) != data[4]) return FALSE;
+
+  /* Sign and magnitude */
+  temperature = ((S32)(data[2] & 0x7F) << 8) | data[3];
+  pReading->Temperature = (S16)((0 != (data[2] & 0x80)) ? -temperature : temperature);
+  pReading->Humidity    = (U16)(((U32)data[0] << 8) | data[1]);
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Leader 9 ms active then 4.5 ms idle, 32 bits of 560 us active and 560 us (0) or 1690 us (1)
+   idle, LSB first: address, inverted address, command, inverted command. A repeat frame is the
+   leader with a 2.25 ms idle and one 560 us pulse. Receivers stretch the active phases, only the
+   leader and the idle phases are checked.                                                       */
+
+U32 NEC_Decode(const Capture_Frame * pFrame, U32 tickHz, NEC_Code * pCode)
+{
+  U32 n = pFrame->Pulses, threshold, code = 0, i, address, command;
+
+  if ((FALSE != pFrame->Full) || (2 > n)) return FALSE;
+  if (FALSE == pulse_Near(pFrame->pActive[0], 9000, tickHz)) return FALSE;
+
+  if ((2 == n) && (TRUE == pulse_Near(pFrame->pIdle[0], 2250, tickHz)))
+  {
+    pCode->Address = 0;
+    pCode->Command = 0;
+    pCode->Repeat  = TRUE;
+    return TRUE;
+  }
+
+  if ((NEC_PULSES != n) || (FALSE == pulse_Near(pFrame->pIdle[0], 4500, tickHz))) return FALSE;
+
+  threshold = CAPTURE_TICKS(1125, tickHz);
+  for (i = 0; i < NEC_BITS; i++)
+  {
+    if (pFrame->pIdle[i + 1] > threshold) code |= (1U << i);
+  }
+
+  command = (code >> 16) & 0xFF;
+  if (0xFF != (command ^ (code >> 24))) return FALSE;
+
+  /* The extended protocol uses the inverted byte as the high part of a 16-bit address */
+  address = code & 0xFF;
+  pCode->Address = (U16)((0xFF == (address ^ ((code >> 8) & 0xFF))) ? address : (code & 0xFFFF));
+  pCode->Command = (U8)command;
+  pCode->Repeat  = FALSE;
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Sums over the frame: the average is as precise as one tick over the whole frame, well below
+   the resolution of a single period                                                              */
+
+U32 PWM_Decode(const Capture_Frame * pFrame, U32 tickHz, PWM_Measure * pMeasure)
+{
+  U32 i, active = 0, period = 0;
+
+  for (i = 0; i < pFrame->Pulses; i++)
+  {
+    if (CAPTURE_TIMEOUT == pFrame->pIdle[i]) break;
+    active += pFrame->pActive[i];
+    period += pFrame->pActive[i] + pFrame->pIdle[i];
+  }
+
+  if (0 == period) return FALSE;
+
+  pMeasure->Frequency = (U32)(((U64)tickHz * 1000 * i + period / 2) / period);
+  pMeasure->Duty      = (U16)(((U64)active * 10000 + period / 2) / period);
+  pMeasure->Periods   = (U16)i;
+
+  return TRUE;
+}
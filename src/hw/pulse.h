@@ -0,0 +1,45 @@
+#ifndef __PULSE_H__
+#define __PULSE_H__
+
+#include "types.h"
+#include "capture.h"
+
+/* Decoders of pulse-width protocols, run once per captured frame. They are stateless, take the
+   tick rate of the capture (Capture_GetTickHz()) and return FALSE for a frame that does not
+   match. The timings are checked within +-25% of the nominal values.                             */
+
+/* DHT21 (AM2301) / DHT22 (AM2302). Idle high, active low, Timeout of a few ms (longer than the
+   start pulse). The start pulse is made with Capture_Drive(FALSE) for 1..10 ms, then
+   Capture_Drive(TRUE): the frame holds it, the 80/80 us response, 40 bits and the stop pulse.    */
+typedef struct
+{
+  S16 Temperature;                         /* 0.1 C                                               */
+  U16 Humidity;                            /* 0.1 %RH                                             */
+} DHT_Reading;
+
+U32 DHT_Decode(const Capture_Frame * pFrame, U32 tickHz, DHT_Reading * pReading);
+
+/* NEC infrared remote, from a demodulating receiver (idle high, active low), Timeout of about
+   10 ms. A held key sends repeat frames: Repeat is set and the code is not.                      */
+typedef struct
+{
+  U16 Address;                             /* 8 bits, or 16 for the extended protocol             */
+  U8  Command;
+  U8  Repeat;
+} NEC_Code;
+
+U32 NEC_Decode(const Capture_Frame * pFrame, U32 tickHz, NEC_Code * pCode);
+
+/* PWM: frequency and duty cycle averaged over the complete periods of the frame. The duty cycle
+   is the share of the active level: capture with IdleHigh = FALSE to get the high time. Timeout
+   must be longer than the longest phase.                                                         */
+typedef struct
+{
+  U32 Frequency;                           /* mHz                                                 */
+  U16 Duty;                                /* 0.01 %                                              */
+  U16 Periods;
+} PWM_Measure;
+
+U32 PWM_Decode(const Capture_Frame * pFrame, U32 tickHz, PWM_Measure * pMeasure);
+
+#endif /* __PULSE_H__ */
@@ -0,0 +1,29 @@
+#ifndef __RAMFUNC_H__
+#define __RAMFUNC_H__
+
+/* Places a function in SRAM, where it runs without flash wait states. The copy is made by the C
+   runtime (scatter loading for Keil, "initialize by copy" for IAR) before main(), so the function
+   must not be called from ApplicationInit(). A call between flash and SRAM is out of the BL range
+   and goes through a linker veneer, so the callees of a hot function should be moved with it.
+
+   Kernel functions and objects that can not be annotated are moved by the linker files:
+     Keil - RW_IRAM1 in stm32f103xb.sct
+     IAR  - "ramfunc" selectors in stm32f103xb_flash.icf
+
+   RAMFUNC_FLASH, defined for the compiler and the linker (Keil --predefine="-DRAMFUNC_FLASH",
+   IAR --config_def RAMFUNC_FLASH=1), leaves everything in flash. Bench_RamFunc() run on both
+   builds gives the saving of each kernel path.                                                   */
+#if defined(RAMFUNC_FLASH)
+#define RAMFUNC
+#elif defined(__ICCARM__)
+#define RAMFUNC                            __ramfunc
+#elif defined(__ARMCC_VERSION) || defined(__GNUC__)
+#define RAMFUNC                            __attribute__((section(".ramfunc")))
+#else
+#define RAMFUNC
+#endif
+
+/* SRAM is aliased at 0x20000000, flash at 0x08000000 */
+#define RAMFUNC_IS_SRAM(f)                 (0x20000000 == ((U32)(f) & 0xE0000000))
+
+#endif /* __RAMFUNC_H__ */
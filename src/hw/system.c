@@ -1,13 +1,32 @@
+#include <stdio.h>
+
 #include "types.h"
 #include "stm32f1xx.h"
 #include "system_stm32f1xx.h"
+#include "dwt.h"
 #include "system.h"
 
 #define SYSTEM_STARTUP_TIMEOUT     (20000U)
 #define RCC_CFGR_PLLSRC_HSI        (0U << RCC_CFGR_PLLSRC_Pos)
 #define RCC_CFGR_PLLSRC_HSE        (1U << RCC_CFGR_PLLSRC_Pos)
+#define SYSTEM_HSI_CLOCK           (8000000U)
+
+typedef struct
+{
+  const char * pStage;
+  U32          Cycles;
+  U32          Clock;
+} SystemBootStage;
+
+static SystemBootStage SystemBoot[SYSTEM_BOOT_STAGES];
+static U32 SystemBootCount = 0;
 
-static void SystemClockConfig( void );
+static void SystemClockStart( void );
+
+/* Called from Reset_Handler before the C runtime initializes RAM, so it must not use any static
+   data. Only the non-blocking part of the clock setup is done here: the HSE oscillator starts
+   while RAM and peripherals are being initialized, and main() calls SystemClockConfig() to wait
+   for it and switch to PLL.                                                                      */
 
 void ApplicationInit( void )
 {
@@ -16,9 +35,50 @@ void ApplicationInit( void )
   
   /* First of all - Init the system */
   SystemInit();
+
+  /* Boot stages are timed from here: a reset of the core does not clear the counter */
+  DWT_Init();
+  DWT->CYCCNT = 0;
   
-  /* Initialize system clock */
-  SystemClockConfig();
+  /* Start system clock */
+  SystemClockStart();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Stores the cycle counter at the end of a boot stage. Until the switch to PLL the core runs
+   from HSI, so the clock is taken from the current SYSCLK source.                              */
+
+void SystemBootMark( const char * pStage )
+{
+  if (SYSTEM_BOOT_STAGES <= SystemBootCount) return;
+
+  SystemBoot[SystemBootCount].Cycles = DWT_Cycles();
+  SystemBoot[SystemBootCount].pStage = pStage;
+  SystemBoot[SystemBootCount].Clock  =
+    (RCC_CFGR_SWS_PLL == (RCC->CFGR & RCC_CFGR_SWS)) ? SystemCoreClock : SYSTEM_HSI_CLOCK;
+  SystemBootCount++;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Each stage is converted to microseconds with the clock that was active when it started. */
+
+void SystemBootReport( void )
+{
+  U32 i, cycles, us, total = 0, clock = SYSTEM_HSI_CLOCK, last = 0;
+
+  printf("Boot time\r\n");
+  for (i = 0; i < SystemBootCount; i++)
+  {
+    cycles = SystemBoot[i].Cycles - last;
+    us = cycles / (clock / 1000000);
+    total += us;
+    printf("  %-12s %8d cycles %6d us, total %6d us\r\n", SystemBoot[i].pStage, cycles, us, total);
+    last  = SystemBoot[i].Cycles;
+    clock = SystemBoot[i].Clock;
+  }
+  printf("  Up to %s: %d us\r\n", (0 < i) ? SystemBoot[i - 1].pStage : "reset", total);
 }
 
 /* ---------------------------------------------------------------------------------------------- */
@@ -35,12 +95,40 @@ void ApplicationInit( void )
     - VDD                 - 3.3 V
     - Flash Latency       - 1 WS                                                                  */
 
-void SystemClockConfig( void )
-{
-  volatile U32 StartUpCounter = 0, HSEStatus = 0;
+/* Non-blocking part: everything that can be programmed before the oscillator is ready. */
 
+void SystemClockStart( void )
+{
   /* Enable HSE */    
   RCC->CR |= ((U32)RCC_CR_HSEON);
+
+  /* Enable Prefetch Buffer */
+  FLASH->ACR |= FLASH_ACR_PRFTBE;
+
+  /* Flash 2 wait states (LATENCY = 0b010), it is also valid while running from HSI */
+  FLASH->ACR &= (U32)((U32)~FLASH_ACR_LATENCY);
+  FLASH->ACR |= (U32)FLASH_ACR_LATENCY_1;    
+ 
+  /* HCLK = SYSCLK */
+  RCC->CFGR |= (U32)RCC_CFGR_HPRE_DIV1;
+    
+  /* PCLK2 = HCLK */
+  RCC->CFGR |= (U32)RCC_CFGR_PPRE2_DIV1;
+  
+  /* PCLK1 = HCLK */
+  RCC->CFGR |= (U32)RCC_CFGR_PPRE1_DIV2;
+
+  /*  PLL configuration: PLLCLK = HSE * 9 = 72 MHz */
+  RCC->CFGR &= (U32)((U32)~(RCC_CFGR_PLLSRC | RCC_CFGR_PLLXTPRE |
+                            RCC_CFGR_PLLMULL));
+  RCC->CFGR |= (U32)(RCC_CFGR_PLLSRC_HSE | RCC_CFGR_PLLMULL9);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void SystemClockConfig( void )
+{
+  volatile U32 StartUpCounter = 0, HSEStatus = 0;
  
   /* Wait till HSE is ready and if Time out is reached exit */
   do
@@ -61,27 +149,6 @@ void SystemClockConfig( void )
 
   if (1U == HSEStatus)
   {
-    /* Enable Prefetch Buffer */
-    FLASH->ACR |= FLASH_ACR_PRFTBE;
-
-    /* Flash 2 wait state */
-    FLASH->ACR &= (U32)((U32)~FLASH_ACR_LATENCY);
-    FLASH->ACR |= (U32)FLASH_ACR_LATENCY_2;    
- 
-    /* HCLK = SYSCLK */
-    RCC->CFGR |= (U32)RCC_CFGR_HPRE_DIV1;
-      
-    /* PCLK2 = HCLK */
-    RCC->CFGR |= (U32)RCC_CFGR_PPRE2_DIV1;
-    
-    /* PCLK1 = HCLK */
-    RCC->CFGR |= (U32)RCC_CFGR_PPRE1_DIV2;
-
-    /*  PLL configuration: PLLCLK = HSE * 9 = 72 MHz */
-    RCC->CFGR &= (U32)((U32)~(RCC_CFGR_PLLSRC | RCC_CFGR_PLLXTPRE |
-                              RCC_CFGR_PLLMULL));
-    RCC->CFGR |= (U32)(RCC_CFGR_PLLSRC_HSE | RCC_CFGR_PLLMULL9);
-
     /* Enable PLL */
     RCC->CR |= RCC_CR_PLLON;
 
@@ -100,11 +167,29 @@ void SystemClockConfig( void )
     {
         //
     }
+
+    /* From now on a crystal failure raises the NMI, see Clock_HSEFailed() */
+    RCC->CR |= RCC_CR_CSSON;
   }
   else
   {
-    /* If HSE fails to start-up, the application will have wrong clock 
-    configuration. User can add here some code to deal with this error */
+    /* No crystal: PLLCLK = HSI/2 * 16 = 64 MHz, the rest of the setup is the same */
+    RCC->CR &= (U32)~RCC_CR_HSEON;
+    RCC->CFGR &= (U32)((U32)~(RCC_CFGR_PLLSRC | RCC_CFGR_PLLXTPRE | RCC_CFGR_PLLMULL));
+    RCC->CFGR |= (U32)(RCC_CFGR_PLLSRC_HSI | RCC_CFGR_PLLMULL16);
+
+    RCC->CR |= RCC_CR_PLLON;
+    while (0U == (RCC->CR & RCC_CR_PLLRDY))
+    {
+        //
+    }
+
+    RCC->CFGR &= (U32)((U32)~(RCC_CFGR_SW));
+    RCC->CFGR |= (U32)RCC_CFGR_SW_PLL;
+    while (RCC_CFGR_SWS_PLL != (RCC->CFGR & (U32)RCC_CFGR_SWS))
+    {
+        //
+    }
   }
   
   SystemCoreClockUpdate();  
@@ -1,4 +1,13 @@
 #ifndef __SYSTEM_H__
 #define __SYSTEM_H__
 
+#include "types.h"
+
+/* Maximum number of boot stages recorded by SystemBootMark() */
+#define SYSTEM_BOOT_STAGES         (8)
+
+void SystemClockConfig( void );
+void SystemBootMark( const char * pStage );
+void SystemBootReport( void );
+
 #endif /* __SYSTEM_H__ */
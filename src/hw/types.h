@@ -49,5 +49,11 @@
 #ifndef CU32
   typedef const unsigned int   CU32;
 #endif
+#ifndef S64
+  typedef long long            S64;
+#endif
+#ifndef U64
+  typedef unsigned long long   U64;
+#endif
 
 #endif /* __TYPES_H__ */
@@ -0,0 +1,263 @@
+#include <string.h>
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "gpio.h"
+#include "dwt.h"
+#include "irq.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "dma.h"
+#include "wave.h"
+
+/* No short half seen yet */
+#define WAVE_NONE                          (2)
+
+/* Memory to peripheral, 32-bit both sides, very high priority: a late word is a timing error */
+#define WAVE_DMA_CCR                       (DMA_CCR_PL_1 | DMA_CCR_PL_0 | DMA_CCR_MSIZE_1 | \
+                                            DMA_CCR_PSIZE_1 | DMA_CCR_MINC | DMA_CCR_CIRC | \
+                                            DMA_CCR_DIR | DMA_CCR_TEIE | DMA_CCR_HTIE | \
+                                            DMA_CCR_TCIE | DMA_CCR_EN)
+
+typedef struct
+{
+  Wave_Config    Config;
+  volatile U32   Busy;
+  U32            Last;                     /* Half after which the engine stops                   */
+  U32            Channel;                  /* DMA channel, 0 when released                        */
+  Wave_Stats     Stats;
+  Clock_Notifier Notifier;
+} Wave_State;
+
+static Wave_State Wave_This;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* TIM4 runs at PCLK1, doubled when the APB1 prescaler is not 1 */
+
+static U32 wave_TimerClock(void)
+{
+  U32 clock = Clock_GetPCLK1();
+
+  if (0 != (RCC->CFGR & RCC_CFGR_PPRE1_2)) clock *= 2;
+  return clock;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void wave_SetRate(U32 rate)
+{
+  U32 ticks = (wave_TimerClock() + rate / 2) / rate, psc;
+
+  if (0 == ticks) ticks = 1;
+  psc = (ticks - 1) / 0x10000;
+
+  TIM4->PSC = psc;
+  TIM4->ARR = (ticks / (psc + 1)) - 1;
+  TIM4->EGR = TIM_EGR_UG;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void wave_ClockChanged(U32 oldHz, U32 newHz, void * pContext)
+{
+  wave_SetRate(Wave_This.Config.Rate);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void wave_Fill(Wave_State * pThis, U32 half)
+{
+  Wave_Config * pConfig = &pThis->Config;
+  U32 * pWords = &pConfig->pBuffer[half * pConfig->Words];
+  U32 count;
+
+  count = pConfig->pProducer(pWords, pConfig->Words, pConfig->pContext);
+  pThis->Stats.Halves++;
+
+  if (count < pConfig->Words)
+  {
+    memset(&pWords[count], 0, (pConfig->Words - count) * sizeof(U32));
+    pThis->Last = half;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A zero BSRR word changes no pin */
+
+static void wave_Clear(Wave_State * pThis, U32 half)
+{
+  memset(&pThis->Config.pBuffer[half * pThis->Config.Words], 0, pThis->Config.Words * sizeof(U32));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void wave_Finish(Wave_State * pThis)
+{
+  TIM4->CR1   = 0;
+  TIM4->DIER  = 0;
+  DMA_CHANNEL(pThis->Channel)->CCR = 0;
+  pThis->Busy = FALSE;
+
+  if (NULL != pThis->Config.pDone) pThis->Config.pDone(pThis->Config.pContext);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The DMA has just left 'half'. It is refilled, unless the stream has ended: then either the
+   last half is out and the engine stops, or the other half is the last one and this one is
+   cleared. The channel is circular: the words it may still write before wave_Finish() stops TIM4
+   are zero, which leaves the pins as they are.                                                   */
+
+static void wave_Half(Wave_State * pThis, U32 half)
+{
+  U32 position;
+
+  if (half == pThis->Last)
+  {
+    wave_Finish(pThis);
+    return;
+  }
+  if (WAVE_NONE != pThis->Last)
+  {
+    wave_Clear(pThis, half);
+    return;
+  }
+
+  wave_Fill(pThis, half);
+
+  /* Late if the DMA has wrapped around into the half while the producer was writing it */
+  position = WAVE_BUFFER_SIZE(pThis->Config.Words) - DMA_CHANNEL(pThis->Channel)->CNDTR;
+  if (half == position / pThis->Config.Words) pThis->Stats.Late++;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void wave_DMA(U32 channel, U32 events, void * pContext)
+{
+  Wave_State * pThis = (Wave_State *)pContext;
+#if (1 == WAVE_PROFILE)
+  U32 cycles = DWT_Cycles();
+#endif
+
+  if (0 != (events & DMA_EVENT_ERROR)) pThis->Stats.Errors++;
+
+  if (0 != (events & DMA_EVENT_HALF)) wave_Half(pThis, 0);
+  if ((0 != (events & DMA_EVENT_DONE)) && (FALSE != pThis->Busy)) wave_Half(pThis, 1);
+
+#if (1 == WAVE_PROFILE)
+  pThis->Stats.Cycles += DWT_Cycles() - cycles;
+#endif
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Wave_Init(const Wave_Config * pConfig)
+{
+  Wave_State * pThis = &Wave_This;
+
+  if ((NULL == pConfig) || (NULL == pConfig->pPort) || (NULL == pConfig->pBuffer)) return FALSE;
+  if ((NULL == pConfig->pProducer) || (0 == pConfig->Rate)) return FALSE;
+  if ((0 == pConfig->Words) || (0xFFFF < WAVE_BUFFER_SIZE(pConfig->Words))) return FALSE;
+
+  Wave_Stop();
+  pThis->Channel = DMA_Claim(DMA_REQ_TIM4_UP, IRQ_PRIORITY_WAVE, wave_DMA, pThis);
+  if (0 == pThis->Channel) return FALSE;
+
+  memset(&pThis->Stats, 0, sizeof(pThis->Stats));
+  memcpy(&pThis->Config, pConfig, sizeof(Wave_Config));
+
+  BITBAND_RCC_APB1ENR(RCC_APB1ENR_TIM4EN_Pos) = 1;
+
+  /* TIM4 only paces the DMA, no outputs */
+  TIM4->CR1  = 0;
+  TIM4->CR2  = 0;
+  TIM4->DIER = 0;
+  wave_SetRate(pConfig->Rate);
+
+  if (NULL == pThis->Notifier.pFunc)
+  {
+    Clock_Register(&pThis->Notifier, wave_ClockChanged, NULL);
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Both halves are filled before the first word goes out, or cleared after a short first one */
+
+void Wave_Start(void)
+{
+  Wave_State * pThis = &Wave_This;
+  Wave_Config * pConfig = &pThis->Config;
+  DMA_Channel_TypeDef * pChannel;
+
+  Wave_Stop();
+
+  /* Claimed again after a stop, by then another driver may have taken it */
+  pThis->Channel = DMA_Claim(DMA_REQ_TIM4_UP, IRQ_PRIORITY_WAVE, wave_DMA, pThis);
+  if (0 == pThis->Channel) return;
+  pChannel = DMA_CHANNEL(pThis->Channel);
+
+  pThis->Last = WAVE_NONE;
+  pThis->Busy = TRUE;
+  wave_Fill(pThis, 0);
+  if (WAVE_NONE == pThis->Last) wave_Fill(pThis, 1);
+  else                          wave_Clear(pThis, 1);
+
+  pChannel->CCR   = 0;
+  pChannel->CPAR  = (U32)&pConfig->pPort->BSRR;
+  pChannel->CMAR  = (U32)pConfig->pBuffer;
+  pChannel->CNDTR = WAVE_BUFFER_SIZE(pConfig->Words);
+  DMA1->IFCR      = DMA_IFCR_CGIF7;
+  pChannel->CCR   = WAVE_DMA_CCR;
+
+  TIM4->CNT  = 0;
+  TIM4->SR   = 0;
+  TIM4->DIER = TIM_DIER_UDE;
+  TIM4->CR1  = TIM_CR1_CEN;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The pins keep the level of the last word written */
+
+void Wave_Stop(void)
+{
+  if (0 == (RCC->APB1ENR & RCC_APB1ENR_TIM4EN)) return;
+
+  TIM4->CR1  = 0;
+  TIM4->DIER = 0;
+  DMA_Release(Wave_This.Channel);
+  Wave_This.Channel = 0;
+  Wave_This.Busy = FALSE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Wave_IsBusy(void)
+{
+  return Wave_This.Busy;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Wave_GetStats(Wave_Stats * pStats)
+{
+  U32 primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(pStats, &Wave_This.Stats, sizeof(Wave_Stats));
+  __set_PRIMASK(primask);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The word rate actually produced by TIM4, the requested one is rounded to the timer clock */
+
+U32 Wave_GetRate(void)
+{
+  return wave_TimerClock() / ((TIM4->PSC + 1) * (TIM4->ARR + 1));
+}
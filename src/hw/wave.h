@@ -0,0 +1,59 @@
+#ifndef __WAVE_H__
+#define __WAVE_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* Waveform engine: TIM4 update events pace DMA1 channel 7, which writes one 32-bit word per
+   tick to the BSRR of a GPIO port. A word sets (bits 0..15) and resets (bits 16..31) any pins of
+   the port at once, 0 leaves them all as they are. Up to 16 outputs change together with a fixed
+   timing and no CPU involvement: LED strips, software UART transmitters, stepper pulses.
+
+   The buffer is a ring of two halves. When the DMA leaves a half, the interrupt asks the producer
+   to fill it again, so the CPU only prepares words, a half ahead of the output. The producer
+   returns how many words it wrote: the rest of the half is cleared (no change on the pins) and a
+   short half is the last one, the engine stops after it has been output.                        */
+
+/* Measure the cycles spent in the DMA interrupt, the producer included */
+#ifndef WAVE_PROFILE
+#define WAVE_PROFILE                       (0)
+#endif
+
+/* Size of the buffer the caller provides, in words */
+#define WAVE_BUFFER_SIZE(words)            (2 * (words))
+
+/* Called from the DMA interrupt (IRQ_PRIORITY_WAVE), and twice from Wave_Start() */
+typedef U32 (*Wave_Producer)(U32 * pWords, U32 count, void * pContext);
+
+/* Called from the DMA interrupt once the last word is out, may be NULL */
+typedef void (*Wave_Done)(void * pContext);
+
+typedef struct
+{
+  GPIO_TypeDef * pPort;
+  U32            Rate;                     /* Words per second                                    */
+  U32 *          pBuffer;                  /* WAVE_BUFFER_SIZE(Words)                             */
+  U16            Words;                    /* Words in one half                                   */
+  Wave_Producer  pProducer;
+  Wave_Done      pDone;
+  void *         pContext;
+} Wave_Config;
+
+typedef struct
+{
+  U32 Halves;                              /* Halves filled by the producer                       */
+  U32 Late;                                /* Halves refilled while the DMA was already in them   */
+  U32 Errors;                              /* DMA transfer errors                                 */
+#if (1 == WAVE_PROFILE)
+  U32 Cycles;                              /* Spent in the interrupt                              */
+#endif
+} Wave_Stats;
+
+U32  Wave_Init(const Wave_Config * pConfig);
+void Wave_Start(void);
+void Wave_Stop(void);
+U32  Wave_IsBusy(void);
+void Wave_GetStats(Wave_Stats * pStats);
+U32  Wave_GetRate(void);
+
+#endif /* __WAVE_H__ */
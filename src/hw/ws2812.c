@@ -0,0 +1,87 @@
+#include <string.h>
+
+#include "types.h"
+#include "ws2812.h"
+
+/* The words of the latch, whole ones, still cover the 280 us */
+typedef char ws2812_latch_too_short[(280U * WS2812_RATE <= WS2812_LATCH_WORDS * 1000000U) ? 1 : -1];
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void WS2812_Init(WS2812 * pStrip, const U8 * pPins, U32 strips, U32 leds)
+{
+  U32 i;
+
+  if (WS2812_STRIPS_MAX < strips) strips = WS2812_STRIPS_MAX;
+
+  pStrip->Strips = (U8)strips;
+  pStrip->Bytes  = (U16)(3 * leds);
+  pStrip->Mask   = 0;
+  for (i = 0; i < strips; i++)
+  {
+    pStrip->Pins[i] = (U16)(1U << (pPins[i] & 0x0F));
+    pStrip->Mask   |= pStrip->Pins[i];
+  }
+
+  WS2812_Frame(pStrip, NULL);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void WS2812_Frame(WS2812 * pStrip, const U8 * pData)
+{
+  pStrip->pData    = pData;
+  pStrip->Position = 0;
+  pStrip->Latch    = WS2812_LATCH_WORDS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Byte by byte: the bits of all the strips are gathered into one reset mask per bit, then the
+   24 words are written. The set and the final reset words are the same for every bit.           */
+
+U32 WS2812_Produce(U32 * pWords, U32 count, void * pContext)
+{
+  WS2812 * pStrip = (WS2812 *)pContext;
+  const U8 * pData;
+  U32 set = pStrip->Mask, clear = (U32)pStrip->Mask << 16, zeros[8], n = 0, latch, s, b, byte;
+
+  if (NULL == pStrip->pData) return 0;
+
+  while ((pStrip->Position < pStrip->Bytes) && (n + WS2812_WORDS_PER_BYTE <= count))
+  {
+    memset(zeros, 0, sizeof(zeros));
+    pData = &pStrip->pData[pStrip->Position];
+    for (s = 0; s < pStrip->Strips; s++, pData += pStrip->Bytes)
+    {
+      byte = ~(U32)*pData;
+      for (b = 0; b < 8; b++)
+      {
+        if (0 != (byte & (0x80 >> b))) zeros[b] |= pStrip->Pins[s];
+      }
+    }
+
+    for (b = 0; b < 8; b++)
+    {
+      pWords[n++] = set;
+      pWords[n++] = zeros[b] << 16;
+      pWords[n++] = clear;
+    }
+    pStrip->Position++;
+  }
+
+  /* The rest of the half is too short for a byte: a low gap, the stream goes on */
+  if (pStrip->Position < pStrip->Bytes)
+  {
+    memset(&pWords[n], 0, (count - n) * sizeof(U32));
+    return count;
+  }
+
+  latch = count - n;
+  if (latch > pStrip->Latch) latch = pStrip->Latch;
+  memset(&pWords[n], 0, latch * sizeof(U32));
+  pStrip->Latch -= latch;
+  n += latch;
+
+  return (0 == pStrip->Latch) ? n : count;
+}
@@ -0,0 +1,42 @@
+#ifndef __WS2812_H__
+#define __WS2812_H__
+
+#include "types.h"
+
+/* WS2812 encoder for the waveform engine. A bit is three words at 2.4 MHz (417 ns each): the
+   first sets the line, the second clears it for a 0, the third clears it for a 1:
+     0 - 417 ns high, 833 ns low        1 - 833 ns high, 417 ns low
+   which is within the +-150 ns of the datasheet. Up to 16 strips on the same port are driven in
+   parallel, one BSRR word covers all of them, so a frame takes as long as the longest strip.
+
+   The words of one byte (24) are written together: the halves of the engine should hold a
+   multiple of WS2812_WORDS_PER_BYTE, any other size pads each half with a short low gap.         */
+
+#define WS2812_RATE                        (2400000)
+#define WS2812_WORDS_PER_BYTE              (24)
+#define WS2812_STRIPS_MAX                  (16)
+
+/* The line stays low 300 us after the data: the newer parts latch after 280 us, not 50 */
+#define WS2812_LATCH_WORDS                 (WS2812_RATE / 1000 * 300 / 1000)
+
+typedef struct
+{
+  const U8 * pData;                        /* Strips x Bytes, GRB per LED, strip after strip      */
+  U16        Bytes;                        /* Per strip, 3 per LED                                */
+  U16        Mask;                         /* Pins of all the strips                              */
+  U16        Pins[WS2812_STRIPS_MAX];
+  U8         Strips;
+  U32        Position;                     /* Next byte of every strip                            */
+  U32        Latch;                        /* Words of the latch still to be written              */
+} WS2812;
+
+/* pPins are the pin numbers (0..15) of the strips on the port given to the engine */
+void WS2812_Init(WS2812 * pStrip, const U8 * pPins, U32 strips, U32 leds);
+
+/* Starts over with new data, before Wave_Start() */
+void WS2812_Frame(WS2812 * pStrip, const U8 * pData);
+
+/* Wave_Producer, the context is the WS2812 */
+U32  WS2812_Produce(U32 * pWords, U32 count, void * pContext);
+
+#endif /* __WS2812_H__ */
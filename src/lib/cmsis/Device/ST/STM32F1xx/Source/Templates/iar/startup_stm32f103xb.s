@@ -66,6 +66,7 @@
 
         EXTERN  __iar_program_start
         EXTERN  ApplicationInit        
+        EXTERN  Fault
         PUBLIC  __vector_table
 
         DATA
@@ -154,22 +155,38 @@ NMI_Handler
         PUBWEAK HardFault_Handler
         SECTION .text:CODE:REORDER:NOROOT(1)
 HardFault_Handler
-        B HardFault_Handler
+        TST     LR, #4
+        ITE     EQ
+        MRSEQ   R0, MSP
+        MRSNE   R0, PSP
+        B       Fault
 
         PUBWEAK MemManage_Handler
         SECTION .text:CODE:REORDER:NOROOT(1)
 MemManage_Handler
-        B MemManage_Handler
+        TST     LR, #4
+        ITE     EQ
+        MRSEQ   R0, MSP
+        MRSNE   R0, PSP
+        B       Fault
 
         PUBWEAK BusFault_Handler
         SECTION .text:CODE:REORDER:NOROOT(1)
 BusFault_Handler
-        B BusFault_Handler
+        TST     LR, #4
+        ITE     EQ
+        MRSEQ   R0, MSP
+        MRSNE   R0, PSP
+        B       Fault
 
         PUBWEAK UsageFault_Handler
         SECTION .text:CODE:REORDER:NOROOT(1)
 UsageFault_Handler
-        B UsageFault_Handler
+        TST     LR, #4
+        ITE     EQ
+        MRSEQ   R0, MSP
+        MRSNE   R0, PSP
+        B       Fault
 
         PUBWEAK SVC_Handler
         SECTION .text:CODE:REORDER:NOROOT(1)
@@ -179,7 +196,11 @@ SVC_Handler
         PUBWEAK DebugMon_Handler
         SECTION .text:CODE:REORDER:NOROOT(1)
 DebugMon_Handler
-        B DebugMon_Handler
+        TST     LR, #4
+        ITE     EQ
+        MRSEQ   R0, MSP
+        MRSNE   R0, PSP
+        B       Fault
 
         PUBWEAK PendSV_Handler
         SECTION .text:CODE:REORDER:NOROOT(1)
@@ -172,17 +172,29 @@ HardFault_Handler\
 MemManage_Handler\
                 PROC
                 EXPORT  MemManage_Handler          [WEAK]
-                B       .
+                TST     LR, #4
+                ITE     EQ
+                MRSEQ   R0, MSP
+                MRSNE   R0, PSP
+                B       Fault
                 ENDP
 BusFault_Handler\
                 PROC
                 EXPORT  BusFault_Handler           [WEAK]
-                B       .
+                TST     LR, #4
+                ITE     EQ
+                MRSEQ   R0, MSP
+                MRSNE   R0, PSP
+                B       Fault
                 ENDP
 UsageFault_Handler\
                 PROC
                 EXPORT  UsageFault_Handler         [WEAK]
-                B       .
+                TST     LR, #4
+                ITE     EQ
+                MRSEQ   R0, MSP
+                MRSNE   R0, PSP
+                B       Fault
                 ENDP
 SVC_Handler     PROC
                 EXPORT  SVC_Handler                [WEAK]
@@ -191,7 +203,11 @@ SVC_Handler     PROC
 DebugMon_Handler\
                 PROC
                 EXPORT  DebugMon_Handler           [WEAK]
-                B       .
+                TST     LR, #4
+                ITE     EQ
+                MRSEQ   R0, MSP
+                MRSNE   R0, PSP
+                B       Fault
                 ENDP
 PendSV_Handler  PROC
                 EXPORT  PendSV_Handler             [WEAK]
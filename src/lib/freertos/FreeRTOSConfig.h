@@ -82,10 +82,17 @@
  * See http://www.freertos.org/a00110.html.
  *----------------------------------------------------------*/
 
+/* The clock is changed at run time (src/hw/clock.c), the SysTick reload is derived from the
+clock the scheduler is started at and re-derived on every change. */
+#ifndef __IAR_SYSTEMS_ASM__
+#include <stdint.h>
+extern uint32_t SystemCoreClock;
+#endif
+
 #define configUSE_PREEMPTION		                 1
-#define configUSE_IDLE_HOOK			                 0
-#define configUSE_TICK_HOOK			                 0
-#define configCPU_CLOCK_HZ			                 ( ( unsigned long ) 72000000 )	
+#define configUSE_IDLE_HOOK			                 1
+#define configUSE_TICK_HOOK			                 1
+#define configCPU_CLOCK_HZ			                 ( SystemCoreClock )
 #define configTICK_RATE_HZ			                 ( ( TickType_t ) 1000 )
 #define configMAX_PRIORITIES		                 ( 5 )
 #define configMINIMAL_STACK_SIZE	               ( ( unsigned short ) 128 )
@@ -110,9 +117,9 @@
 #define configNUM_THREAD_LOCAL_STORAGE_POINTERS  5
 
 /* Hook function related definitions. */
-#define configUSE_IDLE_HOOK                      0
-#define configUSE_TICK_HOOK                      0
-#define configCHECK_FOR_STACK_OVERFLOW           0
+#define configUSE_IDLE_HOOK                      1
+#define configUSE_TICK_HOOK                      1
+#define configCHECK_FOR_STACK_OVERFLOW           1
 #define configUSE_MALLOC_FAILED_HOOK             0
 
 /* Run time and task stats gathering related definitions. */
@@ -142,11 +149,11 @@ to exclude the API function. */
 #define INCLUDE_vTaskDelay				               1
 #define INCLUDE_xResumeFromISR                   0
 #define INCLUDE_xTaskGetSchedulerState           0
-#define INCLUDE_xTaskGetCurrentTaskHandle        0
-#define INCLUDE_uxTaskGetStackHighWaterMark      0
-#define INCLUDE_xTaskGetIdleTaskHandle           0
+#define INCLUDE_xTaskGetCurrentTaskHandle        1
+#define INCLUDE_uxTaskGetStackHighWaterMark      1
+#define INCLUDE_xTaskGetIdleTaskHandle           1
 #define INCLUDE_xTimerGetTimerDaemonTaskHandle   0
-#define INCLUDE_pcTaskGetTaskName                0
+#define INCLUDE_pcTaskGetTaskName                1
 #define INCLUDE_eTaskGetState                    0
 #define INCLUDE_xEventGroupSetBitFromISR         0
 #define INCLUDE_xTimerPendFunctionCall           0
@@ -166,6 +173,27 @@ NVIC value of 255. */
 #define configLIBRARY_KERNEL_INTERRUPT_PRIORITY	 15
 
 
+/* Stack usage monitor (src/os/stackmon.c). The stacks are filled with tskSTACK_FILL_BYTE because
+INCLUDE_uxTaskGetStackHighWaterMark is set, the watermarks are scanned from the Idle hook. */
+#ifndef __IAR_SYSTEMS_ASM__
+#include "ramfunc.h"
+extern void StackMon_TaskCreate( void * pTask, void * pStack, unsigned short depth, const char * pName );
+extern void StackMon_TaskDelete( void * pTask );
+extern RAMFUNC void StackGuard_Switch( void * pStack, const char * pName );
+extern RAMFUNC void Trace_TaskSwitch( const char * pName );
+#endif
+#define traceTASK_CREATE( pxNewTCB )             StackMon_TaskCreate( ( pxNewTCB ), ( pxNewTCB )->pxStack, usStackDepth, ( pxNewTCB )->pcTaskName )
+#define traceTASK_DELETE( pxTCB )                StackMon_TaskDelete( ( pxTCB ) )
+
+/* Stack guard (src/os/stackguard.c) follows the running task, the switch is logged for the crash
+record (src/os/crashdump.c). */
+#define traceTASK_SWITCHED_IN()                                                                   \
+{                                                                                                 \
+  StackGuard_Switch( pxCurrentTCB->pxStack, pxCurrentTCB->pcTaskName );                           \
+  Trace_TaskSwitch( pxCurrentTCB->pcTaskName );                                                   \
+}
+
+
 #define xPortSysTickHandler                      SysTick_Handler
 #define xPortPendSVHandler                       PendSV_Handler
 #define vPortSVCHandler                          SVC_Handler
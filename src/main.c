@@ -3,47 +3,231 @@
 #include "stm32f1xx.h"
 #include "types.h"
 #include "gpio.h"
+#include "gpiomap.h"
 #include "uniquedevid.h"
+#include "system.h"
+#include "debug.h"
+#include "clock.h"
+#include "irq.h"
+#include "periodic.h"
+#include "stackmon.h"
+#include "stackguard.h"
+#include "trace.h"
+#include "crashdump.h"
+#include "governor.h"
+#include "bench.h"
+#include "usbpipe.h"
+#include "cdc.h"
+#include "vendor.h"
+#include "composite.h"
+#include "slave.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
 #include "queue.h"
 
+/* Board pin map: (port, pin, type, initial level) */
+#define BOARD_PINS(PIN, a, b) \
+  PIN(a, b, C, 13, GPIO_TYPE_OUT_OD_2MHZ, 1)
+
+GPIO_MAP_Check(BOARD_PINS)
+
+static PeriodicTask LEDTask;
+static U32 CrashSaved;
+
 void vLEDTask(void * pvParameters)
 {
-  GPIO_Init(GPIOC, 13, GPIO_TYPE_OUT_OD_2MHZ);
-  
-  while(1)
+  if (0 == (GPIOC->ODR & (1 << 13)))
   {
-    GPIO_Lo(GPIOC, 13);
-    vTaskDelay(500);
     GPIO_Hi(GPIOC, 13);
-    vTaskDelay(500);
   }
-  //vTaskDelete(NULL);
+  else
+  {
+    GPIO_Lo(GPIOC, 13);
+  }
 }
 
-int main(void)
+#if (1 == USB_ENABLED)
+
+/* Echoes what the terminal sends on the CDC port */
+
+void vUSBEchoTask(void * pvParameters)
+{
+  U8 buffer[64];
+  U32 count;
+
+  while (TRUE)
+  {
+    count = USB_PipeRead(CDC_Pipe(), buffer, sizeof(buffer), portMAX_DELAY);
+    USB_PipeWrite(CDC_Pipe(), buffer, count, portMAX_DELAY);
+  }
+}
+
+/* Throughput test on the vendor interface (tools/usb_speed.py): the IN endpoint sends a 32-bit
+   counter as fast as the host reads it, what arrives on the OUT endpoint is dropped              */
+
+void vUSBBulkTask(void * pvParameters)
 {
+  USB_Pipe * pPipe = Vendor_Pipe();
+  U32 counter = 0, count, i;
+  U8 * pData;
+
+  while (TRUE)
+  {
+    while (0 != (count = USB_PipeGetRead(pPipe, &pData)))
+    {
+      USB_PipeConsume(pPipe, count);
+    }
+
+    /* The writes are whole words, so is the contiguous space */
+    count = USB_PipeGetWrite(pPipe, &pData);
+    if (0 == count)
+    {
+      USB_PipeWait(pPipe, portMAX_DELAY);
+      continue;
+    }
+    for (i = 0; i < count; i += 4)
+    {
+      *((U32 *)&pData[i]) = counter++;
+    }
+    USB_PipeCommit(pPipe, count);
+  }
+}
+
+#endif
+
+/* Non-critical initialization and the banner are deferred here, after the scheduler has
+   started. The task has the highest priority, so it is the first one to run.                     */
+
+void vBootTask(void * pvParameters)
+{
+  SystemBootMark("First task");
+
   printf("STM32F103C8 Started!\r\n");
   printf("ID0 = 0x%04X\r\n", UDID_0);
   printf("ID1 = 0x%04X\r\n", UDID_1);
   printf("ID2 = 0x%08X\r\n", UDID_2);
   printf("ID2 = 0x%08X\r\n", UDID_3);
   printf("Memory Size = %d kB\r\n", FLASH_SIZE);
-  
-  xTaskCreate(vLEDTask,"LEDTask", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL);
+
+  SystemBootReport();
+
+  if (FALSE == Clock_IsHSE())
+  {
+    printf("HSE failed, running from HSI at %d Hz\r\n", SystemCoreClock);
+  }
+
+  if (TRUE == CrashSaved)
+  {
+    printf("Crash record saved at 0x%08X\r\n", CRASHDUMP_FLASH_ADDRESS);
+  }
+
+#if (1 == BENCH_ENABLED)
+  Bench_GPIO();
+  Bench_RamFunc();
+  Bench_IRQ();
+  Bench_ADC();
+  Bench_DSP();
+  Bench_FFT();
+  Bench_Math();
+  Bench_AHRS();
+  Bench_Control();
+  Bench_Wave();
+  Bench_Logic();
+  Bench_CAN();
+  Bench_DMA();
+#endif
+
+#if (1 == USB_ENABLED)
+  /* The USB clock is derived from the system clock, which has to stay at 72 MHz from now on */
+  Governor_SetFloor(CLOCK_LEVEL_MAX);
+  if (FALSE == Composite_Start())
+  {
+    printf("USB not started, the system clock is %d Hz\r\n", SystemCoreClock);
+  }
+  else
+  {
+    xTaskCreate(vUSBEchoTask, "Echo", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY + 2, NULL);
+    xTaskCreate(vUSBBulkTask, "Bulk", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY + 1, NULL);
+  }
+#endif
+
+#if (1 == MODBUS_ENABLED)
+  if (FALSE == Slave_Start())
+  {
+    printf("Modbus slave not started\r\n");
+  }
+#endif
+
+  vTaskDelete(NULL);
+}
+
+int main(void)
+{
+  SystemBootMark("C runtime");
+
+  /* The vector table is moved to SRAM before any interrupt is enabled */
+  IRQ_Init();
+
+  /* Nothing else runs yet, so the flash stall of saving a crash record delays no one */
+  CrashSaved = CrashDump_Init();
+
+  /* Peripherals are brought up from HSI while the HSE oscillator is starting */
+  Trace_Init();
+  StackGuard_Init();
+  GPIO_MAP_Apply(BOARD_PINS);
+  SystemBootMark("Peripherals");
+
+  SystemClockConfig();
+  Clock_Init();
+  Debug_Init();
+  SystemBootMark("Clock");
+
+  xTaskCreate(vBootTask, "BootTask", 2 * configMINIMAL_STACK_SIZE, NULL, configMAX_PRIORITIES - 1, NULL);
+
+  PeriodicTask_Create
+  (
+    &LEDTask,
+    "LEDTask",
+    configMINIMAL_STACK_SIZE,
+    tskIDLE_PRIORITY + 1,
+    vLEDTask,
+    NULL,
+    500,
+    0
+  );
+  Governor_Start(configMAX_PRIORITIES - 2);
+  SystemBootMark("Tasks");
 
   vTaskStartScheduler();
 
   while(TRUE) {};
 }
 
+void vApplicationIdleHook(void)
+{
+  StackMon_IdleScan();
+}
+
+void vApplicationTickHook(void)
+{
+  Governor_TickHook();
+}
+
 void Fault(U32 stack[])
 {
   enum {r0, r1, r2, r3, r12, lr, pc, psr};
+  static const char * const names[] =
+  {
+    "Fault", "Fault", "NMI", "Hard Fault", "Mem Manage", "Bus Fault", "Usage Fault",
+    "Fault", "Fault", "Fault", "Fault", "Fault", "Debug Monitor"
+  };
+  U32 vector = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk);
   
-  printf("Hard Fault\r\n");
+  /* Save the record first, printing may fault again */
+  CrashDump_Capture(stack);
+
+  printf("%s\r\n", names[(12 < vector) ? 0 : vector]);
   printf("  SHCSR    = 0x%08x\r\n", SCB->SHCSR);
   printf("  CFSR     = 0x%08x\r\n", SCB->CFSR);
   printf("  HFSR     = 0x%08x\r\n", SCB->HFSR);
@@ -59,5 +243,18 @@ void Fault(U32 stack[])
   printf("  PC [R15] = 0x%08x - Program counter\r\n", stack[pc]);
   printf("  PSR      = 0x%08x\r\n", stack[psr]);
 
+  if ((12 == vector) && (FALSE != StackGuard_IsHit()))
+  {
+    printf("Stack Overflow\r\n");
+    printf("  Task     = %s\r\n", StackGuard_TaskName());
+    printf("  Guard    = 0x%08x\r\n", StackGuard_GuardBase());
+  }
+
+  /* In the field restart, the record is moved to flash on the next boot */
+  if (0 == (CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk))
+  {
+    NVIC_SystemReset();
+  }
+
   while(TRUE) {};
 }
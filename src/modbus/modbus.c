@@ -0,0 +1,274 @@
+#include <string.h>
+
+#include "types.h"
+#include "modbus.h"
+
+/* Largest quantities of a request that fit in a PDU */
+#define MODBUS_READ_BITS                   (2000)
+#define MODBUS_READ_REGISTERS              (125)
+#define MODBUS_WRITE_BITS                  (1968)
+#define MODBUS_WRITE_REGISTERS             (123)
+
+#define MODBUS_COIL_ON                     (0xFF00)
+
+/* CRC of every byte value, the CRC of a frame then costs a lookup and a shift per byte */
+static const U16 Modbus_CRCTable[256] =
+{
+  0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241, 0xC601, 0x06C0,
+  0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440, 0xCC01, 0x0CC0, 0x0D80, 0xCD41,
+  0x0F00, 0xCFC1, 0xCE81, 0x0E40, 0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0,
+  0x0880, 0xC841, 0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+  0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41, 0x1400, 0xD4C1,
+  0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641, 0xD201, 0x12C0, 0x1380, 0xD341,
+  0x1100, 0xD1C1, 0xD081, 0x1040, 0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1,
+  0xF281, 0x3240, 0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+  0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41, 0xFA01, 0x3AC0,
+  0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840, 0x2800, 0xE8C1, 0xE981, 0x2940,
+  0xEB01, 0x2BC0, 0x2A80, 0xEA41, 0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1,
+  0xEC81, 0x2C40, 0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+  0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041, 0xA001, 0x60C0,
+  0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240, 0x6600, 0xA6C1, 0xA781, 0x6740,
+  0xA501, 0x65C0, 0x6480, 0xA441, 0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0,
+  0x6E80, 0xAE41, 0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+  0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41, 0xBE01, 0x7EC0,
+  0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40, 0xB401, 0x74C0, 0x7580, 0xB541,
+  0x7700, 0xB7C1, 0xB681, 0x7640, 0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0,
+  0x7080, 0xB041, 0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+  0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440, 0x9C01, 0x5CC0,
+  0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40, 0x5A00, 0x9AC1, 0x9B81, 0x5B40,
+  0x9901, 0x59C0, 0x5880, 0x9841, 0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1,
+  0x8A81, 0x4A40, 0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+  0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641, 0x8201, 0x42C0,
+  0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U16 Modbus_CRC(const U8 * pData, U32 count)
+{
+  U32 crc = 0xFFFF;
+
+  while (0 != count--)
+  {
+    crc = (crc >> 8) ^ Modbus_CRCTable[(crc ^ *pData++) & 0xFF];
+  }
+  return (U16)crc;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Big endian fields of the PDU */
+
+static U32 modbus_Get16(const U8 * pData)
+{
+  return ((U32)pData[0] << 8) | pData[1];
+}
+
+static void modbus_Put16(U8 * pData, U32 value)
+{
+  pData[0] = (U8)(value >> 8);
+  pData[1] = (U8)value;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void modbus_CopyBits(U8 * pTo, U32 to, const U8 * pFrom, U32 from, U32 count)
+{
+  U32 i, bit;
+
+  for (i = 0; i < count; i++, to++, from++)
+  {
+    bit = 1U << (to & 7);
+    if (0 != (pFrom[from >> 3] & (1U << (from & 7)))) pTo[to >> 3] |= bit;
+    else                                              pTo[to >> 3] &= ~bit;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The range that holds all the addresses, NULL if there is none or it can not be written */
+
+static const Modbus_Range * modbus_Find(const Modbus_Map * pMap, U32 table, U32 address,
+                                        U32 count, U32 write)
+{
+  const Modbus_Range * pRange = pMap->pRanges;
+  U32 i;
+
+  for (i = 0; i < pMap->Ranges; i++, pRange++)
+  {
+    if ((table == pRange->Table) && (address >= pRange->Start) &&
+        (address + count <= (U32)pRange->Start + pRange->Count))
+    {
+      return ((FALSE != write) && (0 != (pRange->Flags & MODBUS_READ_ONLY))) ? NULL : pRange;
+    }
+  }
+  return NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 modbus_Access(const Modbus_Range * pRange, U32 write, U32 address, U32 count)
+{
+  if (NULL == pRange->pAccess) return 0;
+  return pRange->pAccess(pRange, write, address - pRange->Start, count, pRange->pContext);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 modbus_Exception(U8 * pReply, U32 function, U32 code)
+{
+  pReply[0] = (U8)(function | MODBUS_EXCEPTION);
+  pReply[1] = (U8)code;
+  return 2;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Functions 1 to 4 */
+
+static U32 modbus_Read(const Modbus_Map * pMap, const U8 * pRequest, U32 length, U8 * pReply)
+{
+  const Modbus_Range * pRange;
+  U32 function = pRequest[0], address, count, bits, table, bytes, exception, i;
+  U16 * pRegisters;
+
+  bits    = (MODBUS_READ_COILS == function) || (MODBUS_READ_DISCRETE_INPUTS == function);
+  table   = (MODBUS_READ_COILS == function)             ? MODBUS_COILS :
+            (MODBUS_READ_DISCRETE_INPUTS == function)   ? MODBUS_DISCRETE_INPUTS :
+            (MODBUS_READ_HOLDING_REGISTERS == function) ? MODBUS_HOLDING_REGISTERS :
+                                                          MODBUS_INPUT_REGISTERS;
+  if (5 != length) return modbus_Exception(pReply, function, MODBUS_ILLEGAL_DATA_VALUE);
+
+  address = modbus_Get16(&pRequest[1]);
+  count   = modbus_Get16(&pRequest[3]);
+  if ((0 == count) || ((bits ? MODBUS_READ_BITS : MODBUS_READ_REGISTERS) < count))
+  {
+    return modbus_Exception(pReply, function, MODBUS_ILLEGAL_DATA_VALUE);
+  }
+
+  pRange = modbus_Find(pMap, table, address, count, FALSE);
+  if (NULL == pRange) return modbus_Exception(pReply, function, MODBUS_ILLEGAL_DATA_ADDRESS);
+
+  exception = modbus_Access(pRange, FALSE, address, count);
+  if (0 != exception) return modbus_Exception(pReply, function, exception);
+
+  bytes = bits ? (count + 7) / 8 : 2 * count;
+  pReply[0] = (U8)function;
+  pReply[1] = (U8)bytes;
+
+  if (bits)
+  {
+    memset(&pReply[2], 0, bytes);
+    modbus_CopyBits(&pReply[2], 0, (const U8 *)pRange->pData, address - pRange->Start, count);
+  }
+  else
+  {
+    pRegisters = (U16 *)pRange->pData + (address - pRange->Start);
+    for (i = 0; i < count; i++) modbus_Put16(&pReply[2 + 2 * i], pRegisters[i]);
+  }
+
+  return 2 + bytes;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Functions 5, 6, 15 and 16. The data is checked and stored before the access function is told;
+   the reply to a write echoes the request, up to the quantity for the multiple writes.           */
+
+static U32 modbus_Write(const Modbus_Map * pMap, const U8 * pRequest, U32 length, U8 * pReply)
+{
+  const Modbus_Range * pRange;
+  U32 function = pRequest[0], address, count, value, bits, single, bytes, exception, i;
+  U16 * pRegisters;
+  U8 coil;
+
+  bits   = (MODBUS_WRITE_SINGLE_COIL == function) || (MODBUS_WRITE_MULTIPLE_COILS == function);
+  single = (MODBUS_WRITE_SINGLE_COIL == function) || (MODBUS_WRITE_SINGLE_REGISTER == function);
+
+  if ((single ? 5 : 6) > length)
+  {
+    return modbus_Exception(pReply, function, MODBUS_ILLEGAL_DATA_VALUE);
+  }
+
+  address = modbus_Get16(&pRequest[1]);
+  value   = modbus_Get16(&pRequest[3]);
+  if (single)
+  {
+    count = 1;
+    if ((5 != length) || (bits && (MODBUS_COIL_ON != value) && (0 != value)))
+    {
+      return modbus_Exception(pReply, function, MODBUS_ILLEGAL_DATA_VALUE);
+    }
+  }
+  else
+  {
+    count = value;
+    bytes = bits ? (count + 7) / 8 : 2 * count;
+    if ((0 == count) || ((bits ? MODBUS_WRITE_BITS : MODBUS_WRITE_REGISTERS) < count) ||
+        (bytes != pRequest[5]) || (6 + bytes != length))
+    {
+      return modbus_Exception(pReply, function, MODBUS_ILLEGAL_DATA_VALUE);
+    }
+  }
+
+  pRange = modbus_Find(pMap, bits ? MODBUS_COILS : MODBUS_HOLDING_REGISTERS, address, count, TRUE);
+  if (NULL == pRange) return modbus_Exception(pReply, function, MODBUS_ILLEGAL_DATA_ADDRESS);
+
+  pRegisters = (U16 *)pRange->pData + (address - pRange->Start);
+  if (bits && single)
+  {
+    coil = (0 != value);
+    modbus_CopyBits((U8 *)pRange->pData, address - pRange->Start, &coil, 0, 1);
+  }
+  else if (bits)
+  {
+    modbus_CopyBits((U8 *)pRange->pData, address - pRange->Start, &pRequest[6], 0, count);
+  }
+  else if (single)
+  {
+    pRegisters[0] = (U16)value;
+  }
+  else
+  {
+    for (i = 0; i < count; i++) pRegisters[i] = (U16)modbus_Get16(&pRequest[6 + 2 * i]);
+  }
+
+  exception = modbus_Access(pRange, TRUE, address, count);
+  if (0 != exception) return modbus_Exception(pReply, function, exception);
+
+  memcpy(pReply, pRequest, 5);
+  return 5;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Modbus_Process(const Modbus_Map * pMap, const U8 * pRequest, U32 length, U8 * pReply)
+{
+  U32 function = pRequest[0];
+
+  switch (function)
+  {
+    case MODBUS_READ_COILS:
+    case MODBUS_READ_DISCRETE_INPUTS:
+    case MODBUS_READ_HOLDING_REGISTERS:
+    case MODBUS_READ_INPUT_REGISTERS:
+      return modbus_Read(pMap, pRequest, length, pReply);
+
+    case MODBUS_WRITE_SINGLE_COIL:
+    case MODBUS_WRITE_SINGLE_REGISTER:
+    case MODBUS_WRITE_MULTIPLE_COILS:
+    case MODBUS_WRITE_MULTIPLE_REGISTERS:
+      return modbus_Write(pMap, pRequest, length, pReply);
+
+    case MODBUS_DIAGNOSTICS:
+      if ((3 > length) || (0 != modbus_Get16(&pRequest[1])))
+      {
+        return modbus_Exception(pReply, function, MODBUS_ILLEGAL_FUNCTION);
+      }
+      memcpy(pReply, pRequest, length);
+      return length;
+
+    default:
+      return modbus_Exception(pReply, function, MODBUS_ILLEGAL_FUNCTION);
+  }
+}
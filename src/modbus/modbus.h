@@ -0,0 +1,78 @@
+#ifndef __MODBUS_H__
+#define __MODBUS_H__
+
+#include "types.h"
+
+/* Modbus slave, application layer. The device's data is described by a table of ranges: each
+   range maps a run of addresses of one of the four data tables onto variables of the
+   application, a request is served from the range that holds all of its addresses. Nothing here
+   touches the hardware (modbus.c), the RTU framing and the serial line are in rtu.c.
+
+   Registers are kept as U16 in the CPU's byte order, bits (coils and discrete inputs) packed
+   eight per byte, the lowest address in bit 0.                                                   */
+
+/* Protocol data unit: function code and up to 252 bytes */
+#define MODBUS_PDU_SIZE                    (253)
+
+/* Function codes */
+#define MODBUS_READ_COILS                  (0x01)
+#define MODBUS_READ_DISCRETE_INPUTS        (0x02)
+#define MODBUS_READ_HOLDING_REGISTERS      (0x03)
+#define MODBUS_READ_INPUT_REGISTERS        (0x04)
+#define MODBUS_WRITE_SINGLE_COIL           (0x05)
+#define MODBUS_WRITE_SINGLE_REGISTER       (0x06)
+#define MODBUS_DIAGNOSTICS                 (0x08)   /* Sub-function 0, return query data only  */
+#define MODBUS_WRITE_MULTIPLE_COILS        (0x0F)
+#define MODBUS_WRITE_MULTIPLE_REGISTERS    (0x10)
+
+/* Exception codes, the reply to a refused request is the function code | MODBUS_EXCEPTION */
+#define MODBUS_EXCEPTION                   (0x80)
+#define MODBUS_ILLEGAL_FUNCTION            (0x01)
+#define MODBUS_ILLEGAL_DATA_ADDRESS        (0x02)
+#define MODBUS_ILLEGAL_DATA_VALUE          (0x03)
+#define MODBUS_DEVICE_FAILURE              (0x04)
+
+/* Range flags */
+#define MODBUS_READ_ONLY                   (0x01)   /* Coils or holding registers not written  */
+
+typedef enum
+{
+  MODBUS_COILS,
+  MODBUS_DISCRETE_INPUTS,
+  MODBUS_INPUT_REGISTERS,
+  MODBUS_HOLDING_REGISTERS
+} Modbus_Table;
+
+struct Modbus_Range_s;
+
+/* Called before the data of a read is taken (write FALSE), so that it can be refreshed, and after
+   the data of a write is stored. The addresses are offsets in the range. In the context of the
+   transport (the USART interrupt for RTU), a non-zero return is sent as the exception code.      */
+typedef U32 (*Modbus_Access)(const struct Modbus_Range_s * pRange, U32 write, U32 offset,
+                             U32 count, void * pContext);
+
+typedef struct Modbus_Range_s
+{
+  U8            Table;                     /* Modbus_Table                                        */
+  U8            Flags;
+  U16           Start;                     /* First address                                       */
+  U16           Count;                     /* Addresses                                           */
+  void *        pData;                     /* U16 per register, U8 per 8 bits                     */
+  Modbus_Access pAccess;                   /* May be NULL                                         */
+  void *        pContext;
+} Modbus_Range;
+
+typedef struct
+{
+  const Modbus_Range * pRanges;
+  U32                  Ranges;
+} Modbus_Map;
+
+/* CRC-16 of the RTU frames (polynomial 0xA001 reflected, initial value 0xFFFF), by table */
+U16 Modbus_CRC(const U8 * pData, U32 count);
+
+/* Serves a request PDU of 'length' bytes into pReply (MODBUS_PDU_SIZE bytes), returns the length
+   of the reply, exceptions included. A broadcast is served the same way, its reply not sent.     */
+U32 Modbus_Process(const Modbus_Map * pMap, const U8 * pRequest, U32 length, U8 * pReply);
+
+#endif /* __MODBUS_H__ */
@@ -0,0 +1,264 @@
+#include <string.h>
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "gpio.h"
+#include "dwt.h"
+#include "irq.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "dma.h"
+#include "modbus.h"
+#include "rtu.h"
+
+/* Shortest frame: address, function code and CRC */
+#define RTU_FRAME_MIN                      (4)
+
+/* One more byte than a frame: a full count means the frame was too long */
+#define RTU_RX_SIZE                        (RTU_FRAME_SIZE + 1)
+
+#define RTU_ERRORS                         (USART_SR_PE | USART_SR_FE | USART_SR_NE | USART_SR_ORE)
+
+/* Peripheral to memory and back, bytes */
+#define RTU_DMA_RX_CCR                     (DMA_CCR_PL_1 | DMA_CCR_MINC | DMA_CCR_EN)
+#define RTU_DMA_TX_CCR                     (DMA_CCR_PL_1 | DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_EN)
+
+typedef struct
+{
+  RTU_Config     Config;
+  U8             Rx[RTU_RX_SIZE];
+  U8             Tx[RTU_FRAME_SIZE];
+  U32            Claimed;                  /* Both DMA channels                                   */
+  RTU_Stats      Stats;
+  Clock_Notifier Notifier;
+} RTU_State;
+
+static RTU_State RTU_This;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void rtu_SetBaudrate(U32 baudrate)
+{
+  USART1->BRR = (Clock_GetPCLK2() + baudrate / 2) / baudrate;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void rtu_ClockChanged(U32 oldHz, U32 newHz, void * pContext)
+{
+  rtu_SetBaudrate(RTU_This.Config.Baudrate);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void rtu_Listen(RTU_State * pThis)
+{
+  DMA1_Channel5->CCR   = 0;
+  DMA1_Channel5->CNDTR = RTU_RX_SIZE;
+  DMA1_Channel5->CCR   = RTU_DMA_RX_CCR;
+  USART1->CR1 |= USART_CR1_RE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The receiver stays off until the last stop bit is out (TC) */
+
+static void rtu_Send(RTU_State * pThis, U32 length)
+{
+  RTU_Config * pConfig = &pThis->Config;
+  U32 crc;
+
+  pThis->Tx[0] = pConfig->Address;
+  crc = Modbus_CRC(pThis->Tx, length + 1);
+  pThis->Tx[length + 1] = (U8)crc;
+  pThis->Tx[length + 2] = (U8)(crc >> 8);
+
+  if (NULL != pConfig->pDE) GPIO_Hi(pConfig->pDE, pConfig->DEPin);
+  USART1->CR1 &= ~USART_CR1_RE;
+
+  DMA1_Channel4->CCR   = 0;
+  DMA1_Channel4->CNDTR = length + 3;
+  DMA1_Channel4->CCR   = RTU_DMA_TX_CCR;
+
+  USART1->SR   = ~USART_SR_TC;
+  USART1->CR1 |= USART_CR1_TCIE;
+  pThis->Stats.Replies++;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The line went idle after a frame. A broadcast is served without a reply. */
+
+static void rtu_Frame(RTU_State * pThis, U32 sr, U32 start)
+{
+  RTU_Config * pConfig = &pThis->Config;
+  RTU_Stats * pStats = &pThis->Stats;
+  U8 * pFrame = pThis->Rx;
+  U32 count = RTU_RX_SIZE - DMA1_Channel5->CNDTR, length = 0;
+
+  DMA1_Channel5->CCR = 0;
+
+  if ((0 != (sr & RTU_ERRORS)) || (RTU_FRAME_MIN > count) || (RTU_FRAME_SIZE < count))
+  {
+    pStats->Errors++;
+  }
+  else if ((pConfig->Address != pFrame[0]) && (RTU_BROADCAST != pFrame[0]))
+  {
+    pStats->Ignored++;
+  }
+  else if (0 != Modbus_CRC(pFrame, count))
+  {
+    pStats->CRCErrors++;
+  }
+  else
+  {
+    pStats->Requests++;
+    length = Modbus_Process(pConfig->pMap, &pFrame[1], count - 3, &pThis->Tx[1]);
+    if ((0 != length) && (0 != (pThis->Tx[1] & MODBUS_EXCEPTION))) pStats->Exceptions++;
+    if (RTU_BROADCAST == pFrame[0]) length = 0;
+  }
+
+  if (0 == length)
+  {
+    rtu_Listen(pThis);
+    return;
+  }
+
+  rtu_Send(pThis, length);
+  pStats->Cycles = DWT_Cycles() - start;
+  if (pStats->Cycles > pStats->MaxCycles) pStats->MaxCycles = pStats->Cycles;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Reading SR then DR clears IDLE and the error flags. DR holds no data then: the DMA has taken
+   every byte and the line is quiet.                                                              */
+
+static void rtu_IRQ(RTU_State * pThis)
+{
+  U32 start = DWT_Cycles(), sr = USART1->SR;
+
+  if ((0 != (sr & USART_SR_TC)) && (0 != (USART1->CR1 & USART_CR1_TCIE)))
+  {
+    USART1->CR1 &= ~USART_CR1_TCIE;
+    DMA1_Channel4->CCR = 0;
+    if (NULL != pThis->Config.pDE) GPIO_Lo(pThis->Config.pDE, pThis->Config.DEPin);
+    rtu_Listen(pThis);
+  }
+
+  if (0 != (sr & USART_SR_IDLE))
+  {
+    (void)USART1->DR;
+    rtu_Frame(pThis, sr, start);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The channels run without their interrupts, the ends of the frames come from the USART */
+
+static U32 rtu_Claim(RTU_State * pThis)
+{
+  if (0 == DMA_Claim(DMA_REQ_USART1_TX, IRQ_PRIORITY_MODBUS, NULL, pThis)) return FALSE;
+  if (0 == DMA_Claim(DMA_REQ_USART1_RX, IRQ_PRIORITY_MODBUS, NULL, pThis))
+  {
+    DMA_Release(DMA_REQ_USART1_TX);
+    return FALSE;
+  }
+  pThis->Claimed = TRUE;
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 RTU_Init(const RTU_Config * pConfig)
+{
+  RTU_State * pThis = &RTU_This;
+
+  if ((NULL == pConfig) || (NULL == pConfig->pMap) || (0 == pConfig->Baudrate)) return FALSE;
+  if ((RTU_BROADCAST == pConfig->Address) || (247 < pConfig->Address)) return FALSE;
+  if ((RTU_PARITY_NONE < pConfig->Parity) || (15 < pConfig->DEPin)) return FALSE;
+  if (16 > Clock_GetPCLK2() / pConfig->Baudrate) return FALSE;
+
+  RTU_Stop();
+  if (FALSE == rtu_Claim(pThis)) return FALSE;
+
+  memcpy(&pThis->Config, pConfig, sizeof(RTU_Config));
+  memset(&pThis->Stats, 0, sizeof(RTU_Stats));
+  DWT_Init();
+
+  if (NULL != pConfig->pDE)
+  {
+    GPIO_Lo(pConfig->pDE, pConfig->DEPin);
+    GPIO_Init(pConfig->pDE, pConfig->DEPin, GPIO_TYPE_OUT_PP_10MHZ);
+  }
+  GPIO_Hi(GPIOA, 10);
+  GPIO_Init(GPIOA, 10, GPIO_TYPE_IN_PUP_PDN);
+  GPIO_Init(GPIOA, 9, GPIO_TYPE_ALT_PP_10MHZ);
+
+  BITBAND_RCC_APB2ENR(RCC_APB2ENR_USART1EN_Pos) = 1;
+
+  /* 8 data bits and the parity bit, or 8 data bits and two stop bits */
+  USART1->CR1 = 0;
+  USART1->CR2 = (RTU_PARITY_NONE == pConfig->Parity) ? USART_CR2_STOP_1 : 0;
+  USART1->CR3 = USART_CR3_DMAR | USART_CR3_DMAT;
+  rtu_SetBaudrate(pConfig->Baudrate);
+
+  DMA1_Channel4->CCR  = 0;
+  DMA1_Channel4->CPAR = (U32)&USART1->DR;
+  DMA1_Channel4->CMAR = (U32)pThis->Tx;
+  DMA1_Channel5->CCR  = 0;
+  DMA1_Channel5->CPAR = (U32)&USART1->DR;
+  DMA1_Channel5->CMAR = (U32)pThis->Rx;
+
+  IRQ_ATTACH(USART1_IRQn, rtu_IRQ, pThis);
+  NVIC_SetPriority(USART1_IRQn, IRQ_PRIORITY_MODBUS);
+
+  if (NULL == pThis->Notifier.pFunc)
+  {
+    Clock_Register(&pThis->Notifier, rtu_ClockChanged, NULL);
+  }
+
+  switch (pConfig->Parity)
+  {
+    case RTU_PARITY_EVEN: USART1->CR1 = USART_CR1_M | USART_CR1_PCE;                break;
+    case RTU_PARITY_ODD:  USART1->CR1 = USART_CR1_M | USART_CR1_PCE | USART_CR1_PS; break;
+    default:              USART1->CR1 = 0;                                          break;
+  }
+  USART1->CR1 |= USART_CR1_UE | USART_CR1_TE | USART_CR1_IDLEIE;
+  rtu_Listen(pThis);
+  NVIC_EnableIRQ(USART1_IRQn);
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void RTU_Stop(void)
+{
+  if (0 == (RCC->APB2ENR & RCC_APB2ENR_USART1EN)) return;
+
+  NVIC_DisableIRQ(USART1_IRQn);
+  USART1->CR1 = 0;
+  USART1->CR3 = 0;
+  if (FALSE != RTU_This.Claimed)
+  {
+    DMA_Release(DMA_REQ_USART1_TX);
+    DMA_Release(DMA_REQ_USART1_RX);
+    RTU_This.Claimed = FALSE;
+  }
+  if (NULL != RTU_This.Config.pDE) GPIO_Lo(RTU_This.Config.pDE, RTU_This.Config.DEPin);
+  BITBAND_RCC_APB2ENR(RCC_APB2ENR_USART1EN_Pos) = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void RTU_GetStats(RTU_Stats * pStats)
+{
+  U32 primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(pStats, &RTU_This.Stats, sizeof(RTU_Stats));
+  __set_PRIMASK(primask);
+}
@@ -0,0 +1,62 @@
+#ifndef __RTU_H__
+#define __RTU_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "modbus.h"
+
+/* Modbus RTU slave on USART1 (PA9 TX, PA10 RX). DMA1 channel 5 receives a whole frame without an
+   interrupt per byte; the end of the frame is the IDLE flag of the USART, raised by hardware once
+   the line has been quiet for one character. That interrupt checks the address and the CRC,
+   serves the request with Modbus_Process() and hands the reply to DMA1 channel 4, so a reply
+   starts one character time plus the processing time after the request, with no software timer.
+
+   The standard asks for 3.5 characters of silence between frames; the reply comes sooner, which
+   the masters waiting for it accept. A pause of more than one character inside a frame splits
+   it, the parts fail their CRC.
+
+   The register map is read and written from the USART interrupt (IRQ_PRIORITY_MODBUS). The
+   receiver is off while a reply is sent, so an RS-485 transceiver with its receiver always
+   enabled does not echo the reply back. Both channels are claimed from the DMA service: channel 5
+   is also the one of the logic analyzer, RTU_Init() fails while it holds it. A clock change
+   recomputes the baud rate.                                                                      */
+
+/* Longest RTU frame: address, PDU and CRC */
+#define RTU_FRAME_SIZE                     (1 + MODBUS_PDU_SIZE + 2)
+
+#define RTU_BROADCAST                      (0)
+
+typedef enum
+{
+  RTU_PARITY_EVEN,                         /* The default of the standard                         */
+  RTU_PARITY_ODD,
+  RTU_PARITY_NONE                          /* Two stop bits                                       */
+} RTU_Parity;
+
+typedef struct
+{
+  U32                Baudrate;
+  U8                 Address;              /* 1..247                                              */
+  U8                 Parity;               /* RTU_Parity                                          */
+  GPIO_TypeDef *     pDE;                  /* RS-485 driver enable, high while sending, may be    */
+  U8                 DEPin;                /* NULL                                                */
+  const Modbus_Map * pMap;
+} RTU_Config;
+
+typedef struct
+{
+  U32 Requests;                            /* Frames for this slave or broadcast, CRC correct     */
+  U32 Replies;
+  U32 Exceptions;                          /* Replies with an exception code                      */
+  U32 Ignored;                             /* Frames for other slaves                             */
+  U32 CRCErrors;
+  U32 Errors;                              /* Parity, framing, noise, overrun, length             */
+  U32 Cycles;                              /* Last reply, from the IDLE interrupt to its start    */
+  U32 MaxCycles;
+} RTU_Stats;
+
+U32  RTU_Init(const RTU_Config * pConfig);
+void RTU_Stop(void);
+void RTU_GetStats(RTU_Stats * pStats);
+
+#endif /* __RTU_H__ */
@@ -0,0 +1,91 @@
+#include "types.h"
+#include "stm32f1xx.h"
+#include "modbus.h"
+#include "rtu.h"
+#include "slave.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define SLAVE_COILS                        (16)
+#define SLAVE_INPUTS                       (16)
+#define SLAVE_INPUT_REGISTERS              (15)
+#define SLAVE_HOLDING_REGISTERS            (32)
+
+static U8  Slave_Coils[SLAVE_COILS / 8];
+static U8  Slave_Inputs[SLAVE_INPUTS / 8];
+static U16 Slave_InputRegisters[SLAVE_INPUT_REGISTERS];
+static U16 Slave_HoldingRegisters[SLAVE_HOLDING_REGISTERS];
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 slave_Pins(const Modbus_Range * pRange, U32 write, U32 offset, U32 count,
+                      void * pContext)
+{
+  U32 idr = GPIOB->IDR;
+
+  Slave_Inputs[0] = (U8)idr;
+  Slave_Inputs[1] = (U8)(idr >> 8);
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void slave_Put32(U16 * pRegisters, U32 value)
+{
+  pRegisters[0] = (U16)(value >> 16);
+  pRegisters[1] = (U16)value;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 slave_Status(const Modbus_Range * pRange, U32 write, U32 offset, U32 count,
+                        void * pContext)
+{
+  U16 * pRegisters = Slave_InputRegisters;
+  U32 mhz = SystemCoreClock / 1000000;
+  RTU_Stats stats;
+
+  RTU_GetStats(&stats);
+  slave_Put32(&pRegisters[0], stats.Requests);
+  slave_Put32(&pRegisters[2], stats.Replies);
+  slave_Put32(&pRegisters[4], stats.Exceptions);
+  slave_Put32(&pRegisters[6], stats.CRCErrors);
+  slave_Put32(&pRegisters[8], stats.Errors);
+  pRegisters[10] = (U16)(stats.Cycles / mhz);
+  pRegisters[11] = (U16)(stats.MaxCycles / mhz);
+  pRegisters[12] = (U16)mhz;
+  slave_Put32(&pRegisters[13], xTaskGetTickCountFromISR() / configTICK_RATE_HZ);
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static const Modbus_Range Slave_Ranges[] =
+{
+  {MODBUS_COILS, 0, 0, SLAVE_COILS, Slave_Coils, NULL, NULL},
+  {MODBUS_DISCRETE_INPUTS, 0, 0, SLAVE_INPUTS, Slave_Inputs, slave_Pins, NULL},
+  {MODBUS_INPUT_REGISTERS, 0, 0, SLAVE_INPUT_REGISTERS, Slave_InputRegisters, slave_Status, NULL},
+  {MODBUS_HOLDING_REGISTERS, 0, 0, SLAVE_HOLDING_REGISTERS, Slave_HoldingRegisters, NULL, NULL}
+};
+
+static const Modbus_Map Slave_Map =
+{
+  Slave_Ranges, sizeof(Slave_Ranges) / sizeof(Slave_Ranges[0])
+};
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Slave_Start(void)
+{
+  RTU_Config config;
+
+  config.Baudrate = SLAVE_BAUDRATE;
+  config.Address  = SLAVE_ADDRESS;
+  config.Parity   = RTU_PARITY_EVEN;
+  config.pDE      = NULL;
+  config.DEPin    = 0;
+  config.pMap     = &Slave_Map;
+
+  return RTU_Init(&config);
+}
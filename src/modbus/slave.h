@@ -0,0 +1,25 @@
+#ifndef __SLAVE_H__
+#define __SLAVE_H__
+
+#include "types.h"
+
+/* The Modbus device of the board, RTU on USART1 (see rtu.h), 8 data bits and even parity.
+
+   Coils              0..15   Kept, no effect
+   Discrete inputs    0..15   Levels of PB0..PB15
+   Input registers    0..9    Requests, replies, exceptions, CRC errors and line errors of the
+                              slave, 32-bit, the high word first
+                      10, 11  Last and longest turnaround in the firmware, microseconds
+                      12      System clock, MHz
+                      13, 14  Uptime, seconds, 32-bit
+   Holding registers  0..31   Kept, no effect (tools/modbus_rtu.py writes and reads them back)  */
+#ifndef MODBUS_ENABLED
+#define MODBUS_ENABLED                     (1)
+#endif
+
+#define SLAVE_ADDRESS                      (1)
+#define SLAVE_BAUDRATE                     (115200)
+
+U32 Slave_Start(void);
+
+#endif /* __SLAVE_H__ */
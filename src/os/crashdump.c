@@ -0,0 +1,135 @@
+#include "stm32f1xx.h"
+#include "types.h"
+#include "flash.h"
+#include "crashdump.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define CRASHDUMP_RAM                      ((CrashDump_Record *)CRASHDUMP_RAM_ADDRESS)
+#define CRASHDUMP_FLASH                    ((const CrashDump_Record *)CRASHDUMP_FLASH_ADDRESS)
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 crashdump_Checksum(const CrashDump_Record * pRecord)
+{
+  const U32 * pWord = (const U32 *)pRecord;
+  U32 count = (sizeof(CrashDump_Record) - sizeof(U32)) / sizeof(U32);
+  U32 sum = 0;
+
+  while (0 < count--)
+  {
+    sum = ((sum << 1) | (sum >> 31)) + *pWord++;
+  }
+
+  return sum;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 crashdump_IsValid(const CrashDump_Record * pRecord)
+{
+  return ((CRASHDUMP_MAGIC == pRecord->Magic) &&
+          (CRASHDUMP_VERSION == pRecord->Version) &&
+          (sizeof(CrashDump_Record) == pRecord->Size) &&
+          (crashdump_Checksum(pRecord) == pRecord->Checksum));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Enables the configurable faults and moves a record left by the previous run into flash.
+   Must be called before the scheduler starts: the page erase stalls every fetch from flash for
+   about 20 ms, which no task or interrupt could tolerate. Returns TRUE if a record was saved.    */
+
+U32 CrashDump_Init(void)
+{
+  U32 result = FALSE;
+
+  SCB->SHCSR |= (SCB_SHCSR_MEMFAULTENA_Msk | SCB_SHCSR_BUSFAULTENA_Msk | SCB_SHCSR_USGFAULTENA_Msk);
+
+  if (TRUE == crashdump_IsValid(CRASHDUMP_RAM))
+  {
+    FLASH_Unlock();
+    if (TRUE == FLASH_ErasePage(CRASHDUMP_FLASH_ADDRESS))
+    {
+      result = FLASH_Write(CRASHDUMP_FLASH_ADDRESS, CRASHDUMP_RAM, sizeof(CrashDump_Record));
+    }
+    FLASH_Lock();
+  }
+  CRASHDUMP_RAM->Magic = 0;
+
+  return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Called from the fault context: no heap, no printf, no kernel critical sections. The stack
+   pointer is checked before it is dereferenced, so a corrupted PSP does not lock the core up.   */
+
+void CrashDump_Capture(U32 stack[])
+{
+  CrashDump_Record * pRecord = CRASHDUMP_RAM;
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  const char * pName;
+  U32 address = (U32)stack, i;
+
+  pRecord->Magic   = CRASHDUMP_MAGIC;
+  pRecord->Version = CRASHDUMP_VERSION;
+  pRecord->Size    = sizeof(CrashDump_Record);
+  pRecord->Vector  = (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk);
+  pRecord->SP      = address;
+  pRecord->CFSR    = SCB->CFSR;
+  pRecord->HFSR    = SCB->HFSR;
+  pRecord->MMFAR   = SCB->MMFAR;
+  pRecord->BFAR    = SCB->BFAR;
+  pRecord->SHCSR   = SCB->SHCSR;
+
+  for (i = 0; i < 8 + CRASHDUMP_STACK_WORDS; i++, address += 4)
+  {
+    U32 value = 0;
+
+    if ((SRAM_BASE <= address) && (address < CRASHDUMP_RAM_ADDRESS))
+    {
+      value = stack[i];
+    }
+
+    if (8 > i)
+    {
+      pRecord->Frame[i] = value;
+    }
+    else
+    {
+      pRecord->Stack[i - 8] = value;
+    }
+  }
+
+  pName = (NULL != task) ? pcTaskGetTaskName(task) : "";
+  for (i = 0; (i < CRASHDUMP_TASK_NAME_LEN - 1) && (0 != pName[i]); i++)
+  {
+    pRecord->Task[i] = pName[i];
+  }
+  for (; i < CRASHDUMP_TASK_NAME_LEN; i++)
+  {
+    pRecord->Task[i] = 0;
+  }
+
+  pRecord->TraceCount = Trace_Copy(pRecord->Trace, TRACE_EVENTS);
+
+  pRecord->Checksum = crashdump_Checksum(pRecord);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+const CrashDump_Record * CrashDump_Get(void)
+{
+  return (TRUE == crashdump_IsValid(CRASHDUMP_FLASH)) ? CRASHDUMP_FLASH : NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void CrashDump_Clear(void)
+{
+  FLASH_Unlock();
+  (void)FLASH_ErasePage(CRASHDUMP_FLASH_ADDRESS);
+  FLASH_Lock();
+}
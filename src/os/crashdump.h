@@ -0,0 +1,44 @@
+#ifndef __CRASHDUMP_H__
+#define __CRASHDUMP_H__
+
+#include "types.h"
+#include "trace.h"
+
+/* The record is captured into the last 512 bytes of SRAM, which are excluded from the linker     */
+/* RAM region and so survive a reset. On the next boot it is moved into the last 1 kB flash page  */
+/* (also excluded from the linker ROM region). tools/crashdump.py decodes the flash page.         */
+#define CRASHDUMP_RAM_ADDRESS              (0x20004E00U)
+#define CRASHDUMP_RAM_END                  (0x20005000U)
+#define CRASHDUMP_FLASH_ADDRESS            (0x0800FC00U)
+
+#define CRASHDUMP_MAGIC                    (0x48535243U) /* "CRSH" */
+#define CRASHDUMP_VERSION                  (1U)
+#define CRASHDUMP_STACK_WORDS              (32)
+#define CRASHDUMP_TASK_NAME_LEN            (12)
+
+typedef struct
+{
+  U32        Magic;
+  U16        Version;
+  U16        Size;
+  U32        Vector;                       /* Active exception number                              */
+  U32        Frame[8];                     /* R0, R1, R2, R3, R12, LR, PC, PSR                     */
+  U32        SP;                           /* Address of the exception frame                       */
+  U32        CFSR;
+  U32        HFSR;
+  U32        MMFAR;
+  U32        BFAR;
+  U32        SHCSR;
+  char       Task[CRASHDUMP_TASK_NAME_LEN];
+  U32        Stack[CRASHDUMP_STACK_WORDS]; /* Stack contents just above the exception frame        */
+  U32        TraceCount;
+  Trace_Item Trace[TRACE_EVENTS];          /* The oldest event first                               */
+  U32        Checksum;
+} CrashDump_Record;
+
+U32                      CrashDump_Init(void);
+void                     CrashDump_Capture(U32 stack[]);
+const CrashDump_Record * CrashDump_Get(void);
+void                     CrashDump_Clear(void);
+
+#endif /* __CRASHDUMP_H__ */
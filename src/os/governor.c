@@ -0,0 +1,101 @@
+#include "stm32f1xx.h"
+#include "types.h"
+#include "clock.h"
+#include "periodic.h"
+#include "governor.h"
+
+static PeriodicTask Governor_Task;
+static volatile U32 Governor_IdleTicks = 0;
+static U32 Governor_Load = 0;
+static volatile Clock_Level Governor_Floor = CLOCK_LEVEL_8MHZ;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Lowest level that runs the measured load within the target. The load scales with the inverse of
+   the clock, the memory wait states are not taken into account.                                  */
+
+static Clock_Level governor_Select(U32 load)
+{
+  U32 mhz = Clock_GetHz(Clock_Get()) / 1000000;
+  U32 level;
+
+  for (level = 0; level < (CLOCK_LEVELS - 1); level++)
+  {
+    if ((load * mhz) <= (GOVERNOR_TARGET * (Clock_GetHz((Clock_Level)level) / 1000000))) break;
+  }
+  if (level < Governor_Floor) level = Governor_Floor;
+
+  return (Clock_Level)level;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void governor_Run(void * pContext)
+{
+  Clock_Level level;
+  U32 idle;
+
+  taskENTER_CRITICAL();
+  idle = Governor_IdleTicks;
+  Governor_IdleTicks = 0;
+  taskEXIT_CRITICAL();
+
+  if (GOVERNOR_PERIOD < idle) idle = GOVERNOR_PERIOD;
+  Governor_Load = 100 - (idle * 100 / GOVERNOR_PERIOD);
+
+  level = governor_Select(Governor_Load);
+  if ((level < Clock_Get()) || (GOVERNOR_UP < Governor_Load))
+  {
+    Clock_Set(level);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Governor_Start(UBaseType_t priority)
+{
+  PeriodicTask_Create
+  (
+    &Governor_Task,
+    "Governor",
+    configMINIMAL_STACK_SIZE,
+    priority,
+    governor_Run,
+    NULL,
+    GOVERNOR_PERIOD,
+    0
+  );
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Called from vApplicationTickHook(), in the SysTick interrupt. The current task is the one that
+   was interrupted, so this is a 1 kHz statistical sample of the Idle time.                       */
+
+void Governor_TickHook(void)
+{
+  if (xTaskGetIdleTaskHandle() == xTaskGetCurrentTaskHandle())
+  {
+    Governor_IdleTicks++;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Lowest level the governor may select, for a peripheral that needs a given clock (USB). The
+   clock is raised at once if it is below.                                                        */
+
+void Governor_SetFloor(Clock_Level level)
+{
+  Governor_Floor = level;
+  if (Clock_Get() < level) Clock_Set(level);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Percent of the last period spent outside of the Idle task */
+
+U32 Governor_GetLoad(void)
+{
+  return Governor_Load;
+}
@@ -0,0 +1,24 @@
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+
+#include "types.h"
+#include "clock.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Load is sampled every tick (the task interrupted by SysTick is either Idle or not) and the clock
+   is re-evaluated every GOVERNOR_PERIOD ticks:                                                   */
+/*   - the lowest level where the projected load is not above GOVERNOR_TARGET is selected,        */
+/*   - a higher level is only taken when the load goes above GOVERNOR_UP (hysteresis).            */
+#ifndef GOVERNOR_PERIOD
+#define GOVERNOR_PERIOD                    (100)
+#endif
+#define GOVERNOR_TARGET                    (60)
+#define GOVERNOR_UP                        (80)
+
+void Governor_Start(UBaseType_t priority);
+void Governor_TickHook(void);
+U32  Governor_GetLoad(void);
+void Governor_SetFloor(Clock_Level level);
+
+#endif /* __GOVERNOR_H__ */
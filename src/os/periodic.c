@@ -0,0 +1,138 @@
+#include <string.h>
+
+#include "stm32f1xx.h"
+#include "types.h"
+#include "periodic.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Time elapsed since the beginning of the tick 'release' in CPU cycles. The SysTick down counter
+   gives the sub-tick part, so the resolution is one CPU cycle without any extra timer.           */
+
+static U32 periodic_CyclesSince(TickType_t release)
+{
+  U32 load, value;
+  TickType_t ticks;
+
+  taskENTER_CRITICAL();
+  {
+    load  = SysTick->LOAD + 1;
+    value = SysTick->VAL;
+    ticks = xTaskGetTickCount();
+
+    /* The counter has already been reloaded, but the tick is still pending */
+    if (0 != (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk))
+    {
+      value = SysTick->VAL;
+      ticks++;
+    }
+  }
+  taskEXIT_CRITICAL();
+
+  return ((U32)(ticks - release) * load + (load - 1 - value));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 periodic_Bin(U32 cycles)
+{
+  U32 us = cycles / (SystemCoreClock / 1000000);
+  U32 bin = 32 - __CLZ(us);
+
+  if (PERIODIC_HIST_BINS <= bin)
+  {
+    bin = PERIODIC_HIST_BINS - 1;
+  }
+
+  return bin;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void periodic_Record(PeriodicTask * pTask, U32 jitter, U32 response)
+{
+  PeriodicTask_Stats * pStats = &pTask->Stats;
+  U32 deadline = (U32)pTask->Period * (SysTick->LOAD + 1);
+
+  taskENTER_CRITICAL();
+  {
+    pStats->Activations++;
+    if (deadline < response) pStats->Overruns++;
+    if (pStats->JitterMax < jitter) pStats->JitterMax = jitter;
+    if (pStats->ResponseMax < response) pStats->ResponseMax = response;
+    pStats->JitterHist[periodic_Bin(jitter)]++;
+    pStats->ResponseHist[periodic_Bin(response)]++;
+  }
+  taskEXIT_CRITICAL();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void periodic_Task(void * pvParameters)
+{
+  PeriodicTask * pTask = (PeriodicTask *)pvParameters;
+  TickType_t release = pTask->Release;
+  U32 jitter, response;
+
+  if (0 < pTask->Phase)
+  {
+    vTaskDelayUntil(&release, pTask->Phase);
+  }
+
+  while (TRUE)
+  {
+    jitter = periodic_CyclesSince(release);
+    pTask->pFunc(pTask->pContext);
+    response = periodic_CyclesSince(release);
+
+    periodic_Record(pTask, jitter, response);
+
+    /* Releases are derived from the previous release, not from "now", so they do not drift */
+    vTaskDelayUntil(&release, pTask->Period);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+BaseType_t PeriodicTask_Create
+(
+  PeriodicTask *    pTask,
+  const char *      pName,
+  U16               stackSize,
+  UBaseType_t       priority,
+  PeriodicTask_Func pFunc,
+  void *            pContext,
+  TickType_t        period,
+  TickType_t        phase
+)
+{
+  if ((NULL == pTask) || (NULL == pFunc) || (0 == period)) return pdFAIL;
+
+  memset(pTask, 0, sizeof(PeriodicTask));
+  pTask->pFunc    = pFunc;
+  pTask->pContext = pContext;
+  pTask->Period   = period;
+  pTask->Phase    = phase;
+  /* Phase is counted from the moment of creation (tick 0 if the scheduler is not running yet) */
+  pTask->Release  = xTaskGetTickCount();
+
+  return xTaskCreate(periodic_Task, pName, stackSize, pTask, priority, &pTask->Handle);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void PeriodicTask_GetStats(PeriodicTask * pTask, PeriodicTask_Stats * pStats)
+{
+  taskENTER_CRITICAL();
+  memcpy(pStats, &pTask->Stats, sizeof(PeriodicTask_Stats));
+  taskEXIT_CRITICAL();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void PeriodicTask_ResetStats(PeriodicTask * pTask)
+{
+  taskENTER_CRITICAL();
+  memset(&pTask->Stats, 0, sizeof(PeriodicTask_Stats));
+  taskEXIT_CRITICAL();
+}
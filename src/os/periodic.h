@@ -0,0 +1,51 @@
+#ifndef __PERIODIC_H__
+#define __PERIODIC_H__
+
+#include "types.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Histogram bins are powers of two in microseconds:                                              */
+/*   bin 0 - [0..1) us, bin 1 - [1..2) us, bin 2 - [2..4) us, ..., last bin - everything above    */
+#ifndef PERIODIC_HIST_BINS
+#define PERIODIC_HIST_BINS                 (16)
+#endif
+
+typedef void (*PeriodicTask_Func)(void * pContext);
+
+typedef struct
+{
+  U32 Activations;                         /* Number of executed periods                          */
+  U32 Overruns;                            /* Body finished after the next release time           */
+  U32 JitterMax;                           /* Worst release jitter, CPU cycles                    */
+  U32 ResponseMax;                         /* Worst response time (release to completion), cycles */
+  U32 JitterHist[PERIODIC_HIST_BINS];
+  U32 ResponseHist[PERIODIC_HIST_BINS];
+} PeriodicTask_Stats;
+
+typedef struct
+{
+  PeriodicTask_Func  pFunc;
+  void *             pContext;
+  TickType_t         Period;
+  TickType_t         Phase;
+  TaskHandle_t       Handle;
+  TickType_t         Release;
+  PeriodicTask_Stats Stats;
+} PeriodicTask;
+
+BaseType_t PeriodicTask_Create
+(
+  PeriodicTask *    pTask,
+  const char *      pName,
+  U16               stackSize,
+  UBaseType_t       priority,
+  PeriodicTask_Func pFunc,
+  void *            pContext,
+  TickType_t        period,
+  TickType_t        phase
+);
+void PeriodicTask_GetStats(PeriodicTask * pTask, PeriodicTask_Stats * pStats);
+void PeriodicTask_ResetStats(PeriodicTask * pTask);
+
+#endif /* __PERIODIC_H__ */
@@ -0,0 +1,106 @@
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "stackguard.h"
+
+/* DWT_FUNCTION.FUNCTION = 0b0110 - watchpoint on write access, generates a debug event */
+#define STACKGUARD_FUNCTION_WRITE          (0x06U)
+#define STACKGUARD_SIZE                    (1U << STACKGUARD_SIZE_LOG2)
+
+typedef struct
+{
+  volatile U32 COMP;
+  volatile U32 MASK;
+  volatile U32 FUNCTION;
+           U32 RESERVED;
+} StackGuard_Comparator;
+
+#define STACKGUARD_DWT \
+  ((StackGuard_Comparator *)&DWT->COMP0 + STACKGUARD_COMPARATOR)
+
+static U32 StackGuard_Base = 0;
+static const char * StackGuard_pName = NULL;
+
+#if (1 == STACKGUARD_PROFILE)
+static U32 StackGuard_CyclesMin = 0xFFFFFFFF;
+static U32 StackGuard_CyclesMax = 0;
+#endif
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void StackGuard_Init(void)
+{
+  /* Trace must be enabled to access DWT, DebugMonitor catches the watchpoint events */
+  CoreDebug->DEMCR |= (CoreDebug_DEMCR_TRCENA_Msk | CoreDebug_DEMCR_MON_EN_Msk);
+
+  /* Not enough comparators implemented */
+  if (STACKGUARD_COMPARATOR >= (DWT->CTRL >> DWT_CTRL_NUMCOMP_Pos)) return;
+
+  /* Until the first context switch the guard points to the flash alias, it is never written */
+  STACKGUARD_DWT->COMP     = 0;
+  STACKGUARD_DWT->MASK     = STACKGUARD_SIZE_LOG2;
+  STACKGUARD_DWT->FUNCTION = STACKGUARD_FUNCTION_WRITE;
+
+  /* The guard must be able to preempt everything except faults */
+  NVIC_SetPriority(DebugMonitor_IRQn, 0);
+
+#if (1 == STACKGUARD_PROFILE)
+  DWT_Init();
+#endif
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Called by the kernel from traceTASK_SWITCHED_IN(), so this is on the context switch path and
+   runs from SRAM with it. The whole cost is one comparator store, the mask and function are
+   programmed once.                                                                              */
+
+RAMFUNC void StackGuard_Switch(void * pStack, const char * pName)
+{
+#if (1 == STACKGUARD_PROFILE)
+  U32 cycles = DWT_Cycles();
+#endif
+
+  StackGuard_Base = ((U32)pStack + STACKGUARD_SIZE - 1) & ~(STACKGUARD_SIZE - 1);
+  StackGuard_pName = pName;
+  STACKGUARD_DWT->COMP = StackGuard_Base;
+
+#if (1 == STACKGUARD_PROFILE)
+  cycles = DWT_Cycles() - cycles;
+  if (StackGuard_CyclesMin > cycles) StackGuard_CyclesMin = cycles;
+  if (StackGuard_CyclesMax < cycles) StackGuard_CyclesMax = cycles;
+#endif
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Reading DWT_FUNCTION clears the MATCHED flag, so call it once per fault */
+
+U32 StackGuard_IsHit(void)
+{
+  return (0 != (STACKGUARD_DWT->FUNCTION & DWT_FUNCTION_MATCHED_Msk));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+const char * StackGuard_TaskName(void)
+{
+  return StackGuard_pName;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 StackGuard_GuardBase(void)
+{
+  return StackGuard_Base;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#if (1 == STACKGUARD_PROFILE)
+void StackGuard_GetCycles(U32 * pMin, U32 * pMax)
+{
+  *pMin = StackGuard_CyclesMin;
+  *pMax = StackGuard_CyclesMax;
+}
+#endif
@@ -0,0 +1,40 @@
+#ifndef __STACKGUARD_H__
+#define __STACKGUARD_H__
+
+#include "types.h"
+#include "ramfunc.h"
+
+/* The STM32F103x8/xB has no MPU (__MPU_PRESENT == 0), so the guard is a DWT write watchpoint     */
+/* over the lowest 32 bytes of the running task stack. A write into it raises the DebugMonitor    */
+/* exception, which is reported by Fault().                                                       */
+
+/* DWT comparator used for the guard (0..3) */
+#ifndef STACKGUARD_COMPARATOR
+#define STACKGUARD_COMPARATOR              (3)
+#endif
+
+/* Guard size is 2^STACKGUARD_SIZE_LOG2 bytes, the base is aligned to the size */
+#ifndef STACKGUARD_SIZE_LOG2
+#define STACKGUARD_SIZE_LOG2               (5)
+#endif
+
+/* Measure the cycles spent in StackGuard_Switch(), reported by Bench_RamFunc(). On by default
+   when the bench build is selected on the command line (BENCH_ENABLED, bench.h).                 */
+#ifndef STACKGUARD_PROFILE
+#if defined(BENCH_ENABLED)
+#define STACKGUARD_PROFILE                 (BENCH_ENABLED)
+#else
+#define STACKGUARD_PROFILE                 (0)
+#endif
+#endif
+
+void         StackGuard_Init(void);
+RAMFUNC void StackGuard_Switch(void * pStack, const char * pName);
+U32          StackGuard_IsHit(void);
+const char * StackGuard_TaskName(void);
+U32          StackGuard_GuardBase(void);
+#if (1 == STACKGUARD_PROFILE)
+void         StackGuard_GetCycles(U32 * pMin, U32 * pMax);
+#endif
+
+#endif /* __STACKGUARD_H__ */
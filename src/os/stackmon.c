@@ -0,0 +1,144 @@
+#include <stdio.h>
+
+#include "types.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "stackmon.h"
+
+/* tskSTACK_FILL_BYTE (0xA5) as it is seen by the word wide scan */
+#define STACKMON_FILL_WORD                 (0xA5A5A5A5U)
+
+typedef struct
+{
+  void *       pTask;
+  U32 *        pStack;                     /* The lowest address of the stack                      */
+  const char * pName;
+  U16          Size;                       /* Stack size, words                                    */
+  U16          Free;                       /* Untouched words at the bottom of the stack           */
+  U16          Pos;                        /* Scan position inside the current pass                */
+} StackMon_Entry;
+
+static StackMon_Entry StackMon[STACKMON_MAX_TASKS] = {0};
+static U32 StackMon_Current = 0;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Called by the kernel from traceTASK_CREATE() inside the critical section */
+
+void StackMon_TaskCreate(void * pTask, void * pStack, U16 depth, const char * pName)
+{
+  U32 i;
+
+  for (i = 0; i < STACKMON_MAX_TASKS; i++)
+  {
+    if (NULL == StackMon[i].pTask)
+    {
+      StackMon[i].pStack = (U32 *)pStack;
+      StackMon[i].pName  = pName;
+      StackMon[i].Size   = depth;
+      StackMon[i].Free   = depth;
+      StackMon[i].Pos    = 0;
+      StackMon[i].pTask  = pTask;
+      break;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Called by the kernel from traceTASK_DELETE() inside the critical section. The stack itself is
+   freed later by the Idle task, so a scan interrupted by the deletion is still safe.              */
+
+void StackMon_TaskDelete(void * pTask)
+{
+  U32 i;
+
+  for (i = 0; i < STACKMON_MAX_TASKS; i++)
+  {
+    if (pTask == StackMon[i].pTask)
+    {
+      StackMon[i].pTask = NULL;
+      break;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Incremental high-water-mark scan. Each call checks a few words of one task going up from the
+   bottom of the stack. A pass ends at the first overwritten word (the new watermark) or when it
+   reaches the previously known watermark, then the next task is taken.                          */
+
+void StackMon_IdleScan(void)
+{
+  StackMon_Entry * pEntry = &StackMon[StackMon_Current];
+  U32 count = STACKMON_WORDS_PER_IDLE;
+
+  if (NULL != pEntry->pTask)
+  {
+    while ((0 < count--) && (pEntry->Pos < pEntry->Free))
+    {
+      if (STACKMON_FILL_WORD != pEntry->pStack[pEntry->Pos])
+      {
+        pEntry->Free = pEntry->Pos;
+        break;
+      }
+      pEntry->Pos++;
+    }
+
+    if (pEntry->Pos < pEntry->Free) return;
+  }
+
+  pEntry->Pos = 0;
+  StackMon_Current = (StackMon_Current + 1) % STACKMON_MAX_TASKS;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 StackMon_GetInfo(U32 index, StackMon_Info * pInfo)
+{
+  U32 result = FALSE;
+
+  taskENTER_CRITICAL();
+  if ((index < STACKMON_MAX_TASKS) && (NULL != StackMon[index].pTask))
+  {
+    pInfo->pName = StackMon[index].pName;
+    pInfo->Size  = StackMon[index].Size;
+    pInfo->Peak  = StackMon[index].Size - StackMon[index].Free;
+    result = TRUE;
+  }
+  taskEXIT_CRITICAL();
+
+  return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void StackMon_Print(void)
+{
+  StackMon_Info info;
+  U32 i;
+
+  printf("Stack usage (words)\r\n");
+  for (i = 0; i < STACKMON_MAX_TASKS; i++)
+  {
+    if (FALSE == StackMon_GetInfo(i, &info)) continue;
+    printf("  %-10s %4d / %4d\r\n", info.pName, info.Peak, info.Size);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Called by the kernel at the context switch when the stack pointer of the task being switched
+   out is beyond its stack (configCHECK_FOR_STACK_OVERFLOW == 1).                                */
+
+void vApplicationStackOverflowHook(TaskHandle_t xTask, char * pcTaskName)
+{
+  taskDISABLE_INTERRUPTS();
+
+  printf("Stack Overflow\r\n");
+  printf("  Task     = %s\r\n", pcTaskName);
+  printf("  TCB      = 0x%08x\r\n", (U32)xTask);
+
+  while(TRUE) {};
+}
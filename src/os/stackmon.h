@@ -0,0 +1,29 @@
+#ifndef __STACKMON_H__
+#define __STACKMON_H__
+
+#include "types.h"
+
+/* Maximum number of tasks watched by the monitor (the Idle task included) */
+#ifndef STACKMON_MAX_TASKS
+#define STACKMON_MAX_TASKS                 (8)
+#endif
+
+/* Number of stack words checked per one Idle task iteration */
+#ifndef STACKMON_WORDS_PER_IDLE
+#define STACKMON_WORDS_PER_IDLE            (8)
+#endif
+
+typedef struct
+{
+  const char * pName;
+  U16          Size;                       /* Stack size, words                                    */
+  U16          Peak;                       /* Peak usage seen so far, words                        */
+} StackMon_Info;
+
+void StackMon_TaskCreate(void * pTask, void * pStack, U16 depth, const char * pName);
+void StackMon_TaskDelete(void * pTask);
+void StackMon_IdleScan(void);
+U32  StackMon_GetInfo(U32 index, StackMon_Info * pInfo);
+void StackMon_Print(void);
+
+#endif /* __STACKMON_H__ */
@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include "types.h"
+#include "stream.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Stream_Init(Stream * pStream, U8 * pData, U32 size)
+{
+  if ((NULL == pData) || (0 == size) || (0 != (size & (size - 1)))) return FALSE;
+
+  pStream->pData = pData;
+  pStream->Mask  = size - 1;
+  Stream_Reset(pStream);
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Only while neither side is using the stream */
+
+void Stream_Reset(Stream * pStream)
+{
+  pStream->Head = 0;
+  pStream->Tail = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Free space up to the end of the buffer, the rest (if any) is offered by the next call */
+
+U32 Stream_GetWrite(Stream * pStream, U8 ** ppData)
+{
+  U32 head = pStream->Head & pStream->Mask;
+  U32 count = Stream_Space(pStream);
+
+  if (count > pStream->Mask + 1 - head) count = pStream->Mask + 1 - head;
+  *ppData = &pStream->pData[head];
+
+  return count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Stream_Commit(Stream * pStream, U32 count)
+{
+  pStream->Head += count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Stream_GetRead(Stream * pStream, U8 ** ppData)
+{
+  U32 tail = pStream->Tail & pStream->Mask;
+  U32 count = Stream_Count(pStream);
+
+  if (count > pStream->Mask + 1 - tail) count = pStream->Mask + 1 - tail;
+  *ppData = &pStream->pData[tail];
+
+  return count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Stream_Consume(Stream * pStream, U32 count)
+{
+  pStream->Tail += count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Writes what fits, returns the number of bytes written */
+
+U32 Stream_Write(Stream * pStream, const void * pData, U32 count)
+{
+  const U8 * pSource = (const U8 *)pData;
+  U32 done = 0, n;
+  U8 * pBuffer;
+
+  while (done < count)
+  {
+    n = Stream_GetWrite(pStream, &pBuffer);
+    if (0 == n) break;
+    if (n > count - done) n = count - done;
+
+    memcpy(pBuffer, &pSource[done], n);
+    Stream_Commit(pStream, n);
+    done += n;
+  }
+
+  return done;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Stream_Read(Stream * pStream, void * pData, U32 count)
+{
+  U8 * pDestination = (U8 *)pData;
+  U32 done = 0, n;
+  U8 * pBuffer;
+
+  while (done < count)
+  {
+    n = Stream_GetRead(pStream, &pBuffer);
+    if (0 == n) break;
+    if (n > count - done) n = count - done;
+
+    memcpy(&pDestination[done], pBuffer, n);
+    Stream_Consume(pStream, n);
+    done += n;
+  }
+
+  return done;
+}
@@ -0,0 +1,42 @@
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* Byte ring between exactly one writer and one reader, which may be an interrupt and a task. Head
+   and Tail run freely, each side only writes its own index, so no lock is needed on a single
+   core. Reading and writing in place avoids the copy: the writer asks for the contiguous free
+   space (Stream_GetWrite), fills it and commits what it wrote; the reader does the same with
+   Stream_GetRead and Stream_Consume. Stream_Write/Stream_Read are the copying shortcuts.         */
+
+typedef struct
+{
+  U8 *         pData;
+  U32          Mask;                       /* Size - 1, the size is a power of two                */
+  volatile U32 Head;                       /* Bytes ever written                                  */
+  volatile U32 Tail;                       /* Bytes ever read                                     */
+} Stream;
+
+U32  Stream_Init(Stream * pStream, U8 * pData, U32 size);
+void Stream_Reset(Stream * pStream);
+
+U32  Stream_GetWrite(Stream * pStream, U8 ** ppData);
+void Stream_Commit(Stream * pStream, U32 count);
+U32  Stream_GetRead(Stream * pStream, U8 ** ppData);
+void Stream_Consume(Stream * pStream, U32 count);
+
+U32  Stream_Write(Stream * pStream, const void * pData, U32 count);
+U32  Stream_Read(Stream * pStream, void * pData, U32 count);
+
+__STATIC_INLINE U32 Stream_Count(const Stream * pStream)
+{
+  return pStream->Head - pStream->Tail;
+}
+
+__STATIC_INLINE U32 Stream_Space(const Stream * pStream)
+{
+  return pStream->Mask + 1 - (pStream->Head - pStream->Tail);
+}
+
+#endif /* __STREAM_H__ */
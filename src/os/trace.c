@@ -0,0 +1,64 @@
+#include "stm32f1xx.h"
+#include "types.h"
+#include "dwt.h"
+#include "trace.h"
+
+static Trace_Item Trace[TRACE_EVENTS] = {0};
+static U32 Trace_Index = 0;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Trace_Init(void)
+{
+  DWT_Init();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* May be called from tasks, interrupts and the kernel (PendSV), so the slot is claimed with the
+   interrupts masked. This is a few cycles, much less than a kernel critical section.             */
+
+RAMFUNC void Trace_Event(U32 id, U32 arg)
+{
+  U32 primask = __get_PRIMASK();
+  Trace_Item * pItem;
+
+  __disable_irq();
+  pItem = &Trace[Trace_Index++ & (TRACE_EVENTS - 1)];
+  pItem->Time = DWT_Cycles();
+  pItem->Info = (id & 0xFF) | (arg << 8);
+  __set_PRIMASK(primask);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+RAMFUNC void Trace_TaskSwitch(const char * pName)
+{
+  U32 arg = 0, i;
+
+  for (i = 0; (i < 3) && (0 != pName[i]); i++)
+  {
+    arg |= ((U32)(U8)pName[i] << (i * 8));
+  }
+
+  Trace_Event(TRACE_ID_TASK_SWITCH, arg);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Copies the last 'count' events, the oldest first. Returns the number of copied events. */
+
+U32 Trace_Copy(Trace_Item * pItems, U32 count)
+{
+  U32 index = Trace_Index, i;
+
+  if (count > TRACE_EVENTS) count = TRACE_EVENTS;
+  if (count > index) count = index;
+
+  for (i = 0; i < count; i++)
+  {
+    pItems[i] = Trace[(index - count + i) & (TRACE_EVENTS - 1)];
+  }
+
+  return count;
+}
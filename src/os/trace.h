@@ -0,0 +1,28 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "types.h"
+#include "ramfunc.h"
+
+/* Number of the last events kept, must be a power of two */
+#ifndef TRACE_EVENTS
+#define TRACE_EVENTS                       (16)
+#endif
+
+/* Event identifiers. The argument is 24 bits wide.                                               */
+/* TRACE_ID_TASK_SWITCH - the argument holds the first three characters of the task name.         */
+#define TRACE_ID_TASK_SWITCH               (0x01U)
+#define TRACE_ID_USER                      (0x80U)
+
+typedef struct
+{
+  U32 Time;                                /* DWT cycle counter                                    */
+  U32 Info;                                /* [7:0] - event id, [31:8] - argument                  */
+} Trace_Item;
+
+void Trace_Init(void);
+RAMFUNC void Trace_Event(U32 id, U32 arg);
+RAMFUNC void Trace_TaskSwitch(const char * pName);
+U32  Trace_Copy(Trace_Item * pItems, U32 count);
+
+#endif /* __TRACE_H__ */
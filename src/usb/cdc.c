@@ -0,0 +1,117 @@
+#include <string.h>
+
+#include "types.h"
+#include "usb.h"
+#include "usbpipe.h"
+#include "cdc.h"
+
+typedef struct
+{
+  USB_Pipe       Pipe;
+  U32            Interface;
+  volatile U32   Lines;                    /* CDC_LINE_DTR, CDC_LINE_RTS                          */
+  CDC_LineCoding Coding;
+  U8             Rx[CDC_RX_SIZE];
+  U8             Tx[CDC_TX_SIZE];
+} CDC_State;
+
+static CDC_State CDC_This;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 CDC_Init(U32 interface, U32 in, U32 out)
+{
+  CDC_State * pThis = &CDC_This;
+
+  pThis->Interface       = interface;
+  pThis->Lines           = 0;
+  pThis->Coding.Baud     = 115200;
+  pThis->Coding.StopBits = 0;
+  pThis->Coding.Parity   = 0;
+  pThis->Coding.DataBits = 8;
+
+  return USB_PipeInit(&pThis->Pipe, in, out, pThis->Rx, CDC_RX_SIZE, pThis->Tx, CDC_TX_SIZE);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+USB_Pipe * CDC_Pipe(void)
+{
+  return &CDC_This.Pipe;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 CDC_IsOpen(void)
+{
+  return (0 != (CDC_This.Lines & CDC_LINE_DTR));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void CDC_GetLineCoding(CDC_LineCoding * pCoding)
+{
+  U32 primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(pCoding, &CDC_This.Coding, sizeof(CDC_LineCoding));
+  __set_PRIMASK(primask);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The line coding travels as dwDTERate (4 bytes), bCharFormat, bParityType and bDataBits */
+
+U32 CDC_Request(const USB_Setup * pSetup, U8 * pBuffer, const U8 ** ppData, U32 * pLength,
+                void * pContext)
+{
+  CDC_State * pThis = &CDC_This;
+  CDC_LineCoding * pCoding = &pThis->Coding;
+
+  if ((USB_REQ_CLASS | USB_REQ_INTERFACE) !=
+      (pSetup->bmRequestType & (USB_REQ_TYPE | USB_REQ_RECIPIENT)))
+  {
+    return FALSE;
+  }
+  if ((pSetup->wIndex & 0xFF) != pThis->Interface) return FALSE;
+
+  switch (pSetup->bRequest)
+  {
+    case CDC_SET_LINE_CODING:
+      if (7 > *pLength) return FALSE;
+      pCoding->Baud     = pBuffer[0] | ((U32)pBuffer[1] << 8) | ((U32)pBuffer[2] << 16) |
+                          ((U32)pBuffer[3] << 24);
+      pCoding->StopBits = pBuffer[4];
+      pCoding->Parity   = pBuffer[5];
+      pCoding->DataBits = pBuffer[6];
+      return TRUE;
+
+    case CDC_GET_LINE_CODING:
+      pBuffer[0] = (U8)pCoding->Baud;
+      pBuffer[1] = (U8)(pCoding->Baud >> 8);
+      pBuffer[2] = (U8)(pCoding->Baud >> 16);
+      pBuffer[3] = (U8)(pCoding->Baud >> 24);
+      pBuffer[4] = pCoding->StopBits;
+      pBuffer[5] = pCoding->Parity;
+      pBuffer[6] = pCoding->DataBits;
+      *pLength = 7;
+      return TRUE;
+
+    case CDC_SET_CONTROL_LINE_STATE:
+      pThis->Lines = pSetup->wValue & (CDC_LINE_DTR | CDC_LINE_RTS);
+      return TRUE;
+
+    case CDC_SEND_BREAK:
+      return TRUE;
+
+    default:
+      return FALSE;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void CDC_Event(USB_Event event, void * pContext)
+{
+  if (USB_EVENT_RESET == event) CDC_This.Lines = 0;
+}
@@ -0,0 +1,42 @@
+#ifndef __CDC_H__
+#define __CDC_H__
+
+#include "types.h"
+#include "usb.h"
+#include "usbpipe.h"
+
+/* CDC-ACM: the data interface is a pipe, seen by the host as a serial port. There is no UART
+   behind it, the line coding is only recorded. DTR tells whether a terminal has the port open.  */
+
+#define CDC_RX_SIZE                        (512)
+#define CDC_TX_SIZE                        (512)
+
+/* Class requests */
+#define CDC_SET_LINE_CODING                (0x20)
+#define CDC_GET_LINE_CODING                (0x21)
+#define CDC_SET_CONTROL_LINE_STATE         (0x22)
+#define CDC_SEND_BREAK                     (0x23)
+
+#define CDC_LINE_DTR                       (0x01)
+#define CDC_LINE_RTS                       (0x02)
+
+typedef struct
+{
+  U32 Baud;
+  U8  StopBits;                            /* 0 - 1, 1 - 1.5, 2 - 2                               */
+  U8  Parity;                              /* 0 - none, 1 - odd, 2 - even, 3 - mark, 4 - space    */
+  U8  DataBits;
+} CDC_LineCoding;
+
+/* 'interface' is the communication interface the class requests are addressed to */
+U32        CDC_Init(U32 interface, U32 in, U32 out);
+USB_Pipe * CDC_Pipe(void);
+U32        CDC_IsOpen(void);
+void       CDC_GetLineCoding(CDC_LineCoding * pCoding);
+
+/* USB_Function members */
+U32        CDC_Request(const USB_Setup * pSetup, U8 * pBuffer, const U8 ** ppData, U32 * pLength,
+                       void * pContext);
+void       CDC_Event(USB_Event event, void * pContext);
+
+#endif /* __CDC_H__ */
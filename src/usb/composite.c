@@ -0,0 +1,102 @@
+#include <stdio.h>
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "uniquedevid.h"
+#include "usb.h"
+#include "cdc.h"
+#include "vendor.h"
+#include "composite.h"
+
+#define COMPOSITE_EP0_SIZE                 (32)
+#define COMPOSITE_CONFIG_SIZE              (98)
+
+static const U8 Composite_Device[] =
+{
+  18, USB_DESC_DEVICE, USB_LE16(0x0200),
+  0xEF, 0x02, 0x01,                        /* Miscellaneous, interface association                */
+  COMPOSITE_EP0_SIZE,
+  USB_LE16(COMPOSITE_VID), USB_LE16(COMPOSITE_PID), USB_LE16(0x0100),
+  1, 2, 3,                                 /* Manufacturer, product, serial number                */
+  1
+};
+
+static const U8 Composite_Configuration[COMPOSITE_CONFIG_SIZE] =
+{
+  9, USB_DESC_CONFIGURATION, USB_LE16(COMPOSITE_CONFIG_SIZE), 3, 1, 0,
+  0x80, 50,                                /* Bus powered, 100 mA                                 */
+
+  /* CDC-ACM */
+  8, USB_DESC_IAD, 0, 2, 0x02, 0x02, 0x01, 0,
+  9, USB_DESC_INTERFACE, 0, 0, 1, 0x02, 0x02, 0x01, 4,
+  5, USB_DESC_CS_INTERFACE, 0x00, USB_LE16(0x0110),   /* Header, CDC 1.10                         */
+  5, USB_DESC_CS_INTERFACE, 0x01, 0x00, 1,            /* Call management, no calls                */
+  4, USB_DESC_CS_INTERFACE, 0x02, 0x02,               /* ACM, line coding and line state          */
+  5, USB_DESC_CS_INTERFACE, 0x06, 0, 1,               /* Union, data interface 1                  */
+  7, USB_DESC_ENDPOINT, COMPOSITE_CDC_NOTIFY, 0x03, USB_LE16(16), 16,
+  9, USB_DESC_INTERFACE, 1, 0, 2, 0x0A, 0x00, 0x00, 0,
+  7, USB_DESC_ENDPOINT, COMPOSITE_CDC_OUT, 0x02, USB_LE16(64), 0,
+  7, USB_DESC_ENDPOINT, COMPOSITE_CDC_IN, 0x02, USB_LE16(64), 0,
+
+  /* Vendor */
+  9, USB_DESC_INTERFACE, 2, 0, 2, 0xFF, 0x00, 0x00, 5,
+  7, USB_DESC_ENDPOINT, COMPOSITE_VENDOR_OUT, 0x02, USB_LE16(64), 0,
+  7, USB_DESC_ENDPOINT, COMPOSITE_VENDOR_IN, 0x02, USB_LE16(64), 0
+};
+
+/* The packet memory is full with this table: 48 bytes of descriptor table, 64 for endpoint 0,
+   the IN endpoints double buffered and the OUT ones single buffered. The notification endpoint
+   is never written, the host only gets NAKs from it.                                             */
+static const USB_Endpoint Composite_Endpoints[] =
+{
+  {COMPOSITE_CDC_IN,     USB_EP_BULK,      64, TRUE},
+  {COMPOSITE_CDC_OUT,    USB_EP_BULK,      64, FALSE},
+  {COMPOSITE_CDC_NOTIFY, USB_EP_INTERRUPT, 16, FALSE},
+  {COMPOSITE_VENDOR_IN,  USB_EP_BULK,      64, TRUE},
+  {COMPOSITE_VENDOR_OUT, USB_EP_BULK,      64, FALSE}
+};
+
+static const USB_Function Composite_Functions[] =
+{
+  {CDC_Request, CDC_Event, NULL}
+};
+
+/* The serial number is the unique device ID in hexadecimal */
+static char Composite_Serial[25];
+
+static const char * const Composite_Strings[] =
+{
+  "BluePill",
+  "STM32F103C8 CDC + Bulk",
+  Composite_Serial,
+  "CDC ACM",
+  "Vendor Bulk"
+};
+
+static const USB_Config Composite_Config =
+{
+  Composite_Device,
+  Composite_Configuration,
+  Composite_Strings,
+  sizeof(Composite_Strings) / sizeof(Composite_Strings[0]),
+  Composite_Endpoints,
+  sizeof(Composite_Endpoints) / sizeof(Composite_Endpoints[0]),
+  Composite_Functions,
+  sizeof(Composite_Functions) / sizeof(Composite_Functions[0])
+};
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Composite_Start(void)
+{
+  sprintf(Composite_Serial, "%04X%04X%08X%08X", UDID_0, UDID_1, UDID_2, UDID_3);
+
+  if ((FALSE == USB_Init(&Composite_Config)) ||
+      (FALSE == CDC_Init(0, COMPOSITE_CDC_IN, COMPOSITE_CDC_OUT)) ||
+      (FALSE == Vendor_Init(COMPOSITE_VENDOR_IN, COMPOSITE_VENDOR_OUT)))
+  {
+    return FALSE;
+  }
+
+  return USB_Start();
+}
@@ -0,0 +1,26 @@
+#ifndef __COMPOSITE_H__
+#define __COMPOSITE_H__
+
+#include "types.h"
+
+/* The device presented on the USB connector: a CDC-ACM serial port (interfaces 0 and 1) and a
+   vendor bulk interface (2) for libusb, tied together with an interface association. The system
+   clock has to stay at 72 or 48 MHz while it is started (see usb.h).                             */
+#ifndef USB_ENABLED
+#define USB_ENABLED                        (1)
+#endif
+
+/* pid.codes test identifiers, to be replaced by an allocated pair for a product */
+#define COMPOSITE_VID                      (0x1209)
+#define COMPOSITE_PID                      (0x0001)
+
+/* Endpoints */
+#define COMPOSITE_CDC_IN                   (0x81)
+#define COMPOSITE_CDC_OUT                  (0x02)
+#define COMPOSITE_CDC_NOTIFY               (0x83)
+#define COMPOSITE_VENDOR_IN                (0x84)
+#define COMPOSITE_VENDOR_OUT               (0x05)
+
+U32 Composite_Start(void);
+
+#endif /* __COMPOSITE_H__ */
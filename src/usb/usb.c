@@ -0,0 +1,125 @@
+#include "types.h"
+#include "stm32f1xx.h"
+#include "bitband.h"
+#include "gpio.h"
+#include "dwt.h"
+#include "irq.h"
+#include "clock.h"
+#include "interrupts.h"
+#include "usbreg.h"
+#include "usb.h"
+
+/* D+ (PA12) is held low this long before the start, so the host sees a disconnection: the
+   BluePill has a fixed pull-up on it and a reset of the chip alone goes unnoticed                */
+#define USB_DISCONNECT_US                  (10000)
+
+/* Transceiver startup time (tSTARTUP) */
+#define USB_STARTUP_US                     (1)
+
+typedef struct
+{
+  U32            Hz;                       /* System clock the USB clock was derived from         */
+  Clock_Notifier Notifier;
+} USB_Port;
+
+static USB_Port USB_PortThis;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_Delay(U32 us)
+{
+  U32 start = DWT_Cycles(), cycles = (SystemCoreClock / 1000000) * us;
+
+  while ((DWT_Cycles() - start) < cycles) {};
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_IRQ(void * pContext)
+{
+  USB_Interrupt();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The USB prescaler can not change while the peripheral is clocked: any change of the system
+   clock stops the device, USB_Start() brings it back at a suitable clock                         */
+
+static void usb_ClockChanged(U32 oldHz, U32 newHz, void * pContext)
+{
+  if (newHz != USB_PortThis.Hz) USB_Stop();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* USB_Init() and the bindings of the streams come first. Needs the system clock at 48 or 72 MHz,
+   and CAN stopped: it uses the same packet memory.                                               */
+
+U32 USB_Start(void)
+{
+  USB_Port * pThis = &USB_PortThis;
+
+  if ((72000000 != SystemCoreClock) && (48000000 != SystemCoreClock)) return FALSE;
+  if (0 != (RCC->APB1ENR & RCC_APB1ENR_CAN1EN)) return FALSE;
+
+  USB_Stop();
+
+  /* 72 MHz / 1.5 or 48 MHz / 1. RCC->CFGR is shared with the clock manager, which may run from
+     the NMI: the bit is written alone, no read-modify-write and no critical section.             */
+  BITBAND_PERIPH(&RCC->CFGR, RCC_CFGR_USBPRE_Pos) = (72000000 != SystemCoreClock);
+  pThis->Hz = SystemCoreClock;
+
+  DWT_Init();
+  GPIO_Lo(GPIOA, 12);
+  GPIO_Init(GPIOA, 12, GPIO_TYPE_OUT_PP_2MHZ);
+  usb_Delay(USB_DISCONNECT_US);
+  GPIO_Init(GPIOA, 12, GPIO_TYPE_IN_FLOATING);
+
+  /* The pins are taken over by the transceiver once the peripheral is clocked */
+  BITBAND_RCC_APB1ENR(RCC_APB1ENR_USBEN_Pos) = 1;
+
+  USB_REGS->CNTR = USB_CNTR_FRES;
+  usb_Delay(USB_STARTUP_US);
+  USB_REGS->CNTR = 0;
+  USB_REGS->ISTR = 0;
+  USB_REGS->CNTR = USB_CNTR_CTRM | USB_CNTR_RESETM | USB_CNTR_SUSPM | USB_CNTR_WKUPM |
+                   USB_CNTR_ERRM | USB_CNTR_PMAOVRM;
+
+  IRQ_ATTACH(USB_LP_CAN1_RX0_IRQn, usb_IRQ, NULL);
+  NVIC_SetPriority(USB_LP_CAN1_RX0_IRQn, IRQ_PRIORITY_USB);
+  NVIC_EnableIRQ(USB_LP_CAN1_RX0_IRQn);
+
+  if (NULL == pThis->Notifier.pFunc)
+  {
+    Clock_Register(&pThis->Notifier, usb_ClockChanged, NULL);
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Powers the transceiver down. D+ stays pulled up, the host only notices the failed transfers
+   until USB_Start() disconnects the device.                                                      */
+
+void USB_Stop(void)
+{
+  if (0 == (RCC->APB1ENR & RCC_APB1ENR_USBEN)) return;
+
+  NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
+  USB_REGS->CNTR = USB_CNTR_FRES | USB_CNTR_PDWN;
+  USB_REGS->ISTR = 0;
+  BITBAND_RCC_APB1ENR(RCC_APB1ENR_USBEN_Pos) = 0;
+
+  USB_Detached();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Called after the application has written to or read from a stream: the interrupt hands the
+   new data to the IN endpoints and takes the OUT packets that were waiting for space             */
+
+void USB_Kick(void)
+{
+  if (0 != (RCC->APB1ENR & RCC_APB1ENR_USBEN)) NVIC_SetPendingIRQ(USB_LP_CAN1_RX0_IRQn);
+}
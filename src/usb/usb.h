@@ -0,0 +1,143 @@
+#ifndef __USB_H__
+#define __USB_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "stream.h"
+
+/* USB full-speed device. The core (usbcore.c) runs the control endpoint and moves the data of
+   the other endpoints between the packet memory and streams, all in the USB interrupt; it only
+   touches the peripheral through usbreg.h. usb.c brings the peripheral up on the F103.
+
+   Bulk endpoints may be double buffered: the peripheral sends or receives one packet buffer
+   while the interrupt fills or empties the other, so the bus is not held up by the copy. The
+   packet memory is 512 bytes, the endpoint table must fit in it with the descriptor table and
+   the two buffers of endpoint 0 (USB_Init() fails otherwise).
+
+   The 48 MHz USB clock comes from the PLL divided by 1.5 at 72 MHz or by 1 at 48 MHz, and the
+   divider can not be changed while the peripheral is clocked: a clock change stops the device.   */
+
+/* bmRequestType */
+#define USB_REQ_IN                         (0x80)
+#define USB_REQ_TYPE                       (0x60)
+#define USB_REQ_STANDARD                   (0x00)
+#define USB_REQ_CLASS                      (0x20)
+#define USB_REQ_VENDOR                     (0x40)
+#define USB_REQ_RECIPIENT                  (0x1F)
+#define USB_REQ_DEVICE                     (0x00)
+#define USB_REQ_INTERFACE                  (0x01)
+#define USB_REQ_ENDPOINT                   (0x02)
+
+/* Standard bRequest */
+#define USB_REQ_GET_STATUS                 (0)
+#define USB_REQ_CLEAR_FEATURE              (1)
+#define USB_REQ_SET_FEATURE                (3)
+#define USB_REQ_SET_ADDRESS                (5)
+#define USB_REQ_GET_DESCRIPTOR             (6)
+#define USB_REQ_GET_CONFIGURATION          (8)
+#define USB_REQ_SET_CONFIGURATION          (9)
+#define USB_REQ_GET_INTERFACE              (10)
+#define USB_REQ_SET_INTERFACE              (11)
+
+#define USB_FEATURE_ENDPOINT_HALT          (0)
+
+/* Descriptor types */
+#define USB_DESC_DEVICE                    (1)
+#define USB_DESC_CONFIGURATION             (2)
+#define USB_DESC_STRING                    (3)
+#define USB_DESC_INTERFACE                 (4)
+#define USB_DESC_ENDPOINT                  (5)
+#define USB_DESC_IAD                       (11)
+#define USB_DESC_CS_INTERFACE              (0x24)
+
+/* Little endian 16-bit field of a descriptor */
+#define USB_LE16(x)                        (U8)((x) & 0xFF), (U8)(((x) >> 8) & 0xFF)
+
+/* Data stage of a control transfer, the longest descriptor built at run time (a string) and the
+   longest OUT request accepted                                                                   */
+#define USB_CTRL_SIZE                      (128)
+
+typedef enum
+{
+  USB_EVENT_RESET,                         /* Also when the configuration is dropped              */
+  USB_EVENT_CONFIGURED,
+  USB_EVENT_SUSPEND,
+  USB_EVENT_RESUME
+} USB_Event;
+
+typedef struct
+{
+  U8  bmRequestType;
+  U8  bRequest;
+  U16 wValue;
+  U16 wIndex;
+  U16 wLength;
+} USB_Setup;
+
+/* Class and vendor requests, in the USB interrupt. pBuffer (USB_CTRL_SIZE bytes) holds the data
+   stage of an OUT request, *pLength bytes. An IN request points *ppData to its reply (pBuffer may
+   be used) and sets *pLength, at most wLength is sent. FALSE stalls the request (not handled).   */
+typedef U32  (*USB_Request)(const USB_Setup * pSetup, U8 * pBuffer, const U8 ** ppData,
+                            U32 * pLength, void * pContext);
+typedef void (*USB_EventFunc)(USB_Event event, void * pContext);
+
+/* Progress of a stream endpoint, in the USB interrupt: space freed in the stream of an IN
+   endpoint, data added to the stream of an OUT endpoint                                          */
+typedef void (*USB_Notify)(void * pContext);
+
+typedef struct
+{
+  USB_Request   pRequest;
+  USB_EventFunc pEvent;
+  void *        pContext;
+} USB_Function;
+
+typedef struct
+{
+  U8  Address;                             /* bEndpointAddress, bit 7 set for IN                  */
+  U16 Type;                                /* USB_EP_BULK or USB_EP_INTERRUPT (EPnR field)        */
+  U16 Size;                                /* wMaxPacketSize, a multiple of 32 above 62 for OUT   */
+  U8  Double;                              /* Bulk only: both packet buffers for this direction   */
+} USB_Endpoint;
+
+/* Each endpoint takes a register of its own, so the endpoint numbers must all differ, also
+   between an IN and an OUT endpoint                                                              */
+typedef struct
+{
+  const U8 *           pDevice;
+  const U8 *           pConfiguration;     /* With its interface, class and endpoint descriptors  */
+  const char * const * ppStrings;          /* String descriptors 1..Strings, ASCII                */
+  U32                  Strings;
+  const USB_Endpoint * pEndpoints;         /* Endpoint registers 1.. in this order                */
+  U32                  Endpoints;
+  const USB_Function * pFunctions;         /* Asked in this order for class and vendor requests   */
+  U32                  Functions;
+} USB_Config;
+
+typedef struct
+{
+  U32 Resets;
+  U32 Suspends;
+  U32 Setups;
+  U32 Stalls;                              /* Requests refused                                    */
+  U32 PacketsIn;
+  U32 PacketsOut;
+  U32 Deferred;                            /* OUT packets left in the packet memory (NAKed) until */
+                                           /* the stream had space                                */
+  U32 Errors;                              /* Bus errors and packet memory overruns               */
+} USB_Stats;
+
+/* Core */
+U32  USB_Init(const USB_Config * pConfig);
+U32  USB_Bind(U32 address, Stream * pStream, USB_Notify pNotify, void * pContext);
+U32  USB_IsConfigured(void);
+void USB_GetStats(USB_Stats * pStats);
+void USB_Interrupt(void);
+void USB_Detached(void);
+
+/* Peripheral */
+U32  USB_Start(void);
+void USB_Stop(void);
+void USB_Kick(void);
+
+#endif /* __USB_H__ */
@@ -0,0 +1,914 @@
+#include <string.h>
+
+#include "types.h"
+#include "stm32f1xx.h"
+#include "stream.h"
+#include "usbreg.h"
+#include "usb.h"
+
+typedef enum
+{
+  USB_CTRL_IDLE,
+  USB_CTRL_DATA_IN,
+  USB_CTRL_DATA_OUT,
+  USB_CTRL_STATUS_IN,                      /* Zero length IN after the data OUT or no data stage  */
+  USB_CTRL_STATUS_OUT                      /* Zero length OUT after the data IN stage             */
+} USB_Ctrl;
+
+typedef struct
+{
+  const USB_Endpoint * pConfig;
+  Stream *             pStream;
+  USB_Notify           pNotify;
+  void *               pContext;
+  U16                  Buffer[2];          /* Packet memory offsets                               */
+  U8                   Queued;             /* IN: packets handed to the peripheral                */
+  U8                   Next;               /* IN double buffered: the buffer written next         */
+  U8                   Full;               /* IN: the last packet had the full size, a zero      */
+                                           /* length one ends the transfer if no data follows     */
+  U8                   Pending;            /* OUT: a packet waits for space in the stream         */
+  U8                   Halted;
+} USB_EPState;
+
+typedef struct
+{
+  USB_Config  Config;
+  USB_EPState EP[USB_ENDPOINTS_MAX];       /* [0] only holds the buffers of endpoint 0            */
+  U32         MaxPacket0;
+  U32         Configuration;
+  USB_Ctrl    Ctrl;
+  USB_Setup   Setup;
+  const U8 *  pCtrlData;
+  U32         CtrlLeft;
+  U32         CtrlDone;
+  U32         CtrlZlp;
+  U32         CtrlBuffer[USB_CTRL_SIZE / sizeof(U32)];
+  USB_Stats   Stats;
+} USB_State;
+
+static USB_State USB_This;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The packet memory holds two bytes per 32-bit word: byte 'o' is in the word USB_PMA[o & ~1] */
+
+static void usb_PMAWrite(U32 offset, const U8 * pData, U32 count)
+{
+  volatile U16 * pPMA = &USB_PMA[offset];
+  U32 i;
+
+  for (i = 0; i + 1 < count; i += 2)
+  {
+    pPMA[i] = (U16)(pData[i] | ((U32)pData[i + 1] << 8));
+  }
+  if (0 != (count & 1)) pPMA[count - 1] = pData[count - 1];
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_PMARead(U32 offset, U8 * pData, U32 count)
+{
+  volatile U16 * pPMA = &USB_PMA[offset];
+  U32 i, word;
+
+  for (i = 0; i + 1 < count; i += 2)
+  {
+    word = pPMA[i];
+    pData[i]     = (U8)word;
+    pData[i + 1] = (U8)(word >> 8);
+  }
+  if (0 != (count & 1)) pData[count - 1] = (U8)pPMA[count - 1];
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The stream versions index the ring directly, a packet may wrap around its end. An odd count
+   reads one byte past the data, which is never sent.                                             */
+
+static void usb_PMAFromStream(U32 offset, Stream * pStream, U32 count)
+{
+  volatile U16 * pPMA = &USB_PMA[offset];
+  const U8 * pData = pStream->pData;
+  U32 mask = pStream->Mask, tail = pStream->Tail, i;
+
+  for (i = 0; i < count; i += 2)
+  {
+    pPMA[i] = (U16)(pData[(tail + i) & mask] | ((U32)pData[(tail + i + 1) & mask] << 8));
+  }
+  Stream_Consume(pStream, count);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_PMAToStream(U32 offset, Stream * pStream, U32 count)
+{
+  volatile U16 * pPMA = &USB_PMA[offset];
+  U8 * pData = pStream->pData;
+  U32 mask = pStream->Mask, head = pStream->Head, i, word;
+
+  for (i = 0; i + 1 < count; i += 2)
+  {
+    word = pPMA[i];
+    pData[(head + i) & mask]     = (U8)word;
+    pData[(head + i + 1) & mask] = (U8)(word >> 8);
+  }
+  if (0 != (count & 1)) pData[(head + count - 1) & mask] = (U8)pPMA[count - 1];
+  Stream_Commit(pStream, count);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* COUNTn_RX: size of the reception buffer, in 2-byte blocks up to 62, in 32-byte blocks above */
+
+static U16 usb_RxSize(U32 size)
+{
+  if (62 < size) return (U16)(0x8000U | (((size / 32) - 1) << 10));
+  return (U16)((size / 2) << 10);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Brings the toggled fields in 'mask' to 'value'. The CTR flags are written with 1: no change. */
+
+static void usb_EPSet(U32 n, U32 value, U32 mask)
+{
+  U32 r = USB_EPR_READ(n);
+
+  USB_EPR_WRITE(n, (r & USB_EP_RW) | USB_EP_CTR | ((r ^ value) & mask));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_EPFlip(U32 n, U32 bits)
+{
+  USB_EPR_WRITE(n, (USB_EPR_READ(n) & USB_EP_RW) | USB_EP_CTR | bits);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_EPClear(U32 n, U32 flag)
+{
+  USB_EPR_WRITE(n, ((USB_EPR_READ(n) & USB_EP_RW) | USB_EP_CTR) & ~flag);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Writes the type, kind and address, brings all the toggled fields to 'value' and clears the CTR
+   flags                                                                                          */
+
+static void usb_EPOpen(U32 n, U32 rw, U32 value)
+{
+  U32 r = USB_EPR_READ(n);
+
+  USB_EPR_WRITE(n, rw | ((r ^ value) & USB_EP_TOGGLES));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_Event(USB_State * pThis, USB_Event event)
+{
+  const USB_Function * pFunction = pThis->Config.pFunctions;
+  U32 i;
+
+  for (i = 0; i < pThis->Config.Functions; i++, pFunction++)
+  {
+    if (NULL != pFunction->pEvent) pFunction->pEvent(event, pFunction->pContext);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Register of an endpoint address, 0 if there is none */
+
+static U32 usb_Find(USB_State * pThis, U32 address)
+{
+  U32 n;
+
+  for (n = 1; n <= pThis->Config.Endpoints; n++)
+  {
+    if (address == pThis->EP[n].pConfig->Address) return n;
+  }
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Resets the buffers and the data toggles. A double buffered OUT endpoint starts with the
+   application owning buffer 1 (SW_BUF = 1), a double buffered IN one with both buffers empty.   */
+
+static void usb_Open(USB_State * pThis, U32 n)
+{
+  USB_EPState * pEP = &pThis->EP[n];
+  const USB_Endpoint * pConfig = pEP->pConfig;
+  U32 rw = pConfig->Type | (pConfig->Address & USB_EPADDR_FIELD), value;
+
+  pEP->Queued  = 0;
+  pEP->Next    = 0;
+  pEP->Full    = FALSE;
+  pEP->Pending = FALSE;
+  pEP->Halted  = FALSE;
+
+  if (0 != pConfig->Double) rw |= USB_EP_KIND;
+
+  if (0 != (pConfig->Address & 0x80))
+  {
+    USB_PMA_ADDR_TX(n)  = pEP->Buffer[0];
+    USB_PMA_COUNT_TX(n) = 0;
+    USB_PMA_ADDR_RX(n)  = pEP->Buffer[1];
+    USB_PMA_COUNT_RX(n) = 0;
+    value = (0 != pConfig->Double) ? USB_EP_TX_VALID : USB_EP_TX_NAK;
+  }
+  else if (0 != pConfig->Double)
+  {
+    USB_PMA_ADDR_TX(n)  = pEP->Buffer[0];
+    USB_PMA_COUNT_TX(n) = usb_RxSize(pConfig->Size);
+    USB_PMA_ADDR_RX(n)  = pEP->Buffer[1];
+    USB_PMA_COUNT_RX(n) = usb_RxSize(pConfig->Size);
+    value = USB_EP_RX_VALID | USB_EP_DTOG_TX;
+  }
+  else
+  {
+    USB_PMA_ADDR_RX(n)  = pEP->Buffer[0];
+    USB_PMA_COUNT_RX(n) = usb_RxSize(pConfig->Size);
+    value = USB_EP_RX_VALID;
+  }
+
+  usb_EPOpen(n, rw, value);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_Halt(USB_State * pThis, U32 n)
+{
+  if (0 != (pThis->EP[n].pConfig->Address & 0x80))
+  {
+    usb_EPSet(n, USB_EP_TX_STALL, USB_EPTX_STAT);
+  }
+  else
+  {
+    usb_EPSet(n, USB_EP_RX_STALL, USB_EPRX_STAT);
+  }
+  pThis->EP[n].Halted = TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Hands the stream data to the peripheral while a packet buffer is free. With two buffers the
+   second one is only written: the peripheral gets it when the first one has been sent.          */
+
+static void usb_InFill(USB_State * pThis, U32 n)
+{
+  USB_EPState * pEP = &pThis->EP[n];
+  U32 size = pEP->pConfig->Size, buffers = (0 != pEP->pConfig->Double) ? 2 : 1, count, freed = 0;
+
+  while (pEP->Queued < buffers)
+  {
+    count = Stream_Count(pEP->pStream);
+    if ((0 == count) && ((FALSE == pEP->Full) || (0 != pEP->Queued))) break;
+    if (count > size) count = size;
+
+    if (1 == buffers)
+    {
+      usb_PMAFromStream(pEP->Buffer[0], pEP->pStream, count);
+      USB_PMA_COUNT_TX(n) = (U16)count;
+      usb_EPSet(n, USB_EP_TX_VALID, USB_EPTX_STAT);
+    }
+    else
+    {
+      usb_PMAFromStream(pEP->Buffer[pEP->Next], pEP->pStream, count);
+      if (0 == pEP->Next) USB_PMA_COUNT_TX(n) = (U16)count;
+      else                USB_PMA_COUNT_RX(n) = (U16)count;
+      pEP->Next ^= 1;
+
+      /* SW_BUF of an IN endpoint is DTOG_RX */
+      if (0 == pEP->Queued) usb_EPFlip(n, USB_EP_DTOG_RX);
+    }
+
+    pEP->Full = (count == size);
+    pEP->Queued++;
+    freed += count;
+    pThis->Stats.PacketsIn++;
+  }
+
+  if ((0 != freed) && (NULL != pEP->pNotify)) pEP->pNotify(pEP->pContext);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_InDone(USB_State * pThis, U32 n)
+{
+  USB_EPState * pEP = &pThis->EP[n];
+
+  if (0 != pEP->Queued) pEP->Queued--;
+
+  /* The other buffer was written meanwhile */
+  if ((0 != pEP->pConfig->Double) && (0 != pEP->Queued)) usb_EPFlip(n, USB_EP_DTOG_RX);
+
+  if (NULL != pEP->pStream)
+  {
+    usb_InFill(pThis, n);
+  }
+  else if (NULL != pEP->pNotify)
+  {
+    pEP->pNotify(pEP->pContext);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Moves the received packet into the stream if it fits, else it stays in the packet memory and
+   the peripheral NAKs the host until the next call. A double buffered endpoint gets the other
+   buffer back (SW_BUF, which is DTOG_TX) before the copy, so the host can send on meanwhile.     */
+
+static void usb_OutDrain(USB_State * pThis, U32 n)
+{
+  USB_EPState * pEP = &pThis->EP[n];
+  U32 buffer = 0, count;
+
+  if (FALSE == pEP->Pending) return;
+
+  if (0 == pEP->pConfig->Double)
+  {
+    count = USB_PMA_COUNT_RX(n) & USB_PMA_COUNT_MASK;
+  }
+  else
+  {
+    buffer = (0 != (USB_EPR_READ(n) & USB_EP_DTOG_RX)) ? 0 : 1;
+    count = ((0 == buffer) ? USB_PMA_COUNT_TX(n) : USB_PMA_COUNT_RX(n)) & USB_PMA_COUNT_MASK;
+  }
+
+  if (Stream_Space(pEP->pStream) < count) return;
+
+  if (0 != pEP->pConfig->Double) usb_EPFlip(n, USB_EP_DTOG_TX);
+  usb_PMAToStream(pEP->Buffer[buffer], pEP->pStream, count);
+  if (0 == pEP->pConfig->Double) usb_EPSet(n, USB_EP_RX_VALID, USB_EPRX_STAT);
+
+  pEP->Pending = FALSE;
+  pThis->Stats.PacketsOut++;
+
+  if (NULL != pEP->pNotify) pEP->pNotify(pEP->pContext);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_Reset(USB_State * pThis)
+{
+  USB_REGS->BTABLE = 0;
+
+  USB_PMA_ADDR_TX(0)  = pThis->EP[0].Buffer[0];
+  USB_PMA_COUNT_TX(0) = 0;
+  USB_PMA_ADDR_RX(0)  = pThis->EP[0].Buffer[1];
+  USB_PMA_COUNT_RX(0) = usb_RxSize(pThis->MaxPacket0);
+  usb_EPOpen(0, USB_EP_CONTROL, USB_EP_RX_VALID | USB_EP_TX_NAK);
+
+  USB_REGS->DADDR = USB_DADDR_EF;
+
+  pThis->Configuration = 0;
+  pThis->Ctrl = USB_CTRL_IDLE;
+  pThis->Stats.Resets++;
+
+  usb_Event(pThis, USB_EVENT_RESET);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Configuration 0 closes the endpoints, the other value is the one of the descriptor */
+
+static U32 usb_Configure(USB_State * pThis, U32 value)
+{
+  U32 n;
+
+  if ((0 != value) && (pThis->Config.pConfiguration[5] != value)) return FALSE;
+
+  pThis->Configuration = value;
+  for (n = 1; n <= pThis->Config.Endpoints; n++)
+  {
+    if (0 != value)
+    {
+      usb_Open(pThis, n);
+    }
+    else
+    {
+      usb_EPOpen(n, USB_EPR_READ(n) & USB_EP_RW, 0);
+    }
+  }
+
+  usb_Event(pThis, (0 != value) ? USB_EVENT_CONFIGURED : USB_EVENT_RESET);
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* String 0 is the language list (English), the others are turned from ASCII into UTF-16 */
+
+static U32 usb_Descriptor(USB_State * pThis, U8 * pBuffer, const U8 ** ppData, U32 * pLength)
+{
+  const U8 * pConfiguration = pThis->Config.pConfiguration;
+  U32 index = pThis->Setup.wValue & 0xFF, length;
+  const char * pString;
+
+  switch (pThis->Setup.wValue >> 8)
+  {
+    case USB_DESC_DEVICE:
+      *ppData  = pThis->Config.pDevice;
+      *pLength = pThis->Config.pDevice[0];
+      return TRUE;
+
+    case USB_DESC_CONFIGURATION:
+      if (0 != index) return FALSE;
+      *ppData  = pConfiguration;
+      *pLength = pConfiguration[2] | ((U32)pConfiguration[3] << 8);
+      return TRUE;
+
+    case USB_DESC_STRING:
+      if (0 == index)
+      {
+        pBuffer[0] = 4;
+        pBuffer[1] = USB_DESC_STRING;
+        pBuffer[2] = 0x09;
+        pBuffer[3] = 0x04;
+        *pLength = 4;
+        return TRUE;
+      }
+      if (index > pThis->Config.Strings) return FALSE;
+
+      pString = pThis->Config.ppStrings[index - 1];
+      for (length = 2; ('\0' != *pString) && (length + 2 <= USB_CTRL_SIZE); length += 2)
+      {
+        pBuffer[length]     = (U8)*pString++;
+        pBuffer[length + 1] = 0;
+      }
+      pBuffer[0] = (U8)length;
+      pBuffer[1] = USB_DESC_STRING;
+      *pLength = length;
+      return TRUE;
+
+    default:
+      /* Device qualifier included: a full-speed only device stalls it */
+      return FALSE;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 usb_Standard(USB_State * pThis, U8 * pBuffer, const U8 ** ppData, U32 * pLength)
+{
+  const USB_Setup * pSetup = &pThis->Setup;
+  const U8 * pConfiguration = pThis->Config.pConfiguration;
+  U32 n;
+
+  switch (pSetup->bmRequestType & USB_REQ_RECIPIENT)
+  {
+    case USB_REQ_DEVICE:
+      switch (pSetup->bRequest)
+      {
+        case USB_REQ_GET_STATUS:
+          pBuffer[0] = (0 != (pConfiguration[7] & 0x40)) ? 1 : 0;
+          pBuffer[1] = 0;
+          *pLength = 2;
+          return TRUE;
+
+        case USB_REQ_SET_ADDRESS:
+          /* Taken after the status stage, which still goes to address 0 */
+          return (0x80 > pSetup->wValue);
+
+        case USB_REQ_GET_DESCRIPTOR:
+          return usb_Descriptor(pThis, pBuffer, ppData, pLength);
+
+        case USB_REQ_GET_CONFIGURATION:
+          pBuffer[0] = (U8)pThis->Configuration;
+          *pLength = 1;
+          return TRUE;
+
+        case USB_REQ_SET_CONFIGURATION:
+          return usb_Configure(pThis, pSetup->wValue & 0xFF);
+
+        default:
+          return FALSE;
+      }
+
+    case USB_REQ_INTERFACE:
+      if ((0 == pThis->Configuration) || ((pSetup->wIndex & 0xFF) >= pConfiguration[4]))
+      {
+        return FALSE;
+      }
+      switch (pSetup->bRequest)
+      {
+        case USB_REQ_GET_STATUS:
+          pBuffer[0] = 0;
+          pBuffer[1] = 0;
+          *pLength = 2;
+          return TRUE;
+
+        case USB_REQ_GET_INTERFACE:
+          pBuffer[0] = 0;
+          *pLength = 1;
+          return TRUE;
+
+        case USB_REQ_SET_INTERFACE:
+          return (0 == pSetup->wValue);
+
+        default:
+          return FALSE;
+      }
+
+    case USB_REQ_ENDPOINT:
+      n = usb_Find(pThis, pSetup->wIndex & 0xFF);
+      if ((0 == n) && (0 != (pSetup->wIndex & 0x7F))) return FALSE;
+      if ((0 != n) && (0 == pThis->Configuration)) return FALSE;
+
+      switch (pSetup->bRequest)
+      {
+        case USB_REQ_GET_STATUS:
+          pBuffer[0] = (0 != n) ? pThis->EP[n].Halted : 0;
+          pBuffer[1] = 0;
+          *pLength = 2;
+          return TRUE;
+
+        case USB_REQ_CLEAR_FEATURE:
+        case USB_REQ_SET_FEATURE:
+          if (USB_FEATURE_ENDPOINT_HALT != pSetup->wValue) return FALSE;
+          if (0 == n) return TRUE;
+
+          /* Clearing the halt resets the data toggle, whether the endpoint was halted or not */
+          if (USB_REQ_SET_FEATURE == pSetup->bRequest) usb_Halt(pThis, n);
+          else                                         usb_Open(pThis, n);
+          return TRUE;
+
+        default:
+          return FALSE;
+      }
+
+    default:
+      return FALSE;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_CtrlIn(USB_State * pThis)
+{
+  U32 count = pThis->CtrlLeft;
+
+  if (count > pThis->MaxPacket0) count = pThis->MaxPacket0;
+
+  usb_PMAWrite(pThis->EP[0].Buffer[0], pThis->pCtrlData, count);
+  USB_PMA_COUNT_TX(0) = (U16)count;
+  pThis->pCtrlData += count;
+  pThis->CtrlLeft  -= count;
+
+  usb_EPSet(0, USB_EP_TX_VALID, USB_EPTX_STAT);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_CtrlStall(USB_State * pThis)
+{
+  usb_EPSet(0, USB_EP_TX_STALL | USB_EP_RX_STALL, USB_EPTX_STAT | USB_EPRX_STAT);
+  pThis->Ctrl = USB_CTRL_IDLE;
+  pThis->Stats.Stalls++;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Runs the request once its data stage (if OUT) is in, then starts the data IN or the status
+   stage. A reply shorter than wLength that ends on a full packet is followed by a zero length
+   packet.                                                                                        */
+
+static void usb_Request(USB_State * pThis)
+{
+  const USB_Setup * pSetup = &pThis->Setup;
+  const USB_Function * pFunction = pThis->Config.pFunctions;
+  U8 * pBuffer = (U8 *)pThis->CtrlBuffer;
+  const U8 * pData = pBuffer;
+  U32 length = pThis->CtrlDone, result = FALSE, i;
+
+  if (USB_REQ_STANDARD == (pSetup->bmRequestType & USB_REQ_TYPE))
+  {
+    result = usb_Standard(pThis, pBuffer, &pData, &length);
+  }
+  else
+  {
+    for (i = 0; (FALSE == result) && (i < pThis->Config.Functions); i++, pFunction++)
+    {
+      if (NULL == pFunction->pRequest) continue;
+      result = pFunction->pRequest(pSetup, pBuffer, &pData, &length, pFunction->pContext);
+    }
+  }
+
+  if (FALSE == result)
+  {
+    usb_CtrlStall(pThis);
+    return;
+  }
+
+  if ((0 != (pSetup->bmRequestType & USB_REQ_IN)) && (0 != pSetup->wLength))
+  {
+    if (length > pSetup->wLength) length = pSetup->wLength;
+
+    pThis->pCtrlData = pData;
+    pThis->CtrlLeft  = length;
+    pThis->CtrlZlp   = (length < pSetup->wLength) && (0 == (length % pThis->MaxPacket0));
+    pThis->Ctrl      = USB_CTRL_DATA_IN;
+    usb_CtrlIn(pThis);
+  }
+  else
+  {
+    USB_PMA_COUNT_TX(0) = 0;
+    usb_EPSet(0, USB_EP_TX_VALID, USB_EPTX_STAT);
+    pThis->Ctrl = USB_CTRL_STATUS_IN;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The peripheral has set both directions to NAK on the SETUP, whatever state they were in */
+
+static void usb_Setup(USB_State * pThis)
+{
+  USB_Setup * pSetup = &pThis->Setup;
+  U8 packet[8];
+
+  usb_PMARead(pThis->EP[0].Buffer[1], packet, sizeof(packet));
+  pSetup->bmRequestType = packet[0];
+  pSetup->bRequest      = packet[1];
+  pSetup->wValue        = (U16)(packet[2] | (packet[3] << 8));
+  pSetup->wIndex        = (U16)(packet[4] | (packet[5] << 8));
+  pSetup->wLength       = (U16)(packet[6] | (packet[7] << 8));
+
+  pThis->Stats.Setups++;
+  pThis->CtrlDone = 0;
+  pThis->CtrlZlp  = FALSE;
+
+  if ((0 == (pSetup->bmRequestType & USB_REQ_IN)) && (0 != pSetup->wLength))
+  {
+    if (USB_CTRL_SIZE < pSetup->wLength)
+    {
+      usb_CtrlStall(pThis);
+      return;
+    }
+    pThis->CtrlLeft = pSetup->wLength;
+    pThis->Ctrl = USB_CTRL_DATA_OUT;
+  }
+  else
+  {
+    usb_Request(pThis);
+    if (USB_CTRL_IDLE == pThis->Ctrl) return;
+  }
+
+  /* The data OUT, or the status OUT that may come early during a data IN stage */
+  usb_EPSet(0, USB_EP_RX_VALID, USB_EPRX_STAT);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_CtrlOut(USB_State * pThis)
+{
+  U32 count = USB_PMA_COUNT_RX(0) & USB_PMA_COUNT_MASK;
+
+  if (USB_CTRL_DATA_OUT != pThis->Ctrl)
+  {
+    /* Status OUT, or the host has given up on the data IN stage */
+    pThis->Ctrl = USB_CTRL_IDLE;
+    usb_EPSet(0, USB_EP_RX_VALID | USB_EP_TX_NAK, USB_EPRX_STAT | USB_EPTX_STAT);
+    return;
+  }
+
+  if (count > pThis->CtrlLeft) count = pThis->CtrlLeft;
+  usb_PMARead(pThis->EP[0].Buffer[1], &((U8 *)pThis->CtrlBuffer)[pThis->CtrlDone], count);
+  pThis->CtrlDone += count;
+  pThis->CtrlLeft -= count;
+
+  if ((0 == pThis->CtrlLeft) || (count < pThis->MaxPacket0))
+  {
+    usb_Request(pThis);
+    if (USB_CTRL_IDLE == pThis->Ctrl) return;
+  }
+
+  usb_EPSet(0, USB_EP_RX_VALID, USB_EPRX_STAT);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usb_CtrlTx(USB_State * pThis)
+{
+  const USB_Setup * pSetup = &pThis->Setup;
+
+  if (USB_CTRL_DATA_IN == pThis->Ctrl)
+  {
+    if ((0 != pThis->CtrlLeft) || (FALSE != pThis->CtrlZlp))
+    {
+      if (0 == pThis->CtrlLeft) pThis->CtrlZlp = FALSE;
+      usb_CtrlIn(pThis);
+    }
+    else
+    {
+      pThis->Ctrl = USB_CTRL_STATUS_OUT;
+    }
+  }
+  else if (USB_CTRL_STATUS_IN == pThis->Ctrl)
+  {
+    if ((USB_REQ_DEVICE == pSetup->bmRequestType) && (USB_REQ_SET_ADDRESS == pSetup->bRequest))
+    {
+      USB_REGS->DADDR = (U16)(USB_DADDR_EF | pSetup->wValue);
+    }
+    pThis->Ctrl = USB_CTRL_IDLE;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* On endpoint 0 the IN completion comes first: a SETUP received meanwhile starts over */
+
+static void usb_Transfer(USB_State * pThis, U32 n)
+{
+  U32 r = USB_EPR_READ(n);
+
+  if (0 != (r & USB_EP_CTR_TX))
+  {
+    usb_EPClear(n, USB_EP_CTR_TX);
+    if (0 == n) usb_CtrlTx(pThis);
+    else        usb_InDone(pThis, n);
+  }
+
+  if (0 != (r & USB_EP_CTR_RX))
+  {
+    usb_EPClear(n, USB_EP_CTR_RX);
+    if (0 == n)
+    {
+      if (0 != (r & USB_EP_SETUP)) usb_Setup(pThis);
+      else                         usb_CtrlOut(pThis);
+    }
+    else
+    {
+      pThis->EP[n].Pending = TRUE;
+      usb_OutDrain(pThis, n);
+      if (FALSE != pThis->EP[n].Pending) pThis->Stats.Deferred++;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Streams may have changed on the application side since the last interrupt (USB_Kick) */
+
+static void usb_Service(USB_State * pThis)
+{
+  USB_EPState * pEP;
+  U32 n;
+
+  if (0 == pThis->Configuration) return;
+
+  for (n = 1; n <= pThis->Config.Endpoints; n++)
+  {
+    pEP = &pThis->EP[n];
+    if ((NULL == pEP->pStream) || (FALSE != pEP->Halted)) continue;
+
+    if (0 != (pEP->pConfig->Address & 0x80)) usb_InFill(pThis, n);
+    else                                     usb_OutDrain(pThis, n);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Lays out the packet memory: the descriptor table, endpoint 0, then the endpoints in order */
+
+U32 USB_Init(const USB_Config * pConfig)
+{
+  USB_State * pThis = &USB_This;
+  const USB_Endpoint * pEndpoint;
+  U32 offset, size, n;
+
+  if ((NULL == pConfig) || (NULL == pConfig->pDevice) || (NULL == pConfig->pConfiguration))
+  {
+    return FALSE;
+  }
+  if ((USB_ENDPOINTS_MAX <= pConfig->Endpoints) || (NULL == pConfig->pEndpoints)) return FALSE;
+
+  size = pConfig->pDevice[7];
+  if ((8 != size) && (16 != size) && (32 != size) && (64 != size)) return FALSE;
+
+  memset(pThis, 0, sizeof(USB_State));
+  memcpy(&pThis->Config, pConfig, sizeof(USB_Config));
+  pThis->MaxPacket0 = size;
+
+  offset = 8 * (pConfig->Endpoints + 1);
+  pThis->EP[0].Buffer[0] = (U16)offset;
+  pThis->EP[0].Buffer[1] = (U16)(offset + size);
+  offset += 2 * size;
+
+  for (n = 1; n <= pConfig->Endpoints; n++)
+  {
+    pEndpoint = &pConfig->pEndpoints[n - 1];
+    size = (pEndpoint->Size + 1) & ~1U;
+
+    if ((0 == size) || ((0 != pEndpoint->Double) && (USB_EP_BULK != pEndpoint->Type))) return FALSE;
+    if ((0 == (pEndpoint->Address & 0x80)) && (62 < size) && (0 != (size % 32))) return FALSE;
+
+    pThis->EP[n].pConfig   = pEndpoint;
+    pThis->EP[n].Buffer[0] = (U16)offset;
+    pThis->EP[n].Buffer[1] = (U16)offset;
+    offset += size;
+    if (0 != pEndpoint->Double)
+    {
+      pThis->EP[n].Buffer[1] = (U16)offset;
+      offset += size;
+    }
+  }
+
+  return (USB_PMA_SIZE >= offset);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Every OUT endpoint must be given a stream. IN endpoints without one are only opened (NAK). */
+
+U32 USB_Bind(U32 address, Stream * pStream, USB_Notify pNotify, void * pContext)
+{
+  USB_State * pThis = &USB_This;
+  U32 n = usb_Find(pThis, address);
+
+  if (0 == n) return FALSE;
+
+  pThis->EP[n].pStream  = pStream;
+  pThis->EP[n].pNotify  = pNotify;
+  pThis->EP[n].pContext = pContext;
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 USB_IsConfigured(void)
+{
+  return (0 != USB_This.Configuration);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void USB_GetStats(USB_Stats * pStats)
+{
+  U32 primask = __get_PRIMASK();
+
+  __disable_irq();
+  memcpy(pStats, &USB_This.Stats, sizeof(USB_Stats));
+  __set_PRIMASK(primask);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void USB_Interrupt(void)
+{
+  USB_State * pThis = &USB_This;
+  U32 istr = USB_REGS->ISTR;
+
+  if (0 != (istr & USB_ISTR_RESET))
+  {
+    USB_ISTR_CLEAR(USB_ISTR_RESET);
+    usb_Reset(pThis);
+  }
+
+  if (0 != (istr & (USB_ISTR_ERR | USB_ISTR_PMAOVR)))
+  {
+    USB_ISTR_CLEAR(USB_ISTR_ERR | USB_ISTR_PMAOVR);
+    pThis->Stats.Errors++;
+  }
+
+  if (0 != (istr & USB_ISTR_SUSP))
+  {
+    USB_REGS->CNTR |= USB_CNTR_FSUSP;
+    USB_ISTR_CLEAR(USB_ISTR_SUSP);
+    pThis->Stats.Suspends++;
+    usb_Event(pThis, USB_EVENT_SUSPEND);
+  }
+
+  if (0 != (istr & USB_ISTR_WKUP))
+  {
+    USB_REGS->CNTR &= (U16)~USB_CNTR_FSUSP;
+    USB_ISTR_CLEAR(USB_ISTR_WKUP);
+    usb_Event(pThis, USB_EVENT_RESUME);
+  }
+
+  /* CTR stays set while any endpoint has a transfer to report */
+  while (0 != (istr & USB_ISTR_CTR))
+  {
+    usb_Transfer(pThis, istr & USB_ISTR_EP_ID);
+    istr = USB_REGS->ISTR;
+  }
+
+  usb_Service(pThis);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The peripheral has been stopped: the host will have to enumerate the device again */
+
+void USB_Detached(void)
+{
+  if (0 != USB_This.Configuration)
+  {
+    USB_This.Configuration = 0;
+    usb_Event(&USB_This, USB_EVENT_RESET);
+  }
+}
@@ -0,0 +1,157 @@
+#include "types.h"
+#include "stream.h"
+#include "usb.h"
+#include "usbpipe.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usbpipe_Wake(TaskHandle_t pTask)
+{
+  BaseType_t woken = pdFALSE;
+
+  if (NULL == pTask) return;
+
+  vTaskNotifyGiveFromISR(pTask, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usbpipe_RxNotify(void * pContext)
+{
+  usbpipe_Wake(((USB_Pipe *)pContext)->pReader);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void usbpipe_TxNotify(void * pContext)
+{
+  usbpipe_Wake(((USB_Pipe *)pContext)->pWriter);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Between USB_Init() and USB_Start(). The sizes are powers of two, at least a packet. */
+
+U32 USB_PipeInit(USB_Pipe * pPipe, U32 in, U32 out, U8 * pRx, U32 rxSize, U8 * pTx, U32 txSize)
+{
+  pPipe->pReader = NULL;
+  pPipe->pWriter = NULL;
+
+  if ((FALSE == Stream_Init(&pPipe->Rx, pRx, rxSize)) ||
+      (FALSE == Stream_Init(&pPipe->Tx, pTx, txSize)))
+  {
+    return FALSE;
+  }
+
+  return (USB_Bind(in, &pPipe->Tx, usbpipe_TxNotify, pPipe) &&
+          USB_Bind(out, &pPipe->Rx, usbpipe_RxNotify, pPipe));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 USB_PipeGetWrite(USB_Pipe * pPipe, U8 ** ppData)
+{
+  return Stream_GetWrite(&pPipe->Tx, ppData);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void USB_PipeCommit(USB_Pipe * pPipe, U32 count)
+{
+  Stream_Commit(&pPipe->Tx, count);
+  USB_Kick();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 USB_PipeGetRead(USB_Pipe * pPipe, U8 ** ppData)
+{
+  return Stream_GetRead(&pPipe->Rx, ppData);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The freed space may let in an OUT packet the endpoint is holding back */
+
+void USB_PipeConsume(USB_Pipe * pPipe, U32 count)
+{
+  Stream_Consume(&pPipe->Rx, count);
+  USB_Kick();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The task registers itself before it checks the stream again: a notification sent in between
+   is kept and makes ulTaskNotifyTake() return at once                                            */
+
+U32 USB_PipeWrite(USB_Pipe * pPipe, const void * pData, U32 count, TickType_t timeout)
+{
+  const U8 * pSource = (const U8 *)pData;
+  U32 done = 0, n;
+  TimeOut_t time;
+
+  vTaskSetTimeOutState(&time);
+  while (TRUE)
+  {
+    n = Stream_Write(&pPipe->Tx, &pSource[done], count - done);
+    if (0 != n)
+    {
+      done += n;
+      USB_Kick();
+    }
+    if ((done == count) || (pdFALSE != xTaskCheckForTimeOut(&time, &timeout))) break;
+
+    pPipe->pWriter = xTaskGetCurrentTaskHandle();
+    if (0 == Stream_Space(&pPipe->Tx)) ulTaskNotifyTake(pdTRUE, timeout);
+    pPipe->pWriter = NULL;
+  }
+
+  return done;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 USB_PipeRead(USB_Pipe * pPipe, void * pData, U32 count, TickType_t timeout)
+{
+  TimeOut_t time;
+  U32 n;
+
+  vTaskSetTimeOutState(&time);
+  while (TRUE)
+  {
+    n = Stream_Read(&pPipe->Rx, pData, count);
+    if (0 != n)
+    {
+      USB_Kick();
+      return n;
+    }
+    if (pdFALSE != xTaskCheckForTimeOut(&time, &timeout)) return 0;
+
+    pPipe->pReader = xTaskGetCurrentTaskHandle();
+    if (0 == Stream_Count(&pPipe->Rx)) ulTaskNotifyTake(pdTRUE, timeout);
+    pPipe->pReader = NULL;
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* For a task that both reads and writes the pipe with the zero copy calls: returns when there
+   is data to read or space to write, or after the timeout                                        */
+
+void USB_PipeWait(USB_Pipe * pPipe, TickType_t timeout)
+{
+  TaskHandle_t pTask = xTaskGetCurrentTaskHandle();
+
+  pPipe->pReader = pTask;
+  pPipe->pWriter = pTask;
+  if ((0 == Stream_Count(&pPipe->Rx)) && (0 == Stream_Space(&pPipe->Tx)))
+  {
+    ulTaskNotifyTake(pdTRUE, timeout);
+  }
+  pPipe->pReader = NULL;
+  pPipe->pWriter = NULL;
+}
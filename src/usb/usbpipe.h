@@ -0,0 +1,40 @@
+#ifndef __USBPIPE_H__
+#define __USBPIPE_H__
+
+#include "types.h"
+#include "stream.h"
+#include "usb.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* A bulk IN and a bulk OUT endpoint seen by the tasks as two streams. Zero copy: the data is
+   written where the interrupt takes it from (GetWrite/Commit) and read where the interrupt puts
+   it (GetRead/Consume). One task may write and one task may read at a time; a waiting task is
+   woken by a task notification from the USB interrupt.                                           */
+
+typedef struct
+{
+  Stream                Rx;                /* OUT endpoint to the application                     */
+  Stream                Tx;                /* Application to the IN endpoint                      */
+  volatile TaskHandle_t pReader;
+  volatile TaskHandle_t pWriter;
+} USB_Pipe;
+
+U32  USB_PipeInit(USB_Pipe * pPipe, U32 in, U32 out, U8 * pRx, U32 rxSize, U8 * pTx, U32 txSize);
+
+U32  USB_PipeGetWrite(USB_Pipe * pPipe, U8 ** ppData);
+void USB_PipeCommit(USB_Pipe * pPipe, U32 count);
+U32  USB_PipeGetRead(USB_Pipe * pPipe, U8 ** ppData);
+void USB_PipeConsume(USB_Pipe * pPipe, U32 count);
+
+/* Blocks until all is written, returns the count written before the timeout */
+U32  USB_PipeWrite(USB_Pipe * pPipe, const void * pData, U32 count, TickType_t timeout);
+
+/* Blocks until at least one byte has arrived, returns the count read */
+U32  USB_PipeRead(USB_Pipe * pPipe, void * pData, U32 count, TickType_t timeout);
+
+/* Waits until there is data to read or space to write */
+void USB_PipeWait(USB_Pipe * pPipe, TickType_t timeout);
+
+#endif /* __USBPIPE_H__ */
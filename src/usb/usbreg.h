@@ -0,0 +1,49 @@
+#ifndef __USBREG_H__
+#define __USBREG_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* Every access of the device core to the USB block goes through these macros. A host build can
+   define them before including this file, to run the control transfer and the endpoint state
+   machines against a model of the registers and of the packet memory.                           */
+
+#ifndef USB_REGS
+#define USB_REGS                           (USB)
+#endif
+
+/* Packet memory: 512 bytes seen by the CPU as 16-bit words on a 32-bit stride, so the word at
+   byte offset 'o' of the packet memory is USB_PMA[o]                                             */
+#ifndef USB_PMA
+#define USB_PMA                            ((volatile U16 *)USB_PMAADDR)
+#endif
+
+#ifndef USB_EPR_READ
+#define USB_EPR_READ(n)                    ((U32)(&USB_REGS->EP0R)[2 * (n)])
+#define USB_EPR_WRITE(n, value)            ((&USB_REGS->EP0R)[2 * (n)] = (U16)(value))
+#endif
+
+/* ISTR flags are cleared by writing 0, the ones written with 1 are left alone */
+#ifndef USB_ISTR_CLEAR
+#define USB_ISTR_CLEAR(flags)              (USB_REGS->ISTR = (U16)~(flags))
+#endif
+
+#define USB_PMA_SIZE                       (512)
+#define USB_ENDPOINTS_MAX                  (8)
+
+/* Buffer descriptor table at the start of the packet memory (BTABLE = 0), 8 bytes per register.
+   A double buffered endpoint uses the TX entry for buffer 0 and the RX entry for buffer 1.       */
+#define USB_PMA_ADDR_TX(n)                 (USB_PMA[8 * (n) + 0])
+#define USB_PMA_COUNT_TX(n)                (USB_PMA[8 * (n) + 2])
+#define USB_PMA_ADDR_RX(n)                 (USB_PMA[8 * (n) + 4])
+#define USB_PMA_COUNT_RX(n)                (USB_PMA[8 * (n) + 6])
+
+#define USB_PMA_COUNT_MASK                 (0x03FFU)
+
+/* Fields of EPnR: read-write, toggled by writing 1, and cleared by writing 0 (the CTR flags) */
+#define USB_EP_RW                          (USB_EP_T_FIELD | USB_EP_KIND | USB_EPADDR_FIELD)
+#define USB_EP_CTR                         (USB_EP_CTR_RX | USB_EP_CTR_TX)
+#define USB_EP_TOGGLES                     (USB_EP_DTOG_RX | USB_EPRX_STAT | USB_EP_DTOG_TX | \
+                                            USB_EPTX_STAT)
+
+#endif /* __USBREG_H__ */
@@ -0,0 +1,30 @@
+#include "types.h"
+#include "usb.h"
+#include "usbpipe.h"
+#include "vendor.h"
+
+typedef struct
+{
+  USB_Pipe Pipe;
+  U8       Rx[VENDOR_RX_SIZE];
+  U8       Tx[VENDOR_TX_SIZE];
+} Vendor_State;
+
+static Vendor_State Vendor_This;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Vendor_Init(U32 in, U32 out)
+{
+  Vendor_State * pThis = &Vendor_This;
+
+  return USB_PipeInit(&pThis->Pipe, in, out, pThis->Rx, VENDOR_RX_SIZE, pThis->Tx,
+                      VENDOR_TX_SIZE);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+USB_Pipe * Vendor_Pipe(void)
+{
+  return &Vendor_This.Pipe;
+}
@@ -0,0 +1,17 @@
+#ifndef __VENDOR_H__
+#define __VENDOR_H__
+
+#include "types.h"
+#include "usb.h"
+#include "usbpipe.h"
+
+/* Vendor specific interface (class 0xFF) with a bulk pipe and no requests, for raw transfers
+   through libusb. The larger streams keep the IN endpoint busy at full speed.                    */
+
+#define VENDOR_RX_SIZE                     (1024)
+#define VENDOR_TX_SIZE                     (1024)
+
+U32        Vendor_Init(U32 in, U32 out);
+USB_Pipe * Vendor_Pipe(void);
+
+#endif /* __VENDOR_H__ */
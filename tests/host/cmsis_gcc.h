@@ -0,0 +1,80 @@
+#ifndef __CMSIS_GCC_H
+#define __CMSIS_GCC_H
+
+#include <stdint.h>
+
+/* The intrinsics of core_cmFunc.h and core_cmInstr.h for a host build of the target sources with
+   gcc. There is one core and no interrupt: masking is a no-op, the exclusive accesses always
+   succeed, and the instructions are computed in C as the Cortex-M3 defines them.                */
+
+__STATIC_INLINE void     __enable_irq(void)                 { }
+__STATIC_INLINE void     __disable_irq(void)                { }
+__STATIC_INLINE uint32_t __get_PRIMASK(void)                { return 0; }
+__STATIC_INLINE void     __set_PRIMASK(uint32_t priMask)    { (void)priMask; }
+__STATIC_INLINE uint32_t __get_BASEPRI(void)                { return 0; }
+__STATIC_INLINE void     __set_BASEPRI(uint32_t basePri)    { (void)basePri; }
+__STATIC_INLINE uint32_t __get_IPSR(void)                   { return 0; }
+__STATIC_INLINE uint32_t __get_CONTROL(void)                { return 0; }
+__STATIC_INLINE void     __set_CONTROL(uint32_t control)    { (void)control; }
+__STATIC_INLINE uint32_t __get_MSP(void)                    { return 0; }
+__STATIC_INLINE void     __set_MSP(uint32_t topOfStack)     { (void)topOfStack; }
+__STATIC_INLINE uint32_t __get_PSP(void)                    { return 0; }
+__STATIC_INLINE void     __set_PSP(uint32_t topOfStack)     { (void)topOfStack; }
+
+__STATIC_INLINE void     __NOP(void)                        { }
+__STATIC_INLINE void     __WFI(void)                        { }
+__STATIC_INLINE void     __WFE(void)                        { }
+__STATIC_INLINE void     __SEV(void)                        { }
+__STATIC_INLINE void     __ISB(void)                        { }
+__STATIC_INLINE void     __DSB(void)                        { }
+__STATIC_INLINE void     __DMB(void)                        { }
+
+__STATIC_INLINE uint32_t __REV(uint32_t value)              { return __builtin_bswap32(value); }
+
+__STATIC_INLINE uint32_t __RBIT(uint32_t value)
+{
+  uint32_t result = 0, i;
+
+  for (i = 0; i < 32; i++, value >>= 1) result = (result << 1) | (value & 1);
+  return result;
+}
+
+__STATIC_INLINE uint8_t  __CLZ(uint32_t value)
+{
+  return (uint8_t)((0 == value) ? 32 : __builtin_clz(value));
+}
+
+__STATIC_INLINE uint32_t __ROR(uint32_t value, uint32_t shift)
+{
+  shift &= 31;
+  return (0 == shift) ? value : ((value >> shift) | (value << (32 - shift)));
+}
+
+__STATIC_INLINE int32_t  __SSAT(int32_t value, uint32_t bits)
+{
+  int32_t max = (int32_t)((1U << (bits - 1)) - 1), min = -max - 1;
+
+  return (value > max) ? max : ((value < min) ? min : value);
+}
+
+__STATIC_INLINE uint32_t __USAT(int32_t value, uint32_t bits)
+{
+  int32_t max = (int32_t)((1U << bits) - 1);
+
+  return (uint32_t)((value > max) ? max : ((value < 0) ? 0 : value));
+}
+
+__STATIC_INLINE uint32_t __LDREXW(volatile uint32_t * pAddress)
+{
+  return *pAddress;
+}
+
+__STATIC_INLINE uint32_t __STREXW(uint32_t value, volatile uint32_t * pAddress)
+{
+  *pAddress = value;
+  return 0;
+}
+
+__STATIC_INLINE void     __CLREX(void)                      { }
+
+#endif /* __CMSIS_GCC_H */
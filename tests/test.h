@@ -0,0 +1,41 @@
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <stdio.h>
+
+#include "types.h"
+
+/* Host tests: each one is a program built from the target sources it checks (CMakeLists.txt).
+   A failed check is printed with its line and counted, the test goes on with the next one;
+   main() returns TEST_RESULT(), which is 0 when all the checks passed. Random inputs come from
+   Test_Random(), the same sequence on every run.                                                 */
+
+static U32 Test_Checks;
+static U32 Test_Failures;
+static U32 Test_Seed = 1;
+
+#define TEST_CHECK(condition)                                                                     \
+  do                                                                                              \
+  {                                                                                               \
+    Test_Checks++;                                                                                \
+    if (!(condition))                                                                             \
+    {                                                                                             \
+      printf("%s:%d: failed: %s\n", __FILE__, __LINE__, #condition);                              \
+      Test_Failures++;                                                                            \
+    }                                                                                             \
+  }                                                                                               \
+  while (0)
+
+#define TEST_RESULT()                                                                             \
+  (printf("%u checks, %u failed\n", Test_Checks, Test_Failures), (0 != Test_Failures))
+
+/* xorshift32 */
+static U32 Test_Random(void)
+{
+  Test_Seed ^= Test_Seed << 13;
+  Test_Seed ^= Test_Seed >> 17;
+  Test_Seed ^= Test_Seed << 5;
+  return Test_Seed;
+}
+
+#endif /* __TEST_H__ */
@@ -0,0 +1,555 @@
+#include <math.h>
+#include <string.h>
+
+#include "types.h"
+#include "dsp.h"
+#include "fixmath.h"
+#include "matrix.h"
+#include "quat.h"
+#include "ahrs.h"
+#include "test.h"
+
+/* The matrix, quaternion and attitude code against double precision twins fed with the same
+   quantized inputs. The matrices are random Q16.16 and the quaternions random unit ones in Q30;
+   the filters run on a board held tilted, turning about the vertical, and with a gyroscope bias.
+   The largest error of each function is printed next to its bound.                              */
+
+#define TEST_RUNS                          (20000)
+#define TEST_Q16                           (65536.0)
+#define TEST_Q30                           (1073741824.0)
+
+/* 1/65536 turn per radian */
+#define TEST_ANGLE                         (65536.0 / (2.0 * M_PI))
+
+/* Update rate of the filters, accelerometer LSB per g */
+#define TEST_RATE                          (200)
+#define TEST_G                             (16384.0)
+
+/* Madgwick Beta, Mahony Kp and Ki */
+#define TEST_BETA                          (0.04)
+#define TEST_KP                            (2.0)
+#define TEST_KI                            (0.2)
+
+/* Bounds: LSB of the output format, except where noted */
+#define TEST_BOUND_PRODUCT                 (0.5)
+#define TEST_BOUND_DET                     (4.0)
+#define TEST_BOUND_INVERSE                 (2.0)
+#define TEST_BOUND_NORMALIZE               (1.5)
+#define TEST_BOUND_ROTATE                  (1.5)
+#define TEST_BOUND_MATRIX                  (1.0)
+#define TEST_BOUND_EULER                   (2.0)     /* 1/65536 turn, pitch within +-85 degrees */
+#define TEST_BOUND_TWIN                    (1e-4)    /* Quaternion component, filter vs twin    */
+#define TEST_BOUND_STEP                    (2.0 * TEST_BETA / TEST_RATE)  /* Madgwick, 2 steps */
+#define TEST_BOUND_ATTITUDE                (0.2)     /* Degrees, settled filter vs truth        */
+
+/* Double precision quaternion: w, x, y, z */
+typedef double Test_Quat[4];
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static double test_Uniform(double low, double high)
+{
+  return low + (high - low) * (Test_Random() / 4294967296.0);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Of a turn, the shorter way round */
+
+static double test_AngleError(Math_Angle angle, double radians)
+{
+  double error = fabs(fmod((double)(S16)angle - radians * TEST_ANGLE, 65536.0));
+
+  return (32768.0 < error) ? 65536.0 - error : error;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Aerospace sequence, as Quat_ToEuler() reads it back */
+
+static void test_FromEuler(Test_Quat q, double roll, double pitch, double yaw)
+{
+  double cr = cos(roll / 2.0), sr = sin(roll / 2.0);
+  double cp = cos(pitch / 2.0), sp = sin(pitch / 2.0);
+  double cy = cos(yaw / 2.0), sy = sin(yaw / 2.0);
+
+  q[0] = cr * cp * cy + sr * sp * sy;
+  q[1] = sr * cp * cy - cr * sp * sy;
+  q[2] = cr * sp * cy + sr * cp * sy;
+  q[3] = cr * cp * sy - sr * sp * cy;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_ToEuler(const Test_Quat q, double * pRoll, double * pPitch)
+{
+  *pRoll  = atan2(2.0 * (q[0] * q[1] + q[2] * q[3]), 1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2]));
+  *pPitch = asin(2.0 * (q[0] * q[2] - q[3] * q[1]));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A random unit quaternion in Q30, 'q' gets the quantized values */
+
+static void test_RandomQuat(Quat * pQ, Test_Quat q)
+{
+  double length;
+  U32 i;
+
+  do
+  {
+    for (i = 0, length = 0.0; i < 4; i++)
+    {
+      q[i] = test_Uniform(-1.0, 1.0);
+      length += q[i] * q[i];
+    }
+  }
+  while ((1.0 < length) || (0.01 > length));
+
+  pQ->W = (S32)lrint(q[0] / sqrt(length) * TEST_Q30);
+  pQ->X = (S32)lrint(q[1] / sqrt(length) * TEST_Q30);
+  pQ->Y = (S32)lrint(q[2] / sqrt(length) * TEST_Q30);
+  pQ->Z = (S32)lrint(q[3] / sqrt(length) * TEST_Q30);
+  q[0] = pQ->W / TEST_Q30;
+  q[1] = pQ->X / TEST_Q30;
+  q[2] = pQ->Y / TEST_Q30;
+  q[3] = pQ->Z / TEST_Q30;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Products against the exact sums (the Q16 operands keep them exact in double), the in place
+   forms against the separate ones, the determinant and the inverse of well conditioned matrices
+   against their double precision values                                                          */
+
+static void test_Matrix(void)
+{
+  double product = 0.0, det = 0.0, inverse = 0.0, m[3][3], cof[3][3], d, sum;
+  U32 wrong = 0, run, i, j, k;
+  Mat3 a, b, c, t;
+  Mat4 a4, b4, c4, t4;
+  Vec3 v, w;
+  S32 v4[4], w4[4];
+
+  for (run = 0; run < TEST_RUNS; run++)
+  {
+    for (i = 0; i < 4; i++)
+    {
+      for (j = 0; j < 4; j++)
+      {
+        a4.M[i][j] = (S32)test_Uniform(-4.0 * TEST_Q16, 4.0 * TEST_Q16);
+        b4.M[i][j] = (S32)test_Uniform(-4.0 * TEST_Q16, 4.0 * TEST_Q16);
+        if ((3 > i) && (3 > j))
+        {
+          a.M[i][j] = a4.M[i][j];
+          b.M[i][j] = b4.M[i][j];
+        }
+      }
+      v4[i] = (S32)test_Uniform(-1048576.0, 1048576.0);
+    }
+    v.X = v4[0];
+    v.Y = v4[1];
+    v.Z = v4[2];
+
+    Mat3_Mul(&c, &a, &b, 16);
+    Mat3_MulVec(&w, &a, &v, 16);
+    for (i = 0; i < 3; i++)
+    {
+      for (j = 0; j < 3; j++)
+      {
+        for (k = 0, sum = 0.0; k < 3; k++) sum += (double)a.M[i][k] * b.M[k][j];
+        product = fmax(product, fabs(c.M[i][j] - sum / TEST_Q16));
+      }
+      sum = (double)a.M[i][0] * v.X + (double)a.M[i][1] * v.Y + (double)a.M[i][2] * v.Z;
+      product = fmax(product, fabs((&w.X)[i] - sum / TEST_Q16));
+    }
+
+    Mat4_Mul(&c4, &a4, &b4, 16);
+    Mat4_MulVec(w4, &a4, v4, 16);
+    for (i = 0; i < 4; i++)
+    {
+      for (j = 0; j < 4; j++)
+      {
+        for (k = 0, sum = 0.0; k < 4; k++) sum += (double)a4.M[i][k] * b4.M[k][j];
+        product = fmax(product, fabs(c4.M[i][j] - sum / TEST_Q16));
+      }
+      for (k = 0, sum = 0.0; k < 4; k++) sum += (double)a4.M[i][k] * v4[k];
+      product = fmax(product, fabs(w4[i] - sum / TEST_Q16));
+    }
+
+    /* In place */
+    t = a;
+    Mat3_Mul(&t, &t, &b, 16);
+    if (0 != memcmp(&t, &c, sizeof(Mat3))) wrong++;
+    t4 = a4;
+    Mat4_Mul(&t4, &t4, &b4, 16);
+    if (0 != memcmp(&t4, &c4, sizeof(Mat4))) wrong++;
+    w4[0] = v4[0];
+    w4[1] = v4[1];
+    w4[2] = v4[2];
+    w4[3] = v4[3];
+    Mat4_MulVec(w4, &a4, w4, 16);
+    Mat4_MulVec(v4, &a4, v4, 16);
+    if (0 != memcmp(w4, v4, sizeof(v4))) wrong++;
+
+    t = a;
+    Mat3_Transpose(&t, &t);
+    Mat3_Add(&c, &t, &b);
+    t4 = a4;
+    Mat4_Transpose(&t4, &t4);
+    Mat4_Add(&c4, &t4, &b4);
+    for (i = 0; i < 4; i++)
+    {
+      for (j = 0; j < 4; j++)
+      {
+        if (c4.M[i][j] != a4.M[j][i] + b4.M[i][j]) wrong++;
+        if ((3 > i) && (3 > j) && (c.M[i][j] != a.M[j][i] + b.M[i][j])) wrong++;
+      }
+    }
+
+    /* Diagonally dominant, |det| above 1 */
+    for (i = 0; i < 3; i++)
+    {
+      for (j = 0; j < 3; j++)
+      {
+        a.M[i][j] = (S32)test_Uniform(-0.5 * TEST_Q16, 0.5 * TEST_Q16);
+        if (i == j) a.M[i][j] += ((0 != (Test_Random() & 1)) ? 3 : -3) * (S32)TEST_Q16;
+        m[i][j] = a.M[i][j] / TEST_Q16;
+      }
+    }
+    for (i = 0; i < 3; i++)
+    {
+      for (j = 0; j < 3; j++)
+      {
+        cof[i][j] = m[(i + 1) % 3][(j + 1) % 3] * m[(i + 2) % 3][(j + 2) % 3] -
+                    m[(i + 1) % 3][(j + 2) % 3] * m[(i + 2) % 3][(j + 1) % 3];
+      }
+    }
+    d = m[0][0] * cof[0][0] + m[0][1] * cof[0][1] + m[0][2] * cof[0][2];
+    det = fmax(det, fabs(Mat3_Det(&a, 16) - d * TEST_Q16));
+
+    if (FALSE == Mat3_Inverse(&t, &a, 16)) wrong++;
+    for (i = 0; i < 3; i++)
+    {
+      for (j = 0; j < 3; j++) inverse = fmax(inverse, fabs(t.M[i][j] - cof[j][i] / d * TEST_Q16));
+    }
+  }
+
+  printf("matrix   product %.3f  det %.3f  inverse %.3f LSB\n", product, det, inverse);
+  TEST_CHECK(0 == wrong);
+  TEST_CHECK(TEST_BOUND_PRODUCT >= product);
+  TEST_CHECK(TEST_BOUND_DET >= det);
+  TEST_CHECK(TEST_BOUND_INVERSE >= inverse);
+
+  memset(&a, 0, sizeof(a));
+  TEST_CHECK(FALSE == Mat3_Inverse(&t, &a, 16));
+  Mat3_Identity(&a, 30);
+  Mat3_Add(&a, &a, &a);
+  TEST_CHECK((Q31_MAX == a.M[0][0]) && (0 == a.M[0][1]));
+  Mat4_Identity(&a4, 16);
+  TEST_CHECK((65536 == a4.M[3][3]) && (0 == a4.M[3][0]));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Quaternion(void)
+{
+  double product = 0.0, normalize = 0.0, rotate = 0.0, matrix = 0.0, euler = 0.0;
+  double r[4], scale, length, t[3], u[3], roll, pitch, yaw;
+  Test_Quat qa, qb;
+  Math_Angle angles[3];
+  Quat a, b, c;
+  Vec3 v, w;
+  Mat3 m;
+  U32 run, i;
+
+  for (run = 0; run < TEST_RUNS; run++)
+  {
+    test_RandomQuat(&a, qa);
+    test_RandomQuat(&b, qb);
+
+    Quat_Mul(&c, &a, &b);
+    r[0] = qa[0] * qb[0] - qa[1] * qb[1] - qa[2] * qb[2] - qa[3] * qb[3];
+    r[1] = qa[0] * qb[1] + qa[1] * qb[0] + qa[2] * qb[3] - qa[3] * qb[2];
+    r[2] = qa[0] * qb[2] - qa[1] * qb[3] + qa[2] * qb[0] + qa[3] * qb[1];
+    r[3] = qa[0] * qb[3] + qa[1] * qb[2] - qa[2] * qb[1] + qa[3] * qb[0];
+    for (i = 0; i < 4; i++) product = fmax(product, fabs((&c.W)[i] - r[i] * TEST_Q30));
+
+    /* Any length up to 1.9 */
+    scale = test_Uniform(0.001, 1.9);
+    for (i = 0, length = 0.0; i < 4; i++)
+    {
+      (&c.W)[i] = (S32)lrint(qa[i] * scale * TEST_Q30);
+      length += (double)(&c.W)[i] * (&c.W)[i];
+    }
+    for (i = 0; i < 4; i++) r[i] = (&c.W)[i] / sqrt(length);
+    TEST_CHECK(FALSE != Quat_Normalize(&c));
+    for (i = 0; i < 4; i++) normalize = fmax(normalize, fabs((&c.W)[i] - r[i] * TEST_Q30));
+
+    /* Raw sensor readings */
+    scale = (0 != (run & 1)) ? 32767.0 : 1e9;
+    v.X = (S32)test_Uniform(-scale, scale);
+    v.Y = (S32)test_Uniform(-scale, scale);
+    v.Z = (S32)test_Uniform(-scale, scale);
+    length = sqrt((double)v.X * v.X + (double)v.Y * v.Y + (double)v.Z * v.Z);
+    w = v;
+    if (FALSE != Vec3_Normalize(&w))
+    {
+      normalize = fmax(normalize, fabs(w.X - v.X / length * TEST_Q30));
+      normalize = fmax(normalize, fabs(w.Y - v.Y / length * TEST_Q30));
+      normalize = fmax(normalize, fabs(w.Z - v.Z / length * TEST_Q30));
+    }
+
+    /* v + w t + q x t with t = 2 q x v, which is q v q* for a unit q */
+    v.X = (S32)test_Uniform(-16777216.0, 16777216.0);
+    v.Y = (S32)test_Uniform(-16777216.0, 16777216.0);
+    v.Z = (S32)test_Uniform(-16777216.0, 16777216.0);
+    Quat_Rotate(&w, &a, &v);
+    t[0] = 2.0 * (qa[2] * v.Z - qa[3] * v.Y);
+    t[1] = 2.0 * (qa[3] * v.X - qa[1] * v.Z);
+    t[2] = 2.0 * (qa[1] * v.Y - qa[2] * v.X);
+    u[0] = v.X + qa[0] * t[0] + qa[2] * t[2] - qa[3] * t[1];
+    u[1] = v.Y + qa[0] * t[1] + qa[3] * t[0] - qa[1] * t[2];
+    u[2] = v.Z + qa[0] * t[2] + qa[1] * t[1] - qa[2] * t[0];
+    rotate = fmax(rotate, fabs(w.X - u[0]));
+    rotate = fmax(rotate, fabs(w.Y - u[1]));
+    rotate = fmax(rotate, fabs(w.Z - u[2]));
+
+    Quat_ToMatrix(&m, &a);
+    r[0] = 1.0 - 2.0 * (qa[2] * qa[2] + qa[3] * qa[3]);
+    r[1] = 2.0 * (qa[1] * qa[2] - qa[0] * qa[3]);
+    r[2] = 2.0 * (qa[1] * qa[3] + qa[0] * qa[2]);
+    r[3] = 2.0 * (qa[2] * qa[3] + qa[0] * qa[1]);
+    matrix = fmax(matrix, fabs(m.M[0][0] - r[0] * TEST_Q30));
+    matrix = fmax(matrix, fabs(m.M[0][1] - r[1] * TEST_Q30));
+    matrix = fmax(matrix, fabs(m.M[0][2] - r[2] * TEST_Q30));
+    matrix = fmax(matrix, fabs(m.M[2][1] - r[3] * TEST_Q30));
+
+    roll  = test_Uniform(-M_PI, M_PI);
+    pitch = test_Uniform(-85.0, 85.0) * M_PI / 180.0;
+    yaw   = test_Uniform(-M_PI, M_PI);
+    test_FromEuler(qa, roll, pitch, yaw);
+    a.W = (S32)lrint(qa[0] * TEST_Q30);
+    a.X = (S32)lrint(qa[1] * TEST_Q30);
+    a.Y = (S32)lrint(qa[2] * TEST_Q30);
+    a.Z = (S32)lrint(qa[3] * TEST_Q30);
+    Quat_ToEuler(&a, &angles[0], &angles[1], &angles[2]);
+    euler = fmax(euler, test_AngleError(angles[0], roll));
+    euler = fmax(euler, test_AngleError(angles[1], pitch));
+    euler = fmax(euler, test_AngleError(angles[2], yaw));
+  }
+
+  printf("quat     mul %.3f  normalize %.3f  rotate %.3f  matrix %.3f LSB", product, normalize,
+         rotate, matrix);
+  printf("  euler %.3f / 65536 turn\n", euler);
+  TEST_CHECK(TEST_BOUND_PRODUCT >= product);
+  TEST_CHECK(TEST_BOUND_NORMALIZE >= normalize);
+  TEST_CHECK(TEST_BOUND_ROTATE >= rotate);
+  TEST_CHECK(TEST_BOUND_MATRIX >= matrix);
+  TEST_CHECK(TEST_BOUND_EULER >= euler);
+
+  memset(&c, 0, sizeof(c));
+  TEST_CHECK(FALSE == Quat_Normalize(&c));
+  Quat_Identity(&a);
+  Quat_Conj(&b, &a);
+  Quat_Mul(&c, &a, &b);
+  TEST_CHECK((QUAT_ONE == c.W) && (0 == c.X) && (0 == c.Y) && (0 == c.Z));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The filters in double precision, the same equations as ahrs.c */
+
+typedef struct
+{
+  Test_Quat Q;
+  double Beta;
+  double Kp;
+  double Ki;
+  double Bias[3];
+} Test_Filter;
+
+static void test_Integrate(Test_Quat q, const double * pRate, const double * pCorrection)
+{
+  double dot[4], length;
+  U32 i;
+
+  dot[0] = 0.5 * (-q[1] * pRate[0] - q[2] * pRate[1] - q[3] * pRate[2]);
+  dot[1] = 0.5 * ( q[0] * pRate[0] + q[2] * pRate[2] - q[3] * pRate[1]);
+  dot[2] = 0.5 * ( q[0] * pRate[1] - q[1] * pRate[2] + q[3] * pRate[0]);
+  dot[3] = 0.5 * ( q[0] * pRate[2] + q[1] * pRate[1] - q[2] * pRate[0]);
+
+  for (i = 0, length = 0.0; i < 4; i++)
+  {
+    if (NULL != pCorrection) dot[i] -= pCorrection[i];
+    q[i] += dot[i] / TEST_RATE;
+    length += q[i] * q[i];
+  }
+  for (i = 0; i < 4; i++) q[i] /= sqrt(length);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Madgwick(Test_Filter * pFilter, const double * pRate, const double * pAccel)
+{
+  double * q = pFilter->Q, f[3], s[4], length;
+  U32 i;
+
+  f[0] = 2.0 * (q[1] * q[3] - q[0] * q[2]) - pAccel[0];
+  f[1] = 2.0 * (q[0] * q[1] + q[2] * q[3]) - pAccel[1];
+  f[2] = 1.0 - 2.0 * (q[1] * q[1] + q[2] * q[2]) - pAccel[2];
+
+  s[0] = -2.0 * q[2] * f[0] + 2.0 * q[1] * f[1];
+  s[1] =  2.0 * q[3] * f[0] + 2.0 * q[0] * f[1] - 4.0 * q[1] * f[2];
+  s[2] = -2.0 * q[0] * f[0] + 2.0 * q[3] * f[1] - 4.0 * q[2] * f[2];
+  s[3] =  2.0 * q[1] * f[0] + 2.0 * q[2] * f[1];
+
+  length = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2] + s[3] * s[3]);
+  for (i = 0; i < 4; i++) s[i] = (0.0 < length) ? pFilter->Beta * s[i] / length : 0.0;
+
+  test_Integrate(q, pRate, s);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Mahony(Test_Filter * pFilter, const double * pRate, const double * pAccel)
+{
+  double * q = pFilter->Q, v[3], e[3], rate[3];
+  U32 i;
+
+  v[0] = 2.0 * (q[1] * q[3] - q[0] * q[2]);
+  v[1] = 2.0 * (q[0] * q[1] + q[2] * q[3]);
+  v[2] = q[0] * q[0] - q[1] * q[1] - q[2] * q[2] + q[3] * q[3];
+
+  e[0] = pAccel[1] * v[2] - pAccel[2] * v[1];
+  e[1] = pAccel[2] * v[0] - pAccel[0] * v[2];
+  e[2] = pAccel[0] * v[1] - pAccel[1] * v[0];
+
+  for (i = 0; i < 3; i++)
+  {
+    pFilter->Bias[i] += pFilter->Ki * e[i] / TEST_RATE;
+    rate[i] = pRate[i] + pFilter->Kp * e[i] + pFilter->Bias[i];
+  }
+
+  test_Integrate(q, rate, NULL);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* 'seconds' of updates of both filters and their twins on a board at the attitude 'truth' turning
+   at 'rate' (rad/s, body frame) with the gyroscope off by 'bias'. The largest distance of each
+   filter from its twin goes to pTrack, the settled roll and pitch errors to pError (degrees).   */
+
+static void test_Run(const Test_Quat truth, const double * pRate, const double * pBias,
+                     U32 seconds, double * pTrack, double * pError)
+{
+  Test_Filter twins[2] = {{{1.0}, TEST_BETA, 0.0, 0.0}, {{1.0}, 0.0, TEST_KP, TEST_KI}};
+  double accel[3], rate[3], gravity, roll, pitch, truthRoll, truthPitch;
+  Test_Quat attitude;
+  Madgwick madgwick;
+  Mahony mahony;
+  Vec3 gyro, raw;
+  Quat q[2];
+  Math_Angle angles[3];
+  U32 k, f, i;
+
+  memcpy(attitude, truth, sizeof(Test_Quat));
+  Madgwick_Init(&madgwick, TEST_RATE, Q30(TEST_BETA));
+  Mahony_Init(&mahony, TEST_RATE, Q16(TEST_KP), Q16(TEST_KI));
+  pTrack[0] = 0.0;
+  pTrack[1] = 0.0;
+
+  for (k = 0; k < seconds * TEST_RATE; k++)
+  {
+    /* Gravity in the body frame, the third row of R(q), as a raw reading */
+    raw.X = (S32)lrint(2.0 * (attitude[1] * attitude[3] - attitude[0] * attitude[2]) * TEST_G);
+    raw.Y = (S32)lrint(2.0 * (attitude[0] * attitude[1] + attitude[2] * attitude[3]) * TEST_G);
+    raw.Z = (S32)lrint((attitude[0] * attitude[0] - attitude[1] * attitude[1] -
+                        attitude[2] * attitude[2] + attitude[3] * attitude[3]) * TEST_G);
+    gravity = sqrt((double)raw.X * raw.X + (double)raw.Y * raw.Y + (double)raw.Z * raw.Z);
+    accel[0] = raw.X / gravity;
+    accel[1] = raw.Y / gravity;
+    accel[2] = raw.Z / gravity;
+
+    gyro.X = Q16(pRate[0] + pBias[0]);
+    gyro.Y = Q16(pRate[1] + pBias[1]);
+    gyro.Z = Q16(pRate[2] + pBias[2]);
+    rate[0] = gyro.X / TEST_Q16;
+    rate[1] = gyro.Y / TEST_Q16;
+    rate[2] = gyro.Z / TEST_Q16;
+
+    Madgwick_Update(&madgwick, &gyro, &raw);
+    Mahony_Update(&mahony, &gyro, &raw);
+    test_Madgwick(&twins[0], rate, accel);
+    test_Mahony(&twins[1], rate, accel);
+
+    q[0] = madgwick.Q;
+    q[1] = mahony.Q;
+    for (f = 0; f < 2; f++)
+    {
+      for (i = 0; i < 4; i++)
+      {
+        pTrack[f] = fmax(pTrack[f], fabs((&q[f].W)[i] / TEST_Q30 - twins[f].Q[i]));
+      }
+    }
+
+    test_Integrate(attitude, pRate, NULL);
+  }
+
+  test_ToEuler(attitude, &truthRoll, &truthPitch);
+  for (f = 0; f < 2; f++)
+  {
+    Quat_ToEuler(&q[f], &angles[0], &angles[1], &angles[2]);
+    roll  = test_AngleError(angles[0], truthRoll) * 360.0 / 65536.0;
+    pitch = test_AngleError(angles[1], truthPitch) * 360.0 / 65536.0;
+    pError[f] = fmax(roll, pitch);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* From the identity, both filters have to find the tilt; the yaw is not observable without a
+   magnetometer and only has to follow the gyroscope. The Mahony integral takes the bias out, its
+   slow pole is at Ki / Kp. The Madgwick step has the length Beta dt whatever the gradient: while
+   the bias keeps it off the optimum, 1 LSB may turn the step of the filter and not of its twin. */
+
+static void test_Filters(void)
+{
+  static const double still[3] = {0.0, 0.0, 0.0};
+  static const double turning[3] = {0.0, 0.0, 0.5};
+  static const double bias[3] = {0.02, -0.01, 0.0};
+  double track[2], error[2];
+  Test_Quat truth;
+
+  test_FromEuler(truth, 30.0 * M_PI / 180.0, -20.0 * M_PI / 180.0, 0.0);
+  test_Run(truth, still, still, 40, track, error);
+  printf("tilted   twin %.2e %.2e  madgwick %.3f  mahony %.3f degrees\n",
+         track[0], track[1], error[0], error[1]);
+  TEST_CHECK((TEST_BOUND_TWIN >= track[0]) && (TEST_BOUND_TWIN >= track[1]));
+  TEST_CHECK((TEST_BOUND_ATTITUDE >= error[0]) && (TEST_BOUND_ATTITUDE >= error[1]));
+
+  test_FromEuler(truth, 0.0, 0.0, 0.0);
+  test_Run(truth, turning, still, 10, track, error);
+  printf("turning  twin %.2e %.2e  madgwick %.3f  mahony %.3f degrees\n",
+         track[0], track[1], error[0], error[1]);
+  TEST_CHECK((TEST_BOUND_TWIN >= track[0]) && (TEST_BOUND_TWIN >= track[1]));
+  TEST_CHECK((TEST_BOUND_ATTITUDE >= error[0]) && (TEST_BOUND_ATTITUDE >= error[1]));
+
+  test_FromEuler(truth, -10.0 * M_PI / 180.0, 15.0 * M_PI / 180.0, 0.0);
+  test_Run(truth, still, bias, 60, track, error);
+  printf("biased   twin %.2e %.2e  madgwick %.3f  mahony %.3f degrees\n",
+         track[0], track[1], error[0], error[1]);
+  TEST_CHECK((TEST_BOUND_STEP >= track[0]) && (TEST_BOUND_TWIN >= track[1]));
+  TEST_CHECK(TEST_BOUND_ATTITUDE >= error[1]);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int main(void)
+{
+  test_Matrix();
+  test_Quaternion();
+  test_Filters();
+
+  return TEST_RESULT();
+}
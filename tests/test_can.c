@@ -0,0 +1,312 @@
+#include <string.h>
+
+#include "types.h"
+#include "irq.h"
+#include "clock.h"
+#include "can.h"
+#include "test.h"
+
+/* The filter bank compiler against the bank layouts of the reference manual. A fixed list is
+   checked register by register, with the filter match indexes of both FIFOs; random lists of
+   every kind of entry are then checked through CAN_Match() against a plain walk of the list.
+   Only the pure functions of can.c run here, the peripheral is never touched.                    */
+
+#define TEST_SETS                          (4000)
+#define TEST_FRAMES                        (400)
+#define TEST_FILTERS_MAX                   (60)
+
+#define TEST_EXACT                         (0xFFFFFFFFU)
+
+static const CAN_Filter Test_Filters[] =
+{
+  {0x100,                   TEST_EXACT,                  0},   /* 0..3 - 16-bit list bank         */
+  {0x101,                   TEST_EXACT,                  0},
+  {0x102,                   TEST_EXACT,                  0},
+  {0x103,                   TEST_EXACT,                  0},
+  {0x104,                   TEST_EXACT,                  0},   /* Left over, joins the mask       */
+  {0x200,                   0x7F0,                       0},
+  {CAN_ID_EXT | 0x18DAF110, TEST_EXACT,                  0},
+  {CAN_ID_EXT | 0x18FF0000, 0x1FFF0000 | CAN_ID_RTR,     1},
+  {0x7E8,                   TEST_EXACT,                  1}
+};
+
+typedef struct
+{
+  U32 Id;
+  U32 Accepted;
+  U32 Fifo;
+  U32 Filter;
+} Test_Frame;
+
+static const Test_Frame Test_Frames[] =
+{
+  {0x100,                                TRUE,  0, 0},
+  {0x103,                                TRUE,  0, 3},
+  {0x104,                                TRUE,  0, 4},
+  {0x105,                                FALSE, 0, 0},
+  {0x20F,                                TRUE,  0, 5},
+  {0x200 | CAN_ID_RTR,                   TRUE,  0, 5},
+  {0x210,                                FALSE, 0, 0},
+  {0x104 | CAN_ID_RTR,                   FALSE, 0, 0},
+  {CAN_ID_EXT | 0x18DAF110,              TRUE,  0, 6},
+  {CAN_ID_EXT | 0x18DAF111,              FALSE, 0, 0},
+  {CAN_ID_EXT | 0x18FF1234,              TRUE,  1, 7},
+  {CAN_ID_EXT | 0x18FF1234 | CAN_ID_RTR, FALSE, 0, 0},
+  {0x7E8,                                TRUE,  1, 8},
+  {CAN_ID_EXT | 0x7E8,                   FALSE, 0, 0},
+  {CAN_ID_EXT | 0x100,                   FALSE, 0, 0}
+};
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void IRQ_Attach(IRQn_Type irq, IRQ_Handler pFunc, void * pContext)
+{
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void Clock_Register(Clock_Notifier * pNotifier, Clock_Callback pFunc, void * pContext)
+{
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+U32 Clock_GetPCLK1(void)
+{
+  return 36000000;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The entry compares the identifier bits its mask selects, RTR if selected, and always IDE */
+
+static U32 test_Accepts(const CAN_Filter * pFilter, U32 id)
+{
+  U32 bits = ((0 != (pFilter->Id & CAN_ID_EXT)) ? CAN_ID_EXT_MASK : CAN_ID_STD_MASK) | CAN_ID_RTR;
+
+  return (0 == ((id ^ pFilter->Id) & ((pFilter->Mask & bits) | CAN_ID_EXT)));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* 16-bit list, 16-bit mask, 32-bit list, 16-bit list, 32-bit mask: FIFO 0 numbers the slots of
+   its three banks 0 to 7, FIFO 1 those of its two banks 0 to 4                                   */
+
+static void test_Layout(void)
+{
+  static const U8 match0[8] = {0, 1, 2, 3, 4, 5, 6, 6};
+  static const U8 match1[5] = {8, 8, 8, 8, 7};
+  CAN_Banks banks;
+  U32 fifo, filter, accepted, i;
+
+  TEST_CHECK(FALSE != CAN_Compile(Test_Filters, 9, &banks));
+  TEST_CHECK(5 == banks.Banks);
+  TEST_CHECK((0x0D == banks.FM1R) && (0x14 == banks.FS1R));
+  TEST_CHECK((0x18 == banks.FFA1R) && (0x1F == banks.FA1R));
+
+  TEST_CHECK((0x20202000 == banks.FR[0][0]) && (0x20602040 == banks.FR[0][1]));
+  TEST_CHECK((0xFFF82080 == banks.FR[1][0]) && (0xFE084000 == banks.FR[1][1]));
+  TEST_CHECK((0xC6D78884 == banks.FR[2][0]) && (0xC6D78884 == banks.FR[2][1]));
+  TEST_CHECK((0xFD00FD00 == banks.FR[3][0]) && (0xFD00FD00 == banks.FR[3][1]));
+  TEST_CHECK((0xC7F80004 == banks.FR[4][0]) && (0xFFF80006 == banks.FR[4][1]));
+
+  TEST_CHECK(0 == memcmp(banks.Match[0], match0, sizeof(match0)));
+  TEST_CHECK(0 == memcmp(banks.Match[1], match1, sizeof(match1)));
+
+  for (i = 0; i < sizeof(Test_Frames) / sizeof(Test_Frames[0]); i++)
+  {
+    accepted = CAN_Match(&banks, Test_Frames[i].Id, &fifo, &filter);
+    TEST_CHECK(Test_Frames[i].Accepted == accepted);
+    if (FALSE == accepted) continue;
+
+    TEST_CHECK((Test_Frames[i].Fifo == fifo) && (Test_Frames[i].Filter == filter));
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Of the entries that take a frame, the hardware reports one in 32-bit scale before 16-bit, in
+   list mode before mask mode, then the one with the lowest filter number, whatever the FIFO      */
+
+static void test_Priority(void)
+{
+  static const CAN_Filter filters[] =
+  {
+    {0x300,                   0x700,      1},
+    {0x310,                   TEST_EXACT, 0},          /* Alone, goes to the mask bank            */
+    {0x300,                   0x7F0,      0},
+    {CAN_ID_EXT | 0x1000,     0x1FFFFF00, 0},
+    {CAN_ID_EXT | 0x1000,     TEST_EXACT, 1}
+  };
+  CAN_Banks banks;
+  U32 fifo, filter;
+
+  TEST_CHECK((FALSE != CAN_Compile(filters, 5, &banks)) && (4 == banks.Banks));
+
+  TEST_CHECK(FALSE != CAN_Match(&banks, 0x310, &fifo, &filter));
+  TEST_CHECK((0 == fifo) && (1 == filter));
+  TEST_CHECK(FALSE != CAN_Match(&banks, 0x305, &fifo, &filter));
+  TEST_CHECK((0 == fifo) && (2 == filter));
+  TEST_CHECK(FALSE != CAN_Match(&banks, 0x345, &fifo, &filter));
+  TEST_CHECK((1 == fifo) && (0 == filter));
+
+  TEST_CHECK(FALSE != CAN_Match(&banks, CAN_ID_EXT | 0x1000, &fifo, &filter));
+  TEST_CHECK((1 == fifo) && (4 == filter));
+  TEST_CHECK(FALSE != CAN_Match(&banks, CAN_ID_EXT | 0x1001, &fifo, &filter));
+  TEST_CHECK((0 == fifo) && (3 == filter));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Capacity(void)
+{
+  CAN_Filter filters[2 * CAN_MATCHES + 1];
+  CAN_Banks banks;
+  U32 i;
+
+  /* Four standard identifiers per bank: seven banks for each FIFO */
+  for (i = 0; i <= 2 * CAN_MATCHES; i++)
+  {
+    filters[i].Id   = i;
+    filters[i].Mask = TEST_EXACT;
+    filters[i].Fifo = (U8)(i & 1);
+  }
+  TEST_CHECK((FALSE != CAN_Compile(filters, 4 * CAN_BANKS, &banks)) && (14 == banks.Banks));
+  TEST_CHECK(0x3F80 == banks.FFA1R);
+  TEST_CHECK(FALSE == CAN_Compile(filters, 4 * CAN_BANKS + 1, &banks));
+  TEST_CHECK(FALSE == CAN_Compile(filters, 2 * CAN_MATCHES + 1, &banks));
+
+  /* Two extended identifiers per bank */
+  for (i = 0; i < 29; i++)
+  {
+    filters[i].Id   = CAN_ID_EXT | i;
+    filters[i].Fifo = 0;
+  }
+  TEST_CHECK((FALSE != CAN_Compile(filters, 28, &banks)) && (14 == banks.Banks));
+  TEST_CHECK(FALSE == CAN_Compile(filters, 29, &banks));
+
+  /* One extended mask per bank, the fifteenth bank is needed by FIFO 1 */
+  for (i = 0; i < 15; i++)
+  {
+    filters[i].Id   = CAN_ID_EXT | (i << 8);
+    filters[i].Mask = 0x1FFFFF00;
+    filters[i].Fifo = (13 <= i);
+  }
+  TEST_CHECK((FALSE != CAN_Compile(filters, 14, &banks)) && (0x2000 == banks.FFA1R));
+  TEST_CHECK(FALSE == CAN_Compile(filters, 15, &banks));
+
+  /* A single standard identifier fills the free slot of a mask bank */
+  TEST_CHECK((FALSE != CAN_Compile(Test_Filters, 6, &banks)) && (2 == banks.Banks));
+
+  filters[0].Fifo = 2;
+  TEST_CHECK(FALSE == CAN_Compile(filters, 1, &banks));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Identifiers from a few small clusters, so that the entries overlap and compete for frames */
+
+static void test_RandomFilter(CAN_Filter * pFilter)
+{
+  U32 random = Test_Random();
+
+  if (0 != (random & 1))
+  {
+    pFilter->Id = CAN_ID_EXT | ((random >> 8) & 0x700) | (Test_Random() & 3);
+    if (0 != (random & 2)) pFilter->Id |= Test_Random() & 0x1FFFF800;
+  }
+  else
+  {
+    pFilter->Id = ((random >> 8) & 0x70) | (Test_Random() & 3);
+  }
+  if (0 == (random & 0x1C)) pFilter->Id |= CAN_ID_RTR;
+
+  pFilter->Fifo = (U8)((random >> 5) & 1);
+  pFilter->Mask = TEST_EXACT;
+  if (0 != ((random >> 6) % 3))
+  {
+    pFilter->Mask = Test_Random() & ~(1U << (Test_Random() % 11));
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A frame near one of the entries, or any identifier */
+
+static U32 test_RandomId(const CAN_Filter * pFilters, U32 count)
+{
+  U32 random = Test_Random(), id;
+
+  if (0 != (random & 1))
+  {
+    id = pFilters[Test_Random() % count].Id;
+    if (0 == (random & 6)) id ^= 1U << (Test_Random() % 11);
+  }
+  else if (0 != (random & 2))
+  {
+    id = CAN_ID_EXT | (Test_Random() & CAN_ID_EXT_MASK);
+  }
+  else
+  {
+    id = Test_Random() & 0x7F;
+  }
+  if (0 == (random & 0x38)) id ^= CAN_ID_RTR;
+
+  return id & ((0 != (id & CAN_ID_EXT)) ? (CAN_ID_EXT | CAN_ID_RTR | CAN_ID_EXT_MASK) :
+                                          (CAN_ID_RTR | CAN_ID_STD_MASK));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A frame is accepted when any entry takes it, and is reported under one of those entries, in
+   the FIFO of that entry                                                                         */
+
+static void test_Sweep(void)
+{
+  CAN_Filter filters[TEST_FILTERS_MAX];
+  CAN_Banks banks;
+  U32 sets, frames, count, accepted, expected, fifo, filter, id, i;
+  U32 compiled = 0, errors = 0;
+
+  for (sets = 0; sets < TEST_SETS; sets++)
+  {
+    count = 1 + Test_Random() % TEST_FILTERS_MAX;
+    for (i = 0; i < count; i++) test_RandomFilter(&filters[i]);
+    if (FALSE == CAN_Compile(filters, count, &banks)) continue;
+    compiled++;
+
+    for (frames = 0; frames < TEST_FRAMES + count; frames++)
+    {
+      id = (frames < count) ? filters[frames].Id : test_RandomId(filters, count);
+
+      for (i = 0, expected = FALSE; (i < count) && (FALSE == expected); i++)
+      {
+        expected = test_Accepts(&filters[i], id);
+      }
+      accepted = CAN_Match(&banks, id, &fifo, &filter);
+
+      if ((expected != accepted) || ((FALSE != accepted) &&
+          ((count <= filter) || (FALSE == test_Accepts(&filters[filter], id)) ||
+           (filters[filter].Fifo != fifo))))
+      {
+        if (0 == errors++) printf("set %u, frame %08X: %u %u %u\n", sets, id, accepted, fifo,
+                                  filter);
+      }
+    }
+  }
+
+  TEST_CHECK(0 == errors);
+  TEST_CHECK(TEST_SETS / 4 < compiled);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int main(void)
+{
+  test_Layout();
+  test_Priority();
+  test_Capacity();
+  Test_Random();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,224 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "dsp.h"
+#include "control.h"
+#include "test.h"
+
+/* Step responses of the PID closed around a second order plant, which is a StateSpace itself.
+   The loop is run again in double precision with the gains of the design, before quantization:
+   the two must track each other, settle on the setpoint and keep the limits. Rise time (10 % to
+   90 %), overshoot and settling time (within 2 %) of each response are printed.                  */
+
+#define TEST_RATE                          (1000)
+#define TEST_SETPOINT                      (10000)
+#define TEST_UPDATES                       (1500)
+
+/* Gains of the design, ki in 1/s, kd in s, the derivative cutoff in Hz */
+#define TEST_KP                            (2.0)
+#define TEST_KI                            (40.0)
+#define TEST_KD                            (0.01)
+#define TEST_CUTOFF                        (100.0)
+
+/* Largest distance of the fixed-point output from the double one, in codes */
+#define TEST_TRACK                         (30.0)
+
+/* Two first order lags, 0.8 and 0.98 per update, unity gain at DC */
+static const StateSpace_Config Test_Plant =
+{
+  {{Q16(0.8), 0}, {Q16(0.02), Q16(0.98)}},
+  {{Q16(0.2)}, {0}},
+  {0, Q16(1.0)},
+  {0},
+  2, 1, 16,
+  -2000000000, 2000000000
+};
+
+static const PID_Config Test_Free =
+{
+  PID_KP(TEST_KP), PID_KI(TEST_KI, TEST_RATE), PID_KD(TEST_KD, TEST_RATE), 0,
+  PID_ALPHA(TEST_CUTOFF, TEST_RATE),
+  -32767, 32767, 0
+};
+
+/* Range and rate limits hold the output for most of the rise */
+static const PID_Config Test_Limited =
+{
+  PID_KP(TEST_KP), PID_KI(TEST_KI, TEST_RATE), PID_KD(TEST_KD, TEST_RATE), 0,
+  PID_ALPHA(TEST_CUTOFF, TEST_RATE),
+  -12000, 12000, 200
+};
+
+typedef struct
+{
+  double Kp, Ki, Kd, Alpha;                /* Ki per update, Kd times the rate                    */
+  double Integral, Derivative, Measure, Output;
+} Test_Pid;
+
+typedef struct
+{
+  U32 Rise;
+  U32 Settle;
+  double Overshoot;                        /* %                                                   */
+  double Track;                            /* Largest distance from the double loop               */
+  U32 Range;                               /* Outputs outside OutMin, OutMax                      */
+  U32 Rate;                                /* Output changes above RateMax                        */
+  S32 Final;
+} Test_Response;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* PID_Update() in double precision, same structure and same limits */
+
+static double test_Update(Test_Pid * pPid, const PID_Config * pConfig, double setpoint,
+                          double measure)
+{
+  double error = setpoint - measure, integral, output, result, low, high;
+
+  pPid->Derivative += pPid->Alpha * ((pPid->Measure - measure) - pPid->Derivative);
+  pPid->Measure = measure;
+
+  integral = fmin(fmax(pPid->Integral + pPid->Ki * error, pConfig->OutMin), pConfig->OutMax);
+  output = pPid->Kp * error + integral + pPid->Kd * pPid->Derivative;
+
+  low  = pConfig->OutMin;
+  high = pConfig->OutMax;
+  if (0 != pConfig->RateMax)
+  {
+    low  = fmax(low,  pPid->Output - pConfig->RateMax);
+    high = fmin(high, pPid->Output + pConfig->RateMax);
+  }
+  result = fmin(fmax(output, low), high);
+
+  if (!(((output > result) && (0 < error)) || ((output < result) && (0 > error))))
+  {
+    pPid->Integral = integral;
+  }
+
+  pPid->Output = result;
+  return result;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Run(const PID_Config * pConfig, Test_Response * pResponse)
+{
+  Test_Pid reference = {TEST_KP, TEST_KI / TEST_RATE, TEST_KD * TEST_RATE};
+  double x0 = 0.0, x1 = 0.0, y, u = 0.0, overshoot;
+  S32 measure, output = 0, previous;
+  U32 rise10 = 0, rise90 = 0, k;
+  StateSpace plant;
+  PID pid;
+
+  reference.Alpha = 2.0 * M_PI * TEST_CUTOFF / (TEST_RATE + 2.0 * M_PI * TEST_CUTOFF);
+  memset(pResponse, 0, sizeof(*pResponse));
+  PID_Init(&pid, pConfig);
+  StateSpace_Init(&plant, &Test_Plant);
+
+  for (k = 0; k < TEST_UPDATES; k++)
+  {
+    measure = StateSpace_Update(&plant, &output);
+    previous = output;
+    output = PID_Update(&pid, TEST_SETPOINT, measure);
+
+    y  = x1;
+    x1 = 0.02 * x0 + 0.98 * x1;
+    x0 = 0.8 * x0 + 0.2 * u;
+    u  = test_Update(&reference, pConfig, TEST_SETPOINT, y);
+
+    if ((0 == rise10) && (TEST_SETPOINT / 10 <= measure)) rise10 = k;
+    if ((0 == rise90) && (TEST_SETPOINT * 9 / 10 <= measure)) rise90 = k;
+    if (TEST_SETPOINT / 50 < abs(measure - TEST_SETPOINT)) pResponse->Settle = k + 1;
+
+    overshoot = 100.0 * (measure - TEST_SETPOINT) / TEST_SETPOINT;
+    pResponse->Overshoot = fmax(pResponse->Overshoot, overshoot);
+    pResponse->Track = fmax(pResponse->Track, fabs(measure - y));
+    if ((pConfig->OutMin > output) || (pConfig->OutMax < output)) pResponse->Range++;
+    if ((0 != pConfig->RateMax) && (pConfig->RateMax < abs(output - previous))) pResponse->Rate++;
+  }
+
+  pResponse->Rise  = rise90 - rise10;
+  pResponse->Final = measure;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Step(void)
+{
+  Test_Response free, limited;
+
+  test_Run(&Test_Free, &free);
+  printf("free     rise %u  overshoot %.1f %%  settle %u  track %.1f\n",
+         free.Rise, free.Overshoot, free.Settle, free.Track);
+  TEST_CHECK(TEST_SETPOINT == free.Final);
+  TEST_CHECK((5.0 > free.Overshoot) && (100 > free.Settle));
+  TEST_CHECK(TEST_TRACK >= free.Track);
+  TEST_CHECK(0 == free.Range);
+
+  /* The integral does not pile up while the limits hold the output, so there is no overshoot */
+  test_Run(&Test_Limited, &limited);
+  printf("limited  rise %u  overshoot %.1f %%  settle %u  track %.1f\n",
+         limited.Rise, limited.Overshoot, limited.Settle, limited.Track);
+  TEST_CHECK(TEST_SETPOINT == limited.Final);
+  TEST_CHECK((1.0 > limited.Overshoot) && (250 > limited.Settle));
+  TEST_CHECK(limited.Rise > free.Rise);
+  TEST_CHECK(TEST_TRACK >= limited.Track);
+  TEST_CHECK((0 == limited.Range) && (0 == limited.Rate));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A setpoint step moves the output by Kp alone, the derivative sees the measurement. After a reset
+   the output carries on from the given one.                                                      */
+
+static void test_Kick(void)
+{
+  static const PID_Config config =
+  {
+    PID_KP(1.5), 0, PID_KD(0.1, TEST_RATE), 0, Q15_MAX, -32767, 32767, 0
+  };
+  PID pid;
+
+  PID_Init(&pid, &config);
+  TEST_CHECK(0 == PID_Update(&pid, 0, 0));
+  TEST_CHECK(1500 == PID_Update(&pid, 1000, 0));
+
+  /* 10 codes in one update against Kd of 100 updates, within the rounding of the filter */
+  TEST_CHECK(1 >= abs(PID_Update(&pid, 1000, 10) - (1485 - 1000)));
+
+  PID_Reset(&pid, 5000, 3000);
+  TEST_CHECK(3000 == PID_Update(&pid, 5000, 5000));
+  TEST_CHECK(3000 == PID_Update(&pid, 5000, 5000));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Integer coefficients, Frac 0: an accumulator y[k] = x[k], x[k+1] = x[k] + 2 u[k] */
+
+static void test_Integer(void)
+{
+  static const StateSpace_Config config =
+  {
+    {{1}}, {{2}}, {1}, {0}, 1, 1, 0, -1000, 1000
+  };
+  StateSpace ss;
+  S32 input = -3;
+
+  StateSpace_Init(&ss, &config);
+  TEST_CHECK(0 == StateSpace_Update(&ss, &input));
+  TEST_CHECK(-6 == StateSpace_Update(&ss, &input));
+  TEST_CHECK(-12 == StateSpace_Update(&ss, &input));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int main(void)
+{
+  test_Step();
+  test_Kick();
+  test_Integer();
+
+  return TEST_RESULT();
+}
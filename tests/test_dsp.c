@@ -0,0 +1,369 @@
+#include <math.h>
+#include <string.h>
+
+#include "types.h"
+#include "dsp.h"
+#include "fir.h"
+#include "biquad.h"
+#include "moving.h"
+#include "test.h"
+
+/* The block kernels against plain references written from the formulas of their headers: one
+   output at a time, straight from the whole input history, with the same rounding. The outputs
+   must be equal bit for bit. The input is fed in chunks of random length, so the state carried
+   between calls and the split into blocks are checked as well; full scale noise drives the
+   saturation.                                                                                    */
+
+#define TEST_SAMPLES                       (1024)
+#define TEST_CHUNK_MAX                     (97)
+#define TEST_TAPS_MAX                      (64)
+#define TEST_BLOCK_MAX                     (32)
+#define TEST_STAGES                        (2)
+#define TEST_WINDOW_MAX                    (15)
+
+typedef struct
+{
+  U16 Taps;
+  U16 BlockSize;
+} Test_FIRCase;
+
+static const Test_FIRCase Test_FIRCases[] =
+{
+  {1, 1}, {2, 7}, {3, 32}, {4, 4}, {5, 13}, {16, 1}, {31, 32}, {64, 24}
+};
+
+static Q15 Test_In15[TEST_SAMPLES];
+static Q15 Test_Out15[TEST_SAMPLES];
+static Q15 Test_Ref15[TEST_SAMPLES];
+static Q31 Test_In31[TEST_SAMPLES];
+static Q31 Test_Out31[TEST_SAMPLES];
+static Q31 Test_Ref31[TEST_SAMPLES];
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static Q15 test_Sat15(S64 x)
+{
+  return (Q15)((32767 < x) ? 32767 : ((-32768 > x) ? -32768 : x));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static Q31 test_Sat31(S64 x)
+{
+  return (Q31)((0x7FFFFFFFLL < x) ? 0x7FFFFFFFLL : ((-0x80000000LL > x) ? -0x80000000LL : x));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Noise at full scale with a few steps between the rails */
+
+static void test_Input(void)
+{
+  U32 n;
+
+  for (n = 0; n < TEST_SAMPLES; n++)
+  {
+    Test_In31[n] = (Q31)Test_Random();
+    if (0 == ((n / 128) & 3)) Test_In31[n] = (0 != (n & 64)) ? Q31_MAX : Q31_MIN;
+    Test_In15[n] = (Q15)(Test_In31[n] >> 16);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 test_Chunk(U32 left)
+{
+  U32 chunk = 1 + Test_Random() % TEST_CHUNK_MAX;
+
+  return (chunk > left) ? left : chunk;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* y[n] = b[0] x[n] + ... + b[Taps - 1] x[n - Taps + 1], with x = 0 before the start */
+
+static S64 test_FIRSum15(const Q15 * pCoeffs, U32 taps, U32 n)
+{
+  S64 acc = 0;
+  U32 k;
+
+  for (k = 0; (k < taps) && (k <= n); k++) acc += (S64)pCoeffs[k] * Test_In15[n - k];
+  return acc;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_FIR(void)
+{
+  Q15 coeffs15[TEST_TAPS_MAX], state15[FIR_STATE_SIZE(TEST_TAPS_MAX, TEST_BLOCK_MAX)];
+  Q31 coeffs31[TEST_TAPS_MAX], state31[FIR_STATE_SIZE(TEST_TAPS_MAX, TEST_BLOCK_MAX)];
+  FIR_Q15 fir15;
+  FIR_Q31 fir31;
+  U32 taps, i, k, n, chunk;
+  S64 acc;
+
+  for (i = 0; i < sizeof(Test_FIRCases) / sizeof(Test_FIRCases[0]); i++)
+  {
+    taps = Test_FIRCases[i].Taps;
+
+    /* Q31: the sum of |b| stays below 1, as the header asks */
+    for (k = 0; k < taps; k++)
+    {
+      coeffs15[k] = (Q15)Test_Random();
+      coeffs31[k] = (Q31)Test_Random() / (Q31)taps;
+    }
+
+    for (n = 0; n < TEST_SAMPLES; n++)
+    {
+      Test_Ref15[n] = test_Sat15((test_FIRSum15(coeffs15, taps, n) + 0x4000) >> 15);
+
+      for (k = 0, acc = 0; (k < taps) && (k <= n); k++)
+      {
+        acc += (S64)coeffs31[k] * Test_In31[n - k];
+      }
+      Test_Ref31[n] = test_Sat31((acc + 0x40000000) >> 31);
+    }
+
+    FIR_Q15_Init(&fir15, coeffs15, (U16)taps, state15, Test_FIRCases[i].BlockSize);
+    FIR_Q31_Init(&fir31, coeffs31, (U16)taps, state31, Test_FIRCases[i].BlockSize);
+    for (n = 0; n < TEST_SAMPLES; n += chunk)
+    {
+      chunk = test_Chunk(TEST_SAMPLES - n);
+      FIR_Q15_Run(&fir15, &Test_In15[n], &Test_Out15[n], chunk);
+      FIR_Q31_Run(&fir31, &Test_In31[n], &Test_Out31[n], chunk);
+    }
+
+    TEST_CHECK(0 == memcmp(Test_Out15, Test_Ref15, sizeof(Test_Ref15)));
+    TEST_CHECK(0 == memcmp(Test_Out31, Test_Ref31, sizeof(Test_Ref31)));
+  }
+
+  /* In place */
+  FIR_Q15_Init(&fir15, coeffs15, (U16)taps, state15, TEST_BLOCK_MAX);
+  memcpy(Test_Out15, Test_In15, sizeof(Test_In15));
+  FIR_Q15_Run(&fir15, Test_Out15, Test_Out15, TEST_SAMPLES);
+  TEST_CHECK(0 == memcmp(Test_Out15, Test_Ref15, sizeof(Test_Ref15)));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Every Factor-th output of the full rate filter, the last of each group */
+
+static void test_FIRDecim(void)
+{
+  static const U16 factors[] = {1, 2, 3, 4, 8};
+  Q15 coeffs[TEST_TAPS_MAX], state[FIR_STATE_SIZE(TEST_TAPS_MAX, TEST_BLOCK_MAX)];
+  FIRDecim_Q15 decim;
+  U32 factor, blockSize, taps, samples, outputs, i, k, n, chunk;
+
+  for (i = 0; i < sizeof(factors) / sizeof(factors[0]); i++)
+  {
+    factor    = factors[i];
+    blockSize = factor * (TEST_BLOCK_MAX / 8);
+    taps      = 5 + 9 * i;
+    samples   = TEST_SAMPLES - TEST_SAMPLES % factor;
+    for (k = 0; k < taps; k++) coeffs[k] = (Q15)(Test_Random() >> 2);
+
+    for (n = factor - 1, outputs = 0; n < samples; n += factor)
+    {
+      Test_Ref15[outputs++] = test_Sat15((test_FIRSum15(coeffs, taps, n) + 0x4000) >> 15);
+    }
+
+    FIRDecim_Q15_Init(&decim, coeffs, (U16)taps, (U16)factor, state, (U16)blockSize);
+    for (n = 0; n < samples; n += chunk)
+    {
+      chunk = test_Chunk(samples - n);
+      chunk = (chunk < factor) ? factor : chunk - chunk % factor;
+      FIRDecim_Q15_Run(&decim, &Test_In15[n], &Test_Out15[n / factor], chunk);
+    }
+
+    TEST_CHECK(0 == memcmp(Test_Out15, Test_Ref15, outputs * sizeof(Q15)));
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Two low pass sections designed in double (RBJ cookbook), a1 and a2 negated and every
+   coefficient scaled by 2^-Shift                                                                 */
+
+static void test_Design(double * pCoeffs, double frequency, double q)
+{
+  double w = 2.0 * M_PI * frequency, alpha = sin(w) / (2.0 * q), a0 = 1.0 + alpha;
+
+  pCoeffs[0] = (1.0 - cos(w)) / 2.0 / a0;
+  pCoeffs[1] = (1.0 - cos(w)) / a0;
+  pCoeffs[2] = pCoeffs[0];
+  pCoeffs[3] = 2.0 * cos(w) / a0;
+  pCoeffs[4] = -(1.0 - alpha) / a0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Biquad(void)
+{
+  static const U8 shifts[] = {1, 2};
+  double design[TEST_STAGES * BIQUAD_COEFFS];
+  Q15 coeffs15[TEST_STAGES * BIQUAD_COEFFS], state15[TEST_STAGES * BIQUAD_STATE];
+  Q31 coeffs31[TEST_STAGES * BIQUAD_COEFFS], state31[TEST_STAGES * BIQUAD_STATE];
+  Q15 x15[3], y15[3];
+  Q31 x31[3], y31[3];
+  Biquad_Q15 biquad15;
+  Biquad_Q31 biquad31;
+  U32 shift, stage, i, k, n, chunk;
+  const Q15 * pB15;
+  const Q31 * pB31;
+  S64 acc;
+
+  test_Design(&design[0], 0.05, 0.707);
+  test_Design(&design[BIQUAD_COEFFS], 0.12, 2.0);
+
+  for (i = 0; i < sizeof(shifts) / sizeof(shifts[0]); i++)
+  {
+    shift = shifts[i];
+    for (k = 0; k < TEST_STAGES * BIQUAD_COEFFS; k++)
+    {
+      coeffs15[k] = Q15(design[k] / (1 << shift));
+      coeffs31[k] = Q31(design[k] / (1 << shift));
+    }
+
+    /* Q31 at half scale: the accumulator has a single guard bit */
+    for (n = 0; n < TEST_SAMPLES; n++) Test_In31[n] >>= 1;
+
+    /* Stage by stage over the whole signal, the output of one is the input of the next */
+    memcpy(Test_Ref15, Test_In15, sizeof(Test_In15));
+    memcpy(Test_Ref31, Test_In31, sizeof(Test_In31));
+    for (stage = 0; stage < TEST_STAGES; stage++)
+    {
+      pB15 = &coeffs15[stage * BIQUAD_COEFFS];
+      pB31 = &coeffs31[stage * BIQUAD_COEFFS];
+      memset(x15, 0, sizeof(x15));
+      memset(y15, 0, sizeof(y15));
+      memset(x31, 0, sizeof(x31));
+      memset(y31, 0, sizeof(y31));
+
+      for (n = 0; n < TEST_SAMPLES; n++)
+      {
+        x15[0] = Test_Ref15[n];
+        acc = (S64)pB15[0] * x15[0] + (S64)pB15[1] * x15[1] + (S64)pB15[2] * x15[2] +
+              (S64)pB15[3] * y15[1] + (S64)pB15[4] * y15[2];
+        y15[0] = test_Sat15((acc + (1 << (14 - shift))) >> (15 - shift));
+        Test_Ref15[n] = y15[0];
+        x15[2] = x15[1]; x15[1] = x15[0];
+        y15[2] = y15[1]; y15[1] = y15[0];
+
+        x31[0] = Test_Ref31[n];
+        acc = (S64)pB31[0] * x31[0] + (S64)pB31[1] * x31[1] + (S64)pB31[2] * x31[2] +
+              (S64)pB31[3] * y31[1] + (S64)pB31[4] * y31[2];
+        y31[0] = test_Sat31((acc + (1LL << (30 - shift))) >> (31 - shift));
+        Test_Ref31[n] = y31[0];
+        x31[2] = x31[1]; x31[1] = x31[0];
+        y31[2] = y31[1]; y31[1] = y31[0];
+      }
+    }
+
+    Biquad_Q15_Init(&biquad15, coeffs15, TEST_STAGES, (U8)shift, state15);
+    Biquad_Q31_Init(&biquad31, coeffs31, TEST_STAGES, (U8)shift, state31);
+    for (n = 0; n < TEST_SAMPLES; n += chunk)
+    {
+      chunk = test_Chunk(TEST_SAMPLES - n);
+      Biquad_Q15_Run(&biquad15, &Test_In15[n], &Test_Out15[n], chunk);
+      Biquad_Q31_Run(&biquad31, &Test_In31[n], &Test_Out31[n], chunk);
+    }
+
+    TEST_CHECK(0 == memcmp(Test_Out15, Test_Ref15, sizeof(Test_Ref15)));
+    TEST_CHECK(0 == memcmp(Test_Out31, Test_Ref31, sizeof(Test_Ref31)));
+    test_Input();
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The mean of the last 2^Log2 inputs, rounded; the median of the last Size inputs by sorting
+   them. Both start from a window of zeros.                                                       */
+
+static void test_Moving(void)
+{
+  Q15 buffer[1 << 6], window[TEST_WINDOW_MAX], sorted[TEST_WINDOW_MAX], last[TEST_WINDOW_MAX], x;
+  MovAvg_Q15 avg;
+  MovMedian_Q15 median;
+  U32 log2, size, i, k, n, chunk;
+  S32 sum;
+
+  for (log2 = 0; log2 <= 6; log2 += 2)
+  {
+    for (n = 0; n < TEST_SAMPLES; n++)
+    {
+      for (k = 0, sum = 0; (k < (1U << log2)) && (k <= n); k++) sum += Test_In15[n - k];
+      Test_Ref15[n] = (Q15)((sum + ((1 << log2) >> 1)) >> log2);
+    }
+
+    MovAvg_Q15_Init(&avg, buffer, (U16)log2);
+    for (n = 0; n < TEST_SAMPLES; n += chunk)
+    {
+      chunk = test_Chunk(TEST_SAMPLES - n);
+      MovAvg_Q15_Run(&avg, &Test_In15[n], &Test_Out15[n], chunk);
+    }
+    TEST_CHECK(0 == memcmp(Test_Out15, Test_Ref15, sizeof(Test_Ref15)));
+  }
+
+  /* Few distinct values, so that the window holds duplicates */
+  for (n = 0; n < TEST_SAMPLES; n++) Test_In15[n] = (Q15)((S32)(Test_Random() % 9) * 4096 - 16384);
+
+  for (size = 1; size <= TEST_WINDOW_MAX; size += 2)
+  {
+    for (n = 0; n < TEST_SAMPLES; n++)
+    {
+      for (k = 0; k < size; k++) last[k] = (k <= n) ? Test_In15[n - k] : 0;
+      for (i = 1; i < size; i++)
+      {
+        for (k = i, x = last[i]; (0 < k) && (last[k - 1] > x); k--) last[k] = last[k - 1];
+        last[k] = x;
+      }
+      Test_Ref15[n] = last[size / 2];
+    }
+
+    MovMedian_Q15_Init(&median, window, sorted, (U16)size);
+    for (n = 0; n < TEST_SAMPLES; n += chunk)
+    {
+      chunk = test_Chunk(TEST_SAMPLES - n);
+      MovMedian_Q15_Run(&median, &Test_In15[n], &Test_Out15[n], chunk);
+    }
+    TEST_CHECK(0 == memcmp(Test_Out15, Test_Ref15, sizeof(Test_Ref15)));
+  }
+
+  test_Input();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Decimate(void)
+{
+  U32 log2, k, n;
+  S32 sum;
+
+  for (log2 = 0; log2 <= 4; log2++)
+  {
+    for (n = 0; n < (TEST_SAMPLES >> log2); n++)
+    {
+      for (k = 0, sum = 0; k < (1U << log2); k++) sum += Test_In15[(n << log2) + k];
+      Test_Ref15[n] = (Q15)((sum + ((1 << log2) >> 1)) >> log2);
+    }
+
+    Decim_Q15_Average(Test_In15, Test_Out15, TEST_SAMPLES, log2);
+    TEST_CHECK(0 == memcmp(Test_Out15, Test_Ref15, (TEST_SAMPLES >> log2) * sizeof(Q15)));
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int main(void)
+{
+  test_Input();
+
+  test_FIR();
+  test_FIRDecim();
+  test_Biquad();
+  test_Moving();
+  test_Decimate();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,166 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "dsp.h"
+#include "fft.h"
+#include "test.h"
+
+/* The transforms against a double precision DFT of the same Q15 input, divided by the size as
+   fft.h defines the output. Random input close to full scale, every size from FFT_SIZE_MIN to
+   FFT_SIZE_MAX, both directions of the complex transform and the real one; the largest error of
+   a real or imaginary part is printed per size. The magnitude and the peak search follow on the
+   spectrum of a windowed tone.                                                                   */
+
+#define TEST_BOUND                         (2.7)   /* LSB, every part of every bin           */
+#define TEST_TONE_BIN                      (10.3)
+#define TEST_TONE_SIZE                     (256)
+
+/* The transforms read the data by words */
+static U32 Test_Words[FFT_SIZE_MAX];
+static double Test_Re[FFT_SIZE_MAX];
+static double Test_Im[FFT_SIZE_MAX];
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Largest error of the parts of bins 'first' to 'last' - 1 of the DFT / size of Test_Re, Test_Im
+   against the interleaved output. 'sign' is -1 for the forward transform.                        */
+
+static double test_Error(const Q15 * pData, U32 size, U32 first, U32 last, double sign)
+{
+  double error = 0.0, re, im, phase;
+  U32 k, n;
+
+  for (k = first; k < last; k++)
+  {
+    for (n = 0, re = 0.0, im = 0.0; n < size; n++)
+    {
+      phase = sign * 2.0 * M_PI * (double)((k * n) % size) / size;
+      re += Test_Re[n] * cos(phase) - Test_Im[n] * sin(phase);
+      im += Test_Re[n] * sin(phase) + Test_Im[n] * cos(phase);
+    }
+    error = fmax(error, fabs(pData[2 * k] - re / size));
+    error = fmax(error, fabs(pData[2 * k + 1] - im / size));
+  }
+
+  return error;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* |x| stays below 1, as the butterflies need */
+
+static void test_Complex(void)
+{
+  Q15 * pData = (Q15 *)Test_Words;
+  double error[2];
+  U32 size, inverse, n;
+
+  for (size = FFT_SIZE_MIN; size <= FFT_SIZE_MAX; size <<= 1)
+  {
+    for (inverse = 0; inverse < 2; inverse++)
+    {
+      for (n = 0; n < size; n++)
+      {
+        pData[2 * n]     = (Q15)((S32)(Test_Random() % 46341) - 23170);
+        pData[2 * n + 1] = (Q15)((S32)(Test_Random() % 46341) - 23170);
+        Test_Re[n] = pData[2 * n];
+        Test_Im[n] = pData[2 * n + 1];
+      }
+
+      TEST_CHECK(FALSE != FFT_Q15_Complex(pData, size, inverse));
+      error[inverse] = test_Error(pData, size, 0, size, (FALSE != inverse) ? 1.0 : -1.0);
+      TEST_CHECK(TEST_BOUND >= error[inverse]);
+    }
+
+    printf("complex %4u  forward %.2f LSB  inverse %.2f LSB\n", size, error[0], error[1]);
+  }
+
+  TEST_CHECK(FALSE == FFT_Q15_Complex(pData, FFT_SIZE_MIN / 2, FALSE));
+  TEST_CHECK(FALSE == FFT_Q15_Complex(pData, 2 * FFT_SIZE_MAX, FALSE));
+  TEST_CHECK(FALSE == FFT_Q15_Complex(pData, 3 * FFT_SIZE_MIN, FALSE));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* DC and Nyquist are real, packed into the first pair. Samples up to 1/sqrt(2) are transformed
+   as they are, louder ones are halved first and the rounding error may double.                   */
+
+static void test_Real(void)
+{
+  static const S32 peaks[] = {23170, 32767};
+  Q15 * pData = (Q15 *)Test_Words;
+  double error, dc, nyquist;
+  U32 size, loud, n;
+
+  for (size = 2 * FFT_SIZE_MIN; size <= FFT_SIZE_MAX; size <<= 1)
+  {
+    printf("real    %4u ", size);
+    for (loud = 0; loud < 2; loud++)
+    {
+      for (n = 0, dc = 0.0, nyquist = 0.0; n < size; n++)
+      {
+        pData[n] = (Q15)((S32)(Test_Random() % (2 * peaks[loud] + 1)) - peaks[loud]);
+        Test_Re[n] = pData[n];
+        Test_Im[n] = 0.0;
+        dc      += pData[n];
+        nyquist += (0 != (n & 1)) ? -pData[n] : pData[n];
+      }
+
+      TEST_CHECK(FALSE != FFT_Q15_Real(pData, size));
+      error = fmax(fabs(pData[0] - dc / size), fabs(pData[1] - nyquist / size));
+      error = fmax(error, test_Error(pData, size, 1, size >> 1, -1.0));
+
+      printf("  %s %.2f LSB", (0 != loud) ? "full scale" : "to 0.707", error);
+      TEST_CHECK((1 + loud) * TEST_BOUND >= error);
+    }
+    printf("\n");
+  }
+
+  TEST_CHECK(FALSE == FFT_Q15_Real(pData, FFT_SIZE_MIN));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A Hann windowed tone between two bins: the magnitudes are those of the bins, within the
+   rounding of the square root, and the strongest peak is found near the tone                     */
+
+static void test_Peak(void)
+{
+  Q15 * pData = (Q15 *)Test_Words;
+  Q15 mag[TEST_TONE_SIZE / 2 + 1];
+  FFT_Peak peaks[2];
+  double exact;
+  U32 wrong = 0, n;
+
+  for (n = 0; n < TEST_TONE_SIZE; n++)
+  {
+    pData[n] = Q15(0.9 * cos(2.0 * M_PI * TEST_TONE_BIN * n / TEST_TONE_SIZE));
+  }
+  FFT_Q15_Hann(pData, TEST_TONE_SIZE);
+  TEST_CHECK(FALSE != FFT_Q15_Real(pData, TEST_TONE_SIZE));
+
+  FFT_Q15_RealMagnitude(pData, mag, TEST_TONE_SIZE);
+  for (n = 1; n < TEST_TONE_SIZE / 2; n++)
+  {
+    exact = sqrt((double)pData[2 * n] * pData[2 * n] + (double)pData[2 * n + 1] * pData[2 * n + 1]);
+    if (mag[n] != (Q15)floor(exact)) wrong++;
+  }
+  TEST_CHECK(0 == wrong);
+  TEST_CHECK((abs(pData[0]) == mag[0]) && (abs(pData[1]) == mag[TEST_TONE_SIZE / 2]));
+
+  TEST_CHECK(1 <= FFT_Q15_Peaks(mag, TEST_TONE_SIZE / 2 + 1, Q15(0.01), peaks, 2));
+  printf("peak    %.3f bins for %.3f\n", peaks[0].Position / 256.0, TEST_TONE_BIN);
+  TEST_CHECK(fabs(peaks[0].Position / 256.0 - TEST_TONE_BIN) < 0.1);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int main(void)
+{
+  test_Complex();
+  test_Real();
+  test_Peak();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,227 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "types.h"
+#include "fixmath.h"
+#include "test.h"
+
+/* The bounds documented in fixmath.h, against the double precision libm. The angles and the
+   Q15 square roots are swept exhaustively, the 32-bit arguments densely near 0 and by a stride
+   prime to the powers of two above. The largest error of each function is printed.              */
+
+#define TEST_DENSE                         (1 << 20)
+#define TEST_STRIDE                        (9973)
+#define TEST_SQUARE                        (1000)
+
+#define TEST_TURN                          (2.0 * M_PI / 65536.0)
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The Q15 reference is clipped at +1, which Q15 can not hold */
+
+static double test_Q15(double x)
+{
+  return (32767.0 < x * 32768.0) ? 32767.0 : x * 32768.0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Of a turn, the shorter way round */
+
+static double test_AngleError(Math_Angle angle, double reference)
+{
+  double error = fabs((double)(S16)angle - reference);
+
+  return (32768.0 < error) ? 65536.0 - error : error;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Every angle */
+
+static void test_SinCos(void)
+{
+  double error = 0.0;
+  U32 angle;
+
+  for (angle = 0; angle < 65536; angle++)
+  {
+    error = fmax(error, fabs(Math_Sin((Math_Angle)angle) - test_Q15(sin(angle * TEST_TURN))));
+    error = fmax(error, fabs(Math_Cos((Math_Angle)angle) - test_Q15(cos(angle * TEST_TURN))));
+  }
+
+  printf("sin/cos  %.3f LSB\n", error);
+  TEST_CHECK(1.5 >= error);
+  TEST_CHECK((0 == Math_Sin(0)) && (Q15_MAX == Math_Sin(MATH_ANGLE_PI_2)));
+  TEST_CHECK(-Q15_MAX == Math_Cos(MATH_ANGLE_PI));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Every point of a small square, points on circles from a radius of 1 to 2^30 with the axes and
+   the octant boundaries, then the corners of the S32 range                                       */
+
+static void test_Atan2(void)
+{
+  static const S32 corners[] = {0x7FFFFFFF, -0x7FFFFFFF - 1, 0x40000000, 1, -1, 123456789};
+  double error = 0.0, radius, phase;
+  U32 i, j, angle;
+  S32 x, y;
+
+  for (y = -TEST_SQUARE; y <= TEST_SQUARE; y++)
+  {
+    for (x = -TEST_SQUARE; x <= TEST_SQUARE; x++)
+    {
+      if ((0 == x) && (0 == y)) continue;
+      error = fmax(error, test_AngleError(Math_Atan2(y, x), atan2(y, x) / TEST_TURN));
+    }
+  }
+
+  for (radius = 1.0; radius < 1073741824.0; radius *= 1.7)
+  {
+    for (angle = 0; angle < 65536; angle += 61)
+    {
+      phase = angle * TEST_TURN;
+      x = (S32)lrint(radius * cos(phase));
+      y = (S32)lrint(radius * sin(phase));
+      if ((0 == x) && (0 == y)) continue;
+
+      error = fmax(error, test_AngleError(Math_Atan2(y, x), atan2(y, x) / TEST_TURN));
+    }
+  }
+
+  for (i = 0; i < sizeof(corners) / sizeof(corners[0]); i++)
+  {
+    for (j = 0; j < sizeof(corners) / sizeof(corners[0]); j++)
+    {
+      error = fmax(error, test_AngleError(Math_Atan2(corners[i], corners[j]),
+                                          atan2(corners[i], corners[j]) / TEST_TURN));
+    }
+  }
+
+  printf("atan2    %.3f / 65536 turn\n", error);
+  TEST_CHECK(1.2 >= error);
+  TEST_CHECK(0 == Math_Atan2(0, 0));
+  TEST_CHECK((MATH_ANGLE_PI_2 == Math_Atan2(5, 0)) && (MATH_ANGLE_PI == Math_Atan2(0, -5)));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Sqrt(void)
+{
+  U32 wrong = 0, root, x;
+  U64 next;
+
+  for (next = 0; next <= 0xFFFFFFFFU; next += (TEST_DENSE > next) ? 1 : TEST_STRIDE)
+  {
+    x    = (U32)next;
+    root = Math_Sqrt(x);
+    if (((U64)root * root > x) || ((U64)(root + 1) * (root + 1) <= x)) wrong++;
+  }
+
+  /* Around the squares near the top, where the root saturates */
+  for (root = 0xFFF0; root <= 0xFFFF; root++)
+  {
+    x = root * root;
+    if ((root != Math_Sqrt(x)) || (root - 1 != Math_Sqrt(x - 1))) wrong++;
+  }
+
+  TEST_CHECK(0 == wrong);
+  TEST_CHECK(0xFFFF == Math_Sqrt(0xFFFFFFFFU));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_SqrtQ15(void)
+{
+  U32 wrong = 0;
+  S32 x, root;
+
+  for (x = -32768; x < 32768; x++)
+  {
+    root = (0 >= x) ? 0 : (S32)floor(sqrt(x / 32768.0) * 32768.0);
+    if (Math_SqrtQ15((Q15)x) != root) wrong++;
+  }
+
+  TEST_CHECK(0 == wrong);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Rounded to the nearest, so exact reciprocals come out exact */
+
+static void test_RecipQ16(void)
+{
+  double error = 0.0, reference;
+  S64 x;
+
+  for (x = -0x7FFFFFFF - 1LL; x <= 0x7FFFFFFF; x += (TEST_DENSE > llabs(x)) ? 1 : TEST_STRIDE)
+  {
+    if (2 >= llabs(x)) continue;
+
+    reference = 4294967296.0 / (double)x;
+    error = fmax(error, fabs(Math_RecipQ16((S32)x) - reference));
+  }
+
+  printf("recip    %.3f LSB\n", error);
+  TEST_CHECK(0.5 >= error);
+  TEST_CHECK((Q16(1.0) == Math_RecipQ16(Q16(1.0))) && (Q16(0.5) == Math_RecipQ16(Q16(2.0))));
+  TEST_CHECK((Q16(-4.0) == Math_RecipQ16(Q16(-0.25))) && (-2 == Math_RecipQ16(-0x7FFFFFFF - 1)));
+  TEST_CHECK((0x7FFFFFFF == Math_RecipQ16(0)) && (-0x7FFFFFFF == Math_RecipQ16(-1)));
+  TEST_CHECK(0x7FFFFFFF == Math_RecipQ16(2));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Log2(void)
+{
+  double error = 0.0;
+  U64 x;
+
+  for (x = 1; x <= 0xFFFFFFFFU; x += (TEST_DENSE > x) ? 1 : TEST_STRIDE)
+  {
+    error = fmax(error, fabs(Math_Log2((U32)x) - log2((double)x) * 65536.0));
+  }
+
+  printf("log2     %.3f LSB\n", error);
+  TEST_CHECK(1.6 >= error);
+  TEST_CHECK((0 == Math_Log2(1)) && (Q16(10.0) == Math_Log2(1024)));
+  TEST_CHECK((-0x7FFFFFFF - 1) == Math_Log2(0));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Every Q16.16 argument from -16 to 16: relative error below 2^-16, plus 1/2 LSB of rounding */
+
+static void test_Exp2(void)
+{
+  double error = 0.0, reference;
+  S32 x;
+
+  for (x = -16 * 65536; x < 16 * 65536; x++)
+  {
+    reference = exp2(x / 65536.0) * 65536.0;
+    error = fmax(error, (fabs(Math_Exp2(x) - reference) - 0.5) / reference * 65536.0);
+  }
+
+  printf("exp2     %.3f x 2^-16 relative, above 1/2 LSB\n", error);
+  TEST_CHECK(1.0 > error);
+  TEST_CHECK((Q16(1.0) == Math_Exp2(0)) && (Q16(8.0) == Math_Exp2(Q16(3.0))));
+  TEST_CHECK((0xFFFFFFFFU == Math_Exp2(Q16(16.0))) && (0xFFFFFFFFU == Math_Exp2(0x7FFFFFFF)));
+  TEST_CHECK(0 == Math_Exp2(Q16(-17.0)));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int main(void)
+{
+  test_SinCos();
+  test_Atan2();
+  test_Sqrt();
+  test_SqrtQ15();
+  test_RecipQ16();
+  test_Log2();
+  test_Exp2();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,250 @@
+#include <string.h>
+
+#include "types.h"
+#include "gpiomap.h"
+#include "test.h"
+
+/* The folded register values of GPIO_MAP_Apply() against the pins configured one by one, as
+   GPIO_Init() does, with the ODR bit of the level. The ports and RCC are host memory. The fixed
+   map covers three ports, both halves of CR, inputs and outputs; the sweep then draws random pins,
+   types and levels for a map whose entries are variables, folded at run time alike. The checks
+   behind GPIO_MAP_Check() are evaluated the same way on maps with a pin listed twice.            */
+
+#define TEST_SWEEPS                        (10000)
+#define TEST_UNTOUCHED                     (0xA5A5A5A5U)
+
+static GPIO Test_Ports[4];
+static RCC_TypeDef Test_Rcc;
+
+#undef GPIOA
+#undef GPIOB
+#undef GPIOC
+#undef GPIOD
+#undef RCC
+#define GPIOA                              (&Test_Ports[GPIO_MAP_IDX_A])
+#define GPIOB                              (&Test_Ports[GPIO_MAP_IDX_B])
+#define GPIOC                              (&Test_Ports[GPIO_MAP_IDX_C])
+#define GPIOD                              (&Test_Ports[GPIO_MAP_IDX_D])
+#define RCC                                (&Test_Rcc)
+
+/* Ports A, B and C, port D unused */
+#define TEST_PINS(PIN, a, b) \
+  PIN(a, b, A,  0, GPIO_TYPE_IN_ANALOG, 0) \
+  PIN(a, b, A,  7, GPIO_TYPE_IN_PUP_PDN, 1) \
+  PIN(a, b, A,  8, GPIO_TYPE_OUT_PP_50MHZ, 1) \
+  PIN(a, b, A, 15, GPIO_TYPE_ALT_OD_2MHZ, 0) \
+  PIN(a, b, B,  3, GPIO_TYPE_OUT_OD_10MHZ, 1) \
+  PIN(a, b, B,  4, GPIO_TYPE_IN_PUP_PDN, 0) \
+  PIN(a, b, B, 10, GPIO_TYPE_ALT_PP_50MHZ, 0) \
+  PIN(a, b, B, 11, GPIO_TYPE_IN_FLOATING, 0) \
+  PIN(a, b, C, 13, GPIO_TYPE_OUT_OD_2MHZ, 1)
+
+GPIO_MAP_Check(TEST_PINS)
+
+/* Twelve variable entries, three per port */
+static U32 Test_Pin[12];
+static U32 Test_Type[12];
+static U32 Test_Level[12];
+
+#define TEST_VARIABLE(PIN, a, b) \
+  PIN(a, b, A, Test_Pin[0],  Test_Type[0],  Test_Level[0]) \
+  PIN(a, b, A, Test_Pin[1],  Test_Type[1],  Test_Level[1]) \
+  PIN(a, b, A, Test_Pin[2],  Test_Type[2],  Test_Level[2]) \
+  PIN(a, b, B, Test_Pin[3],  Test_Type[3],  Test_Level[3]) \
+  PIN(a, b, B, Test_Pin[4],  Test_Type[4],  Test_Level[4]) \
+  PIN(a, b, B, Test_Pin[5],  Test_Type[5],  Test_Level[5]) \
+  PIN(a, b, C, Test_Pin[6],  Test_Type[6],  Test_Level[6]) \
+  PIN(a, b, C, Test_Pin[7],  Test_Type[7],  Test_Level[7]) \
+  PIN(a, b, C, Test_Pin[8],  Test_Type[8],  Test_Level[8]) \
+  PIN(a, b, D, Test_Pin[9],  Test_Type[9],  Test_Level[9]) \
+  PIN(a, b, D, Test_Pin[10], Test_Type[10], Test_Level[10]) \
+  PIN(a, b, D, Test_Pin[11], Test_Type[11], Test_Level[11])
+
+/* Reference: the ports and RCC after configuring the pins one at a time from reset */
+static GPIO Test_Expected[4];
+static U32 Test_ExpectedRcc;
+static U32 Test_Used;
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Every register of every port reads TEST_UNTOUCHED, the reference ports are at reset. Port E is
+   enabled already, the map must keep it.                                                         */
+
+static void test_Reset(void)
+{
+  U32 port;
+
+  memset(Test_Ports, 0xA5, sizeof(Test_Ports));
+  memset(&Test_Rcc, 0, sizeof(Test_Rcc));
+  Test_Rcc.APB2ENR = RCC_APB2ENR_IOPEEN;
+
+  memset(Test_Expected, 0xA5, sizeof(Test_Expected));
+  for (port = 0; port < 4; port++)
+  {
+    Test_Expected[port].CR[0] = GPIO_MAP_CR_RESET;
+    Test_Expected[port].CR[1] = GPIO_MAP_CR_RESET;
+    Test_Expected[port].ODR   = 0;
+  }
+  Test_ExpectedRcc = RCC_APB2ENR_IOPEEN;
+  Test_Used = 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* The read-modify-writes of GPIO_Init(), then the ODR bit */
+
+static void test_Configure(U32 port, U32 pin, U32 type, U32 level)
+{
+  GPIO * pPort = &Test_Expected[port];
+
+  Test_ExpectedRcc |= RCC_APB2ENR_IOPAEN << port;
+  if (type > 8) Test_ExpectedRcc |= RCC_APB2ENR_AFIOEN;
+
+  pPort->CR[pin / 8] &= ~(GPIO_TYPE_MASK << ((pin % 8) * 4));
+  pPort->CR[pin / 8] |= (type << ((pin % 8) * 4));
+  pPort->ODR = (pPort->ODR & ~(1U << pin)) | (level << pin);
+  Test_Used |= 1U << port;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Used ports as the reference, the others not written at all */
+
+static U32 test_Compare(void)
+{
+  U32 port;
+
+  if (Test_ExpectedRcc != Test_Rcc.APB2ENR) return FALSE;
+
+  for (port = 0; port < 4; port++)
+  {
+    if (0 == (Test_Used & (1U << port)))
+    {
+      if ((TEST_UNTOUCHED != Test_Ports[port].CR[0]) ||
+          (TEST_UNTOUCHED != Test_Ports[port].CR[1]) || (TEST_UNTOUCHED != Test_Ports[port].ODR))
+      {
+        return FALSE;
+      }
+      continue;
+    }
+
+    if ((Test_Expected[port].CR[0] != Test_Ports[port].CR[0]) ||
+        (Test_Expected[port].CR[1] != Test_Ports[port].CR[1]) ||
+        (Test_Expected[port].ODR != Test_Ports[port].ODR) ||
+        (TEST_UNTOUCHED != Test_Ports[port].BSRR) || (TEST_UNTOUCHED != Test_Ports[port].LCKR))
+    {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+#define TEST_CONFIGURE(u1, u2, P, N, MODE, LEVEL) \
+  test_Configure(GPIO_MAP_IDX_##P, N, MODE, LEVEL);
+
+static void test_Fixed(void)
+{
+  test_Reset();
+  TEST_PINS(TEST_CONFIGURE, 0, 0)
+  GPIO_MAP_Apply(TEST_PINS);
+
+  TEST_CHECK(FALSE != test_Compare());
+
+  /* The same, written out */
+  TEST_CHECK((0x84444440U == GPIOA->CR[0]) && (0xE4444443U == GPIOA->CR[1]));
+  TEST_CHECK(0x00000180U == GPIOA->ODR);
+  TEST_CHECK((0x44485444U == GPIOB->CR[0]) && (0x44444B44U == GPIOB->CR[1]));
+  TEST_CHECK(0x00000008U == GPIOB->ODR);
+  TEST_CHECK(GPIO_MAP_CR_RESET == GPIOC->CR[0]);
+  TEST_CHECK((0x44644444U == GPIOC->CR[1]) && (0x00002000U == GPIOC->ODR));
+  TEST_CHECK(TEST_UNTOUCHED == GPIOD->CR[0]);
+  TEST_CHECK((RCC_APB2ENR_IOPEEN | RCC_APB2ENR_IOPCEN | RCC_APB2ENR_IOPBEN | RCC_APB2ENR_IOPAEN |
+              RCC_APB2ENR_AFIOEN) == RCC->APB2ENR);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Distinct random pins per port, any type and level */
+
+static void test_Sweep(void)
+{
+  U32 wrong = 0, sweep, i, taken;
+
+  for (sweep = 0; sweep < TEST_SWEEPS; sweep++)
+  {
+    for (i = 0; i < 12; i++)
+    {
+      if (0 == i % 3) taken = 0;
+      do
+      {
+        Test_Pin[i] = Test_Random() % 16;
+      }
+      while (0 != (taken & (1U << Test_Pin[i])));
+      taken |= 1U << Test_Pin[i];
+
+      Test_Type[i]  = Test_Random() % 16;
+      Test_Level[i] = Test_Random() % 2;
+    }
+
+    test_Reset();
+    TEST_VARIABLE(TEST_CONFIGURE, 0, 0)
+    GPIO_MAP_Apply(TEST_VARIABLE);
+    if (FALSE == test_Compare()) wrong++;
+
+    if (0 != (0 TEST_VARIABLE(GPIO_MAP_TERM_INVALID, 0, 0))) wrong++;
+    if (GPIO_MAP_PINS(TEST_VARIABLE, GPIO_MAP_IDX_C) !=
+        (0U TEST_VARIABLE(GPIO_MAP_TERM_PINS_SUM, GPIO_MAP_IDX_C, 0)))
+    {
+      wrong++;
+    }
+  }
+
+  TEST_CHECK(0 == wrong);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A pin listed twice, and entries out of range, as GPIO_MAP_Check() sees them */
+
+static void test_Conflict(void)
+{
+  U32 i;
+
+  for (i = 0; i < 12; i++)
+  {
+    Test_Pin[i]   = i;
+    Test_Type[i]  = GPIO_TYPE_OUT_PP_2MHZ;
+    Test_Level[i] = 0;
+  }
+  TEST_CHECK(GPIO_MAP_PINS(TEST_VARIABLE, GPIO_MAP_IDX_B) ==
+             (0U TEST_VARIABLE(GPIO_MAP_TERM_PINS_SUM, GPIO_MAP_IDX_B, 0)));
+
+  Test_Pin[5] = Test_Pin[3];
+  TEST_CHECK(GPIO_MAP_PINS(TEST_VARIABLE, GPIO_MAP_IDX_B) !=
+             (0U TEST_VARIABLE(GPIO_MAP_TERM_PINS_SUM, GPIO_MAP_IDX_B, 0)));
+  TEST_CHECK(GPIO_MAP_PINS(TEST_VARIABLE, GPIO_MAP_IDX_A) ==
+             (0U TEST_VARIABLE(GPIO_MAP_TERM_PINS_SUM, GPIO_MAP_IDX_A, 0)));
+
+  Test_Pin[5] = 16;
+  TEST_CHECK(1 == (0 TEST_VARIABLE(GPIO_MAP_TERM_INVALID, 0, 0)));
+  Test_Pin[5] = 5;
+  Test_Type[0] = GPIO_TYPE_MASK + 1;
+  TEST_CHECK(1 == (0 TEST_VARIABLE(GPIO_MAP_TERM_INVALID, 0, 0)));
+  Test_Type[0] = GPIO_TYPE_IN_FLOATING;
+  Test_Level[11] = 2;
+  TEST_CHECK(1 == (0 TEST_VARIABLE(GPIO_MAP_TERM_INVALID, 0, 0)));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int main(void)
+{
+  test_Fixed();
+  test_Sweep();
+  test_Conflict();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,507 @@
+#include <string.h>
+#include <time.h>
+
+#include "types.h"
+#include "modbus.h"
+#include "test.h"
+
+/* The application layer of the Modbus slave against a plain model of its map: the CRC against
+   published frames and a bit by bit reference, random reads and writes of every function against
+   the data of the ranges, then the exceptions of each check of a request. The time of
+   Modbus_Process() for the largest requests is printed; the on-wire turnaround is measured on the
+   board by tools/modbus_rtu.py.                                                                  */
+
+#define TEST_RUNS                          (20000)
+#define TEST_TIMING_RUNS                   (10000)
+
+/* One character at 115200 baud: a host has to serve any request well within it */
+#define TEST_BUDGET_NS                     (86800.0)
+
+#define TEST_COILS                         (2000)
+#define TEST_INPUTS                        (20)
+#define TEST_REGISTERS                     (130)
+
+static U8  Test_Coils[TEST_COILS / 8];
+static U8  Test_Fixed[2];                  /* Read only coils                                     */
+static U8  Test_Inputs[(TEST_INPUTS + 7) / 8];
+static U16 Test_Input[TEST_REGISTERS];
+static U16 Test_Holding[TEST_REGISTERS];
+static U16 Test_Constant[8];               /* Read only holding registers                         */
+static U16 Test_Failing[4];
+
+/* Last call of the access function */
+typedef struct
+{
+  U32 Calls;
+  U32 Write;
+  U32 Offset;
+  U32 Count;
+} Test_Access;
+
+static Test_Access Test_Last;
+
+static U32 test_Access(const Modbus_Range * pRange, U32 write, U32 offset, U32 count,
+                       void * pContext)
+{
+  Test_Last.Calls++;
+  Test_Last.Write  = write;
+  Test_Last.Offset = offset;
+  Test_Last.Count  = count;
+  return (U32)(size_t)pContext;
+}
+
+static const Modbus_Range Test_Ranges[] =
+{
+  {MODBUS_COILS,             0,                1000, TEST_COILS,     Test_Coils,    test_Access, 0},
+  {MODBUS_COILS,             MODBUS_READ_ONLY, 100,  16,             Test_Fixed,    NULL,        0},
+  {MODBUS_DISCRETE_INPUTS,   0,                0x10, TEST_INPUTS,    Test_Inputs,   NULL,        0},
+  {MODBUS_INPUT_REGISTERS,   0,                0,    TEST_REGISTERS, Test_Input,    test_Access, 0},
+  {MODBUS_HOLDING_REGISTERS, 0,                1000, TEST_REGISTERS, Test_Holding,  test_Access, 0},
+  {MODBUS_HOLDING_REGISTERS, MODBUS_READ_ONLY, 2000, 8,              Test_Constant, NULL,        0},
+  {MODBUS_HOLDING_REGISTERS, 0,                3000, 4,              Test_Failing,  test_Access,
+   (void *)MODBUS_DEVICE_FAILURE}
+};
+
+static const Modbus_Map Test_Map = {Test_Ranges, sizeof(Test_Ranges) / sizeof(Test_Ranges[0])};
+
+static U8 Test_Request[MODBUS_PDU_SIZE];
+static U8 Test_Reply[MODBUS_PDU_SIZE];
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Put16(U8 * pData, U32 value)
+{
+  pData[0] = (U8)(value >> 8);
+  pData[1] = (U8)value;
+}
+
+static U32 test_Get16(const U8 * pData)
+{
+  return ((U32)pData[0] << 8) | pData[1];
+}
+
+static U32 test_Bit(const U8 * pBits, U32 bit)
+{
+  return (pBits[bit >> 3] >> (bit & 7)) & 1;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Function, address and quantity (or value), the 5 bytes every request but the diagnostics has */
+
+static U32 test_Process(U32 function, U32 address, U32 value, U32 length)
+{
+  Test_Request[0] = (U8)function;
+  test_Put16(&Test_Request[1], address);
+  test_Put16(&Test_Request[3], value);
+  memset(Test_Reply, 0xEE, sizeof(Test_Reply));
+  return Modbus_Process(&Test_Map, Test_Request, length, Test_Reply);
+}
+
+/* The reply is the exception 'code' to 'function' */
+
+static U32 test_Exception(U32 length, U32 function, U32 code)
+{
+  return (2 == length) && ((function | MODBUS_EXCEPTION) == Test_Reply[0]) &&
+         (code == Test_Reply[1]);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Bit by bit, as the specification gives it */
+
+static U16 test_CRC(const U8 * pData, U32 count)
+{
+  U32 crc = 0xFFFF, i;
+
+  while (0 != count--)
+  {
+    crc ^= *pData++;
+    for (i = 0; i < 8; i++) crc = (0 != (crc & 1)) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+  }
+  return (U16)crc;
+}
+
+static void test_Checksum(void)
+{
+  static const U8 check[] = "123456789";
+  static const U8 read[] = {0x11, 0x03, 0x00, 0x6B, 0x00, 0x03};
+  static const U8 frame[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A, 0xC5, 0xCD};
+  U8 data[256];
+  U32 wrong = 0, run, count, i;
+
+  TEST_CHECK(0x4B37 == Modbus_CRC(check, 9));
+  TEST_CHECK(0x8776 == Modbus_CRC(read, sizeof(read)));
+  TEST_CHECK(0xCDC5 == Modbus_CRC(frame, 6));
+  TEST_CHECK(0xFFFF == Modbus_CRC(frame, 0));
+
+  /* A frame with its CRC appended, low byte first, has a CRC of 0 */
+  TEST_CHECK(0 == Modbus_CRC(frame, sizeof(frame)));
+
+  for (run = 0; run < TEST_RUNS; run++)
+  {
+    count = Test_Random() % sizeof(data);
+    for (i = 0; i < count; i++) data[i] = (U8)Test_Random();
+    if (test_CRC(data, count) != Modbus_CRC(data, count)) wrong++;
+  }
+  TEST_CHECK(0 == wrong);
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Fill(void)
+{
+  U32 i;
+
+  for (i = 0; i < sizeof(Test_Coils); i++) Test_Coils[i] = (U8)Test_Random();
+  for (i = 0; i < sizeof(Test_Inputs); i++) Test_Inputs[i] = (U8)Test_Random();
+  for (i = 0; i < TEST_REGISTERS; i++)
+  {
+    Test_Input[i]   = (U16)Test_Random();
+    Test_Holding[i] = (U16)Test_Random();
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Random runs inside each range: byte count, data, padding bits of the last byte, the access
+   function told of the read                                                                      */
+
+static void test_Read(void)
+{
+  U32 wrong = 0, run, address, count, length, bytes, bit, i;
+
+  for (run = 0; run < TEST_RUNS; run++)
+  {
+    test_Fill();
+    memset(&Test_Last, 0, sizeof(Test_Last));
+
+    switch (run % 4)
+    {
+      case 0:
+        count   = 1 + Test_Random() % TEST_COILS;
+        address = 1000 + Test_Random() % (TEST_COILS - count + 1);
+        length  = test_Process(MODBUS_READ_COILS, address, count, 5);
+        bytes   = (count + 7) / 8;
+        if ((2 + bytes != length) || (bytes != Test_Reply[1]))
+        {
+          wrong++;
+          break;
+        }
+        for (i = 0; i < 8 * bytes; i++)
+        {
+          bit = (i < count) ? test_Bit(Test_Coils, address - 1000 + i) : 0;
+          if (test_Bit(&Test_Reply[2], i) != bit) wrong++;
+        }
+        if ((1 != Test_Last.Calls) || (FALSE != Test_Last.Write)) wrong++;
+        if ((address - 1000 != Test_Last.Offset) || (count != Test_Last.Count)) wrong++;
+        break;
+
+      case 1:
+        count   = 1 + Test_Random() % TEST_INPUTS;
+        address = 0x10 + Test_Random() % (TEST_INPUTS - count + 1);
+        length  = test_Process(MODBUS_READ_DISCRETE_INPUTS, address, count, 5);
+        bytes   = (count + 7) / 8;
+        if ((2 + bytes != length) || (bytes != Test_Reply[1]))
+        {
+          wrong++;
+          break;
+        }
+        for (i = 0; i < 8 * bytes; i++)
+        {
+          bit = (i < count) ? test_Bit(Test_Inputs, address - 0x10 + i) : 0;
+          if (test_Bit(&Test_Reply[2], i) != bit) wrong++;
+        }
+        if (0 != Test_Last.Calls) wrong++;
+        break;
+
+      case 2:
+        count   = 1 + Test_Random() % 125;
+        address = 1000 + Test_Random() % (TEST_REGISTERS - count + 1);
+        length  = test_Process(MODBUS_READ_HOLDING_REGISTERS, address, count, 5);
+        if ((2 + 2 * count != length) || (2 * count != Test_Reply[1]))
+        {
+          wrong++;
+          break;
+        }
+        for (i = 0; i < count; i++)
+        {
+          if (Test_Holding[address - 1000 + i] != test_Get16(&Test_Reply[2 + 2 * i])) wrong++;
+        }
+        break;
+      default:
+        count   = 1 + Test_Random() % 125;
+        address = Test_Random() % (TEST_REGISTERS - count + 1);
+        length  = test_Process(MODBUS_READ_INPUT_REGISTERS, address, count, 5);
+        if ((2 + 2 * count != length) || (2 * count != Test_Reply[1]))
+        {
+          wrong++;
+          break;
+        }
+        for (i = 0; i < count; i++)
+        {
+          if (Test_Input[address + i] != test_Get16(&Test_Reply[2 + 2 * i])) wrong++;
+        }
+        if ((1 != Test_Last.Calls) || (address != Test_Last.Offset) || (count != Test_Last.Count))
+        {
+          wrong++;
+        }
+        break;
+
+    }
+    if (run % 4 + 1 != Test_Reply[0]) wrong++;
+  }
+  TEST_CHECK(0 == wrong);
+
+  /* The read only ranges can be read */
+  Test_Fixed[0] = 0x5A;
+  Test_Fixed[1] = 0xC3;
+  TEST_CHECK(4 == test_Process(MODBUS_READ_COILS, 100, 16, 5));
+  TEST_CHECK((2 == Test_Reply[1]) && (0x5A == Test_Reply[2]) && (0xC3 == Test_Reply[3]));
+  Test_Constant[7] = 0x1234;
+  TEST_CHECK(4 == test_Process(MODBUS_READ_HOLDING_REGISTERS, 2007, 1, 5));
+  TEST_CHECK((0x12 == Test_Reply[2]) && (0x34 == Test_Reply[3]));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Random writes of each function: the data stored, nothing around it touched, the echo and the
+   access function told after the store                                                           */
+
+static void test_Write(void)
+{
+  U8 coils[sizeof(Test_Coils)];
+  U16 holding[TEST_REGISTERS];
+  U32 wrong = 0, run, address, count, value, length, bytes, i, bit;
+
+  for (run = 0; run < TEST_RUNS; run++)
+  {
+    test_Fill();
+    memcpy(coils, Test_Coils, sizeof(coils));
+    memcpy(holding, Test_Holding, sizeof(holding));
+    memset(&Test_Last, 0, sizeof(Test_Last));
+
+    switch (run % 4)
+    {
+      case 0:
+        address = 1000 + Test_Random() % TEST_COILS;
+        value   = (0 != (Test_Random() & 1)) ? 0xFF00 : 0;
+        count   = 1;
+        length  = test_Process(MODBUS_WRITE_SINGLE_COIL, address, value, 5);
+        bit     = address - 1000;
+        coils[bit >> 3] = (U8)((coils[bit >> 3] & ~(1U << (bit & 7))) |
+                               ((0 != value) << (bit & 7)));
+        break;
+
+      case 1:
+        address = 1000 + Test_Random() % TEST_REGISTERS;
+        value   = Test_Random() & 0xFFFF;
+        count   = 1;
+        length  = test_Process(MODBUS_WRITE_SINGLE_REGISTER, address, value, 5);
+        holding[address - 1000] = (U16)value;
+        break;
+
+      case 2:
+        count   = 1 + Test_Random() % 1968;
+        address = 1000 + Test_Random() % (TEST_COILS - count + 1);
+        bytes   = (count + 7) / 8;
+        Test_Request[5] = (U8)bytes;
+        for (i = 0; i < bytes; i++) Test_Request[6 + i] = (U8)Test_Random();
+        for (i = 0; i < count; i++)
+        {
+          bit = address - 1000 + i;
+          coils[bit >> 3] = (U8)((coils[bit >> 3] & ~(1U << (bit & 7))) |
+                                 (test_Bit(&Test_Request[6], i) << (bit & 7)));
+        }
+        length  = test_Process(MODBUS_WRITE_MULTIPLE_COILS, address, count, 6 + bytes);
+        break;
+
+      default:
+        count   = 1 + Test_Random() % 123;
+        address = 1000 + Test_Random() % (TEST_REGISTERS - count + 1);
+        Test_Request[5] = (U8)(2 * count);
+        for (i = 0; i < count; i++)
+        {
+          holding[address - 1000 + i] = (U16)Test_Random();
+          test_Put16(&Test_Request[6 + 2 * i], holding[address - 1000 + i]);
+        }
+        length  = test_Process(MODBUS_WRITE_MULTIPLE_REGISTERS, address, count, 6 + 2 * count);
+        break;
+    }
+
+    if ((5 != length) || (0 != memcmp(Test_Reply, Test_Request, 5))) wrong++;
+    if (0 != memcmp(coils, Test_Coils, sizeof(coils))) wrong++;
+    if (0 != memcmp(holding, Test_Holding, sizeof(holding))) wrong++;
+    if ((1 != Test_Last.Calls) || (TRUE != Test_Last.Write)) wrong++;
+    if ((address - 1000 != Test_Last.Offset) || (count != Test_Last.Count)) wrong++;
+  }
+  TEST_CHECK(0 == wrong);
+
+  /* The diagnostic echo */
+  Test_Request[0] = MODBUS_DIAGNOSTICS;
+  test_Put16(&Test_Request[1], 0);
+  test_Put16(&Test_Request[3], 0xA537);
+  TEST_CHECK(5 == Modbus_Process(&Test_Map, Test_Request, 5, Test_Reply));
+  TEST_CHECK(0 == memcmp(Test_Reply, Test_Request, 5));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Each check of a request, at the first value that fails it. A refused write stores nothing.   */
+
+static void test_Exceptions(void)
+{
+  U32 length;
+
+  test_Fill();
+  memset(&Test_Last, 0, sizeof(Test_Last));
+
+  /* Quantities of the reads: 1 to 2000 bits, 1 to 125 registers */
+  length = test_Process(MODBUS_READ_COILS, 1000, 0, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_COILS, MODBUS_ILLEGAL_DATA_VALUE));
+  length = test_Process(MODBUS_READ_COILS, 1000, 2001, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_COILS, MODBUS_ILLEGAL_DATA_VALUE));
+  length = test_Process(MODBUS_READ_DISCRETE_INPUTS, 0x10, 2001, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_DISCRETE_INPUTS, MODBUS_ILLEGAL_DATA_VALUE));
+  length = test_Process(MODBUS_READ_INPUT_REGISTERS, 0, 126, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_INPUT_REGISTERS, MODBUS_ILLEGAL_DATA_VALUE));
+  length = test_Process(MODBUS_READ_HOLDING_REGISTERS, 1000, 0, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_HOLDING_REGISTERS, MODBUS_ILLEGAL_DATA_VALUE));
+  TEST_CHECK(252 == test_Process(MODBUS_READ_COILS, 1000, 2000, 5));
+  TEST_CHECK(252 == test_Process(MODBUS_READ_INPUT_REGISTERS, 0, 125, 5));
+
+  /* Lengths */
+  length = test_Process(MODBUS_READ_HOLDING_REGISTERS, 1000, 1, 4);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_HOLDING_REGISTERS, MODBUS_ILLEGAL_DATA_VALUE));
+  length = test_Process(MODBUS_READ_HOLDING_REGISTERS, 1000, 1, 6);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_HOLDING_REGISTERS, MODBUS_ILLEGAL_DATA_VALUE));
+  length = test_Process(MODBUS_WRITE_SINGLE_REGISTER, 1000, 1, 6);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_ILLEGAL_DATA_VALUE));
+  length = test_Process(MODBUS_WRITE_MULTIPLE_REGISTERS, 1000, 1, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_ILLEGAL_DATA_VALUE));
+
+  /* A coil is 0xFF00 or 0 */
+  length = test_Process(MODBUS_WRITE_SINGLE_COIL, 1000, 0x0001, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_SINGLE_COIL, MODBUS_ILLEGAL_DATA_VALUE));
+
+  /* Quantities of the writes, 1 to 1968 bits, 1 to 123 registers, and their byte counts */
+  Test_Request[5] = 0;
+  length = test_Process(MODBUS_WRITE_MULTIPLE_COILS, 1000, 0, 6);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_MULTIPLE_COILS, MODBUS_ILLEGAL_DATA_VALUE));
+  Test_Request[5] = 247;
+  length = test_Process(MODBUS_WRITE_MULTIPLE_COILS, 1000, 1969, 6 + 247);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_MULTIPLE_COILS, MODBUS_ILLEGAL_DATA_VALUE));
+  Test_Request[5] = 248;
+  length = test_Process(MODBUS_WRITE_MULTIPLE_REGISTERS, 1000, 124, 6 + 248);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_ILLEGAL_DATA_VALUE));
+  Test_Request[5] = 2;
+  length = test_Process(MODBUS_WRITE_MULTIPLE_COILS, 1000, 9, 6 + 2);
+  TEST_CHECK(5 == length);
+  Test_Request[5] = 1;
+  length = test_Process(MODBUS_WRITE_MULTIPLE_COILS, 1000, 9, 6 + 1);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_MULTIPLE_COILS, MODBUS_ILLEGAL_DATA_VALUE));
+  Test_Request[5] = 4;
+  length = test_Process(MODBUS_WRITE_MULTIPLE_REGISTERS, 1000, 2, 6 + 3);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_ILLEGAL_DATA_VALUE));
+
+  /* Addresses: outside the map, across the end of a range, in the table of another function */
+  memset(&Test_Last, 0, sizeof(Test_Last));
+  length = test_Process(MODBUS_READ_HOLDING_REGISTERS, 999, 1, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_HOLDING_REGISTERS, MODBUS_ILLEGAL_DATA_ADDRESS));
+  length = test_Process(MODBUS_READ_HOLDING_REGISTERS, 1000 + TEST_REGISTERS - 2, 3, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_HOLDING_REGISTERS, MODBUS_ILLEGAL_DATA_ADDRESS));
+  length = test_Process(MODBUS_READ_INPUT_REGISTERS, 1000, 1, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_INPUT_REGISTERS, MODBUS_ILLEGAL_DATA_ADDRESS));
+  length = test_Process(MODBUS_READ_DISCRETE_INPUTS, 0x10 + TEST_INPUTS, 1, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_DISCRETE_INPUTS, MODBUS_ILLEGAL_DATA_ADDRESS));
+  length = test_Process(MODBUS_WRITE_SINGLE_COIL, 1000 + TEST_COILS, 0xFF00, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_SINGLE_COIL, MODBUS_ILLEGAL_DATA_ADDRESS));
+  length = test_Process(MODBUS_WRITE_SINGLE_REGISTER, 0xFFFF, 1, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_ILLEGAL_DATA_ADDRESS));
+  TEST_CHECK(0 == Test_Last.Calls);
+
+  /* The read only ranges refuse every write, as an address outside the map */
+  Test_Fixed[0] = 0;
+  Test_Constant[0] = 0x1234;
+  length = test_Process(MODBUS_WRITE_SINGLE_COIL, 100, 0xFF00, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_SINGLE_COIL, MODBUS_ILLEGAL_DATA_ADDRESS));
+  Test_Request[5] = 1;
+  Test_Request[6] = 0xFF;
+  length = test_Process(MODBUS_WRITE_MULTIPLE_COILS, 100, 8, 7);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_MULTIPLE_COILS, MODBUS_ILLEGAL_DATA_ADDRESS));
+  length = test_Process(MODBUS_WRITE_SINGLE_REGISTER, 2000, 0x4321, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_ILLEGAL_DATA_ADDRESS));
+  Test_Request[5] = 2;
+  test_Put16(&Test_Request[6], 0x4321);
+  length = test_Process(MODBUS_WRITE_MULTIPLE_REGISTERS, 2000, 1, 8);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_MULTIPLE_REGISTERS, MODBUS_ILLEGAL_DATA_ADDRESS));
+  TEST_CHECK((0 == Test_Fixed[0]) && (0x1234 == Test_Constant[0]));
+
+  /* The code returned by the access function */
+  length = test_Process(MODBUS_READ_HOLDING_REGISTERS, 3000, 4, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_READ_HOLDING_REGISTERS, MODBUS_DEVICE_FAILURE));
+  length = test_Process(MODBUS_WRITE_SINGLE_REGISTER, 3001, 7, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_WRITE_SINGLE_REGISTER, MODBUS_DEVICE_FAILURE));
+
+  /* Functions: unknown ones and the diagnostics other than sub-function 0 */
+  length = test_Process(0x07, 0, 0, 1);
+  TEST_CHECK(test_Exception(length, 0x07, MODBUS_ILLEGAL_FUNCTION));
+  length = test_Process(0x2B, 0x0E01, 0, 5);
+  TEST_CHECK(test_Exception(length, 0x2B, MODBUS_ILLEGAL_FUNCTION));
+  length = test_Process(MODBUS_DIAGNOSTICS, 0x0001, 0, 5);
+  TEST_CHECK(test_Exception(length, MODBUS_DIAGNOSTICS, MODBUS_ILLEGAL_FUNCTION));
+  length = test_Process(MODBUS_DIAGNOSTICS, 0, 0, 2);
+  TEST_CHECK(test_Exception(length, MODBUS_DIAGNOSTICS, MODBUS_ILLEGAL_FUNCTION));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Average time of a request over TEST_TIMING_RUNS, in ns */
+
+static double test_Time(U32 function, U32 address, U32 value, U32 length)
+{
+  struct timespec start, end;
+  U32 run;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (run = 0; run < TEST_TIMING_RUNS; run++)
+  {
+    if (0 == test_Process(function, address, value, length)) break;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / TEST_TIMING_RUNS;
+}
+
+static void test_Timing(void)
+{
+  double coils, registers, write, echo;
+  U32 i;
+
+  test_Fill();
+  coils     = test_Time(MODBUS_READ_COILS, 1000, 2000, 5);
+  registers = test_Time(MODBUS_READ_HOLDING_REGISTERS, 1000, 125, 5);
+
+  Test_Request[5] = 246;
+  for (i = 0; i < 246; i++) Test_Request[6 + i] = (U8)Test_Random();
+  write = test_Time(MODBUS_WRITE_MULTIPLE_REGISTERS, 1000, 123, 6 + 246);
+  echo  = test_Time(MODBUS_DIAGNOSTICS, 0, 0x1234, 5);
+
+  printf("process  read 2000 coils %.0f ns  read 125 registers %.0f ns  write 123 registers %.0f ns"
+         "  echo %.0f ns\n", coils, registers, write, echo);
+  TEST_CHECK((TEST_BUDGET_NS > coils) && (TEST_BUDGET_NS > registers));
+  TEST_CHECK((TEST_BUDGET_NS > write) && (TEST_BUDGET_NS > echo));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int main(void)
+{
+  test_Checksum();
+  test_Read();
+  test_Write();
+  test_Exceptions();
+  test_Timing();
+
+  return TEST_RESULT();
+}
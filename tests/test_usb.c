@@ -0,0 +1,438 @@
+#include <string.h>
+
+#include "types.h"
+#include "usb_model.h"
+#include "usbreg.h"
+#include "usb.h"
+#include "stream.h"
+#include "test.h"
+
+/* The device core against the register model of usb_model.h. The host side of the bus is played
+   here: a transaction moves the packet through the packet memory, sets the flags the peripheral
+   would set and runs the interrupt. Enumeration goes through SETUP, GET_DESCRIPTOR, SET_ADDRESS
+   and SET_CONFIGURATION; the double buffered IN endpoint is followed buffer by buffer.          */
+
+#define TEST_EP0_SIZE                      (16)
+#define TEST_CONFIG_SIZE                   (32)
+#define TEST_ADDRESS                       (0x12)
+
+/* Endpoint registers */
+#define TEST_IN                            (1)
+#define TEST_OUT                           (2)
+
+#define HOST_NAK                           (-1)
+#define HOST_STALL                         (-2)
+
+/* Fields of an endpoint register; SW_BUF of a double buffered IN endpoint is DTOG_RX */
+#define HOST_STAT_TX(n)                    (USBModel_EPR[n] & USB_EPTX_STAT)
+#define HOST_STAT_RX(n)                    (USBModel_EPR[n] & USB_EPRX_STAT)
+#define HOST_DTOG_TX(n)                    ((0 != (USBModel_EPR[n] & USB_EP_DTOG_TX)) ? 1 : 0)
+#define HOST_DTOG_RX(n)                    ((0 != (USBModel_EPR[n] & USB_EP_DTOG_RX)) ? 1 : 0)
+
+U16 USBModel_EPR[8];
+U16 USBModel_ISTR;
+volatile U16 USBModel_PMA[512];
+
+static USB_TypeDef USBModel_USB;
+
+static const U8 Test_Device[] =
+{
+  18, USB_DESC_DEVICE, USB_LE16(0x0200), 0xFF, 0x00, 0x00, TEST_EP0_SIZE,
+  USB_LE16(0x0483), USB_LE16(0x5740), USB_LE16(0x0100), 1, 0, 0, 1
+};
+
+static const U8 Test_Configuration[TEST_CONFIG_SIZE] =
+{
+  9, USB_DESC_CONFIGURATION, USB_LE16(TEST_CONFIG_SIZE), 1, 1, 0, 0x80, 50,
+  9, USB_DESC_INTERFACE, 0, 0, 2, 0xFF, 0x00, 0x00, 0,
+  7, USB_DESC_ENDPOINT, 0x81, 0x02, USB_LE16(64), 0,
+  7, USB_DESC_ENDPOINT, 0x02, 0x02, USB_LE16(64), 0
+};
+
+static const USB_Endpoint Test_Endpoints[] =
+{
+  {0x81, USB_EP_BULK, 64, TRUE},
+  {0x02, USB_EP_BULK, 64, FALSE}
+};
+
+static const char * const Test_Strings[] = {"Test"};
+
+static const USB_Config Test_Config =
+{
+  Test_Device, Test_Configuration, Test_Strings, 1, Test_Endpoints, 2, NULL, 0
+};
+
+static U8 Test_InData[256];
+static U8 Test_OutData[256];
+static Stream Test_InStream;
+static Stream Test_OutStream;
+
+static U32 Host_Buffer;                    /* Buffer of the last double buffered transaction      */
+static U32 Host_Packets;                   /* Of the last control data stage                      */
+
+/* ---------------------------------------------------------------------------------------------- */
+
+USB_TypeDef * USBModel_Registers(void)
+{
+  U32 n;
+
+  USBModel_USB.ISTR = USBModel_ISTR & (U16)~(USB_ISTR_CTR | USB_ISTR_DIR | USB_ISTR_EP_ID);
+  for (n = 0; n < 8; n++)
+  {
+    if (0 != (USBModel_EPR[n] & USB_EP_CTR))
+    {
+      USBModel_USB.ISTR |= (U16)(USB_ISTR_CTR | n);
+      break;
+    }
+  }
+
+  return &USBModel_USB;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+void USBModel_WriteEPR(U32 n, U32 value)
+{
+  U32 r = USBModel_EPR[n];
+
+  r = (r & ~USB_EP_RW) | (value & USB_EP_RW);
+  r ^= value & USB_EP_TOGGLES;
+  r &= value | ~USB_EP_CTR;
+  USBModel_EPR[n] = (U16)r;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void host_PMAWrite(U32 offset, const U8 * pData, U32 count)
+{
+  U32 i, o;
+
+  for (i = 0; i < count; i++)
+  {
+    o = offset + i;
+    if (0 != (o & 1)) USBModel_PMA[o - 1] = (U16)((USBModel_PMA[o - 1] & 0x00FF) | (pData[i] << 8));
+    else              USBModel_PMA[o]     = (U16)((USBModel_PMA[o] & 0xFF00) | pData[i]);
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void host_PMARead(U32 offset, U8 * pData, U32 count)
+{
+  U32 i, o;
+
+  for (i = 0; i < count; i++)
+  {
+    o = offset + i;
+    pData[i] = (U8)(USBModel_PMA[o & ~1U] >> (8 * (o & 1)));
+  }
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Size of a reception buffer from its COUNTn_RX */
+
+static U32 host_RxSize(U32 count)
+{
+  U32 blocks = (count >> 10) & 0x1F;
+
+  return (0 != (count & 0x8000)) ? (blocks + 1) * 32 : blocks * 2;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static U32 host_IsDouble(U32 n)
+{
+  return (0 != (USBModel_EPR[n] & USB_EP_KIND)) &&
+         (USB_EP_BULK == (USBModel_EPR[n] & USB_EP_T_FIELD));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A SETUP is taken whatever the state of the endpoint, and sets both directions to NAK */
+
+static int host_Out(U32 n, const U8 * pData, U32 count, U32 setup)
+{
+  volatile U16 * pCount;
+  U32 buffer;
+
+  if (FALSE == setup)
+  {
+    if (USB_EP_RX_STALL == HOST_STAT_RX(n)) return HOST_STALL;
+    if (USB_EP_RX_VALID != HOST_STAT_RX(n)) return HOST_NAK;
+  }
+
+  if ((FALSE == setup) && (FALSE != host_IsDouble(n)))
+  {
+    /* The peripheral writes the buffer DTOG_RX points to, unless the CPU still has it (SW_BUF) */
+    buffer = HOST_DTOG_RX(n);
+    if (buffer == HOST_DTOG_TX(n)) return HOST_NAK;
+
+    pCount = (0 == buffer) ? &USB_PMA_COUNT_TX(n) : &USB_PMA_COUNT_RX(n);
+    TEST_CHECK(count <= host_RxSize(*pCount));
+    host_PMAWrite((0 == buffer) ? USB_PMA_ADDR_TX(n) : USB_PMA_ADDR_RX(n), pData, count);
+    *pCount = (U16)((*pCount & ~USB_PMA_COUNT_MASK) | count);
+    USBModel_EPR[n] ^= USB_EP_DTOG_RX;
+  }
+  else
+  {
+    TEST_CHECK(count <= host_RxSize(USB_PMA_COUNT_RX(n)));
+    host_PMAWrite(USB_PMA_ADDR_RX(n), pData, count);
+    USB_PMA_COUNT_RX(n) = (U16)((USB_PMA_COUNT_RX(n) & ~USB_PMA_COUNT_MASK) | count);
+    USBModel_EPR[n] = (U16)((USBModel_EPR[n] & ~USB_EPRX_STAT) | USB_EP_RX_NAK);
+    USBModel_EPR[n] ^= USB_EP_DTOG_RX;
+    if (FALSE != setup)
+    {
+      USBModel_EPR[n] = (U16)((USBModel_EPR[n] & ~USB_EPTX_STAT) | USB_EP_TX_NAK | USB_EP_SETUP);
+    }
+    else
+    {
+      USBModel_EPR[n] &= (U16)~USB_EP_SETUP;
+    }
+  }
+
+  USBModel_EPR[n] |= USB_EP_CTR_RX;
+  USB_Interrupt();
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* Returns the size of the packet */
+
+static int host_In(U32 n, U8 * pData)
+{
+  U32 count;
+
+  if (USB_EP_TX_STALL == HOST_STAT_TX(n)) return HOST_STALL;
+  if (USB_EP_TX_VALID != HOST_STAT_TX(n)) return HOST_NAK;
+
+  if (FALSE != host_IsDouble(n))
+  {
+    /* The peripheral sends the buffer DTOG_TX points to, unless the CPU still has it (SW_BUF) */
+    Host_Buffer = HOST_DTOG_TX(n);
+    if (Host_Buffer == HOST_DTOG_RX(n)) return HOST_NAK;
+
+    count = ((0 == Host_Buffer) ? USB_PMA_COUNT_TX(n) : USB_PMA_COUNT_RX(n)) & USB_PMA_COUNT_MASK;
+    host_PMARead((0 == Host_Buffer) ? USB_PMA_ADDR_TX(n) : USB_PMA_ADDR_RX(n), pData, count);
+  }
+  else
+  {
+    count = USB_PMA_COUNT_TX(n) & USB_PMA_COUNT_MASK;
+    host_PMARead(USB_PMA_ADDR_TX(n), pData, count);
+    USBModel_EPR[n] = (U16)((USBModel_EPR[n] & ~USB_EPTX_STAT) | USB_EP_TX_NAK);
+  }
+
+  USBModel_EPR[n] ^= USB_EP_DTOG_TX;
+  USBModel_EPR[n] |= USB_EP_CTR_TX;
+  USB_Interrupt();
+  return (int)count;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void host_Reset(void)
+{
+  USBModel_ISTR |= USB_ISTR_RESET;
+  USB_Interrupt();
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A whole control transfer: the length of the data IN stage, or HOST_STALL */
+
+static int host_Control(U8 type, U8 request, U16 value, U16 index, U16 length, U8 * pData)
+{
+  U8 setup[8] = {type, request, USB_LE16(value), USB_LE16(index), USB_LE16(length)};
+  U8 status[TEST_EP0_SIZE];
+  int result, done = 0, i;
+
+  host_Out(0, setup, sizeof(setup), TRUE);
+  Host_Packets = 0;
+
+  if ((0 != (type & USB_REQ_IN)) && (0 != length))
+  {
+    for (i = 0; i < 64; i++)
+    {
+      result = host_In(0, &pData[done]);
+      if (HOST_STALL == result) return HOST_STALL;
+      if (HOST_NAK == result) continue;
+
+      done += result;
+      Host_Packets++;
+      if ((TEST_EP0_SIZE > result) || (length <= done)) break;
+    }
+    result = host_Out(0, NULL, 0, FALSE);
+    TEST_CHECK(0 == result);
+    return done;
+  }
+
+  for (i = 0; i < length; i += TEST_EP0_SIZE)
+  {
+    result = host_Out(0, &pData[i], (TEST_EP0_SIZE < length - i) ? TEST_EP0_SIZE : length - i,
+                      FALSE);
+    if (HOST_STALL == result) return HOST_STALL;
+    TEST_CHECK(0 == result);
+  }
+  result = host_In(0, status);
+  if (HOST_STALL == result) return HOST_STALL;
+  TEST_CHECK(0 == result);
+  return 0;
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+static void test_Enumeration(void)
+{
+  U8 setup[8] = {USB_REQ_DEVICE, USB_REQ_SET_ADDRESS, USB_LE16(TEST_ADDRESS), 0, 0, 0, 0};
+  U8 data[256];
+
+  host_Reset();
+  TEST_CHECK(USB_EP_RX_VALID == HOST_STAT_RX(0));
+  TEST_CHECK(USB_EP_TX_NAK == HOST_STAT_TX(0));
+  TEST_CHECK(USB_DADDR_EF == USBModel_USB.DADDR);
+
+  /* The host asks for 64 bytes of the device descriptor first, two packets come */
+  TEST_CHECK(18 == host_Control(0x80, USB_REQ_GET_DESCRIPTOR, 0x0100, 0, 64, data));
+  TEST_CHECK(2 == Host_Packets);
+  TEST_CHECK(0 == memcmp(data, Test_Device, 18));
+
+  /* The address only takes effect after the status stage */
+  host_Out(0, setup, sizeof(setup), TRUE);
+  TEST_CHECK(USB_DADDR_EF == USBModel_USB.DADDR);
+  TEST_CHECK(0 == host_In(0, data));
+  TEST_CHECK((USB_DADDR_EF | TEST_ADDRESS) == USBModel_USB.DADDR);
+
+  /* Header first, then all of it: two full packets and a zero length one to end it */
+  TEST_CHECK(9 == host_Control(0x80, USB_REQ_GET_DESCRIPTOR, 0x0200, 0, 9, data));
+  TEST_CHECK(TEST_CONFIG_SIZE == host_Control(0x80, USB_REQ_GET_DESCRIPTOR, 0x0200, 0, 255, data));
+  TEST_CHECK(3 == Host_Packets);
+  TEST_CHECK(0 == memcmp(data, Test_Configuration, TEST_CONFIG_SIZE));
+
+  /* Exactly wLength: no zero length packet */
+  TEST_CHECK(TEST_CONFIG_SIZE == host_Control(0x80, USB_REQ_GET_DESCRIPTOR, 0x0200, 0,
+                                               TEST_CONFIG_SIZE, data));
+  TEST_CHECK(2 == Host_Packets);
+
+  TEST_CHECK(4 == host_Control(0x80, USB_REQ_GET_DESCRIPTOR, 0x0300, 0, 255, data));
+  TEST_CHECK((0x09 == data[2]) && (0x04 == data[3]));
+  TEST_CHECK(10 == host_Control(0x80, USB_REQ_GET_DESCRIPTOR, 0x0301, 0x0409, 255, data));
+  TEST_CHECK(('T' == data[2]) && (0 == data[3]) && ('t' == data[8]));
+
+  /* The device qualifier is stalled, the next SETUP is taken anyway */
+  TEST_CHECK(HOST_STALL == host_Control(0x80, USB_REQ_GET_DESCRIPTOR, 0x0600, 0, 10, data));
+  TEST_CHECK(18 == host_Control(0x80, USB_REQ_GET_DESCRIPTOR, 0x0100, 0, 18, data));
+
+  TEST_CHECK(FALSE == USB_IsConfigured());
+  TEST_CHECK(HOST_STALL == host_Control(0x00, USB_REQ_SET_CONFIGURATION, 2, 0, 0, data));
+  TEST_CHECK(0 == host_Control(0x00, USB_REQ_SET_CONFIGURATION, 1, 0, 0, data));
+  TEST_CHECK(FALSE != USB_IsConfigured());
+  TEST_CHECK((1 == host_Control(0x80, USB_REQ_GET_CONFIGURATION, 0, 0, 1, data)) && (1 == data[0]));
+
+  /* The endpoints are open: OUT ready to receive, IN with both buffers empty */
+  TEST_CHECK(USB_EP_RX_VALID == HOST_STAT_RX(TEST_OUT));
+  TEST_CHECK(USB_EP_TX_VALID == HOST_STAT_TX(TEST_IN));
+  TEST_CHECK(HOST_DTOG_TX(TEST_IN) == HOST_DTOG_RX(TEST_IN));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* SW_BUF (DTOG_RX) is the buffer the CPU writes, DTOG_TX the one the peripheral sends. They are
+   equal when nothing is ready: the host gets a NAK.                                              */
+
+static void test_DoubleIn(void)
+{
+  U8 data[256], packet[64];
+  U32 i;
+
+  for (i = 0; i < sizeof(data); i++) data[i] = (U8)(i * 7 + 1);
+
+  TEST_CHECK(HOST_NAK == host_In(TEST_IN, packet));
+
+  /* Two full packets and a short one: the first two fill both buffers, SW_BUF hands over
+     buffer 0 and moves to buffer 1                                                               */
+  Stream_Write(&Test_InStream, data, 138);
+  USB_Interrupt();
+  TEST_CHECK(64 == (USB_PMA_COUNT_TX(TEST_IN) & USB_PMA_COUNT_MASK));
+  TEST_CHECK(64 == (USB_PMA_COUNT_RX(TEST_IN) & USB_PMA_COUNT_MASK));
+  TEST_CHECK((0 == HOST_DTOG_TX(TEST_IN)) && (1 == HOST_DTOG_RX(TEST_IN)));
+  TEST_CHECK(10 == Stream_Count(&Test_InStream));
+
+  /* Buffer 0 goes out, the peripheral moves on to buffer 1 which the interrupt hands over, and
+     the short packet goes into buffer 0                                                          */
+  TEST_CHECK(64 == host_In(TEST_IN, packet));
+  TEST_CHECK((0 == Host_Buffer) && (0 == memcmp(packet, &data[0], 64)));
+  TEST_CHECK((1 == HOST_DTOG_TX(TEST_IN)) && (0 == HOST_DTOG_RX(TEST_IN)));
+  TEST_CHECK(10 == (USB_PMA_COUNT_TX(TEST_IN) & USB_PMA_COUNT_MASK));
+  TEST_CHECK(0 == Stream_Count(&Test_InStream));
+
+  TEST_CHECK(64 == host_In(TEST_IN, packet));
+  TEST_CHECK((1 == Host_Buffer) && (0 == memcmp(packet, &data[64], 64)));
+  TEST_CHECK((0 == HOST_DTOG_TX(TEST_IN)) && (1 == HOST_DTOG_RX(TEST_IN)));
+
+  /* The last one is short, no zero length packet follows and both buffers are empty */
+  TEST_CHECK(10 == host_In(TEST_IN, packet));
+  TEST_CHECK((0 == Host_Buffer) && (0 == memcmp(packet, &data[128], 10)));
+  TEST_CHECK(HOST_DTOG_TX(TEST_IN) == HOST_DTOG_RX(TEST_IN));
+  TEST_CHECK(HOST_NAK == host_In(TEST_IN, packet));
+
+  /* A transfer that ends on a full packet is closed by a zero length one, from buffer 1 */
+  Stream_Write(&Test_InStream, data, 64);
+  USB_Interrupt();
+  TEST_CHECK(64 == host_In(TEST_IN, packet));
+  TEST_CHECK(1 == Host_Buffer);
+  TEST_CHECK(0 == host_In(TEST_IN, packet));
+  TEST_CHECK(0 == Host_Buffer);
+  TEST_CHECK(HOST_NAK == host_In(TEST_IN, packet));
+
+  /* Data written while a packet is on the bus joins the queue behind it */
+  Stream_Write(&Test_InStream, data, 20);
+  USB_Interrupt();
+  Stream_Write(&Test_InStream, &data[20], 30);
+  USB_Interrupt();
+  TEST_CHECK((20 == host_In(TEST_IN, packet)) && (0 == memcmp(packet, data, 20)));
+  TEST_CHECK((30 == host_In(TEST_IN, packet)) && (0 == memcmp(packet, &data[20], 30)));
+  TEST_CHECK(HOST_NAK == host_In(TEST_IN, packet));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+/* A packet the stream has no room for stays in the packet memory, NAKed, until it is read */
+
+static void test_SingleOut(void)
+{
+  U8 data[64], read[256];
+  U32 i, total = 0;
+
+  for (i = 0; i < sizeof(data); i++) data[i] = (U8)(0xA0 + i);
+
+  TEST_CHECK((0 == host_Out(TEST_OUT, data, 5, FALSE)) && (5 == Stream_Count(&Test_OutStream)));
+  TEST_CHECK(USB_EP_RX_VALID == HOST_STAT_RX(TEST_OUT));
+
+  while (0 == host_Out(TEST_OUT, data, 64, FALSE)) total += 64;
+  TEST_CHECK((256 == total) && (USB_EP_RX_NAK == HOST_STAT_RX(TEST_OUT)));
+  TEST_CHECK(HOST_NAK == host_Out(TEST_OUT, data, 64, FALSE));
+
+  /* The fourth packet waits in the packet memory */
+  TEST_CHECK(5 + 192 == Stream_Read(&Test_OutStream, read, sizeof(read)));
+  TEST_CHECK((0 == memcmp(read, data, 5)) && (0 == memcmp(&read[5], data, 64)));
+  USB_Interrupt();
+  TEST_CHECK((64 == Stream_Count(&Test_OutStream)) && (USB_EP_RX_VALID == HOST_STAT_RX(TEST_OUT)));
+}
+
+/* ---------------------------------------------------------------------------------------------- */
+
+int main(void)
+{
+  TEST_CHECK(FALSE != USB_Init(&Test_Config));
+  Stream_Init(&Test_InStream, Test_InData, sizeof(Test_InData));
+  Stream_Init(&Test_OutStream, Test_OutData, sizeof(Test_OutData));
+  TEST_CHECK(FALSE != USB_Bind(0x81, &Test_InStream, NULL, NULL));
+  TEST_CHECK(FALSE != USB_Bind(0x02, &Test_OutStream, NULL, NULL));
+
+  test_Enumeration();
+  test_DoubleIn();
+  test_SingleOut();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,28 @@
+#ifndef __USB_MODEL_H__
+#define __USB_MODEL_H__
+
+#include "types.h"
+#include "stm32f1xx.h"
+
+/* Register model of the USB block for the host build of usbcore.c, included ahead of every source
+   of test_usb (CMakeLists.txt) so that usbreg.h finds its access macros already defined.
+
+   The endpoint registers keep the write semantics of the peripheral: the type, kind and address
+   are written, the data toggles and the STAT fields are toggled by the 1s written, and the CTR
+   flags are cleared by the 0s. ISTR reports CTR and the lowest endpoint with a flag set. The
+   packet memory is indexed by byte offset like the real one, two bytes in every even entry.     */
+
+extern U16 USBModel_EPR[8];
+extern U16 USBModel_ISTR;                  /* Flags other than CTR, cleared by USB_ISTR_CLEAR()   */
+extern volatile U16 USBModel_PMA[512];
+
+USB_TypeDef * USBModel_Registers(void);
+void          USBModel_WriteEPR(U32 n, U32 value);
+
+#define USB_REGS                           (USBModel_Registers())
+#define USB_PMA                            (USBModel_PMA)
+#define USB_EPR_READ(n)                    ((U32)USBModel_EPR[n])
+#define USB_EPR_WRITE(n, value)            USBModel_WriteEPR((n), (value))
+#define USB_ISTR_CLEAR(flags)              (USBModel_ISTR &= (U16)~(flags))
+
+#endif /* __USB_MODEL_H__ */
@@ -0,0 +1,159 @@
+#!/usr/bin/env python3
+"""Decoder of the crash record saved by src/os/crashdump.c.
+
+The record lives in the last flash page (0x0800FC00). Read it with any
+programmer, e.g. "st-flash read crash.bin 0x0800FC00 1024", then run
+
+    crashdump.py crash.bin [firmware.axf|firmware.out]
+
+The ELF image (Keil .axf or IAR .out) is optional and is used to turn the
+PC, LR and stacked code addresses into function names.
+"""
+
+import struct
+import sys
+
+MAGIC = 0x48535243
+VERSION = 1
+STACK_WORDS = 32
+TASK_NAME_LEN = 12
+TRACE_EVENTS = 16
+
+HEADER = struct.Struct('<IHHI8II5I%ds' % TASK_NAME_LEN)
+STACK = struct.Struct('<%dI' % STACK_WORDS)
+TRACE = struct.Struct('<I%dI' % (2 * TRACE_EVENTS))
+SIZE = HEADER.size + STACK.size + TRACE.size + 4
+
+VECTORS = {2: 'NMI', 3: 'Hard Fault', 4: 'Mem Manage', 5: 'Bus Fault',
+           6: 'Usage Fault', 12: 'Debug Monitor'}
+
+CFSR_BITS = [
+    (0, 'IACCVIOL'), (1, 'DACCVIOL'), (3, 'MUNSTKERR'), (4, 'MSTKERR'),
+    (7, 'MMARVALID'), (8, 'IBUSERR'), (9, 'PRECISERR'), (10, 'IMPRECISERR'),
+    (11, 'UNSTKERR'), (12, 'STKERR'), (15, 'BFARVALID'), (16, 'UNDEFINSTR'),
+    (17, 'INVSTATE'), (18, 'INVPC'), (19, 'NOCP'), (24, 'UNALIGNED'),
+    (25, 'DIVBYZERO')]
+
+HFSR_BITS = [(1, 'VECTTBL'), (30, 'FORCED'), (31, 'DEBUGEVT')]
+
+TRACE_IDS = {0x01: 'switch'}
+
+
+def checksum(words):
+    total = 0
+    for word in words:
+        total = (((total << 1) | (total >> 31)) + word) & 0xFFFFFFFF
+    return total
+
+
+class Symbols(object):
+    """Function symbols of an ELF32 little-endian image."""
+
+    def __init__(self, path):
+        self.functions = []
+        with open(path, 'rb') as f:
+            data = f.read()
+        if data[:4] != b'\x7fELF':
+            raise ValueError('%s is not an ELF file' % path)
+        shoff, = struct.unpack_from('<I', data, 0x20)
+        shentsize, shnum = struct.unpack_from('<HH', data, 0x2E)
+        sections = [struct.unpack_from('<10I', data, shoff + i * shentsize)
+                    for i in range(shnum)]
+        for section in sections:
+            if section[1] != 2:  # SHT_SYMTAB
+                continue
+            strtab = sections[section[6]]
+            for offset in range(section[4], section[4] + section[5], 16):
+                name, value, size, info = struct.unpack_from('<IIIB', data, offset)
+                if (info & 0x0F) != 2:  # STT_FUNC
+                    continue
+                start = strtab[4] + name
+                end = data.index(b'\x00', start)
+                self.functions.append((value & ~1, size, data[start:end].decode()))
+        self.functions.sort()
+
+    def lookup(self, address):
+        address &= ~1
+        for start, size, name in self.functions:
+            if start <= address < start + max(size, 1):
+                return '%s+0x%x' % (name, address - start)
+        return None
+
+
+def flags(value, bits):
+    return ' '.join(name for bit, name in bits if value & (1 << bit))
+
+
+def decode(data, symbols):
+    if len(data) < SIZE:
+        raise ValueError('record is truncated')
+
+    header = HEADER.unpack_from(data, 0)
+    magic, version, size, vector = header[0:4]
+    frame = header[4:12]
+    sp, cfsr, hfsr, mmfar, bfar, shcsr = header[12:18]
+    task = header[18].split(b'\x00')[0].decode(errors='replace')
+    stack = STACK.unpack_from(data, HEADER.size)
+    trace = TRACE.unpack_from(data, HEADER.size + STACK.size)
+    crc, = struct.unpack_from('<I', data, SIZE - 4)
+
+    if magic != MAGIC:
+        raise ValueError('no crash record (magic 0x%08x)' % magic)
+    if version != VERSION or size != SIZE:
+        raise ValueError('unsupported record version %d size %d' % (version, size))
+    if checksum(struct.unpack_from('<%dI' % ((SIZE - 4) // 4), data, 0)) != crc:
+        raise ValueError('checksum mismatch')
+
+    def where(address):
+        name = symbols.lookup(address) if symbols else None
+        return '0x%08x%s' % (address, ('  ' + name) if name else '')
+
+    print('%s in task "%s"' % (VECTORS.get(vector, 'Exception %d' % vector), task))
+    print('  CFSR     = 0x%08x %s' % (cfsr, flags(cfsr, CFSR_BITS)))
+    print('  HFSR     = 0x%08x %s' % (hfsr, flags(hfsr, HFSR_BITS)))
+    print('  MMFAR    = 0x%08x' % mmfar)
+    print('  BFAR     = 0x%08x' % bfar)
+    print('  SHCSR    = 0x%08x' % shcsr)
+    for name, value in zip(('R0', 'R1', 'R2', 'R3', 'R12'), frame[0:5]):
+        print('  %-8s = 0x%08x' % (name, value))
+    print('  LR [R14] = %s' % where(frame[5]))
+    print('  PC [R15] = %s' % where(frame[6]))
+    print('  PSR      = 0x%08x' % frame[7])
+    print('  SP       = 0x%08x' % sp)
+
+    print('Stack above the frame')
+    for i, value in enumerate(stack):
+        name = symbols.lookup(value) if symbols and (value & 1) else None
+        print('  [0x%08x] 0x%08x%s' % (sp + 32 + 4 * i, value, ('  ' + name) if name else ''))
+
+    count = trace[0]
+    print('Last %d trace events' % count)
+    items = [trace[1 + 2 * i:3 + 2 * i] for i in range(count)]
+    for time, info in items:
+        ident, arg = info & 0xFF, info >> 8
+        if ident == 0x01:
+            text = bytes([(arg >> s) & 0xFF for s in (0, 8, 16)]).split(b'\x00')[0]
+            detail = '"%s"' % text.decode(errors='replace')
+        else:
+            detail = '0x%06x' % arg
+        delta = (items[-1][0] - time) & 0xFFFFFFFF
+        print('  -%10d cyc  %-8s %s' % (delta, TRACE_IDS.get(ident, 'id 0x%02x' % ident), detail))
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write(__doc__)
+        return 1
+    with open(argv[1], 'rb') as f:
+        data = f.read()
+    symbols = Symbols(argv[2]) if len(argv) > 2 else None
+    try:
+        decode(data, symbols)
+    except ValueError as error:
+        sys.stderr.write('%s\n' % error)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
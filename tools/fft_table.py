@@ -0,0 +1,39 @@
+#!/usr/bin/env python3
+"""Generator of the twiddle table used by src/dsp/fft.c.
+
+    fft_table.py [size] > src/dsp/fft_table.h
+
+The table holds cos(2 pi k / size) and sin(2 pi k / size) in Q15 for the
+first three quarters of the circle, which is what the radix-4 butterflies
+of the largest transform need. Smaller transforms step through it.
+"""
+
+import math
+import sys
+
+
+def q15(x):
+    return max(-32768, min(32767, int(math.floor(x * 32768.0 + 0.5))))
+
+
+def main():
+    size = int(sys.argv[1]) if len(sys.argv) > 1 else 1024
+    count = 3 * size // 4
+    out = sys.stdout
+
+    out.write('#ifndef __FFT_TABLE_H__\n#define __FFT_TABLE_H__\n\n')
+    out.write('/* Generated by tools/fft_table.py %d, do not edit. Pairs of cos and sin of '
+              '2 pi k / %d */\n' % (size, size))
+    out.write('#define FFT_TABLE_SIZE                     (%d)\n\n' % size)
+    out.write('static const Q15 FFT_Twiddles[2 * %d] =\n{\n' % count)
+    for k in range(0, count, 4):
+        pairs = []
+        for i in range(k, min(k + 4, count)):
+            a = 2.0 * math.pi * i / size
+            pairs.append('%6d, %6d' % (q15(math.cos(a)), q15(math.sin(a))))
+        out.write('  ' + ', '.join(pairs) + ',\n')
+    out.write('};\n\n#endif /* __FFT_TABLE_H__ */\n')
+
+
+if __name__ == '__main__':
+    main()
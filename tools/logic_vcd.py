@@ -0,0 +1,123 @@
+#!/usr/bin/env python3
+"""Converter of the logic analyzer dump of src/hw/logic.c into a VCD file.
+
+Logic_Print() writes the dump as hex text between "LOGIC <size>" and "END"
+lines; save the SWO output to a file (other lines are skipped) and run
+
+    logic_vcd.py capture.txt capture.vcd
+
+The raw dump, read from RAM with a programmer, is accepted as well. Every
+recorded pin becomes a wire named after it (PB12...), the "trigger" wire
+rises at the trigger sample. Open the result in GTKWave or PulseView.
+"""
+
+import struct
+import sys
+
+MAGIC = 0x43474F4C
+VERSION = 1
+
+HEADER = struct.Struct('<IHHIHHHH')
+RUN = struct.Struct('<HH')
+
+PORTS = 'ABCDEFG'
+
+
+def parse_text(text):
+    """Returns the bytes of the first complete dump in the text."""
+    data = None
+    size = 0
+    for line in text.splitlines():
+        line = line.strip()
+        if data is None:
+            if line.startswith('LOGIC '):
+                size = int(line.split()[1])
+                data = bytearray()
+        elif line == 'END':
+            if len(data) != size:
+                raise ValueError('dump of %d bytes, %d expected' % (len(data), size))
+            return bytes(data)
+        else:
+            data += bytes.fromhex(line)
+    raise ValueError('no complete dump found')
+
+
+def decode(data):
+    """Returns the header fields and the list of (value, count) runs."""
+    if len(data) < HEADER.size:
+        raise ValueError('dump too short')
+    magic, version, runs, rate, mask, port, pre, samples = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError('bad magic 0x%08X' % magic)
+    if version != VERSION:
+        raise ValueError('unsupported version %d' % version)
+    if len(data) < HEADER.size + runs * RUN.size:
+        raise ValueError('%d runs do not fit in %d bytes' % (runs, len(data)))
+    records = [RUN.unpack_from(data, HEADER.size + i * RUN.size) for i in range(runs)]
+    if sum(count for _, count in records) != samples:
+        raise ValueError('runs do not add up to %d samples' % samples)
+    return {'rate': rate, 'mask': mask, 'port': port, 'pre': pre,
+            'samples': samples}, records
+
+
+def write_vcd(out, header, records):
+    port = PORTS[header['port']] if header['port'] < len(PORTS) else '?'
+    pins = [pin for pin in range(16) if header['mask'] & (1 << pin)]
+    codes = dict((pin, chr(ord('!') + i)) for i, pin in enumerate(pins))
+    trigger = chr(ord('!') + len(pins))
+    rate = header['rate']
+
+    def time(sample):
+        return (sample * 10 ** 12 + rate // 2) // rate
+
+    out.write('$comment %d samples at %d Hz, trigger at sample %d $end\n'
+              % (header['samples'], rate, header['pre']))
+    out.write('$timescale 1 ps $end\n')
+    out.write('$scope module logic $end\n')
+    for pin in pins:
+        out.write('$var wire 1 %s P%s%d $end\n' % (codes[pin], port, pin))
+    out.write('$var wire 1 %s trigger $end\n' % trigger)
+    out.write('$upscope $end\n$enddefinitions $end\n')
+
+    sample = 0
+    previous = None
+    for value, count in records:
+        changes = []
+        if sample == 0:
+            changes.append('0%s' % trigger)
+        for pin in pins:
+            bit = (value >> pin) & 1
+            if previous is None or bit != (previous >> pin) & 1:
+                changes.append('%d%s' % (bit, codes[pin]))
+        if sample == header['pre']:
+            changes.append('1%s' % trigger)
+        if changes:
+            out.write('#%d\n%s\n' % (time(sample), '\n'.join(changes)))
+        if sample < header['pre'] < sample + count:
+            # The trigger falls inside the run: a change of its own
+            out.write('#%d\n1%s\n' % (time(header['pre']), trigger))
+        previous = value
+        sample += count
+    out.write('#%d\n' % time(sample))
+
+
+def main(argv):
+    if len(argv) < 3:
+        sys.stderr.write(__doc__)
+        return 1
+    with open(argv[1], 'rb') as f:
+        data = f.read()
+    try:
+        if not data.startswith(struct.pack('<I', MAGIC)):
+            data = parse_text(data.decode('ascii', 'replace'))
+        header, records = decode(data)
+    except ValueError as error:
+        sys.stderr.write('%s\n' % error)
+        return 1
+    with open(argv[2], 'w') as out:
+        write_vcd(out, header, records)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""Generator of the interpolation tables used by src/dsp/fixmath.c.
+
+    math_table.py > src/dsp/fixmath_table.h
+
+Every table has one entry past its range, so the linear interpolation
+between entry i and i + 1 never needs a bounds check.
+"""
+
+import math
+import sys
+
+SEGMENTS = 128
+
+
+def fixed(x, bits, lo, hi):
+    return max(lo, min(hi, int(math.floor(x * (1 << bits) + 0.5))))
+
+
+def table(out, decl, values, per_line, width):
+    out.write('static const %s =\n{\n' % decl)
+    for i in range(0, len(values), per_line):
+        out.write('  ' + ', '.join('%*d' % (width, v) for v in values[i:i + per_line]) + ',\n')
+    out.write('};\n\n')
+
+
+def main():
+    out = sys.stdout
+    n = SEGMENTS
+
+    out.write('#ifndef __FIXMATH_TABLE_H__\n#define __FIXMATH_TABLE_H__\n\n')
+    out.write('/* Generated by tools/math_table.py, do not edit */\n')
+    out.write('#define MATH_SEGMENTS                      (%d)\n\n' % n)
+
+    out.write('/* sin(pi / 2 * i / %d), Q15 */\n' % n)
+    table(out, 'Q15 Math_SinTable[%d + 2]' % n,
+          [fixed(math.sin(math.pi / 2 * i / n), 15, -32768, 32767) for i in range(n + 2)], 10, 6)
+
+    out.write('/* atan(i / %d) in 1/65536 of a turn */\n' % n)
+    table(out, 'U16 Math_AtanTable[%d + 2]' % n,
+          [fixed(math.atan(i / n) / (2 * math.pi), 16, 0, 65535) for i in range(n + 2)], 10, 5)
+
+    out.write('/* log2(1 + i / %d), Q16 */\n' % n)
+    table(out, 'U32 Math_Log2Table[%d + 1]' % n,
+          [fixed(math.log2(1 + i / n), 16, 0, 1 << 16) for i in range(n + 1)], 8, 6)
+
+    out.write('/* 2^(i / %d), Q30 */\n' % n)
+    table(out, 'U32 Math_Exp2Table[%d + 1]' % n,
+          [fixed(2 ** (i / n), 30, 0, 1 << 31) for i in range(n + 1)], 6, 10)
+
+    out.write('/* sqrt(i + 0.5) * 2^14, a first guess from the top 4 bits of a normalized argument */\n')
+    table(out, 'U16 Math_SqrtTable[16]',
+          [fixed(math.sqrt(i + 0.5), 14, 0, 65535) for i in range(16)], 8, 5)
+
+    out.write('#endif /* __FIXMATH_TABLE_H__ */\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Loopback test of the Modbus RTU slave of src/modbus/slave.c.
+
+Connect a USB serial adapter to USART1 (PA9 TX, PA10 RX), or an RS-485
+adapter through a transceiver. Needs pyserial. Run
+
+    modbus_rtu.py PORT [requests] [baudrate]
+
+The map of the slave is exercised first: holding registers and coils are
+written and read back, the exceptions of an address outside the map and of
+an unknown function are checked. Then the turnaround is measured over a
+number of diagnostic echo requests: the time from the end of the request to
+the end of the reply, less the time the reply takes on the line. This
+includes the latency of the adapter (an FTDI chip waits for its latency
+timer, 16 ms by default, 1 ms at best), the slave's own part is read from
+its input registers 10 and 11.
+"""
+
+import random
+import struct
+import sys
+import time
+
+import serial
+
+ADDRESS = 1
+BAUDRATE = 115200
+TIMEOUT_S = 0.5
+
+
+def crc16(data):
+    """CRC of the RTU frames, polynomial 0xA001 reflected, initial value 0xFFFF."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+class Slave:
+    def __init__(self, port, baudrate):
+        self.line = serial.Serial(port, baudrate, parity=serial.PARITY_EVEN,
+                                  timeout=TIMEOUT_S)
+        # 11 bits per character: start, 8 data, parity, stop
+        self.char_s = 11.0 / baudrate
+
+    def request(self, pdu, reply_length):
+        """Sends a PDU, returns the reply PDU and the seconds from the end
+        of the request to the end of the reply."""
+        frame = bytes([ADDRESS]) + pdu
+        frame += struct.pack('<H', crc16(frame))
+        self.line.reset_input_buffer()
+        self.line.write(frame)
+        self.line.flush()
+        sent = time.perf_counter()
+        # An exception reply is 5 bytes, shorter than most replies
+        reply = self.line.read(5)
+        if len(reply) == 5 and not reply[1] & 0x80:
+            reply += self.line.read(reply_length + 3 - 5)
+        elapsed = time.perf_counter() - sent
+        if len(reply) < 5 or crc16(reply) != 0 or reply[0] != ADDRESS:
+            raise IOError('bad reply %s to %s' % (reply.hex(), frame.hex()))
+        return reply[1:-2], elapsed
+
+    def read_registers(self, function, address, count):
+        pdu, _ = self.request(struct.pack('>BHH', function, address, count), 2 + 2 * count)
+        if pdu[0] != function:
+            raise IOError('exception %d' % pdu[1])
+        return list(struct.unpack('>%dH' % count, pdu[2:]))
+
+    def write_registers(self, address, values):
+        pdu = struct.pack('>BHHB', 0x10, address, len(values), 2 * len(values))
+        pdu += struct.pack('>%dH' % len(values), *values)
+        reply, _ = self.request(pdu, 5)
+        return reply == pdu[:5]
+
+    def read_coils(self, address, count):
+        pdu, _ = self.request(struct.pack('>BHH', 0x01, address, count), 2 + (count + 7) // 8)
+        bits = int.from_bytes(pdu[2:], 'little')
+        return [(bits >> i) & 1 for i in range(count)]
+
+    def write_coils(self, address, bits):
+        data = sum(bit << i for i, bit in enumerate(bits)).to_bytes((len(bits) + 7) // 8, 'little')
+        pdu = struct.pack('>BHHB', 0x0F, address, len(bits), len(data)) + data
+        reply, _ = self.request(pdu, 5)
+        return reply == pdu[:5]
+
+    def exception(self, pdu):
+        reply, _ = self.request(pdu, 5)
+        return reply[1] if reply[0] & 0x80 else None
+
+
+def check_map(slave):
+    """Returns the number of failed checks."""
+    failures = 0
+    values = [random.randrange(0x10000) for _ in range(32)]
+    if not slave.write_registers(0, values) or slave.read_registers(0x03, 0, 32) != values:
+        print('holding registers: FAIL')
+        failures += 1
+    bits = [random.randrange(2) for _ in range(16)]
+    if not slave.write_coils(0, bits) or slave.read_coils(0, 16) != bits:
+        print('coils: FAIL')
+        failures += 1
+    if slave.exception(struct.pack('>BHH', 0x03, 30, 4)) != 2:
+        print('illegal data address: FAIL')
+        failures += 1
+    if slave.exception(struct.pack('>BHH', 0x2B, 0, 0)) != 1:
+        print('illegal function: FAIL')
+        failures += 1
+    return failures
+
+
+def measure(slave, requests):
+    """Diagnostic echoes of 8 bytes, returns the turnarounds in seconds."""
+    times = []
+    for i in range(requests):
+        pdu = struct.pack('>BHH', 0x08, 0, i & 0xFFFF)
+        reply, elapsed = slave.request(pdu, len(pdu))
+        if reply != pdu:
+            raise IOError('echo %s of %s' % (reply.hex(), pdu.hex()))
+        times.append(elapsed - (len(pdu) + 3) * slave.char_s)
+    return times
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write(__doc__)
+        return 2
+    requests = int(argv[2]) if len(argv) > 2 else 1000
+    baudrate = int(argv[3]) if len(argv) > 3 else BAUDRATE
+    slave = Slave(argv[1], baudrate)
+
+    failures = check_map(slave)
+    times = measure(slave, requests)
+    times.sort()
+    print('%d requests at %d baud, turnaround min %.3f ms, median %.3f ms, max %.3f ms'
+          % (requests, baudrate, times[0] * 1e3, times[len(times) // 2] * 1e3,
+             times[-1] * 1e3))
+
+    status = slave.read_registers(0x04, 0, 15)
+    counters = [(status[i] << 16) | status[i + 1] for i in range(0, 10, 2)]
+    print('slave: %d requests, %d replies, %d exceptions, %d CRC errors, %d line errors'
+          % tuple(counters))
+    print('slave: turnaround last %d us, longest %d us, clock %d MHz'
+          % (status[10], status[11], status[12]))
+    return 1 if failures or counters[3] or counters[4] else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+"""Throughput test of the vendor bulk interface of src/usb/composite.c.
+
+The firmware (vUSBBulkTask in src/main.c) sends a 32-bit counter on the IN
+endpoint as fast as it is read and drops what comes on the OUT endpoint.
+Needs pyusb and, on Windows, a WinUSB or libusb driver bound to interface 2
+(e.g. with Zadig). Run
+
+    usb_speed.py [seconds]
+
+The IN direction is checked for lost or repeated words, then both
+directions are reported in kB/s.
+"""
+
+import struct
+import sys
+import time
+
+import usb.core
+import usb.util
+
+VID = 0x1209
+PID = 0x0001
+INTERFACE = 2
+EP_IN = 0x84
+EP_OUT = 0x05
+
+# Whole packets per request: the host controller can fill a frame with them
+CHUNK = 64 * 256
+TIMEOUT_MS = 1000
+
+
+def measure_in(dev, seconds):
+    """Returns the kB/s read and the number of counter discontinuities."""
+    expected = None
+    errors = 0
+    total = 0
+    start = time.time()
+    while time.time() - start < seconds:
+        data = bytes(dev.read(EP_IN, CHUNK, TIMEOUT_MS))
+        total += len(data)
+        # A transfer is a whole number of words, the firmware writes words
+        for value in struct.unpack('<%dI' % (len(data) // 4), data[:len(data) & ~3]):
+            if expected is not None and value != expected:
+                errors += 1
+            expected = (value + 1) & 0xFFFFFFFF
+    return total / 1000.0 / (time.time() - start), errors
+
+
+def measure_out(dev, seconds):
+    """Returns the kB/s written."""
+    data = bytes(CHUNK)
+    total = 0
+    start = time.time()
+    while time.time() - start < seconds:
+        total += dev.write(EP_OUT, data, TIMEOUT_MS)
+    return total / 1000.0 / (time.time() - start)
+
+
+def main(argv):
+    seconds = float(argv[1]) if len(argv) > 1 else 5.0
+    dev = usb.core.find(idVendor=VID, idProduct=PID)
+    if dev is None:
+        sys.stderr.write('device %04x:%04x not found\n' % (VID, PID))
+        return 1
+    usb.util.claim_interface(dev, INTERFACE)
+    try:
+        # The words queued before the test started are stale, skip them
+        dev.read(EP_IN, CHUNK, TIMEOUT_MS)
+        rate, errors = measure_in(dev, seconds)
+        print('IN:  %7.1f kB/s, %d counter errors' % (rate, errors))
+        print('OUT: %7.1f kB/s' % measure_out(dev, seconds))
+    finally:
+        usb.util.release_interface(dev, INTERFACE)
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))